@@ -0,0 +1,61 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 23:40
+
+#include "Allocations.hpp"
+#include <cstdlib>
+#include <new>
+
+#if PWS_COUNT_ALLOCATIONS
+
+// constant-initialized, so operator new can use it before any other initialization
+static thread_local uint64_t allocations = 0;
+
+uint64_t threadAllocations() {
+    return allocations;
+}
+
+static void* allocate(std::size_t size) {
+    ++allocations;
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) return nullptr;
+        handler();
+    }
+}
+
+static void* allocateOrThrow(std::size_t size) {
+    if (void* p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+static void* allocateNoThrow(std::size_t size) noexcept {
+    try {
+        return allocate(size);
+    }
+    catch (...) { // from the new handler
+        return nullptr;
+    }
+}
+
+// the aligned forms are left to the library; they come with their own deletes
+void* operator new(std::size_t size) { return allocateOrThrow(size); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocateNoThrow(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#else
+
+uint64_t threadAllocations() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,17 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 23:40
+
+#pragma once
+#include <cstdint>
+
+// heap allocations are counted by a replacement of the global operator new (Allocations.cpp);
+// build with PWS_COUNT_ALLOCATIONS=0 to keep the library's one
+#ifndef PWS_COUNT_ALLOCATIONS
+#define PWS_COUNT_ALLOCATIONS 1
+#endif
+
+// operator new calls made by the calling thread so far (always 0 when not counting).
+// Take the difference around a piece of work to see how much it allocated; memory that
+// libcurl and TBB get straight from malloc is not included.
+uint64_t threadAllocations();
@@ -0,0 +1,448 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 01:20
+
+#include "Analytics.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+static double fieldValue(const BookView& r, RecordField f) {
+    switch (f) {
+    case RecordField::Rating: return r.rating;
+    case RecordField::TitleLength: return static_cast<double>(r.title.size());
+    default: return r.price;
+    }
+}
+
+// ------------------ Query parsing -------------------
+static std::vector<std::string> splitOn(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream in(s);
+    std::string part;
+    while (std::getline(in, part, sep)) parts.push_back(part);
+    return parts;
+}
+
+bool QuerySpec::parse(const std::string& spec, QuerySpec& out, std::string& error) {
+    out = QuerySpec();
+    out.text = spec;
+    std::string body = spec;
+    size_t at = body.find('@');
+    if (at != std::string::npos) {
+        if (body.substr(at + 1) != "rating") {
+            error = "only @rating groups";
+            return false;
+        }
+        out.byRating = true;
+        body.resize(at);
+    }
+    std::vector<std::string> p = splitOn(body, ':');
+    if (p.empty()) {
+        error = "empty query";
+        return false;
+    }
+    if (p.size() > 1) {
+        if (p[1] == "price") out.field = RecordField::Price;
+        else if (p[1] == "rating") out.field = RecordField::Rating;
+        else if (p[1] == "title_len") out.field = RecordField::TitleLength;
+        else {
+            error = "unknown field " + p[1];
+            return false;
+        }
+    }
+    try {
+        if (p[0] == "count" && p.size() == 1) out.kind = Kind::Count;
+        else if (p[0] == "sum" && p.size() == 2) out.kind = Kind::Sum;
+        else if (p[0] == "hist" && p.size() == 5) {
+            out.kind = Kind::Histogram;
+            out.lo = std::stod(p[2]);
+            out.hi = std::stod(p[3]);
+            out.buckets = std::stoul(p[4]);
+            if (out.buckets == 0 || !(out.hi > out.lo)) {
+                error = "hist needs LO < HI and at least one bucket";
+                return false;
+            }
+        }
+        else if (p[0] == "top" && p.size() == 3) {
+            out.kind = Kind::TopK;
+            out.k = std::stoul(p[2]);
+            if (out.k == 0) {
+                error = "top needs K > 0";
+                return false;
+            }
+        }
+        else if (p[0] == "quantiles" && (p.size() == 2 || p.size() == 3)) {
+            out.kind = Kind::Quantiles;
+            if (p.size() == 3) {
+                for (const auto& q : splitOn(p[2], ',')) out.quantiles.push_back(std::stod(q));
+            }
+            else out.quantiles = { 0.5, 0.9, 0.99 };
+            for (double q : out.quantiles) {
+                if (q < 0.0 || q > 1.0) {
+                    error = "quantiles must lie in [0, 1]";
+                    return false;
+                }
+            }
+        }
+        else {
+            error = "expected count, sum:F, hist:F:LO:HI:N, top:F:K or quantiles:F[:Q,...]";
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        error = "bad number";
+        return false;
+    }
+    return true;
+}
+
+// ------------------ Aggregators -------------------
+class CountAggregator : public Aggregator {
+public:
+    void add(const BookView&) override { ++n; }
+    void merge(const Aggregator& other) override { n += static_cast<const CountAggregator&>(other).n; }
+    void write(std::ostream& out) const override { out << n << "\n"; }
+    size_t memoryBytes() const override { return sizeof(*this); }
+
+private:
+    uint64_t n = 0;
+};
+
+class SumAggregator : public Aggregator {
+public:
+    explicit SumAggregator(RecordField f) : field(f) {}
+    void add(const BookView& r) override {
+        double v = fieldValue(r, field);
+        ++n;
+        sum += v;
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+    void merge(const Aggregator& other) override {
+        const auto& o = static_cast<const SumAggregator&>(other);
+        n += o.n;
+        sum += o.sum;
+        lo = std::min(lo, o.lo);
+        hi = std::max(hi, o.hi);
+    }
+    void write(std::ostream& out) const override {
+        out << "sum " << sum << ", mean " << (n ? sum / n : 0.0);
+        if (n) out << ", min " << lo << ", max " << hi;
+        out << " (" << n << " records)\n";
+    }
+    size_t memoryBytes() const override { return sizeof(*this); }
+
+private:
+    RecordField field;
+    uint64_t n = 0;
+    double sum = 0.0;
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -std::numeric_limits<double>::infinity();
+};
+
+class HistogramAggregator : public Aggregator {
+public:
+    HistogramAggregator(RecordField f, double lo, double hi, size_t buckets)
+        : field(f), lo(lo), width((hi - lo) / buckets), counts(buckets + 2, 0) {}
+    void add(const BookView& r) override {
+        double v = fieldValue(r, field);
+        size_t buckets = counts.size() - 2;
+        double pos = (v - lo) / width;
+        if (v < lo) ++counts[0];
+        else if (pos < static_cast<double>(buckets)) ++counts[static_cast<size_t>(pos) + 1];
+        else ++counts[buckets + 1]; // NaN ends up above as well
+    }
+    void merge(const Aggregator& other) override {
+        const auto& o = static_cast<const HistogramAggregator&>(other);
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += o.counts[i];
+    }
+    void write(std::ostream& out) const override {
+        size_t buckets = counts.size() - 2;
+        out << "below " << lo << ": " << counts[0] << "\n";
+        for (size_t b = 0; b < buckets; ++b)
+            out << "[" << lo + b * width << ", " << lo + (b + 1) * width << "): " << counts[b + 1] << "\n";
+        out << "from " << lo + buckets * width << ": " << counts[buckets + 1] << "\n";
+    }
+    size_t memoryBytes() const override { return sizeof(*this) + counts.capacity() * sizeof(uint64_t); }
+
+private:
+    RecordField field;
+    double lo;
+    double width;
+    std::vector<uint64_t> counts; // below, buckets..., above
+};
+
+// min-heap of the k largest values seen; the smallest kept value is replaced first
+class TopKAggregator : public Aggregator {
+public:
+    TopKAggregator(RecordField f, size_t k) : field(f), k(k) { heap.reserve(k); }
+    void add(const BookView& r) override { offer(fieldValue(r, field), r.title); }
+    void merge(const Aggregator& other) override {
+        for (const auto& e : static_cast<const TopKAggregator&>(other).heap) offer(e.first, e.second);
+    }
+    void write(std::ostream& out) const override {
+        std::vector<Entry> sorted(heap);
+        std::sort(sorted.begin(), sorted.end(), after);
+        for (size_t i = 0; i < sorted.size(); ++i) out << i + 1 << ". " << sorted[i].second << " (" << sorted[i].first << ")\n";
+    }
+    size_t memoryBytes() const override {
+        size_t bytes = sizeof(*this) + heap.capacity() * sizeof(Entry);
+        for (const auto& e : heap) bytes += e.second.capacity();
+        return bytes;
+    }
+
+private:
+    using Entry = std::pair<double, std::string>;
+    RecordField field;
+    size_t k;
+    std::vector<Entry> heap;
+
+    // larger value first, ties by title so merges in any order keep the same records
+    static bool after(const Entry& a, const Entry& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    }
+    void offer(double v, std::string_view title) {
+        if (heap.size() == k) {
+            const Entry& least = heap.front();
+            if (v < least.first || (v == least.first && title >= least.second)) return;
+            std::pop_heap(heap.begin(), heap.end(), after);
+            heap.back().first = v;
+            heap.back().second.assign(title.data(), title.size()); // reuses the evicted string
+        }
+        else heap.emplace_back(v, std::string(title));
+        std::push_heap(heap.begin(), heap.end(), after);
+    }
+};
+
+// Merging t-digest (Dunning): values are buffered and periodically merged into centroids
+// whose weight is limited to 4 * n * q(1 - q) / compression, so the tails stay exact-ish
+// and about 2 * compression centroids are kept whatever the number of values.
+class QuantileAggregator : public Aggregator {
+public:
+    QuantileAggregator(RecordField f, std::vector<double> qs, double compression = 100.0)
+        : field(f), quantiles(std::move(qs)), compression(compression) {}
+    void add(const BookView& r) override {
+        double v = fieldValue(r, field);
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+        pending.push_back({ v, 1.0 });
+        if (pending.size() >= bufferLimit()) compress();
+    }
+    void merge(const Aggregator& other) override {
+        const auto& o = static_cast<const QuantileAggregator&>(other);
+        lo = std::min(lo, o.lo);
+        hi = std::max(hi, o.hi);
+        pending.insert(pending.end(), o.centroids.begin(), o.centroids.end());
+        pending.insert(pending.end(), o.pending.begin(), o.pending.end());
+        compress();
+    }
+    void write(std::ostream& out) const override {
+        QuantileAggregator copy(*this); // quantile() compresses
+        for (size_t i = 0; i < quantiles.size(); ++i)
+            out << (i ? ", " : "") << "q" << quantiles[i] << " " << copy.quantile(quantiles[i]);
+        out << " (" << copy.centroids.size() << " centroids)\n";
+    }
+    size_t memoryBytes() const override {
+        return sizeof(*this) + (centroids.capacity() + pending.capacity()) * sizeof(Centroid);
+    }
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+    RecordField field;
+    std::vector<double> quantiles;
+    double compression;
+    std::vector<Centroid> centroids; // sorted by mean
+    std::vector<Centroid> pending;
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -std::numeric_limits<double>::infinity();
+
+    size_t bufferLimit() const { return static_cast<size_t>(5 * compression); }
+
+    void compress() {
+        if (pending.empty()) return;
+        pending.insert(pending.end(), centroids.begin(), centroids.end());
+        std::sort(pending.begin(), pending.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+        double total = 0.0;
+        for (const auto& c : pending) total += c.weight;
+        centroids.clear();
+        Centroid cur = pending.front();
+        double before = 0.0; // weight left of cur
+        for (size_t i = 1; i < pending.size(); ++i) {
+            const Centroid& next = pending[i];
+            double q0 = before / total;
+            double q2 = (before + cur.weight + next.weight) / total;
+            double limit = 4.0 * total * std::min(q0 * (1 - q0), q2 * (1 - q2)) / compression;
+            if (cur.weight + next.weight <= limit) {
+                cur.mean += (next.mean - cur.mean) * next.weight / (cur.weight + next.weight);
+                cur.weight += next.weight;
+            }
+            else {
+                before += cur.weight;
+                centroids.push_back(cur);
+                cur = next;
+            }
+        }
+        centroids.push_back(cur);
+        pending.clear();
+    }
+
+    // interpolates between centroid centres; the extremes are exact
+    double quantile(double q) {
+        compress();
+        if (centroids.empty()) return std::numeric_limits<double>::quiet_NaN();
+        if (centroids.size() == 1) return centroids.front().mean;
+        double total = 0.0;
+        for (const auto& c : centroids) total += c.weight;
+        double target = q * total;
+        const Centroid& first = centroids.front();
+        if (target < first.weight / 2) return lo + (first.mean - lo) * target / (first.weight / 2);
+        double cum = first.weight / 2;
+        for (size_t i = 0; i + 1 < centroids.size(); ++i) {
+            double gap = (centroids[i].weight + centroids[i + 1].weight) / 2;
+            if (cum + gap >= target) {
+                double t = (target - cum) / gap;
+                return centroids[i].mean + t * (centroids[i + 1].mean - centroids[i].mean);
+            }
+            cum += gap;
+        }
+        const Centroid& last = centroids.back();
+        double rest = last.weight / 2;
+        double t = rest > 0 ? std::min(1.0, (target - cum) / rest) : 1.0;
+        return last.mean + t * (hi - last.mean);
+    }
+};
+
+// one state of the query per star rating (0 = unrated, ratings above 5 share the last)
+class RatingGroups : public Aggregator {
+public:
+    explicit RatingGroups(const QuerySpec& spec) {
+        QuerySpec single = spec;
+        single.byRating = false;
+        for (auto& g : groups) g = Aggregator::create(single);
+    }
+    void add(const BookView& r) override {
+        groups[static_cast<size_t>(std::clamp(r.rating, 0, 5))]->add(r);
+        seen[static_cast<size_t>(std::clamp(r.rating, 0, 5))] = true;
+    }
+    void merge(const Aggregator& other) override {
+        const auto& o = static_cast<const RatingGroups&>(other);
+        for (size_t i = 0; i < groups.size(); ++i) {
+            groups[i]->merge(*o.groups[i]);
+            seen[i] = seen[i] || o.seen[i];
+        }
+    }
+    void write(std::ostream& out) const override {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            if (!seen[i]) continue;
+            out << "rating " << i << ":\n";
+            groups[i]->write(out);
+        }
+    }
+    size_t memoryBytes() const override {
+        size_t bytes = sizeof(*this);
+        for (const auto& g : groups) bytes += g->memoryBytes();
+        return bytes;
+    }
+
+private:
+    std::array<std::unique_ptr<Aggregator>, 6> groups;
+    std::array<bool, 6> seen{};
+};
+
+std::unique_ptr<Aggregator> Aggregator::create(const QuerySpec& spec) {
+    if (spec.byRating) return std::make_unique<RatingGroups>(spec);
+    switch (spec.kind) {
+    case QuerySpec::Kind::Sum: return std::make_unique<SumAggregator>(spec.field);
+    case QuerySpec::Kind::Histogram: return std::make_unique<HistogramAggregator>(spec.field, spec.lo, spec.hi, spec.buckets);
+    case QuerySpec::Kind::TopK: return std::make_unique<TopKAggregator>(spec.field, spec.k);
+    case QuerySpec::Kind::Quantiles: return std::make_unique<QuantileAggregator>(spec.field, spec.quantiles);
+    default: return std::make_unique<CountAggregator>();
+    }
+}
+
+// ------------------ State and engine -------------------
+AnalyticsState::AnalyticsState(const std::vector<QuerySpec>& queries) {
+    aggregators.reserve(queries.size());
+    for (const auto& q : queries) aggregators.push_back(Aggregator::create(q));
+}
+
+void AnalyticsState::add(const BookView& r) {
+    for (auto& a : aggregators) a->add(r);
+}
+
+void AnalyticsState::merge(const AnalyticsState& other) {
+    for (size_t i = 0; i < aggregators.size() && i < other.aggregators.size(); ++i)
+        aggregators[i]->merge(*other.aggregators[i]);
+}
+
+void AnalyticsState::write(std::ostream& out, const std::vector<QuerySpec>& queries) const {
+    for (size_t i = 0; i < aggregators.size() && i < queries.size(); ++i) {
+        out << queries[i].text << ":\n";
+        aggregators[i]->write(out);
+    }
+}
+
+size_t AnalyticsState::memoryBytes() const {
+    size_t bytes = sizeof(*this);
+    for (const auto& a : aggregators) bytes += a->memoryBytes();
+    return bytes;
+}
+
+AnalyticsEngine::AnalyticsEngine(std::vector<QuerySpec> queries)
+    : specs(std::move(queries)), partials([this] { return AnalyticsState(specs); }) {
+}
+
+void AnalyticsEngine::add(const std::vector<BookView>& page) {
+    if (page.empty()) return;
+    AnalyticsState& local = partials.local(); // no lock: each thread updates its own state
+    for (const auto& r : page) local.add(r);
+}
+
+void AnalyticsEngine::add(const std::vector<BookRecord>& page) {
+    if (page.empty()) return;
+    AnalyticsState& local = partials.local();
+    for (const auto& r : page) local.add(BookView{ r.title, r.price, r.rating });
+}
+
+AnalyticsState AnalyticsEngine::result() const {
+    AnalyticsState total(specs);
+    partials.combine_each([&total](const AnalyticsState& s) { total.merge(s); });
+    return total;
+}
+
+size_t AnalyticsEngine::partialBytes() const {
+    size_t most = 0;
+    partials.combine_each([&most](const AnalyticsState& s) { most = std::max(most, s.memoryBytes()); });
+    return most;
+}
+
+// ------------------ Offline aggregation -------------------
+namespace {
+struct StoreAggregation {
+    const std::vector<QuerySpec>& queries;
+    const RecordStore& store;
+    AnalyticsState state;
+
+    StoreAggregation(const std::vector<QuerySpec>& q, const RecordStore& s) : queries(q), store(s), state(q) {}
+    StoreAggregation(StoreAggregation& other, tbb::split) : queries(other.queries), store(other.store), state(other.queries) {}
+    void operator()(const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) state.add(store.at(i));
+    }
+    void join(StoreAggregation& rhs) { state.merge(rhs.state); }
+};
+}
+
+AnalyticsState aggregateRecords(const std::vector<QuerySpec>& queries, const RecordStore& store) {
+    StoreAggregation body(queries, store);
+    tbb::parallel_reduce(tbb::blocked_range<size_t>(0, store.size(), 4096), body);
+    return std::move(body.state);
+}
@@ -0,0 +1,97 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 01:20
+
+#pragma once
+#include "Common.hpp"
+#include "RecordStore.hpp"
+
+#include <tbb/combinable.h>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class RecordField { Price, Rating, TitleLength };
+
+// One analytics query, declared on the command line as KIND[:FIELD[:ARGS]][@rating]:
+//   count                        records
+//   sum:FIELD                    sum, mean, min and max
+//   hist:FIELD:LO:HI:BUCKETS     fixed-width buckets over [LO, HI), plus below/above
+//   top:FIELD:K                  the K records with the largest FIELD (title shown)
+//   quantiles:FIELD[:Q,Q,...]    t-digest estimates (default 0.5,0.9,0.99)
+// FIELD is price, rating or title_len; "@rating" answers the query once per star rating.
+struct QuerySpec {
+    enum class Kind { Count, Sum, Histogram, TopK, Quantiles };
+    Kind kind = Kind::Count;
+    RecordField field = RecordField::Price;
+    bool byRating = false;
+    double lo = 0.0;
+    double hi = 0.0;
+    size_t buckets = 0;
+    size_t k = 0;
+    std::vector<double> quantiles;
+    std::string text; // as declared
+
+    // false (with a reason in error) when spec is not a valid query
+    static bool parse(const std::string& spec, QuerySpec& out, std::string& error);
+};
+
+// Mergeable state of one query: add() takes records, merge() takes the state of the same
+// query over other records, and merging in any order gives the same answer (up to the
+// t-digest's approximation and the order of ties in a top-K). Memory is bounded by the
+// query, not by the number of records.
+class Aggregator {
+public:
+    virtual ~Aggregator() = default;
+    virtual void add(const BookView& r) = 0;
+    virtual void merge(const Aggregator& other) = 0;
+    // the answer, one or more lines
+    virtual void write(std::ostream& out) const = 0;
+    virtual size_t memoryBytes() const = 0;
+
+    static std::unique_ptr<Aggregator> create(const QuerySpec& spec);
+};
+
+// the states of every declared query
+class AnalyticsState {
+public:
+    AnalyticsState() = default;
+    explicit AnalyticsState(const std::vector<QuerySpec>& queries);
+    AnalyticsState(AnalyticsState&&) = default;
+    AnalyticsState& operator=(AnalyticsState&&) = default;
+
+    void add(const BookView& r);
+    // other must have been built from the same queries
+    void merge(const AnalyticsState& other);
+    void write(std::ostream& out, const std::vector<QuerySpec>& queries) const;
+    size_t memoryBytes() const;
+
+private:
+    std::vector<std::unique_ptr<Aggregator>> aggregators;
+};
+
+// Answers the declared queries while records are stored: each thread adds a page's records
+// to its own partial state (no lock), and result() merges the partials.
+class AnalyticsEngine {
+public:
+    explicit AnalyticsEngine(std::vector<QuerySpec> queries);
+    AnalyticsEngine(const AnalyticsEngine&) = delete;
+    AnalyticsEngine& operator=(const AnalyticsEngine&) = delete;
+
+    // thread-safe
+    void add(const std::vector<BookView>& page);
+    void add(const std::vector<BookRecord>& page);
+    AnalyticsState result() const;
+    // largest partial state, to show that memory does not follow the record count
+    size_t partialBytes() const;
+    const std::vector<QuerySpec>& queries() const { return specs; }
+
+private:
+    std::vector<QuerySpec> specs;
+    mutable tbb::combinable<AnalyticsState> partials;
+};
+
+// the same queries over a whole store in one parallel_reduce (split states merged pairwise)
+AnalyticsState aggregateRecords(const std::vector<QuerySpec>& queries, const RecordStore& store);
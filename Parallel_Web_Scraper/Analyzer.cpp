@@ -1,13 +1,17 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 12:53
+// Date and time of the last changes: 18.10.2026. 00:40
 
 #include "Analyzer.hpp"
-#include <regex>
+#include "Log.hpp"
+#include "ParseCache.hpp"
+#include "ByteScan.hpp"
+#include "HtmlEntityTable.hpp"
 #include <algorithm>
-#include <unordered_map>
-#include <sstream>
-#include <iostream>
+#include <charconv>
+#include <cstdint>
+
+static constexpr size_t npos = std::string_view::npos;
 
 void AnalysisResult::mergeFrom(const AnalysisResult& other) {
     fiveStarBooks += other.fiveStarBooks;
@@ -21,7 +25,7 @@ void AnalysisResult::mergeFrom(const AnalysisResult& other) {
     }
 }
 
-static int ratingStringToInt(const std::string& r) {
+static int ratingStringToInt(std::string_view r) {
     if (r == "One") return 1;
     if (r == "Two") return 2;
     if (r == "Three") return 3;
@@ -30,8 +34,7 @@ static int ratingStringToInt(const std::string& r) {
     return 0;
 }
 
-static std::string codepointToUtf8(int cp) {
-    std::string out;
+static void appendUtf8(std::string& out, uint32_t cp) {
     if (cp <= 0x7F) out.push_back((char)cp);
     else if (cp <= 0x7FF) {
         out.push_back((char)(0xC0 | (cp >> 6)));
@@ -48,110 +51,372 @@ static std::string codepointToUtf8(int cp) {
         out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
         out.push_back((char)(0x80 | (cp & 0x3F)));
     }
-    return out;
 }
 
-static std::string decodeHtmlEntities(const std::string& text) {
-    std::string result = text;
-    static std::unordered_map<std::string, std::string> entities;
-    if (entities.empty()) {
-        entities["&quot;"] = "\"";
-        entities["&apos;"] = "'";
-        entities["&amp;"] = "&";
-        entities["&pound;"] = "£";
-        entities["&lt;"] = "<";
-        entities["&gt;"] = ">";
-        entities["&nbsp;"] = " ";
-        entities["&#39;"] = "'";
-        entities["&rsquo;"] = "'";
-        entities["&ldquo;"] = "\"";
-        entities["&rdquo;"] = "\"";
-        entities["&hellip;"] = "…";
-    }
-    for (auto it = entities.begin(); it != entities.end(); ++it) {
-        const std::string& entity = it->first;
-        const std::string& chr = it->second;
-        size_t pos = 0;
-        while ((pos = result.find(entity, pos)) != std::string::npos) {
-            result.replace(pos, entity.size(), chr);
-            pos += chr.size();
+static inline bool isAsciiAlnum(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode the character reference starting at text[amp] == '&' into out.
+// Returns the number of input bytes consumed, or 0 when it is not a complete reference.
+static size_t decodeReferenceAt(std::string_view text, size_t amp, std::string& out) {
+    const size_t n = text.size();
+    size_t i = amp + 1;
+    if (i < n && text[i] == '#') {
+        // &#123; or &#x1F;
+        bool hex = (i + 1 < n && (text[i + 1] == 'x' || text[i + 1] == 'X'));
+        i += hex ? 2 : 1;
+        size_t digitsBegin = i;
+        uint32_t cp = 0;
+        for (; i < n; ++i) {
+            int d = hex ? hexValue(text[i]) : (text[i] >= '0' && text[i] <= '9' ? text[i] - '0' : -1);
+            if (d < 0) break;
+            if (cp <= 0x10FFFF) cp = cp * (hex ? 16 : 10) + static_cast<uint32_t>(d);
         }
+        if (i == digitsBegin || i >= n || text[i] != ';') return 0;
+        if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+        appendUtf8(out, cp);
+        return i + 1 - amp;
     }
-    std::regex decimalEntityRe("&#([0-9]+);");
-    std::smatch m;
-    while (std::regex_search(result, m, decimalEntityRe)) {
-        int code = std::stoi(m[1].str());
-        std::string utf8 = codepointToUtf8(code);
-        result.replace(m.position(0), m.length(0), utf8);
+
+    // &name;
+    size_t nameBegin = i;
+    while (i < n && i - nameBegin <= kHtmlEntityMaxName && isAsciiAlnum(text[i])) ++i;
+    if (i >= n || text[i] != ';') return 0;
+    const HtmlEntity* entity = findHtmlEntity(text.substr(nameBegin, i - nameBegin));
+    if (!entity) return 0;
+    out.append(entity->value.data(), entity->value.size());
+    return i + 1 - amp;
+}
+
+std::string_view decodeHtmlEntities(std::string_view text, std::string& scratch) {
+    size_t amp = scanFindByte(text, '&');
+    if (amp == npos) return text;
+
+    scratch.clear();
+    scratch.reserve(text.size());
+    size_t copied = 0;
+    while (amp != npos) {
+        scratch.append(text.data() + copied, amp - copied);
+        size_t consumed = decodeReferenceAt(text, amp, scratch);
+        if (consumed == 0) {
+            scratch.push_back('&');
+            consumed = 1;
+        }
+        copied = amp + consumed;
+        amp = scanFindByte(text, '&', copied);
     }
+    scratch.append(text.data() + copied, text.size() - copied);
+    return scratch;
+}
+
+std::string decodeHtmlEntities(const std::string& text) {
+    std::string scratch;
+    std::string_view decoded = decodeHtmlEntities(text, scratch);
+    if (decoded.data() == scratch.data()) return scratch;
+    return text;
+}
+
+static inline bool isRegexSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static inline bool isAsciiAlpha(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
 
-    std::regex hexEntityRe("&#x([0-9A-Fa-f]+);");
-    while (std::regex_search(result, m, hexEntityRe)) {
-        int code = std::stoi(m[1].str(), nullptr, 16);
-        std::string utf8 = codepointToUtf8(code);
-        result.replace(m.position(0), m.length(0), utf8);
+// true when one of the class="..." attributes of an opening tag lists product_pod
+static bool hasProductPodClass(std::string_view tag) {
+    size_t pos = 0;
+    while ((pos = scanFindNoCase(tag, "class=\"", pos)) != npos) {
+        size_t valueBegin = pos + 7;
+        size_t valueEnd = scanFindByte(tag, '"', valueBegin);
+        if (valueEnd == npos) return false;
+        if (scanFindNoCase(tag.substr(valueBegin, valueEnd - valueBegin), "product_pod") != npos)
+            return true;
+        pos = valueEnd + 1;
     }
+    return false;
+}
+
+// fields of one product_pod article
+struct ArticleFields {
+    std::string_view title;
+    std::string_view rating;
+    double price = 0.0;
+    bool hasTitle = false;
+    bool hasPrice = false;
+    bool hasRating = false;
+    bool hasPoem = false;
+};
+
+// title="<non-empty value>"
+static bool readTitle(std::string_view block, size_t at, std::string_view& title) {
+    size_t end = scanFindByte(block, '"', at + 7);
+    if (end == npos || end == at + 7) return false;
+    title = block.substr(at + 7, end - at - 7);
+    return true;
+}
 
-    return result;
+// £ (U+00A3) followed by digits, a dot and two decimals
+static bool readPrice(std::string_view block, size_t at, double& price) {
+    const size_t n = block.size();
+    size_t j = at + 2;
+    while (j < n && isDigit(block[j])) ++j;
+    if (j == at + 2 || j + 2 >= n || block[j] != '.' || !isDigit(block[j + 1]) || !isDigit(block[j + 2]))
+        return false;
+    std::from_chars(block.data() + at + 2, block.data() + j + 3, price);
+    return true;
 }
 
-std::pair<std::vector<BookRecord>, AnalysisResult> Analyzer::parsePageRecords(const std::string& html) {
-    AnalysisResult res;
-    std::vector<BookRecord> records;
+// star-rating <Word>
+static bool readRating(std::string_view block, size_t at, std::string_view& word) {
+    const size_t n = block.size();
+    size_t j = at + 11;
+    while (j < n && isRegexSpace(block[j])) ++j;
+    size_t wordBegin = j;
+    while (j < n && isAsciiAlpha(block[j])) ++j;
+    if (wordBegin == at + 11 || j == wordBegin) return false;
+    word = block.substr(wordBegin, j - wordBegin);
+    return true;
+}
 
-    std::cout << "[Analyzer] parsing HTML length=" << html.size() << "\n";
+static ArticleFields scanArticle(std::string_view block) {
+    // one vectorized pass finds the first hit of every keyword; a hit that does not
+    // parse (empty title, malformed price) continues the search past it
+    static const KeywordMatcher keywords{ "title=\"", "\xC2\xA3", "star-rating", "poem" };
+    size_t first[4];
+    keywords.findFirst(block, first);
 
-    std::string htmlOneLine = html;
-    std::replace(htmlOneLine.begin(), htmlOneLine.end(), '\n', ' ');
-    std::regex articleRe(R"(<article[^>]*class="[^"]*product_pod[^"]*"[^>]*>.*?</article>)", std::regex::icase);
-    std::sregex_iterator it(htmlOneLine.begin(), htmlOneLine.end(), articleRe);
-    std::sregex_iterator end;
+    ArticleFields f;
+    for (size_t at = first[0]; at != npos && !f.hasTitle; at = scanFindNoCase(block, "title=\"", at + 1))
+        f.hasTitle = readTitle(block, at, f.title);
+    for (size_t at = first[1]; at != npos && !f.hasPrice; at = scanFindNoCase(block, "\xC2\xA3", at + 1))
+        f.hasPrice = readPrice(block, at, f.price);
+    for (size_t at = first[2]; at != npos && !f.hasRating; at = scanFindNoCase(block, "star-rating", at + 1))
+        f.hasRating = readRating(block, at, f.rating);
+    f.hasPoem = first[3] != npos;
+    return f;
+}
 
-    std::regex titleRe("title=\"([^\"]+)\"", std::regex::icase);
-    std::regex priceRe(R"((?:£|\xC2\xA3)([0-9]+(?:\.[0-9]{2})))", std::regex::icase);
-    std::regex ratingRe(R"(star-rating\s+([A-Za-z]+))", std::regex::icase);
+std::pair<std::vector<BookRecord>, AnalysisResult> Analyzer::parsePageRecords(std::string_view html) {
+    PageParser parser;
+    parsePage(html, parser);
+    return parser.finish();
+}
 
-    for (; it != end; ++it) {
-        std::string block = it->str();
-        std::smatch m;
+void Analyzer::parsePage(std::string_view html, PageParser& parser) {
+    ParseCache::Key key;
+    if (cache) {
+        key = cache->key(html);
+        if (cache->lookup(key, parser)) return;
+    }
+    LOG_DEBUG("Analyzer", "parsing HTML length={}", html.size());
+    parser.reset();
+    parser.feed(html);
+    if (cache) cache->insert(key, parser);
+}
 
-        BookRecord br;
-        br.title = "UNKNOWN";
-        if (std::regex_search(block, m, titleRe)) {
-            br.title = decodeHtmlEntities(m[1].str());
+std::vector<std::string> Analyzer::extractLinks(std::string_view html) {
+    LinkExtractor links;
+    links.feed(html);
+    return links.takeLinks();
+}
+
+void Analyzer::extractLinks(std::string_view html, LinkExtractor& extractor, std::vector<std::string>& links) {
+    extractor.reset();
+    extractor.feed(html);
+    extractor.takeLinks(links);
+}
+
+// ------------------ PageParser -------------------
+PageParser::PageParser(RecordCallback onRecord)
+    : onRecord(std::move(onRecord)) {
+}
+
+void PageParser::feed(std::string_view chunk) {
+    fedBytes += chunk.size();
+    if (window.empty()) {
+        // common case: parse straight out of the chunk and keep only the unfinished tail
+        size_t keep = consume(chunk);
+        window.assign(chunk.data() + keep, chunk.size() - keep);
+    }
+    else {
+        window.append(chunk.data(), chunk.size());
+        size_t keep = consume(window);
+        window.erase(0, keep);
+    }
+    if (window.size() > peakWindow) peakWindow = window.size();
+}
+
+std::pair<std::vector<BookRecord>, AnalysisResult> PageParser::finish() {
+    // whatever is left in the window never closed an article, exactly like a whole-page scan
+    std::pair<std::vector<BookRecord>, AnalysisResult> out;
+    out.first.reserve(records.size());
+    for (const auto& r : records) out.first.push_back(BookRecord{ std::string(r.title), r.price, r.rating });
+    out.second = result;
+    reset();
+    return out;
+}
+
+void PageParser::restore(const std::vector<BookView>& recs, const AnalysisResult& res, size_t fed_bytes) {
+    reset();
+    records.reserve(recs.size());
+    for (const auto& r : recs) {
+        records.push_back(BookView{ titles.store(r.title), r.price, r.rating });
+        if (onRecord) onRecord(records.back());
+    }
+    result = res; // keeps maxPriceTitle's capacity
+    fedBytes = fed_bytes;
+}
+
+void PageParser::reset() {
+    window.clear();
+    records.clear();
+    titles.reset();
+    std::string maxTitle = std::move(result.maxPriceTitle); // keeps its capacity
+    maxTitle.clear();
+    result = AnalysisResult();
+    result.maxPriceTitle = std::move(maxTitle);
+    fedBytes = 0;
+}
+
+// Parses every complete product_pod article in text; returns the offset of the first byte
+// that has to be kept because an article (or the "<article" marker itself) may continue
+// in the next chunk.
+size_t PageParser::consume(std::string_view text) {
+    static constexpr size_t markerTail = 7; // strlen("<article") - 1
+
+    // <article ... class="... product_pod ..." ...> ... </article>
+    size_t pos = 0;
+    while (true) {
+        size_t start = scanFindNoCase(text, "<article", pos);
+        if (start == npos)
+            return std::max(pos, text.size() > markerTail ? text.size() - markerTail : 0);
+        size_t tagEnd = scanFindByte(text, '>', start + 8);
+        if (tagEnd == npos) return start;
+        if (!hasProductPodClass(text.substr(start + 8, tagEnd - start - 8))) {
+            pos = start + 8;
+            continue;
         }
+        size_t close = scanFindNoCase(text, "</article>", tagEnd + 1);
+        if (close == npos) return start;
+
+        emitArticle(text.substr(start, close + 10 - start));
+        pos = close + 10;
+    }
+}
+
+void PageParser::emitArticle(std::string_view block) {
+    ArticleFields f = scanArticle(block);
 
-        double price = 0.0;
-        if (std::regex_search(block, m, priceRe)) {
-            try { price = std::stod(m[1].str()); }
-            catch (...) { price = 0.0; }
+    BookView br;
+    br.title = "UNKNOWN";
+    if (f.hasTitle) {
+        std::string_view title = f.title;
+        if (scanFindByte(title, '\n') != npos) { // titles are reported on one line
+            unwrapped.assign(title.data(), title.size());
+            std::replace(unwrapped.begin(), unwrapped.end(), '\n', ' ');
+            title = unwrapped;
         }
-        br.price = price;
+        // the block is dropped with the chunk or window it came from; the arena keeps the title
+        br.title = titles.store(decodeHtmlEntities(title, scratch));
+    }
+    double price = f.price;
+    br.price = price;
+    int rating = f.hasRating ? ratingStringToInt(f.rating) : 0;
+    br.rating = rating;
+    bool hasPoem = f.hasPoem;
+
+    // aggregate
+    AnalysisResult& res = result;
+    res.bookCount += 1;
+    res.totalPrice += price;
+    if (rating == 5) res.fiveStarBooks += 1;
+    if (price > 50.0) res.priceOver50 += 1;
+    if (hasPoem) res.containsPoem += 1;
+    if (price > res.maxPrice) {
+        res.maxPrice = price;
+        res.maxPriceTitle.assign(br.title.data(), br.title.size());
+    }
 
-        int rating = 0;
-        if (std::regex_search(block, m, ratingRe)) {
-            rating = ratingStringToInt(m[1].str());
+    LOG_DEBUG("Analyzer", "Book: {} {} GBP rating={}", br.title, price, rating);
+    if (onRecord) onRecord(br);
+    records.push_back(br);
+}
+
+// ------------------ LinkExtractor -------------------
+void LinkExtractor::feed(std::string_view chunk) {
+    if (window.empty()) {
+        size_t keep = consume(chunk);
+        window.assign(chunk.data() + keep, chunk.size() - keep);
+    }
+    else {
+        window.append(chunk.data(), chunk.size());
+        size_t keep = consume(window);
+        window.erase(0, keep);
+    }
+}
+
+std::vector<std::string> LinkExtractor::takeLinks() {
+    std::vector<std::string> out;
+    out.swap(links);
+    return out;
+}
+
+void LinkExtractor::takeLinks(std::vector<std::string>& out) {
+    out.clear();
+    out.swap(links); // links keeps out's old buffer
+}
+
+void LinkExtractor::reset() {
+    window.clear();
+    links.clear();
+}
+
+// href="..." | href='...' | href=value; returns the offset of the first byte to keep
+size_t LinkExtractor::consume(std::string_view text) {
+    static constexpr size_t markerTail = 4;     // strlen("href=") - 1
+    static constexpr size_t maxPending = 8192;  // an attribute longer than this is not a link we follow
+
+    size_t pos = 0;
+    while (true) {
+        size_t at = scanFindNoCase(text, "href=", pos);
+        if (at == npos)
+            return std::max(pos, text.size() > markerTail ? text.size() - markerTail : 0);
+        size_t begin = at + 5;
+        if (begin >= text.size()) return at;
+
+        size_t end;
+        char quote = text[begin];
+        if (quote == '"' || quote == '\'') {
+            ++begin;
+            end = scanFindByte(text, quote, begin);
+        }
+        else {
+            end = scanFindAnyOf(text, " \t\r\n>", begin);
         }
-        br.rating = rating;
-
-        auto blockLower = block;
-        std::transform(blockLower.begin(), blockLower.end(), blockLower.begin(), ::tolower);
-        bool hasPoem = (blockLower.find("poem") != std::string::npos);
-
-        // aggregate
-        res.bookCount += 1;
-        res.totalPrice += price;
-        if (rating == 5) res.fiveStarBooks += 1;
-        if (price > 50.0) res.priceOver50 += 1;
-        if (hasPoem) res.containsPoem += 1;
-        if (price > res.maxPrice) {
-            res.maxPrice = price;
-            res.maxPriceTitle = br.title;
+        if (end == npos) {
+            if (text.size() - at > maxPending) {
+                pos = begin;
+                continue;
+            }
+            return at;
         }
 
-        records.push_back(std::move(br));
-        std::cout << "[Analyzer] Book: " << records.back().title << price << " GBP" << " rating=" << rating << "\n";
+        std::string_view value = text.substr(begin, end - begin);
+        if (!value.empty()) links.emplace_back(decodeHtmlEntities(value, scratch));
+        pos = end + 1;
     }
-
-    return { std::move(records), res };
-}
\ No newline at end of file
+}
@@ -1,11 +1,14 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:09
+// Date and time of the last changes: 18.10.2026. 00:40
 
 #pragma once
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "Common.hpp"
+#include "PageArena.hpp"
 
 struct AnalysisResult {
     int fiveStarBooks = 0;
@@ -18,11 +21,97 @@ struct AnalysisResult {
     void mergeFrom(const AnalysisResult& other);
 };
 
+class PageParser;
+class LinkExtractor;
+class ParseCache;
+
 class Analyzer {
 public:
     Analyzer() = default;
+    // answer pages seen before from a content-keyed cache instead of parsing them again;
+    // nullptr disables it. Only whole bodies go through it, not pages parsed while streaming.
+    void setCache(ParseCache* parse_cache) { cache = parse_cache; }
+    ParseCache* parseCache() const { return cache; }
     // parse page and return list of BookRecord plus aggregated AnalysisResult
-    std::pair<std::vector<BookRecord>, AnalysisResult> parsePageRecords(const std::string& html);
+    // (single forward scan over the page, no regex and no copies of the HTML)
+    std::pair<std::vector<BookRecord>, AnalysisResult> parsePageRecords(std::string_view html);
+    // the same into a reused parser; the records stay there (parser.parsedRecords())
+    void parsePage(std::string_view html, PageParser& parser);
+    // href values of the page (entity-decoded, not yet resolved against the page URL)
+    std::vector<std::string> extractLinks(std::string_view html);
+    // the same with a reused extractor into a reused vector
+    void extractLinks(std::string_view html, LinkExtractor& extractor, std::vector<std::string>& links);
+
+private:
+    ParseCache* cache = nullptr;
+};
+
+// Incremental parser: the page is fed chunk by chunk as it arrives (e.g. from the curl write
+// callback). Each product_pod article is parsed as soon as its </article> has been received and
+// consumed bytes are dropped, so only the unfinished tail of the page is kept in memory.
+// Titles go into the parser's arena and records into a reused array, so a parser that is
+// reset() and fed the next page does not allocate once it has seen a page of that size.
+class PageParser {
+public:
+    // called for every record right after its article closes
+    using RecordCallback = std::function<void(const BookView& record)>;
+
+    explicit PageParser(RecordCallback onRecord = nullptr);
+    void feed(std::string_view chunk);
+    // end of page: returns copies of all records plus the page aggregate and resets the parser
+    std::pair<std::vector<BookRecord>, AnalysisResult> finish();
+    // records and aggregate of what was fed so far, without copying; valid until reset()
+    const std::vector<BookView>& parsedRecords() const { return records; }
+    const AnalysisResult& parsedResult() const { return result; }
+    // drop everything received so far (the transfer is being retried, or the next page
+    // starts); memory is kept for the next page
+    void reset();
+    // the state after feeding a page of fed_bytes that held these records (a ParseCache hit);
+    // the record callback sees each of them
+    void restore(const std::vector<BookView>& recs, const AnalysisResult& res, size_t fed_bytes);
+
+    size_t bytesFed() const { return fedBytes; }
+    size_t bufferedBytes() const { return window.size(); }
+    size_t peakBufferedBytes() const { return peakWindow; }
+    // what the page holds right now: the unfinished tail, its titles and records
+    size_t heldBytes() const { return window.size() + titles.bytesUsed() + records.size() * sizeof(BookView); }
+
+private:
+    RecordCallback onRecord;
+    std::string window;    // bytes that may still belong to an unfinished article
+    std::string scratch;   // decoded titles
+    std::string unwrapped; // titles that span several lines
+    PageArena titles;
+    std::vector<BookView> records;
+    AnalysisResult result;
+    size_t fedBytes = 0;
+    size_t peakWindow = 0;
+
+    size_t consume(std::string_view text);
+    void emitArticle(std::string_view block);
+};
+
+// Incremental href collector, fed chunk by chunk like PageParser. Keeps only an unfinished
+// attribute between chunks.
+class LinkExtractor {
+public:
+    void feed(std::string_view chunk);
+    // links seen since the last call
+    std::vector<std::string> takeLinks();
+    // the same into out, reusing its capacity
+    void takeLinks(std::vector<std::string>& out);
+    // drop everything received so far (the transfer is being retried)
+    void reset();
+
+private:
+    std::string window;
+    std::string scratch;
+    std::vector<std::string> links;
+
+    size_t consume(std::string_view text);
 };
 
+// Decode HTML character references (all HTML5 named entities, &#dd; and &#xhh;) in one pass.
+// Returns text itself when it contains no '&'; otherwise the result is written into scratch.
+std::string_view decodeHtmlEntities(std::string_view text, std::string& scratch);
 std::string decodeHtmlEntities(const std::string& text);
\ No newline at end of file
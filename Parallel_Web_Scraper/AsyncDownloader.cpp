@@ -0,0 +1,308 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 03:50
+
+#include "AsyncDownloader.hpp"
+#include "Log.hpp"
+#include "PageArchive.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+AsyncDownloader::AsyncDownloader(Downloader& downloader, size_t max_in_flight)
+    : downloader(downloader), maxInFlight(max_in_flight > 0 ? max_in_flight : 1) {
+    multi = curl_multi_init();
+    // without the multi handle there is no I/O thread to complete submissions and wait() would hang
+    if (!multi) throw std::runtime_error("AsyncDownloader: curl_multi_init failed");
+    // many page requests to the same host share one HTTP/2 connection when the server allows it
+    if (downloader.useHttp2())
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    ioThread = std::thread(&AsyncDownloader::run, this);
+}
+
+AsyncDownloader::~AsyncDownloader() {
+    stopping = true;
+    curl_multi_wakeup(multi);
+    if (ioThread.joinable()) ioThread.join();
+
+    // transfers still running at shutdown are dropped without invoking their callbacks
+    for (auto& t : active) {
+        curl_multi_remove_handle(multi, t->curl);
+        downloader.releaseHandle(t->url, t->curl);
+    }
+    std::vector<std::unique_ptr<Transfer>> waiting;
+    parked.drain(waiting);
+    for (auto& t : ready) waiting.push_back(std::move(t));
+    for (auto& t : waiting) {
+        if (t->curl) downloader.releaseHandle(t->url, t->curl);
+    }
+    curl_multi_cleanup(multi);
+}
+
+std::unique_ptr<AsyncDownloader::Transfer> AsyncDownloader::newTransfer(const std::string& url) {
+    std::unique_ptr<Transfer> t;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (!spare.empty()) {
+            t = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    if (!t) t = std::make_unique<Transfer>();
+    t->url = url; // a reused transfer keeps the capacity of its url and buffer
+    return t;
+}
+
+void AsyncDownloader::submit(const std::string& url, Callback onDone) {
+    auto t = newTransfer(url);
+    t->onDone = std::move(onDone);
+    enqueue(std::move(t));
+}
+
+void AsyncDownloader::submitStreaming(const std::string& url, std::shared_ptr<BodySink> sink, StreamCallback onDone) {
+    auto t = newTransfer(url);
+    t->stream = sink.get();
+    t->owned = std::move(sink);
+    t->onStreamDone = std::move(onDone);
+    enqueue(std::move(t));
+}
+
+void AsyncDownloader::submitStreaming(const std::string& url, BodySink& sink, StreamCallback onDone) {
+    auto t = newTransfer(url);
+    t->stream = &sink;
+    t->onStreamDone = std::move(onDone);
+    enqueue(std::move(t));
+}
+
+void AsyncDownloader::enqueue(std::unique_ptr<Transfer> t) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        pending.push_back(std::move(t));
+        ++outstanding;
+    }
+    curl_multi_wakeup(multi);
+}
+
+void AsyncDownloader::wait() {
+    std::unique_lock<std::mutex> lock(m);
+    idle.wait(lock, [this] { return outstanding == 0; });
+}
+
+size_t AsyncDownloader::inFlight() const {
+    return activeCount.load(std::memory_order_relaxed);
+}
+
+void AsyncDownloader::run() {
+    std::vector<std::unique_ptr<Transfer>> woken;
+    while (!stopping) {
+        auto now = std::chrono::steady_clock::now();
+        parked.expire(now, woken);
+        for (auto& t : woken) ready.push_back(std::move(t));
+        woken.clear();
+        startReady(now);
+        startPending(now);
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg = nullptr;
+        int left = 0;
+        while ((msg = curl_multi_info_read(multi, &left)) != nullptr) {
+            if (msg->msg == CURLMSG_DONE)
+                finishTransfer(msg->easy_handle, msg->data.result);
+        }
+
+        // sleeps in the kernel until a socket is ready, a timer fires or submit() wakes us
+        curl_multi_poll(multi, nullptr, 0, pollTimeoutMs(std::chrono::steady_clock::now()), nullptr);
+    }
+}
+
+void AsyncDownloader::launch(std::unique_ptr<Transfer> t, std::chrono::steady_clock::time_point now) {
+    HostScheduler& scheduler = downloader.hostScheduler();
+    std::string host = hostOf(t->url);
+    if (!t->reserved) {
+        auto at = scheduler.reserve(host, now);
+        if (at > now) {
+            t->reserved = true;
+            parked.schedule(std::move(t), at);
+            return;
+        }
+    }
+    else {
+        // the slot was reserved before a 429 blocked the host
+        auto blocked = scheduler.blockedUntil(host);
+        if (blocked > now) {
+            t->reserved = false;
+            parked.schedule(std::move(t), blocked);
+            return;
+        }
+    }
+    t->reserved = false;
+
+    if (t->curl) { // retry: the handle keeps its options
+        t->sink()->onRestart();
+    }
+    else {
+        t->curl = downloader.acquireHandle(t->url);
+        if (!t->curl) {
+            LOG_ERROR("AsyncDownloader", "curl_easy_init failed");
+            complete(std::move(t), false);
+            return;
+        }
+        if (downloader.useHttp2()) curl_easy_setopt(t->curl, CURLOPT_PIPEWAIT, 1L);
+        if (PageArchive* archive = downloader.pageArchive())
+            t->archived = std::make_unique<ArchiveTransfer>(*archive, *t->target());
+        if (ResponseCache* cache = downloader.responseCache()) {
+            t->cached = std::make_unique<CachedTransfer>(*cache, t->url, *t->inner());
+            t->cached->prepare(t->curl);
+        }
+        curl_easy_setopt(t->curl, CURLOPT_URL, t->url.c_str());
+        downloader.attachSink(t->curl, t->sink());
+        curl_easy_setopt(t->curl, CURLOPT_PRIVATE, t.get());
+    }
+    // a failed start is final: left in ready, the transfer would be retried on every pass
+    CURLMcode added = curl_multi_add_handle(multi, t->curl);
+    if (added != CURLM_OK) {
+        LOG_ERROR("AsyncDownloader", "curl_multi_add_handle failed: {} for {}", curl_multi_strerror(added), t->url);
+        complete(std::move(t), false);
+        return;
+    }
+    active.push_back(std::move(t));
+    activeCount.store(active.size(), std::memory_order_relaxed);
+}
+
+void AsyncDownloader::startReady(std::chrono::steady_clock::time_point now) {
+    while (active.size() < maxInFlight && !ready.empty()) {
+        auto t = std::move(ready.front());
+        ready.pop_front();
+        launch(std::move(t), now);
+    }
+}
+
+void AsyncDownloader::startPending(std::chrono::steady_clock::time_point now) {
+    while (active.size() < maxInFlight) {
+        std::unique_ptr<Transfer> t;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (pending.empty()) break;
+            t = std::move(pending.front());
+            pending.pop_front();
+        }
+        launch(std::move(t), now);
+    }
+}
+
+void AsyncDownloader::finishTransfer(CURL* curl, CURLcode code) {
+    curl_multi_remove_handle(multi, curl);
+    auto it = std::find_if(active.begin(), active.end(),
+        [curl](const std::unique_ptr<Transfer>& t) { return t->curl == curl; });
+    if (it == active.end()) return;
+    auto t = std::move(*it);
+    *it = std::move(active.back());
+    active.pop_back();
+    activeCount.store(active.size(), std::memory_order_relaxed);
+
+    downloader.noteAttempt(curl, t->sink());
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (observer) {
+        curl_off_t total_us = 0;
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+        observer(t->url, code, response_code, std::chrono::microseconds(total_us));
+    }
+
+    if (code == CURLE_OK && response_code >= 200 && response_code < 400) {
+        bool ok = !t->cached || t->cached->finish(response_code);
+        if (ok && t->archived) t->archived->finish(curl, t->url, response_code);
+        complete(std::move(t), ok); // successfull download
+        return;
+    }
+
+    HostScheduler& scheduler = downloader.hostScheduler();
+    const std::string host = hostOf(t->url);
+    auto now = std::chrono::steady_clock::now();
+    bool canRetry = t->attempt < downloader.retries();
+    std::chrono::steady_clock::time_point due;
+    if (response_code == 429) {
+        curl_off_t retry_after = 0; // seconds, 0 when the header is absent
+        curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
+        auto wait = retry_after > 0 ? std::chrono::milliseconds(retry_after * 1000) : HostScheduler::backoff(t->attempt);
+        // blocks the whole host, so its other queued requests wait as well
+        due = scheduler.throttle(host, now, wait);
+    }
+    else if (response_code >= 400 && response_code < 500) { // client error — don't retry
+        complete(std::move(t), false);
+        return;
+    }
+    else if (Downloader::oversize(code, t->sink())) {
+        LOG_RATE(LogLevel::Warn, 1000, "AsyncDownloader", "{} is larger than the page cap of {} bytes",
+            t->url, downloader.maxPageSize());
+        if (Metrics* mr = downloader.metrics()) mr->add(Counter::OversizePages);
+        complete(std::move(t), false);
+        return;
+    }
+    else {
+        LOG_RATE(LogLevel::Warn, 1000, "AsyncDownloader", "attempt {} failed for {} (curl={}, http={})",
+            t->attempt, t->url, curl_easy_strerror(code), response_code);
+        due = now + HostScheduler::backoff(t->attempt);
+    }
+    if (!canRetry) {
+        scheduler.noteAbandoned(host);
+        complete(std::move(t), false);
+        return;
+    }
+
+    // parked instead of sleeping; other hosts keep going meanwhile
+    scheduler.noteRetry(host);
+    if (Metrics* mr = downloader.metrics()) mr->add(Counter::Retries);
+    ++t->attempt;
+    parked.schedule(std::move(t), due);
+}
+
+void AsyncDownloader::complete(std::unique_ptr<Transfer> t, bool ok) {
+    if (!ok) {
+        LOG_RATE(LogLevel::Error, 1000, "AsyncDownloader", "failed to download URL after {} attempts: {}",
+            t->attempt, t->url);
+        t->buffer.body.clear();
+        if (Metrics* mr = downloader.metrics()) mr->add(Counter::Failures);
+    }
+    downloader.releaseHandle(t->url, t->curl);
+    t->curl = nullptr;
+
+    try {
+        if (t->stream) {
+            if (t->onStreamDone) t->onStreamDone(t->url, ok);
+        }
+        else if (t->onDone) {
+            t->onDone(t->url, std::move(t->buffer.body));
+        }
+    }
+    catch (const std::exception& ex) {
+        LOG_ERROR("AsyncDownloader", "callback threw: {} for {}", ex.what(), t->url);
+    }
+
+    t->buffer.body.clear();
+    t->stream = nullptr;
+    t->owned.reset();
+    t->cached.reset();
+    t->archived.reset();
+    t->onDone = nullptr;
+    t->onStreamDone = nullptr;
+    t->attempt = 1;
+    t->reserved = false;
+    std::lock_guard<std::mutex> lock(m);
+    if (spare.size() < maxInFlight) spare.push_back(std::move(t));
+    if (--outstanding == 0) idle.notify_all();
+}
+
+int AsyncDownloader::pollTimeoutMs(std::chrono::steady_clock::time_point now) const {
+    int timeout = 1000;
+    if (active.size() >= maxInFlight) return timeout; // due transfers wait for a free slot
+    if (!ready.empty()) return 0;
+    std::chrono::steady_clock::time_point at;
+    if (parked.nextWakeup(now, at)) {
+        // rounded up: waking a fraction of a millisecond early would only poll again with 0
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(at - now).count();
+        timeout = std::min<int>(timeout, static_cast<int>(std::max<long long>(ms, 0)));
+    }
+    return timeout;
+}
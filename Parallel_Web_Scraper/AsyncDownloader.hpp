@@ -0,0 +1,100 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 03:50
+
+#pragma once
+#include "Downloader.hpp"
+#include "TimerWheel.hpp"
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Event-driven download engine: one I/O thread drives many transfers through curl_multi,
+// so the number of requests in flight does not depend on the number of TBB workers.
+// Requests that have to wait (host pacing, Retry-After, backoff) are parked in a timer
+// wheel and started when due; no thread sleeps.
+class AsyncDownloader {
+public:
+    // invoked on the I/O thread when a transfer finishes; body is empty on permanent failure
+    using Callback = std::function<void(const std::string& url, std::string&& body)>;
+    // completion of a streamed transfer; the body already went to the sink
+    using StreamCallback = std::function<void(const std::string& url, bool ok)>;
+    // invoked on the I/O thread after every attempt, including ones that will be retried
+    using AttemptObserver = std::function<void(const std::string& url, CURLcode code, long http_code,
+        std::chrono::microseconds elapsed)>;
+
+    // throws std::runtime_error when curl cannot create the multi handle
+    AsyncDownloader(Downloader& downloader, size_t max_in_flight = 256);
+    ~AsyncDownloader();
+    AsyncDownloader(const AsyncDownloader&) = delete;
+    AsyncDownloader& operator=(const AsyncDownloader&) = delete;
+
+    void submit(const std::string& url, Callback onDone);
+    // deliver the body to sink chunk by chunk from the I/O thread instead of buffering it
+    void submitStreaming(const std::string& url, std::shared_ptr<BodySink> sink, StreamCallback onDone);
+    // the same with a sink the caller keeps alive until onDone has run
+    void submitStreaming(const std::string& url, BodySink& sink, StreamCallback onDone);
+    // block until every submitted transfer has completed
+    void wait();
+    size_t inFlight() const;
+    // set before the first submit
+    void setAttemptObserver(AttemptObserver fn) { observer = std::move(fn); }
+
+private:
+    struct Transfer {
+        CURL* curl = nullptr;
+        std::string url;
+        StringSink buffer;                // body for submit()
+        BodySink* stream = nullptr;       // body for submitStreaming()
+        std::shared_ptr<BodySink> owned;  // keeps stream alive when the caller handed it over
+        std::unique_ptr<ArchiveTransfer> archived; // copies the body for the page archive when enabled
+        std::unique_ptr<CachedTransfer> cached; // tees into the response cache when enabled
+        Callback onDone;
+        StreamCallback onStreamDone;
+        int attempt = 1;
+        bool reserved = false; // already holds a slot from the host scheduler
+
+        BodySink* target() { return stream ? stream : &buffer; }
+        // cache -> archive -> target, so the archive also sees bodies the cache serves
+        BodySink* inner() { return archived ? static_cast<BodySink*>(archived.get()) : target(); }
+        BodySink* sink() { return cached ? static_cast<BodySink*>(cached.get()) : inner(); }
+    };
+
+    Downloader& downloader;
+    size_t maxInFlight;
+    CURLM* multi = nullptr;
+    std::thread ioThread;
+    std::atomic<bool> stopping{ false };
+    AttemptObserver observer;
+
+    mutable std::mutex m;
+    std::condition_variable idle;
+    std::deque<std::unique_ptr<Transfer>> pending; // submitted, not yet started
+    size_t outstanding = 0;                        // submitted and not yet completed
+    std::vector<std::unique_ptr<Transfer>> spare;  // completed, kept for reuse (up to maxInFlight)
+
+    // owned by the I/O thread
+    std::vector<std::unique_ptr<Transfer>> active;
+    TimerWheel<std::unique_ptr<Transfer>> parked;  // waiting for pacing or backoff
+    std::deque<std::unique_ptr<Transfer>> ready;    // due, waiting for a free slot
+    std::atomic<size_t> activeCount{ 0 };
+
+    std::unique_ptr<Transfer> newTransfer(const std::string& url);
+    void enqueue(std::unique_ptr<Transfer> t);
+    void run();
+    void startPending(std::chrono::steady_clock::time_point now);
+    void startReady(std::chrono::steady_clock::time_point now);
+    // starts t, or parks it when its host may not be contacted yet; fails it when curl cannot start it
+    void launch(std::unique_ptr<Transfer> t, std::chrono::steady_clock::time_point now);
+    void finishTransfer(CURL* curl, CURLcode code);
+    void complete(std::unique_ptr<Transfer> t, bool ok);
+    int pollTimeoutMs(std::chrono::steady_clock::time_point now) const;
+};
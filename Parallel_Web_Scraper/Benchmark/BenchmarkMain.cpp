@@ -0,0 +1,408 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 02:00
+
+// Benchmark driver: micro-benchmarks of the parsing, storage and dedupe hot paths plus
+// end-to-end pipeline runs across CPU thread counts against the in-process FixtureServer.
+// Results go to a JSON file (--out, default bench.json) so runs can be compared over time.
+
+#include "FixtureServer.hpp"
+#include "../Allocations.hpp"
+#include "../Analytics.hpp"
+#include "../Analyzer.hpp"
+#include "../CrawlFrontier.hpp"
+#include "../Downloader.hpp"
+#include "../Log.hpp"
+#include "../Metrics.hpp"
+#include "../PageArchive.hpp"
+#include "../ParseCache.hpp"
+#include "../Pipeline.hpp"
+#include "../RecordExport.hpp"
+#include "../Storage.hpp"
+#include "../UrlManager.hpp"
+
+#include <tbb/global_control.h>
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Measurement {
+    std::string name;
+    size_t iterations = 0;  // calls of the body per repetition
+    size_t itemsPerOp = 1;  // e.g. URLs per call for the batch benchmarks
+    double bytesPerOp = 0.0;
+    double allocsPerOp = 0.0;    // operator new calls per call of the body, last repetition
+    std::vector<double> seconds; // one per repetition
+};
+
+struct ScalingRun {
+    int cpuThreads;
+    int ioThreads;
+    size_t inFlight;
+    Result result;
+    FixtureStats server;
+    bool correct;
+};
+
+struct BenchConfig {
+    std::string outPath = "bench.json";
+    int repeats = 5;
+    double minSeconds = 0.05; // calibration target per repetition
+    std::vector<int> threadCounts;
+    int ioThreads = 2;
+    size_t inFlight = 64;
+    int scalingRepeats = 1;
+    bool micro = true;
+    bool scaling = true;
+    FixtureOptions fixture;
+};
+
+// keeps the optimizer from dropping a benchmarked result
+const void* volatile keepSink = nullptr;
+template <typename T>
+void keep(const T& value) {
+    keepSink = &value;
+}
+
+// doubles the iteration count until one repetition takes minSeconds, then times repeats runs
+template <typename Body>
+Measurement measure(const std::string& name, const BenchConfig& cfg, size_t items_per_op, double bytes_per_op, Body body) {
+    Measurement m;
+    m.name = name;
+    m.itemsPerOp = items_per_op;
+    m.bytesPerOp = bytes_per_op;
+    size_t n = 1;
+    for (;;) {
+        auto t0 = Clock::now();
+        body(n);
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        if (s >= cfg.minSeconds || n >= (size_t(1) << 30)) break;
+        n *= 2;
+    }
+    m.iterations = n;
+    for (int r = 0; r < cfg.repeats; ++r) {
+        uint64_t allocs = threadAllocations();
+        auto t0 = Clock::now();
+        body(n);
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        m.allocsPerOp = static_cast<double>(threadAllocations() - allocs) / n;
+        m.seconds.push_back(s);
+    }
+    return m;
+}
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    if (n == 0) return 0.0;
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::vector<Measurement> runMicro(const BenchConfig& cfg) {
+    std::vector<Measurement> out;
+    const std::string page = FixtureServer::catalogPage(1, cfg.fixture.booksPerPage, 1);
+
+    Analyzer analyzer;
+    out.push_back(measure("analyzer_parse_page_records", cfg, 1, static_cast<double>(page.size()), [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) keep(analyzer.parsePageRecords(page));
+        }));
+    // the pipeline's way: one parser per pooled page, reset between pages
+    PageParser reused;
+    out.push_back(measure("analyzer_parse_page_reused", cfg, 1, static_cast<double>(page.size()), [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            analyzer.parsePage(page, reused);
+            keep(reused.parsedResult());
+        }
+        }));
+    // a page seen before: hashed and answered from the parse cache
+    ParseCache parseCache(64);
+    Analyzer memoized;
+    memoized.setCache(&parseCache);
+    memoized.parsePage(page, reused);
+    out.push_back(measure("analyzer_parse_page_memoized", cfg, 1, static_cast<double>(page.size()), [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            memoized.parsePage(page, reused);
+            keep(reused.parsedResult());
+        }
+        }));
+    out.push_back(measure("content_hash_page", cfg, 1, static_cast<double>(page.size()), [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) keep(contentHash(page));
+        }));
+
+    const std::string entities = "Poems &amp; Verses: &quot;Le Petit Prince&quot; &mdash; &Eacute;dition "
+        "Shakespeare&#39;s Sonnets &#x2014; no entities in this tail at all, just plain text";
+    std::string scratch;
+    out.push_back(measure("decode_html_entities", cfg, 1, static_cast<double>(entities.size()), [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) keep(decodeHtmlEntities(entities, scratch));
+        }));
+
+    auto parsed = analyzer.parsePageRecords(page);
+    out.push_back(measure("storage_append_page", cfg, parsed.first.size(), 0.0, [&](size_t n) {
+        Storage storage;
+        for (size_t i = 0; i < n; ++i) {
+            storage.storeResult(parsed.second);
+            storage.storeRecords(parsed.first);
+            storage.incrementPagesProcessed();
+        }
+        keep(storage.pagesProcessed());
+        }));
+
+    Storage filled;
+    for (int i = 0; i < 5000; ++i) {
+        filled.storeResult(parsed.second);
+        filled.storeRecords(parsed.first);
+    }
+    size_t filledRecords = filled.recordsView().stats().count;
+    out.push_back(measure("storage_aggregate", cfg, filledRecords, 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            keep(filled.getAggregatedResult());
+            keep(filled.recordsView().stats());
+        }
+        }));
+
+    // declared analytics: added page by page while storing, or over a whole store at once
+    std::vector<QuerySpec> queries;
+    for (const char* q : { "count@rating", "sum:price", "hist:price:0:60:12", "top:price:100", "quantiles:price" }) {
+        QuerySpec spec;
+        std::string error;
+        if (QuerySpec::parse(q, spec, error)) queries.push_back(std::move(spec));
+    }
+    AnalyticsEngine engine(queries);
+    out.push_back(measure("analytics_add_page", cfg, parsed.first.size(), 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) engine.add(parsed.first);
+        }));
+    out.push_back(measure("analytics_aggregate_store", cfg, filledRecords, 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) keep(aggregateRecords(queries, filled.recordsView()).memoryBytes());
+        }));
+
+    // whole-store export, formatting in parallel chunks; bytes are those of the CSV
+    std::string exportBase = (std::filesystem::temp_directory_path() / "pws_bench_export").string();
+    ExportStats probe = exportRecords(filled.recordsView(), exportBase + ".csv", "");
+    out.push_back(measure("export_csv", cfg, filledRecords, static_cast<double>(probe.csvBytes), [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) keep(exportRecords(filled.recordsView(), exportBase + ".csv", ""));
+        }));
+    out.push_back(measure("export_columnar", cfg, filledRecords, 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) keep(exportRecords(filled.recordsView(), "", exportBase + ".col"));
+        }));
+    std::remove((exportBase + ".csv").c_str());
+    std::remove((exportBase + ".col").c_str());
+
+    // offline re-analysis of an archive of 200 pages, inflate and parse; bytes are the pages
+    std::string archiveDir = (std::filesystem::temp_directory_path() / "pws_bench_archive").string();
+    {
+        PageArchive archive(archiveDir);
+        if (archive.open(true)) {
+            for (int i = 0; i < 200; ++i) {
+                archive.append("https://books.toscrape.com/catalogue/page-" + std::to_string(i) + ".html",
+                    "HTTP/1.1 200 OK\r\n", page);
+            }
+        }
+    }
+    ArchiveReader archived;
+    if (archived.open(archiveDir)) {
+        for (bool parallel : { true, false }) {
+            out.push_back(measure(parallel ? "archive_replay_parallel" : "archive_replay_serial", cfg, archived.size(),
+                static_cast<double>(archived.size() * page.size()), [&](size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        Storage storage;
+                        std::ostringstream sink;
+                        keep(runReplay(archived, analyzer, storage, sink, parallel).pages);
+                    }
+                }));
+        }
+    }
+    std::filesystem::remove_all(archiveDir);
+
+    // 10k URLs, every second one a non-canonical duplicate of an earlier one
+    std::vector<std::string> urls;
+    for (int i = 0; i < 10000; ++i) {
+        if (i % 2 && i > 1) urls.push_back("HTTP://Books.ToScrape.com:80/catalogue/./book_" + std::to_string(i / 2) + "/index.html#reviews");
+        else urls.push_back("https://books.toscrape.com/catalogue/book_" + std::to_string(i) + "/index.html");
+    }
+    for (DedupeMode mode : { DedupeMode::Exact, DedupeMode::Bloom }) {
+        out.push_back(measure(mode == DedupeMode::Exact ? "url_dedupe_exact" : "url_dedupe_bloom", cfg, urls.size(), 0.0,
+            [&](size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    UrlManager manager(mode, urls.size());
+                    for (const auto& u : urls) manager.addUrl(u);
+                    keep(manager.uniqueCount());
+                }
+            }));
+    }
+
+    // cost of the always-on instrumentation
+    Metrics metrics;
+    out.push_back(measure("metrics_observe", cfg, 1, 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) metrics.observe(Hist::ParseStage, static_cast<uint64_t>(i & 0xFFFF));
+        }));
+    out.push_back(measure("metrics_stage_timing", cfg, 1, 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            auto t0 = Clock::now();
+            metrics.observe(Hist::StoreStage, Clock::now() - t0);
+        }
+        }));
+    // a debug message on the parse path while debug logging is off
+    out.push_back(measure("log_debug_disabled", cfg, 1, 0.0, [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) LOG_DEBUG("bench", "Book: {} {} GBP rating={}", entities, 1.5 * i, 5);
+        }));
+    return out;
+}
+
+std::vector<ScalingRun> runScaling(const BenchConfig& cfg) {
+    std::vector<ScalingRun> out;
+    for (int threads : cfg.threadCounts) {
+        for (int r = 0; r < cfg.scalingRepeats; ++r) {
+            FixtureServer server(cfg.fixture);
+            if (!server.start()) return out;
+            tbb::global_control gc(tbb::global_control::max_allowed_parallelism, threads + cfg.ioThreads);
+
+            UrlManager urlManager;
+            for (const auto& u : server.urls()) urlManager.addUrl(u);
+            CrawlFrontier frontier(urlManager, 0, 0, "");
+            frontier.seed(urlManager.getUrlsSnapshot());
+            Downloader downloader(10, 3, false);
+            Analyzer analyzer;
+            Storage storage;
+            ExecutionDomains domains;
+            domains.cpuThreads = threads;
+            domains.ioThreads = cfg.ioThreads;
+            domains.maxBuffered = 4 * static_cast<size_t>(threads);
+            std::ostringstream report;
+
+            ScalingRun run{ threads, cfg.ioThreads, cfg.inFlight, {}, {}, false };
+            run.result = runPipeline(frontier, downloader, analyzer, storage, report, domains, cfg.inFlight, false);
+            server.stop();
+            run.server = server.stats();
+            run.correct = run.result.pages == cfg.fixture.pages
+                && run.result.result.bookCount == cfg.fixture.pages * cfg.fixture.booksPerPage;
+            std::cerr << "[bench] threads=" << threads << " pages=" << run.result.pages << " "
+                << run.result.throughput << " pages/s" << (run.correct ? "" : " (INCOMPLETE)") << "\n";
+            out.push_back(run);
+        }
+    }
+    return out;
+}
+
+void writeJson(std::ostream& os, const BenchConfig& cfg, const std::vector<Measurement>& micro,
+    const std::vector<ScalingRun>& scaling) {
+    const FixtureOptions& f = cfg.fixture;
+    os << "{\n  \"schema\": 1,\n";
+    os << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+    os << "  \"fixture\": {\"pages\": " << f.pages << ", \"books_per_page\": " << f.booksPerPage
+        << ", \"page_bytes\": " << FixtureServer::catalogPage(1, f.booksPerPage, f.pages).size()
+        << ", \"latency_ms\": " << f.latency.count() << ", \"error_rate\": " << f.errorRate
+        << ", \"throttle_rate\": " << f.throttleRate << ", \"keep_alive\": " << (f.keepAlive ? "true" : "false")
+        << ", \"gzip\": " << (f.gzip ? "true" : "false")
+        << ", \"seed\": " << f.seed << "},\n";
+
+    os << "  \"micro\": [";
+    for (size_t i = 0; i < micro.size(); ++i) {
+        const Measurement& m = micro[i];
+        double ops = static_cast<double>(m.iterations) * m.itemsPerOp;
+        double med = median(m.seconds);
+        double best = *std::min_element(m.seconds.begin(), m.seconds.end());
+        os << (i ? ",\n    " : "\n    ") << "{\"name\": " << jsonString(m.name)
+            << ", \"iterations\": " << m.iterations << ", \"items_per_op\": " << m.itemsPerOp
+            << ", \"repeats\": " << m.seconds.size()
+            << ", \"ns_per_item_median\": " << med * 1e9 / ops
+            << ", \"ns_per_item_min\": " << best * 1e9 / ops
+            << ", \"allocs_per_op\": " << m.allocsPerOp;
+        if (m.bytesPerOp > 0) os << ", \"mb_per_s\": " << m.bytesPerOp * m.iterations / med / 1e6;
+        os << "}";
+    }
+    os << "\n  ],\n";
+
+    os << "  \"scaling\": [";
+    for (size_t i = 0; i < scaling.size(); ++i) {
+        const ScalingRun& s = scaling[i];
+        os << (i ? ",\n    " : "\n    ") << "{\"cpu_threads\": " << s.cpuThreads << ", \"io_threads\": " << s.ioThreads
+            << ", \"inflight\": " << s.inFlight << ", \"pages\": " << s.result.pages
+            << ", \"books\": " << s.result.result.bookCount << ", \"seconds\": " << s.result.seconds
+            << ", \"pages_per_s\": " << s.result.throughput << ", \"requests\": " << s.server.requests
+            << ", \"connections\": " << s.server.connections << ", \"body_bytes\": " << s.server.bodyBytes
+            << ", \"errors\": " << s.server.errors << ", \"throttled\": " << s.server.throttled << ", \"correct\": " << (s.correct ? "true" : "false") << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+std::vector<int> parseList(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(std::max(1, std::stoi(item)));
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string a(argv[i]);
+        if (a == "--out" && i + 1 < argc) cfg.outPath = argv[++i];
+        if (a == "--repeats" && i + 1 < argc) cfg.repeats = std::max(1, std::stoi(argv[++i]));
+        if (a == "--min-ms" && i + 1 < argc) cfg.minSeconds = std::stod(argv[++i]) / 1000.0;
+        if (a == "--threads" && i + 1 < argc) cfg.threadCounts = parseList(argv[++i]);
+        if (a == "--io-threads" && i + 1 < argc) cfg.ioThreads = std::max(1, std::stoi(argv[++i]));
+        if ((a == "-i" || a == "--inflight") && i + 1 < argc) cfg.inFlight = std::max(1, std::stoi(argv[++i]));
+        if (a == "--scaling-repeats" && i + 1 < argc) cfg.scalingRepeats = std::max(1, std::stoi(argv[++i]));
+        if (a == "--micro-only") cfg.scaling = false;
+        if (a == "--scaling-only") cfg.micro = false;
+        if (a == "--pages" && i + 1 < argc) cfg.fixture.pages = std::stoi(argv[++i]);
+        if (a == "--books" && i + 1 < argc) cfg.fixture.booksPerPage = std::stoi(argv[++i]);
+        if (a == "--latency-ms" && i + 1 < argc) cfg.fixture.latency = std::chrono::milliseconds(std::stoi(argv[++i]));
+        if (a == "--error-rate" && i + 1 < argc) cfg.fixture.errorRate = std::stod(argv[++i]);
+        if (a == "--throttle-rate" && i + 1 < argc) cfg.fixture.throttleRate = std::stod(argv[++i]);
+        if (a == "--retry-after" && i + 1 < argc) cfg.fixture.retryAfter = std::stoi(argv[++i]);
+        if (a == "--no-keepalive") cfg.fixture.keepAlive = false;
+        if (a == "--gzip") cfg.fixture.gzip = true;
+        if (a == "--seed" && i + 1 < argc) cfg.fixture.seed = std::stoull(argv[++i]);
+    }
+    if (cfg.threadCounts.empty()) {
+        int hw = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int t = 1; t < hw; t *= 2) cfg.threadCounts.push_back(t);
+        cfg.threadCounts.push_back(hw);
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // only problems are logged while measuring; disabled levels are never formatted
+    Logger::instance().setLevel(LogLevel::Warn);
+
+    std::vector<Measurement> micro;
+    std::vector<ScalingRun> scaling;
+    if (cfg.micro) micro = runMicro(cfg);
+    if (cfg.scaling) scaling = runScaling(cfg);
+
+    Logger::instance().flush();
+    std::ofstream file(cfg.outPath);
+    writeJson(file, cfg, micro, scaling);
+    writeJson(std::cout, cfg, micro, scaling);
+
+    curl_global_cleanup();
+    bool allCorrect = std::all_of(scaling.begin(), scaling.end(), [](const ScalingRun& s) { return s.correct; });
+    return file && allCorrect ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 23:10
+
+#include "FixtureServer.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+
+namespace {
+
+// splitmix64: page -> uniform [0, 1), fixed for a given seed
+double pageDraw(uint64_t seed, int page) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * static_cast<uint64_t>(page + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return static_cast<double>(z >> 11) / static_cast<double>(1ULL << 53);
+}
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    default: return "Internal Server Error";
+    }
+}
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// whole body as one gzip member (RFC 1952)
+std::string gzipped(const std::string& body) {
+    z_stream zs{};
+    // 15 + 16: largest window with a gzip header and trailer instead of the zlib ones
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return std::string();
+    std::string out(deflateBound(&zs, static_cast<uLong>(body.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    zs.avail_in = static_cast<uInt>(body.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? out : std::string();
+}
+
+// true when the request's Accept-Encoding lists gzip (head lowercased)
+bool acceptsGzip(const std::string& head) {
+    size_t at = head.find("\r\naccept-encoding:");
+    if (at == std::string::npos) return false;
+    size_t end = head.find("\r\n", at + 2);
+    return head.substr(at, end == std::string::npos ? std::string::npos : end - at).find("gzip") != std::string::npos;
+}
+
+// "/catalogue/page-12.html" -> 12, 0 for anything else
+int pageOf(const std::string& path) {
+    static const std::string prefix = "/catalogue/page-";
+    if (path.compare(0, prefix.size(), prefix) != 0) return 0;
+    int page = 0;
+    size_t i = prefix.size();
+    while (i < path.size() && path[i] >= '0' && path[i] <= '9') page = page * 10 + (path[i++] - '0');
+    return path.compare(i, std::string::npos, ".html") == 0 ? page : 0;
+}
+
+} // namespace
+
+FixtureServer::FixtureServer(FixtureOptions options) : opt(options) {
+    opt.pages = std::max(opt.pages, 1);
+    opt.booksPerPage = std::max(opt.booksPerPage, 0);
+}
+
+FixtureServer::~FixtureServer() {
+    stop();
+}
+
+std::string FixtureServer::catalogPage(int page, int books, int pages) {
+    static const char* ratings[] = { "One", "Two", "Three", "Four", "Five" };
+    static const char* titles[] = {
+        "A Light in the Attic", "Tipping the Velvet", "Soumission", "Sharp Objects",
+        "Sapiens: A Brief History of Humankind", "The Requiem Red", "The Dirty Little Secrets",
+        "Shakespeare&#39;s Sonnets", "Poems &amp; Verses", "Le Petit Prince &mdash; &Eacute;dition",
+    };
+    std::string html;
+    html.reserve(1500 + static_cast<size_t>(books) * 1100);
+    html += "<!DOCTYPE html>\n<html lang=\"en-us\" class=\"no-js\">\n<head>\n<meta charset=\"utf-8\">\n"
+        "<title>All products | Books to Scrape - Sandbox</title>\n</head>\n<body id=\"default\" class=\"default\">\n"
+        "<div class=\"page_inner\"><ul class=\"breadcrumb\"><li><a href=\"../index.html\">Home</a></li>"
+        "<li class=\"active\">All products</li></ul>\n<section>\n<ol class=\"row\">\n";
+    char buf[64];
+    for (int i = 0; i < books; ++i) {
+        int id = (page - 1) * books + i;
+        std::string title = titles[id % 10];
+        title += " #" + std::to_string(id);
+        std::string slug = "book_" + std::to_string(id);
+        int pence = 1000 + (id * 7919) % 5000; // 10.00 .. 59.99
+        std::snprintf(buf, sizeof(buf), "%d.%02d", pence / 100, pence % 100);
+
+        html += "<li class=\"col-xs-6 col-sm-4 col-md-3 col-lg-3\">\n<article class=\"product_pod\">\n"
+            "    <div class=\"image_container\">\n        <a href=\"" + slug + "/index.html\"><img src=\"../media/cache/"
+            + slug + ".jpg\" alt=\"" + title + "\" class=\"thumbnail\"></a>\n    </div>\n"
+            "        <p class=\"star-rating " + ratings[(id * 3) % 5] + "\">\n"
+            "            <i class=\"icon-star\"></i><i class=\"icon-star\"></i><i class=\"icon-star\"></i>"
+            "<i class=\"icon-star\"></i><i class=\"icon-star\"></i>\n        </p>\n"
+            "    <h3><a href=\"" + slug + "/index.html\" title=\"" + title + "\">" + title.substr(0, 20) + "...</a></h3>\n"
+            "    <div class=\"product_price\">\n        <p class=\"price_color\">\xC2\xA3" + buf + "</p>\n"
+            "<p class=\"instock availability\">\n    <i class=\"icon-ok\"></i>\n        In stock\n</p>\n"
+            "        <form>\n            <button type=\"submit\" class=\"btn btn-primary btn-block\" "
+            "data-loading-text=\"Adding...\">Add to basket</button>\n        </form>\n    </div>\n</article>\n</li>\n";
+    }
+    html += "</ol>\n<div><ul class=\"pager\"><li class=\"current\">Page " + std::to_string(page) + " of "
+        + std::to_string(pages) + "</li>\n";
+    if (page > 1) html += "<li class=\"previous\"><a href=\"page-" + std::to_string(page - 1) + ".html\">previous</a></li>\n";
+    if (page < pages) html += "<li class=\"next\"><a href=\"page-" + std::to_string(page + 1) + ".html\">next</a></li>\n";
+    html += "</ul></div>\n</section>\n</div>\n</body>\n</html>\n";
+    return html;
+}
+
+bool FixtureServer::start() {
+    if (listenFd >= 0) return true;
+    bodies.clear();
+    for (int p = 1; p <= opt.pages; ++p) bodies.push_back(catalogPage(p, opt.booksPerPage, opt.pages));
+    gzipBodies.clear();
+    if (opt.gzip) {
+        for (const auto& b : bodies) gzipBodies.push_back(gzipped(b));
+    }
+    hits.reset(new std::atomic<int>[opt.pages]);
+    for (int p = 0; p < opt.pages; ++p) hits[p].store(0);
+
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "[FixtureServer] socket failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    int one = 1;
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    // a deep backlog: a short one drops SYNs under load and adds 1 s retransmit stalls
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || ::listen(listenFd, 1024) != 0
+        || ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        std::cerr << "[FixtureServer] bind/listen failed: " << std::strerror(errno) << "\n";
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    boundPort = ntohs(addr.sin_port);
+    stopping = false;
+    acceptThread = std::thread(&FixtureServer::acceptLoop, this);
+    return true;
+}
+
+void FixtureServer::stop() {
+    if (listenFd < 0) return;
+    stopping = true;
+    ::shutdown(listenFd, SHUT_RDWR); // wakes accept()
+    if (acceptThread.joinable()) acceptThread.join();
+    ::close(listenFd);
+    listenFd = -1;
+
+    std::unique_lock<std::mutex> lock(m);
+    for (int fd : clientFds) ::shutdown(fd, SHUT_RDWR); // wakes recv()
+    clientsDone.wait(lock, [this] { return clientFds.empty(); });
+}
+
+std::string FixtureServer::url(int page) const {
+    return "http://127.0.0.1:" + std::to_string(boundPort) + "/catalogue/page-" + std::to_string(page) + ".html";
+}
+
+std::vector<std::string> FixtureServer::urls() const {
+    std::vector<std::string> out;
+    for (int p = 1; p <= opt.pages; ++p) out.push_back(url(p));
+    return out;
+}
+
+FixtureStats FixtureServer::stats() const {
+    FixtureStats s;
+    s.connections = connections.load();
+    s.requests = requests.load();
+    s.errors = errors.load();
+    s.throttled = throttled.load();
+    s.bodyBytes = bodyBytes.load();
+    return s;
+}
+
+void FixtureServer::acceptLoop() {
+    while (!stopping.load()) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (stopping.load()) break;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "[FixtureServer] accept failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ++connections;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            clientFds.push_back(fd);
+        }
+        std::thread(&FixtureServer::serve, this, fd).detach();
+    }
+}
+
+int FixtureServer::statusFor(int page) {
+    if (page < 1 || page > opt.pages) return 404;
+    if (hits[page - 1].fetch_add(1) > 0) return 200; // only the first request fails
+    double u = pageDraw(opt.seed, page);
+    if (u < opt.errorRate) return 500;
+    if (u < opt.errorRate + opt.throttleRate) return 429;
+    return 200;
+}
+
+void FixtureServer::serve(int fd) {
+    std::string in;
+    char buf[4096];
+    bool open = true;
+    while (open && !stopping.load()) {
+        size_t end;
+        while ((end = in.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                open = false;
+                break;
+            }
+            in.append(buf, static_cast<size_t>(n));
+        }
+        if (!open) break;
+        std::string head = in.substr(0, end);
+        in.erase(0, end + 4); // GET requests carry no body
+        ++requests;
+
+        size_t sp1 = head.find(' ');
+        size_t sp2 = sp1 == std::string::npos ? std::string::npos : head.find(' ', sp1 + 1);
+        std::string path = sp2 == std::string::npos ? std::string() : head.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::string lower(head);
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        bool keep = opt.keepAlive && lower.find("\r\nconnection: close") == std::string::npos;
+
+        if (opt.latency.count() > 0) std::this_thread::sleep_for(opt.latency);
+        int page = pageOf(path);
+        int status = statusFor(page);
+        if (status == 500) ++errors;
+        if (status == 429) ++throttled;
+        bool gz = status == 200 && opt.gzip && acceptsGzip(lower) && !gzipBodies[page - 1].empty();
+        const std::string* body = status != 200 ? nullptr : gz ? &gzipBodies[page - 1] : &bodies[page - 1];
+        if (body) bodyBytes += body->size();
+
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " " + reasonPhrase(status) + "\r\n";
+        response += "Content-Type: text/html; charset=utf-8\r\n";
+        if (gz) response += "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n";
+        response += "Content-Length: " + std::to_string(body ? body->size() : 0) + "\r\n";
+        if (status == 429 && opt.retryAfter > 0) response += "Retry-After: " + std::to_string(opt.retryAfter) + "\r\n";
+        response += keep ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        if (body) response += *body;
+        if (!sendAll(fd, response.data(), response.size())) break;
+        open = keep;
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    ::close(fd);
+    clientFds.erase(std::find(clientFds.begin(), clientFds.end(), fd));
+    clientsDone.notify_all();
+}
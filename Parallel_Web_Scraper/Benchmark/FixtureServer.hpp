@@ -0,0 +1,85 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 23:10
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FixtureOptions {
+    int pages = 50;                       // serves /catalogue/page-1.html .. page-N.html
+    int booksPerPage = 20;                // product_pod articles per page
+    std::chrono::milliseconds latency{ 0 }; // delay before every response
+    double errorRate = 0.0;               // share of pages whose first request gets a 500
+    double throttleRate = 0.0;            // share of pages whose first request gets a 429
+    int retryAfter = 0;                   // seconds sent with a 429, 0 = no Retry-After header
+    bool keepAlive = true;                // false: every response closes its connection
+    bool gzip = false;                    // gzip bodies for requests that accept it
+    uint64_t seed = 1;                    // picks the failing pages, so runs are repeatable
+};
+
+struct FixtureStats {
+    size_t connections = 0;
+    size_t requests = 0;
+    size_t errors = 0;    // 500 responses
+    size_t throttled = 0; // 429 responses
+    size_t bodyBytes = 0; // response bodies as sent (after gzip)
+};
+
+// In-process HTTP/1.1 server on 127.0.0.1 serving synthetic books.toscrape-style catalogue
+// pages, so benchmarks do not depend on the network. Pages are rendered once at start();
+// each connection gets its own thread. Which pages fail is derived from the seed, and only
+// the first request of a failing page fails, so a run with retries always completes.
+// POSIX sockets only.
+class FixtureServer {
+public:
+    explicit FixtureServer(FixtureOptions options = FixtureOptions());
+    ~FixtureServer();
+    FixtureServer(const FixtureServer&) = delete;
+    FixtureServer& operator=(const FixtureServer&) = delete;
+
+    // binds an ephemeral loopback port; false when the socket could not be set up
+    bool start();
+    void stop();
+    uint16_t port() const { return boundPort; }
+    // http://127.0.0.1:<port>/catalogue/page-<page>.html
+    std::string url(int page) const;
+    std::vector<std::string> urls() const;
+    FixtureStats stats() const;
+
+    // catalogue page as served: books product_pods with varied ratings, prices and titles
+    // (some with entities), links to the neighbouring pages
+    static std::string catalogPage(int page, int books, int pages);
+
+private:
+    FixtureOptions opt;
+    std::vector<std::string> bodies;
+    std::vector<std::string> gzipBodies; // with opt.gzip
+    std::unique_ptr<std::atomic<int>[]> hits; // requests per page
+    int listenFd = -1;
+    uint16_t boundPort = 0;
+    std::thread acceptThread;
+    std::atomic<bool> stopping{ false };
+
+    mutable std::mutex m;
+    std::condition_variable clientsDone;
+    std::vector<int> clientFds; // open connections, each served by a detached thread
+
+    std::atomic<size_t> connections{ 0 };
+    std::atomic<size_t> requests{ 0 };
+    std::atomic<size_t> errors{ 0 };
+    std::atomic<size_t> throttled{ 0 };
+    std::atomic<size_t> bodyBytes{ 0 };
+
+    void acceptLoop();
+    void serve(int fd);
+    // status code for this request of page (1-based)
+    int statusFor(int page);
+};
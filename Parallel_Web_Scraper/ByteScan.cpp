@@ -0,0 +1,316 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 12:40
+
+#include "ByteScan.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCAN_TARGET_AVX2
+#endif
+
+static constexpr size_t npos = std::string_view::npos;
+
+static inline char foldAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static inline bool isAsciiLetter(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+// haystack[pos..] starts with the lowercase pattern (ASCII case-insensitive)
+static inline bool matchesNoCase(std::string_view s, size_t pos, std::string_view lower) {
+    if (s.size() - pos < lower.size()) return false;
+    for (size_t k = 0; k < lower.size(); ++k) {
+        if (foldAscii(s[pos + k]) != lower[k]) return false;
+    }
+    return true;
+}
+
+// ------------------ candidate filter -------------------
+// An entry matches at position i when byte i equals `first` and byte i + offset equals `second`.
+// Letters are stored lowercase with fold mask 0x20 so that (byte | fold) == value ignores case.
+struct PairEntry {
+    uint8_t first = 0, firstFold = 0;
+    uint8_t second = 0, secondFold = 0;
+    size_t offset = 0;
+};
+
+struct PairFilter {
+    PairEntry entries[KeywordMatcher::MaxPatterns];
+    size_t count = 0;
+    size_t maxOffset = 0;
+
+    void add(char first, char second, size_t offset, bool noCase) {
+        PairEntry& e = entries[count++];
+        bool foldFirst = noCase && isAsciiLetter(first);
+        bool foldSecond = noCase && isAsciiLetter(second);
+        e.first = static_cast<uint8_t>(foldFirst ? foldAscii(first) : first);
+        e.firstFold = foldFirst ? 0x20 : 0x00;
+        e.second = static_cast<uint8_t>(foldSecond ? foldAscii(second) : second);
+        e.secondFold = foldSecond ? 0x20 : 0x00;
+        e.offset = offset;
+        maxOffset = std::max(maxOffset, offset);
+    }
+};
+
+static inline bool entryMatches(const char* p, size_t n, size_t i, const PairEntry& e) {
+    return i + e.offset < n
+        && (static_cast<uint8_t>(p[i]) | e.firstFold) == e.first
+        && (static_cast<uint8_t>(p[i + e.offset]) | e.secondFold) == e.second;
+}
+
+// all kernels return the first position in [from, n) where some entry matches, or n
+static size_t nextCandidateScalar(const char* p, size_t n, size_t from, const PairFilter& f) {
+    for (size_t i = from; i < n; ++i) {
+        for (size_t k = 0; k < f.count; ++k) {
+            if (entryMatches(p, n, i, f.entries[k])) return i;
+        }
+    }
+    return n;
+}
+
+#if SCAN_X86
+static inline unsigned lowestBit(uint32_t bits) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, bits);
+    return static_cast<unsigned>(idx);
+#else
+    return static_cast<unsigned>(__builtin_ctz(bits));
+#endif
+}
+
+static size_t nextCandidateSse2(const char* p, size_t n, size_t from, const PairFilter& f) {
+    size_t i = from;
+    __m128i first[KeywordMatcher::MaxPatterns], firstFold[KeywordMatcher::MaxPatterns];
+    __m128i second[KeywordMatcher::MaxPatterns], secondFold[KeywordMatcher::MaxPatterns];
+    for (size_t k = 0; k < f.count; ++k) {
+        first[k] = _mm_set1_epi8(static_cast<char>(f.entries[k].first));
+        firstFold[k] = _mm_set1_epi8(static_cast<char>(f.entries[k].firstFold));
+        second[k] = _mm_set1_epi8(static_cast<char>(f.entries[k].second));
+        secondFold[k] = _mm_set1_epi8(static_cast<char>(f.entries[k].secondFold));
+    }
+    for (; i + f.maxOffset + 16 <= n; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_setzero_si128();
+        for (size_t k = 0; k < f.count; ++k) {
+            __m128i eq = _mm_cmpeq_epi8(_mm_or_si128(block, firstFold[k]), first[k]);
+            if (f.entries[k].offset) {
+                const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + f.entries[k].offset));
+                eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_or_si128(tail, secondFold[k]), second[k]));
+            }
+            hits = _mm_or_si128(hits, eq);
+        }
+        uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (bits) return i + lowestBit(bits);
+    }
+    return nextCandidateScalar(p, n, i, f);
+}
+
+SCAN_TARGET_AVX2
+static size_t nextCandidateAvx2(const char* p, size_t n, size_t from, const PairFilter& f) {
+    size_t i = from;
+    __m256i first[KeywordMatcher::MaxPatterns], firstFold[KeywordMatcher::MaxPatterns];
+    __m256i second[KeywordMatcher::MaxPatterns], secondFold[KeywordMatcher::MaxPatterns];
+    for (size_t k = 0; k < f.count; ++k) {
+        first[k] = _mm256_set1_epi8(static_cast<char>(f.entries[k].first));
+        firstFold[k] = _mm256_set1_epi8(static_cast<char>(f.entries[k].firstFold));
+        second[k] = _mm256_set1_epi8(static_cast<char>(f.entries[k].second));
+        secondFold[k] = _mm256_set1_epi8(static_cast<char>(f.entries[k].secondFold));
+    }
+    for (; i + f.maxOffset + 32 <= n; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hits = _mm256_setzero_si256();
+        for (size_t k = 0; k < f.count; ++k) {
+            __m256i eq = _mm256_cmpeq_epi8(_mm256_or_si256(block, firstFold[k]), first[k]);
+            if (f.entries[k].offset) {
+                const __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + f.entries[k].offset));
+                eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_or_si256(tail, secondFold[k]), second[k]));
+            }
+            hits = _mm256_or_si256(hits, eq);
+        }
+        uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (bits) return i + lowestBit(bits);
+    }
+    return nextCandidateSse2(p, n, i, f);
+}
+#endif
+
+// ------------------ dispatch -------------------
+static ScanIsa detectIsa() {
+#if SCAN_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return ScanIsa::SSE2;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return ScanIsa::SSE2;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) ? ScanIsa::AVX2 : ScanIsa::SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? ScanIsa::AVX2 : ScanIsa::SSE2;
+#endif
+#else
+    return ScanIsa::Scalar;
+#endif
+}
+
+static ScanIsa bestIsa() {
+    static const ScanIsa best = detectIsa();
+    return best;
+}
+
+static std::atomic<int> forcedIsa{ -1 };
+
+ScanIsa scanActiveIsa() {
+    int forced = forcedIsa.load(std::memory_order_relaxed);
+    return forced < 0 ? bestIsa() : static_cast<ScanIsa>(forced);
+}
+
+void scanSelectIsa(ScanIsa isa) {
+    forcedIsa.store(static_cast<int>(std::min(isa, bestIsa())), std::memory_order_relaxed);
+}
+
+const char* scanIsaName(ScanIsa isa) {
+    switch (isa) {
+    case ScanIsa::AVX2: return "avx2";
+    case ScanIsa::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+static size_t nextCandidate(std::string_view s, size_t from, const PairFilter& f) {
+#if SCAN_X86
+    switch (scanActiveIsa()) {
+    case ScanIsa::AVX2: return nextCandidateAvx2(s.data(), s.size(), from, f);
+    case ScanIsa::SSE2: return nextCandidateSse2(s.data(), s.size(), from, f);
+    default: break;
+    }
+#endif
+    return nextCandidateScalar(s.data(), s.size(), from, f);
+}
+
+// ------------------ public search functions -------------------
+size_t scanFindByte(std::string_view s, char c, size_t from) {
+    if (from >= s.size()) return npos;
+    PairFilter f;
+    f.add(c, c, 0, false);
+    size_t pos = nextCandidate(s, from, f);
+    return pos < s.size() ? pos : npos;
+}
+
+size_t scanFindAnyOf(std::string_view s, std::string_view set, size_t from) {
+    if (from >= s.size() || set.empty()) return npos;
+    if (set.size() > KeywordMatcher::MaxPatterns)
+        throw std::length_error("scanFindAnyOf supports at most 8 bytes");
+    PairFilter f;
+    for (char c : set) f.add(c, c, 0, false);
+    size_t pos = nextCandidate(s, from, f);
+    return pos < s.size() ? pos : npos;
+}
+
+size_t scanFindNoCase(std::string_view haystack, std::string_view needle, size_t from) {
+    if (needle.empty()) return from <= haystack.size() ? from : npos;
+    if (from >= haystack.size() || haystack.size() - from < needle.size()) return npos;
+
+    char lower[64];
+    std::string heapLower;
+    const char* lowered = lower;
+    if (needle.size() <= sizeof(lower)) {
+        for (size_t k = 0; k < needle.size(); ++k) lower[k] = foldAscii(needle[k]);
+    }
+    else {
+        heapLower.resize(needle.size());
+        for (size_t k = 0; k < needle.size(); ++k) heapLower[k] = foldAscii(needle[k]);
+        lowered = heapLower.data();
+    }
+    std::string_view pattern(lowered, needle.size());
+
+    // first/last byte filter, candidates verified with a full compare
+    PairFilter f;
+    f.add(pattern.front(), pattern.back(), pattern.size() - 1, true);
+    for (size_t pos = from; pos < haystack.size();) {
+        size_t cand = nextCandidate(haystack, pos, f);
+        if (cand >= haystack.size()) break;
+        if (matchesNoCase(haystack, cand, pattern)) return cand;
+        pos = cand + 1;
+    }
+    return npos;
+}
+
+// ------------------ KeywordMatcher -------------------
+KeywordMatcher::KeywordMatcher(std::initializer_list<std::string_view> keywords) {
+    if (keywords.size() > MaxPatterns)
+        throw std::length_error("KeywordMatcher supports at most 8 keywords");
+    for (std::string_view k : keywords) {
+        if (k.empty()) continue;
+        std::string lowered(k);
+        for (char& c : lowered) c = foldAscii(c);
+        patterns.push_back(std::move(lowered));
+    }
+}
+
+void KeywordMatcher::findFirst(std::string_view text, size_t* firstPos, size_t from) const {
+    PairFilter f;
+    size_t owner[MaxPatterns];
+    auto rebuild = [&]() {
+        f = PairFilter();
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            if (firstPos[i] != npos) continue;
+            owner[f.count] = i;
+            f.add(patterns[i].front(), patterns[i].back(), patterns[i].size() - 1, true);
+        }
+    };
+
+    for (size_t i = 0; i < patterns.size(); ++i) firstPos[i] = npos;
+    rebuild();
+    for (size_t pos = from; f.count > 0 && pos < text.size();) {
+        size_t cand = nextCandidate(text, pos, f);
+        if (cand >= text.size()) break;
+        bool found = false;
+        for (size_t k = 0; k < f.count; ++k) {
+            size_t i = owner[k];
+            if (matchesNoCase(text, cand, patterns[i])) {
+                firstPos[i] = cand;
+                found = true;
+            }
+        }
+        if (found) rebuild(); // drop patterns that no longer need to be searched
+        pos = cand + 1;
+    }
+}
+
+void KeywordMatcher::count(std::string_view text, size_t* counts) const {
+    PairFilter f;
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        counts[i] = 0;
+        f.add(patterns[i].front(), patterns[i].back(), patterns[i].size() - 1, true);
+    }
+    if (f.count == 0) return;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t cand = nextCandidate(text, pos, f);
+        if (cand >= text.size()) break;
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            if (matchesNoCase(text, cand, patterns[i])) ++counts[i];
+        }
+        pos = cand + 1;
+    }
+}
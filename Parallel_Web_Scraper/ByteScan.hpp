@@ -0,0 +1,48 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 12:40
+
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Vectorized byte scanning used by the Analyzer hot path.
+// Every function has an AVX2, an SSE2 and a scalar implementation; the widest one the CPU
+// supports is picked at first use. Case-insensitive variants fold ASCII letters only.
+
+enum class ScanIsa { Scalar, SSE2, AVX2 };
+
+ScanIsa scanActiveIsa();
+// force a narrower implementation (benchmarks, checks against the scalar reference);
+// requests the CPU cannot run are clamped to the best supported one
+void scanSelectIsa(ScanIsa isa);
+const char* scanIsaName(ScanIsa isa);
+
+// first position >= from holding c, or npos
+size_t scanFindByte(std::string_view s, char c, size_t from = 0);
+// first position >= from holding any byte of set (at most 8 bytes), or npos
+size_t scanFindAnyOf(std::string_view s, std::string_view set, size_t from = 0);
+// ASCII case-insensitive substring search without allocation, or npos
+size_t scanFindNoCase(std::string_view haystack, std::string_view needle, size_t from = 0);
+
+// Case-insensitive search for several keywords in one pass over the text.
+class KeywordMatcher {
+public:
+    static constexpr size_t MaxPatterns = 8;
+
+    KeywordMatcher(std::initializer_list<std::string_view> keywords);
+    size_t size() const { return patterns.size(); }
+    const std::string& pattern(size_t i) const { return patterns[i]; }
+
+    // firstPos[i] = first occurrence of pattern i at or after from (npos if absent);
+    // the scan stops as soon as every pattern has been seen
+    void findFirst(std::string_view text, size_t* firstPos, size_t from = 0) const;
+    // counts[i] = number of occurrences of pattern i (overlapping occurrences included)
+    void count(std::string_view text, size_t* counts) const;
+
+private:
+    std::vector<std::string> patterns; // lowercased, non-empty
+};
@@ -1,12 +1,20 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:09
+// Date and time of the last changes: 17.10.2026. 23:40
 
 #pragma once
 #include <string>
+#include <string_view>
 
 struct BookRecord {
     std::string title;
     double price = 0.0;
     int rating = 0;
+};
+
+// one book whose title lives elsewhere (a page's arena, the record store)
+struct BookView {
+    std::string_view title;
+    double price = 0.0;
+    int rating = 0;
 };
\ No newline at end of file
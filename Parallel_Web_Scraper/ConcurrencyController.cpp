@@ -0,0 +1,72 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 19:40
+
+#include "ConcurrencyController.hpp"
+#include <algorithm>
+#include <cmath>
+
+ConcurrencyController::ConcurrencyController(Options options)
+    : opt(options), current(0), limitValue(0.0) {
+    opt.minLimit = std::max<size_t>(opt.minLimit, 1);
+    opt.maxLimit = std::max(opt.maxLimit, opt.minLimit);
+    limitValue = static_cast<double>(std::min(std::max(opt.initial, opt.minLimit), opt.maxLimit));
+    current.store(static_cast<size_t>(limitValue), std::memory_order_relaxed);
+    start = windowStart = std::chrono::steady_clock::now();
+    points.push_back({ 0.0, current.load(), 0.0, 0.0, 0, 0 });
+}
+
+void ConcurrencyController::onSample(std::chrono::microseconds latency, bool error) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m);
+    if (error) {
+        ++windowErrors;
+    }
+    else {
+        double ms = latency.count() / 1000.0;
+        windowSum += ms;
+        ++windowCount;
+        // long-term baseline: ~600-sample exponential average, seeded by the first sample
+        longRtt = (longRtt == 0.0) ? ms : longRtt + (ms - longRtt) * (2.0 / 601.0);
+    }
+    if (windowCount + windowErrors >= opt.windowSamples && now - windowStart >= opt.windowTime)
+        updateLocked(now);
+}
+
+void ConcurrencyController::updateLocked(std::chrono::steady_clock::time_point now) {
+    double shortRtt = windowCount ? windowSum / windowCount : 0.0;
+    size_t pendingAnalysis = backlog.load(std::memory_order_relaxed);
+
+    double next;
+    if (windowErrors > 0) {
+        next = limitValue * opt.errorBackoff; // the server pushes back: multiplicative decrease
+    }
+    else {
+        double gradient = (shortRtt > 0.0) ? std::min(1.0, std::max(0.5, longRtt / shortRtt)) : 1.0;
+        double target = limitValue * gradient + std::sqrt(limitValue);
+        next = limitValue * (1.0 - opt.smoothing) + target * opt.smoothing;
+        if (pendingAnalysis > opt.backlogHigh) next = std::min(next, limitValue);
+    }
+    limitValue = std::min(std::max(next, static_cast<double>(opt.minLimit)), static_cast<double>(opt.maxLimit));
+    current.store(static_cast<size_t>(limitValue), std::memory_order_relaxed);
+
+    points.push_back({ std::chrono::duration<double>(now - start).count(), current.load(),
+        shortRtt, longRtt, windowErrors, pendingAnalysis });
+    windowSum = 0.0;
+    windowCount = 0;
+    windowErrors = 0;
+    windowStart = now;
+}
+
+std::vector<ConcurrencyController::TracePoint> ConcurrencyController::trace() const {
+    std::lock_guard<std::mutex> lock(m);
+    return points;
+}
+
+void ConcurrencyController::writeTrace(std::ostream& out) const {
+    out << "seconds,limit,short_rtt_ms,long_rtt_ms,errors,backlog\n";
+    for (const auto& p : trace()) {
+        out << p.seconds << "," << p.limit << "," << p.shortRttMs << "," << p.longRttMs
+            << "," << p.errors << "," << p.backlog << "\n";
+    }
+}
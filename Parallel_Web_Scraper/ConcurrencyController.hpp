@@ -0,0 +1,72 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 19:40
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Adaptive limit for the number of pages being downloaded at once (gradient algorithm in
+// the style of Netflix's concurrency-limits "Gradient2", with multiplicative decrease on errors).
+//   gradient = clamp(longRtt / shortRtt, 0.5, 1)   // < 1 once the remote side starts queueing
+//   target   = limit * gradient + sqrt(limit)      // sqrt(limit) probes for more headroom
+//   limit    = 0.8 * limit + 0.2 * target         // smoothed
+// A window with 429s or failures cuts the limit by errorBackoff instead; an analysis backlog
+// above backlogHigh pages stops growth, since more downloads would only queue for the CPU.
+// Samples arrive from the downloader's I/O thread, limit() is read by any thread.
+class ConcurrencyController {
+public:
+    struct Options {
+        size_t initial = 16;
+        size_t minLimit = 2;
+        size_t maxLimit = 256;
+        size_t windowSamples = 16;                     // samples per update...
+        std::chrono::milliseconds windowTime{ 50 };    // ...and at least this much time
+        double smoothing = 0.2;
+        double errorBackoff = 0.9;
+        size_t backlogHigh = 64;
+    };
+
+    // one chosen limit, as written to the trace
+    struct TracePoint {
+        double seconds;
+        size_t limit;
+        double shortRttMs;
+        double longRttMs;
+        size_t errors;
+        size_t backlog;
+    };
+
+    explicit ConcurrencyController(Options options);
+
+    size_t limit() const { return current.load(std::memory_order_relaxed); }
+    // one finished download attempt; error = transport failure, 429 or 5xx
+    void onSample(std::chrono::microseconds latency, bool error);
+    // pages downloaded but not yet analyzed
+    void setBacklog(size_t pages) { backlog.store(pages, std::memory_order_relaxed); }
+
+    std::vector<TracePoint> trace() const;
+    // CSV: seconds,limit,short_rtt_ms,long_rtt_ms,errors,backlog
+    void writeTrace(std::ostream& out) const;
+
+private:
+    Options opt;
+    std::atomic<size_t> current;
+    std::atomic<size_t> backlog{ 0 };
+
+    mutable std::mutex m;
+    double limitValue;
+    double longRtt = 0.0; // exponential average over ~600 samples, in ms
+    double windowSum = 0.0;
+    size_t windowCount = 0;
+    size_t windowErrors = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point windowStart;
+    std::vector<TracePoint> points;
+
+    // expects m to be held
+    void updateLocked(std::chrono::steady_clock::time_point now);
+};
@@ -0,0 +1,385 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#include "CrawlCheckpoint.hpp"
+#include "Log.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char snapshotMagic[8] = { 'P', 'W', 'S', 'S', 'N', 'A', 'P', '1' };
+
+// little-endian fixed-width fields, so the files move between machines
+void putU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+void putU64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+void putF64(std::string& out, double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    putU64(out, bits);
+}
+
+void putStr(std::string& out, std::string_view s) {
+    putU32(out, static_cast<uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+struct Reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    bool need(size_t n) {
+        if (static_cast<size_t>(end - p) < n) ok = false;
+        return ok;
+    }
+    uint32_t u32() {
+        if (!need(4)) return 0;
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+        p += 4;
+        return v;
+    }
+    uint64_t u64() {
+        uint64_t lo = u32();
+        return lo | (static_cast<uint64_t>(u32()) << 32);
+    }
+    double f64() {
+        uint64_t bits = u64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string str() {
+        uint32_t n = u32();
+        if (!need(n)) return {};
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+uint32_t checksum(const std::string& data) {
+    uint32_t h = 2166136261u; // FNV-1a 32
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// [payload length][checksum][payload]
+std::string frame(const std::string& payload) {
+    std::string out;
+    out.reserve(payload.size() + 8);
+    putU32(out, static_cast<uint32_t>(payload.size()));
+    putU32(out, checksum(payload));
+    out += payload;
+    return out;
+}
+
+// calls fn(payload) for every intact frame from offset on; returns where the intact part ends
+template <typename Fn>
+size_t readFrames(const std::string& file, size_t offset, Fn fn) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return 0;
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t at = offset;
+    while (data.size() - at >= 8) {
+        Reader header{ data.data() + at, data.data() + data.size() };
+        uint32_t len = header.u32();
+        uint32_t sum = header.u32();
+        if (data.size() - at - 8 < len) break;
+        std::string payload = data.substr(at + 8, len);
+        if (checksum(payload) != sum) break;
+        fn(payload);
+        at += 8 + len;
+    }
+    return at;
+}
+
+std::string encodeAdmission(const std::string& url, int depth) {
+    std::string payload;
+    putU32(payload, static_cast<uint32_t>(depth));
+    putStr(payload, url);
+    return frame(payload);
+}
+
+} // namespace
+
+CrawlCheckpoint::CrawlCheckpoint(std::string dir, std::chrono::milliseconds interval)
+    : dir(std::move(dir)), interval(std::max(interval, std::chrono::milliseconds(10))) {
+}
+
+CrawlCheckpoint::~CrawlCheckpoint() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    writeSnapshot(); // a clean shutdown leaves an empty frontier.log, so resuming reads less
+}
+
+std::string CrawlCheckpoint::path(const char* name) const {
+    return (fs::path(dir) / name).string();
+}
+
+bool CrawlCheckpoint::create() {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    fs::remove(path("frontier.log"), ec);
+    fs::remove(path("frontier.snap"), ec);
+    pagesOut.open(path("pages.log"), std::ios::binary | std::ios::trunc);
+    if (!pagesOut || !writeSnapshot()) {
+        LOG_ERROR("CrawlCheckpoint", "Cannot write checkpoint files in {}", dir);
+        return false;
+    }
+    start();
+    return true;
+}
+
+bool CrawlCheckpoint::resume(UrlManager& urls, Storage& storage, Restored& out) {
+    std::ifstream snap(path("frontier.snap"), std::ios::binary);
+    char magic[sizeof(snapshotMagic)] = {};
+    if (!snap.read(magic, sizeof(magic)) || std::memcmp(magic, snapshotMagic, sizeof(magic)) != 0) {
+        LOG_ERROR("CrawlCheckpoint", "No checkpoint to resume in {}", dir);
+        return false;
+    }
+    snap.close();
+
+    auto readAdmission = [this](const std::string& payload) {
+        Reader r{ payload.data(), payload.data() + payload.size() };
+        int depth = static_cast<int>(r.u32());
+        std::string url = r.str();
+        if (r.ok) notePending(url, depth);
+    };
+    readFrames(path("frontier.snap"), sizeof(snapshotMagic), readAdmission);
+    readFrames(path("frontier.log"), 0, readAdmission);
+
+    std::vector<BookRecord> records;
+    size_t intact = readFrames(path("pages.log"), 0, [&](const std::string& payload) {
+        Reader r{ payload.data(), payload.data() + payload.size() };
+        std::string url = r.str();
+        AnalysisResult result;
+        result.fiveStarBooks = static_cast<int>(r.u32());
+        result.totalPrice = r.f64();
+        result.bookCount = static_cast<int>(r.u32());
+        result.priceOver50 = static_cast<int>(r.u32());
+        result.containsPoem = static_cast<int>(r.u32());
+        result.maxPrice = r.f64();
+        result.maxPriceTitle = r.str();
+        uint32_t n = r.u32();
+        records.clear();
+        for (uint32_t i = 0; i < n && r.ok; ++i) {
+            BookRecord br;
+            br.title = r.str();
+            br.price = r.f64();
+            br.rating = static_cast<int>(r.u32());
+            records.push_back(std::move(br));
+        }
+        if (!r.ok) return;
+        storage.storeResult(result);
+        storage.storeRecords(records);
+        storage.incrementPagesProcessed();
+        urls.addUrl(url);
+        noteCompleted(url);
+        ++out.pages;
+        out.records += records.size();
+    });
+    std::error_code ec;
+    if (fs::exists(path("pages.log"), ec) && fs::file_size(path("pages.log"), ec) > intact) {
+        LOG_WARN("CrawlCheckpoint", "Dropping a torn entry at the end of pages.log");
+        fs::resize_file(path("pages.log"), intact, ec);
+    }
+
+    for (const auto& item : pendingOrder) {
+        if (item.url.empty()) continue;
+        urls.addUrl(item.url);
+        out.pending.push_back(item);
+    }
+
+    pagesOut.open(path("pages.log"), std::ios::binary | std::ios::app);
+    if (!pagesOut || !writeSnapshot()) {
+        LOG_ERROR("CrawlCheckpoint", "Cannot write checkpoint files in {}", dir);
+        return false;
+    }
+    start();
+    return true;
+}
+
+void CrawlCheckpoint::start() {
+    worker = std::thread(&CrawlCheckpoint::run, this);
+}
+
+void CrawlCheckpoint::admitted(const CrawlFrontier::Item& item) {
+    Event e;
+    e.url = item.url;
+    e.depth = item.depth;
+    e.frame = encodeAdmission(item.url, item.depth);
+    if (budget) budget->charge(e.bytes());
+    queue.push(std::move(e));
+    ++enqueued;
+}
+
+void CrawlCheckpoint::pageCompleted(const std::string& url, const std::vector<BookView>& records,
+    const AnalysisResult& result) {
+    std::string payload;
+    payload.reserve(64 + url.size() + records.size() * 64);
+    putStr(payload, url);
+    putU32(payload, static_cast<uint32_t>(result.fiveStarBooks));
+    putF64(payload, result.totalPrice);
+    putU32(payload, static_cast<uint32_t>(result.bookCount));
+    putU32(payload, static_cast<uint32_t>(result.priceOver50));
+    putU32(payload, static_cast<uint32_t>(result.containsPoem));
+    putF64(payload, result.maxPrice);
+    putStr(payload, result.maxPriceTitle);
+    putU32(payload, static_cast<uint32_t>(records.size()));
+    for (const auto& br : records) {
+        putStr(payload, br.title);
+        putF64(payload, br.price);
+        putU32(payload, static_cast<uint32_t>(br.rating));
+    }
+    Event e;
+    e.page = true;
+    e.url = url;
+    e.frame = frame(payload);
+    if (budget) budget->charge(e.bytes());
+    queue.push(std::move(e));
+    ++enqueued;
+}
+
+void CrawlCheckpoint::flush() {
+    if (!worker.joinable()) return;
+    uint64_t target = enqueued.load();
+    std::unique_lock<std::mutex> lock(m);
+    flushRequested = true;
+    wake.notify_all();
+    written.wait(lock, [&] { return writtenCount >= target; });
+}
+
+CheckpointStats CrawlCheckpoint::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return counters;
+}
+
+void CrawlCheckpoint::run() {
+    std::unique_lock<std::mutex> lock(m);
+    for (;;) {
+        wake.wait_for(lock, interval, [this] { return stopping || flushRequested; });
+        bool last = stopping;
+        flushRequested = false;
+        lock.unlock();
+        writeBatch();
+        lock.lock();
+        if (last) break;
+    }
+}
+
+void CrawlCheckpoint::writeBatch() {
+    std::string frontierBuf, pagesBuf;
+    size_t events = 0, pages = 0, admissions = 0;
+    Event e;
+    while (queue.try_pop(e)) {
+        ++events;
+        if (e.page) {
+            pagesBuf += e.frame;
+            noteCompleted(e.url);
+            ++pages;
+        }
+        else {
+            frontierBuf += e.frame;
+            notePending(e.url, e.depth);
+            ++admissions;
+        }
+        if (budget) budget->release(e.bytes());
+    }
+    // admissions first: a page must never be on disk without the links it admitted
+    if (!frontierBuf.empty()) {
+        frontierOut.write(frontierBuf.data(), static_cast<std::streamsize>(frontierBuf.size()));
+        frontierOut.flush();
+        frontierLogBytes += frontierBuf.size();
+    }
+    if (!pagesBuf.empty()) {
+        pagesOut.write(pagesBuf.data(), static_cast<std::streamsize>(pagesBuf.size()));
+        pagesOut.flush();
+    }
+    if (!frontierOut || !pagesOut) LOG_ERROR("CrawlCheckpoint", "Write failed in {}", dir);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        counters.pagesLogged += pages;
+        counters.admissionsLogged += admissions;
+        counters.bytesWritten += frontierBuf.size() + pagesBuf.size();
+    }
+    if (frontierLogBytes > std::max<size_t>(snapshotBytes, 1 << 20)) writeSnapshot();
+    {
+        std::lock_guard<std::mutex> lock(m);
+        writtenCount += events;
+    }
+    written.notify_all();
+}
+
+void CrawlCheckpoint::notePending(const std::string& url, int depth) {
+    if (pendingIndex.count(url)) return;
+    pendingIndex.emplace(url, pendingOrder.size());
+    pendingOrder.push_back(CrawlFrontier::Item{ url, depth });
+}
+
+void CrawlCheckpoint::noteCompleted(const std::string& url) {
+    auto it = pendingIndex.find(url);
+    if (it == pendingIndex.end()) return;
+    pendingOrder[it->second].url.clear();
+    pendingIndex.erase(it);
+}
+
+bool CrawlCheckpoint::writeSnapshot() {
+    // drop completed entries, keeping admission order
+    std::vector<CrawlFrontier::Item> live;
+    live.reserve(pendingIndex.size());
+    for (auto& item : pendingOrder) {
+        if (!item.url.empty()) live.push_back(std::move(item));
+    }
+    pendingOrder = std::move(live);
+    pendingIndex.clear();
+    for (size_t i = 0; i < pendingOrder.size(); ++i) pendingIndex.emplace(pendingOrder[i].url, i);
+
+    std::string tmp = path("frontier.snap.tmp");
+    {
+        std::ofstream snap(tmp, std::ios::binary | std::ios::trunc);
+        snap.write(snapshotMagic, sizeof(snapshotMagic));
+        snapshotBytes = sizeof(snapshotMagic);
+        for (const auto& item : pendingOrder) {
+            std::string f = encodeAdmission(item.url, item.depth);
+            snap.write(f.data(), static_cast<std::streamsize>(f.size()));
+            snapshotBytes += f.size();
+        }
+        if (!snap.flush()) return false;
+    }
+    // the new snapshot already covers frontier.log, so replaying the old log over it after a
+    // crash between these two steps only repeats admissions that are already known
+    std::error_code ec;
+    fs::rename(tmp, path("frontier.snap"), ec);
+    if (ec) {
+        fs::remove(path("frontier.snap"), ec);
+        fs::rename(tmp, path("frontier.snap"), ec);
+        if (ec) return false;
+    }
+    if (frontierOut.is_open()) frontierOut.close();
+    frontierOut.open(path("frontier.log"), std::ios::binary | std::ios::trunc);
+    frontierLogBytes = 0;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++counters.snapshots;
+    return static_cast<bool>(frontierOut);
+}
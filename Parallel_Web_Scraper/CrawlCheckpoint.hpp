@@ -0,0 +1,113 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#pragma once
+#include "Analyzer.hpp"
+#include "Common.hpp"
+#include "CrawlFrontier.hpp"
+#include "MemoryBudget.hpp"
+#include "Storage.hpp"
+#include "UrlManager.hpp"
+
+#include <tbb/concurrent_queue.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct CheckpointStats {
+    size_t pagesLogged = 0;     // completed pages appended to pages.log
+    size_t admissionsLogged = 0; // frontier admissions appended to frontier.log
+    size_t snapshots = 0;       // frontier.snap rewrites
+    size_t bytesWritten = 0;
+};
+
+// Crawl state kept in a directory so a crashed or interrupted run can be resumed:
+//   pages.log      append-only; per completed page its URL, page aggregate and records
+//   frontier.snap  compact list of the admitted pages that were not completed (URL + depth)
+//   frontier.log   append-only admissions since frontier.snap was written
+// Every entry is length-prefixed and checksummed, so a torn tail left by a crash is dropped
+// on load. Callers only serialize and enqueue; a background thread appends the queued
+// entries every interval and rewrites frontier.snap (emptying frontier.log) once the log
+// outgrows it. Entries reach the OS on every write, so a dead process loses nothing it had
+// handed over before the last interval.
+class CrawlCheckpoint {
+public:
+    struct Restored {
+        std::vector<CrawlFrontier::Item> pending; // admitted, not completed: fetch these
+        size_t pages = 0;                         // completed pages put back into storage
+        size_t records = 0;
+    };
+
+    CrawlCheckpoint(std::string dir, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    ~CrawlCheckpoint();
+    CrawlCheckpoint(const CrawlCheckpoint&) = delete;
+    CrawlCheckpoint& operator=(const CrawlCheckpoint&) = delete;
+
+    // starts a new checkpoint, replacing whatever the directory held
+    bool create();
+    // loads the directory: completed pages go to storage, every known URL to urls; the
+    // pages still to fetch are returned in out. Starts a new frontier.snap generation.
+    bool resume(UrlManager& urls, Storage& storage, Restored& out);
+
+    // thread-safe, never blocks on I/O
+    void admitted(const CrawlFrontier::Item& item);
+    void pageCompleted(const std::string& url, const std::vector<BookView>& records, const AnalysisResult& result);
+    // blocks until everything enqueued so far has been written
+    void flush();
+    CheckpointStats stats() const;
+    // queued entries are charged to budget until written; set before anything is enqueued,
+    // nullptr = not accounted
+    void setBudget(MemoryBudget* memory) { budget = memory; }
+
+private:
+    struct Event {
+        bool page = false;      // pages.log entry, otherwise an admission
+        std::string url;
+        int depth = 0;
+        std::string frame;      // encoded entry, ready to append
+
+        size_t bytes() const { return url.size() + frame.size(); }
+    };
+
+    std::string dir;
+    std::chrono::milliseconds interval;
+    tbb::concurrent_queue<Event> queue;
+    std::atomic<uint64_t> enqueued{ 0 };
+    MemoryBudget* budget = nullptr;
+
+    std::mutex m;
+    std::condition_variable wake;
+    std::condition_variable written;
+    uint64_t writtenCount = 0;
+    bool flushRequested = false;
+    bool stopping = false;
+    std::thread worker;
+
+    // owned by the worker thread (or the caller before the worker starts)
+    std::ofstream pagesOut;
+    std::ofstream frontierOut;
+    size_t frontierLogBytes = 0;
+    size_t snapshotBytes = 0;
+    std::vector<CrawlFrontier::Item> pendingOrder; // admission order; completed items have empty url
+    std::unordered_map<std::string, size_t> pendingIndex;
+
+    mutable std::mutex statsMutex;
+    CheckpointStats counters;
+
+    std::string path(const char* name) const;
+    void start();
+    void run();
+    void writeBatch();
+    void notePending(const std::string& url, int depth);
+    void noteCompleted(const std::string& url);
+    // rewrites frontier.snap from the pending set and truncates frontier.log
+    bool writeSnapshot();
+};
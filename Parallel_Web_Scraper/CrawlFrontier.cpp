@@ -0,0 +1,89 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 21:40
+
+#include "CrawlFrontier.hpp"
+#include "Downloader.hpp"
+
+CrawlFrontier::CrawlFrontier(UrlManager& urls, int max_depth, size_t max_pages, std::string scope)
+    : urls(urls), maxDepth(max_depth), maxPages(max_pages), scope(std::move(scope)) {
+}
+
+void CrawlFrontier::enqueueLocked(Item item) {
+    if (admitObserver) admitObserver(item);
+    std::string host = hostOf(item.url);
+    auto& queue = queues[host];
+    if (queue.empty()) ready.push_back(host);
+    queue.push_back(std::move(item));
+    ++admittedCount;
+    ++outstanding;
+}
+
+void CrawlFrontier::seed(const std::vector<std::string>& seeds) {
+    std::lock_guard<std::mutex> lock(m);
+    for (const auto& url : seeds) {
+        if (maxPages > 0 && admittedCount >= maxPages) break;
+        enqueueLocked(Item{ url, 0 });
+    }
+}
+
+void CrawlFrontier::restore(const std::vector<Item>& pending, size_t completed) {
+    std::lock_guard<std::mutex> lock(m);
+    AdmitObserver observer = std::move(admitObserver);
+    admitObserver = nullptr;
+    for (const auto& item : pending) enqueueLocked(item);
+    admitObserver = std::move(observer);
+    admittedCount += completed;
+}
+
+size_t CrawlFrontier::addLinks(const Item& from, const std::vector<std::string>& hrefs) {
+    if (!followsLinks(from.depth)) return 0;
+    size_t added = 0;
+    std::string canonical;
+    for (const auto& href : hrefs) {
+        std::string url = resolveUrl(from.url, href);
+        // scope is matched on the same canonical form the dedupe uses
+        if (url.empty() || !canonicalizeUrl(url, canonical)) continue;
+        if (canonical.compare(0, scope.size(), scope) != 0) continue;
+
+        // budget check and dedupe together, so the budget is never overshot
+        std::lock_guard<std::mutex> lock(m);
+        if (maxPages > 0 && admittedCount >= maxPages) break;
+        if (!urls.addUrl(canonical)) continue;
+        enqueueLocked(Item{ canonical, from.depth + 1 });
+        ++added;
+    }
+    return added;
+}
+
+bool CrawlFrontier::next(Item& item) {
+    std::lock_guard<std::mutex> lock(m);
+    if (ready.empty()) return false;
+    std::string host = std::move(ready.front());
+    ready.pop_front();
+    auto& queue = queues[host];
+    item = std::move(queue.front());
+    queue.pop_front();
+    if (!queue.empty()) ready.push_back(std::move(host));
+    return true;
+}
+
+bool CrawlFrontier::pageDone() {
+    std::lock_guard<std::mutex> lock(m);
+    return outstanding > 0 && --outstanding == 0;
+}
+
+bool CrawlFrontier::finished() const {
+    std::lock_guard<std::mutex> lock(m);
+    return outstanding == 0;
+}
+
+size_t CrawlFrontier::admitted() const {
+    std::lock_guard<std::mutex> lock(m);
+    return admittedCount;
+}
+
+size_t CrawlFrontier::hosts() const {
+    std::lock_guard<std::mutex> lock(m);
+    return queues.size();
+}
@@ -0,0 +1,67 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 21:40
+
+#pragma once
+#include "UrlManager.hpp"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Concurrent crawl frontier. URLs found on fetched pages are admitted once (dedupe through
+// the UrlManager), limited by depth, page budget and a URL prefix, and queued per host.
+// next() takes hosts in round-robin order so one large host cannot starve the others.
+// Every admitted page stays outstanding until pageDone(); the crawl is complete when none is.
+class CrawlFrontier {
+public:
+    struct Item {
+        std::string url;
+        int depth = 0;
+    };
+
+    // sees every admission (seeds and links), called with the frontier lock held
+    using AdmitObserver = std::function<void(const Item&)>;
+
+    // max_depth < 0: no depth limit; max_pages == 0: no page budget; empty scope: any http(s) URL
+    CrawlFrontier(UrlManager& urls, int max_depth, size_t max_pages, std::string scope);
+
+    // queue URLs that are already known to the UrlManager (the seeds) at depth 0
+    void seed(const std::vector<std::string>& seeds);
+    // queue pages admitted by an earlier, interrupted run (not passed to the observer) and
+    // count its completed pages against the page budget
+    void restore(const std::vector<Item>& pending, size_t completed);
+    void setAdmitObserver(AdmitObserver observer) { admitObserver = std::move(observer); }
+    // resolve the links found on page from (fetched at depth) and admit the new ones;
+    // returns how many were admitted
+    size_t addLinks(const Item& from, const std::vector<std::string>& hrefs);
+    // links of a page at this depth would still be admitted
+    bool followsLinks(int depth) const { return maxDepth < 0 || depth < maxDepth; }
+
+    // next URL to fetch; false when nothing is queued right now
+    bool next(Item& item);
+    // the page has been fully processed and its links added; true when it was the last one
+    bool pageDone();
+    bool finished() const;
+
+    size_t admitted() const;
+    size_t hosts() const;
+
+private:
+    UrlManager& urls;
+    int maxDepth;
+    size_t maxPages;
+    std::string scope;
+
+    mutable std::mutex m;
+    std::unordered_map<std::string, std::deque<Item>> queues; // per host
+    std::deque<std::string> ready;                            // hosts with queued URLs, round-robin
+    size_t admittedCount = 0;
+    size_t outstanding = 0; // admitted and not yet passed to pageDone()
+    AdmitObserver admitObserver;
+
+    // expects m to be held
+    void enqueueLocked(Item item);
+};
@@ -1,72 +1,373 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:11
+// Date and time of the last changes: 18.10.2026. 05:30
 
 #include "Downloader.hpp"
+#include "Log.hpp"
+#include "PageArchive.hpp"
 #include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <memory>
 #include <stdexcept>
 #include <thread>
 #include <chrono>
-#include <iostream>
+#include <utility>
 
-Downloader::Downloader(int timeout_seconds, int max_retries)
-    : timeoutSec(timeout_seconds), maxRetries(max_retries) {
+Downloader::Downloader(int timeout_seconds, int max_retries, bool use_http2, bool compressed)
+    : timeoutSec(timeout_seconds), maxRetries(max_retries), http2(use_http2), compress(compressed) {
+    share = curl_share_init();
+    if (!share) {
+        LOG_ERROR("Downloader", "curl_share_init failed, caches will not be shared");
+        return;
+    }
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &Downloader::lockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &Downloader::unlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // not CURL_LOCK_DATA_CONNECT: libcurl does not allow a shared connection cache to be used
+    // by transfers running at the same time in different threads, lock callbacks or not
+}
+
+Downloader::~Downloader() {
+    for (auto& entry : idleHandles) {
+        for (CURL* curl : entry.second) curl_easy_cleanup(curl);
+    }
+    if (share) curl_share_cleanup(share);
+}
+
+void Downloader::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<Downloader*>(userptr)->shareLocks[data].lock();
+}
+
+void Downloader::unlockShare(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<Downloader*>(userptr)->shareLocks[data].unlock();
+}
+
+std::string hostOf(const std::string& url) {
+    size_t begin = url.find("://");
+    begin = (begin == std::string::npos) ? 0 : begin + 3;
+    size_t end = url.find_first_of("/?#", begin);
+    return url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+void StringSink::onExpectedSize(uint64_t bytes) {
+    body.reserve(static_cast<size_t>(std::min(bytes, maxPresize)));
+}
+
+void Downloader::attachSink(CURL* curl, BodySink* sink) const {
+    sink->handle = curl;
+    sink->limit = maxPageBytes;
+    sink->overLimit = false;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &Downloader::writeToSink);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, sink);
 }
 
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
+size_t Downloader::writeToSink(char* data, size_t size, size_t nmemb, void* sink) {
+    try {
+        auto* target = static_cast<BodySink*>(sink);
+        if (target->delivered == 0 && target->handle) { // first chunk: the headers are in
+            curl_off_t length = -1;
+            curl_easy_getinfo(target->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+            if (length > 0) target->onExpectedSize(static_cast<uint64_t>(length));
+        }
+        if (target->limit && target->delivered + size * nmemb > target->limit) {
+            target->overLimit = true;
+            return 0; // CURLE_WRITE_ERROR, reported as oversize
+        }
+        target->delivered += size * nmemb;
+        target->onData(std::string_view(data, size * nmemb));
+    }
+    catch (const std::exception& ex) {
+        LOG_ERROR("Downloader", "body sink failed: {}", ex.what());
+        return 0; // aborts the transfer with CURLE_WRITE_ERROR
+    }
     return size * nmemb;
 }
 
-std::string Downloader::downloadPage(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "[Downloader] curl_easy_init failed\n";
-        return "";
+CachedTransfer::CachedTransfer(ResponseCache& cache, const std::string& url, BodySink& target)
+    : cache(cache), url(url), target(target) {
+    cached = cache.lookup(url, sent);
+}
+
+CachedTransfer::~CachedTransfer() {
+    if (headers) curl_slist_free_all(headers);
+    cache.discard(std::move(writer));
+}
+
+void CachedTransfer::prepare(CURL* curl) {
+    if (cached) {
+        if (!sent.etag.empty())
+            headers = curl_slist_append(headers, ("If-None-Match: " + sent.etag).c_str());
+        if (!sent.lastModified.empty())
+            headers = curl_slist_append(headers, ("If-Modified-Since: " + sent.lastModified).c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     }
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &CachedTransfer::onHeader);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
+}
 
-    std::string buffer;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+static bool startsWithNoCase(std::string_view line, std::string_view prefix) {
+    if (line.size() < prefix.size()) return false;
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(line[i])) != prefix[i]) return false;
+    }
+    return true;
+}
+
+size_t CachedTransfer::onHeader(char* data, size_t size, size_t nitems, void* self) {
+    auto* t = static_cast<CachedTransfer*>(self);
+    std::string_view line(data, size * nitems);
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.remove_suffix(1);
+
+    auto value = [&line](size_t nameLength) {
+        std::string_view v = line.substr(nameLength);
+        while (!v.empty() && v.front() == ' ') v.remove_prefix(1);
+        return std::string(v);
+    };
+    if (startsWithNoCase(line, "http/")) t->received = CacheValidators(); // new response (e.g. after a redirect)
+    else if (startsWithNoCase(line, "etag:")) t->received.etag = value(5);
+    else if (startsWithNoCase(line, "last-modified:")) t->received.lastModified = value(14);
+    return size * nitems;
+}
+
+void CachedTransfer::onData(std::string_view chunk) {
+    // only bodies that can be revalidated later are worth keeping
+    if (!writer && !received.empty()) writer = cache.beginStore();
+    if (writer) writer->append(chunk);
+    target.onData(chunk);
+}
+
+void CachedTransfer::onRestart() {
+    cache.discard(std::move(writer));
+    target.onRestart();
+}
+
+bool CachedTransfer::finish(long response_code) {
+    if (response_code == 304) {
+        if (!cached) return false;
+        try {
+            target.onMapped(cached); // a Page parses from the mapping, a StringSink copies it
+        }
+        catch (const std::exception& ex) {
+            LOG_ERROR("Downloader", "body sink failed: {}", ex.what());
+            return false;
+        }
+        cache.noteNotModified(cached->view().size());
+        return true;
+    }
+    if (response_code == 200 && writer) cache.commit(url, std::move(writer), received);
+    return true;
+}
+
+void ArchiveTransfer::onData(std::string_view chunk) {
+    body.append(chunk.data(), chunk.size());
+    target.onData(chunk);
+}
+
+void ArchiveTransfer::onMapped(std::shared_ptr<MappedBody> mapped) {
+    std::string_view view = mapped->view();
+    body.append(view.data(), view.size()); // the archive compresses its own copy later
+    target.onMapped(std::move(mapped));
+}
+
+void ArchiveTransfer::onRestart() {
+    body.clear();
+    target.onRestart();
+}
+
+void ArchiveTransfer::onExpectedSize(uint64_t bytes) {
+    body.reserve(static_cast<size_t>(std::min(bytes, maxPresize)));
+    target.onExpectedSize(bytes);
+}
+
+void ArchiveTransfer::finish(CURL* curl, const std::string& url, long response_code) {
+    std::string headers = PageArchive::responseHeaders(curl, response_code, body.size());
+    archive.append(url, std::move(headers), std::move(body));
+    body = std::string();
+}
+
+void Downloader::setupHandle(CURL* curl) const {
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, static_cast<long>(timeoutSec));
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "ParallelWebScraper/1.0");
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (http2) curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    // "" offers every coding libcurl was built with; bodies are inflated chunk by chunk on
+    // their way to the write callback, so sinks (and the incremental parser) only see decoded bytes
+    if (compress) curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    if (maxPageBytes) curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(maxPageBytes));
+    if (share) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+}
+
+std::string Downloader::acceptedEncodings() {
+    const curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+    std::string list;
+    auto add = [&](bool have, const char* name) {
+        if (!have) return;
+        if (!list.empty()) list += ", ";
+        list += name;
+    };
+    add(info->features & CURL_VERSION_LIBZ, "gzip, deflate");
+    add(info->features & CURL_VERSION_BROTLI, "br");
+#ifdef CURL_VERSION_ZSTD
+    add(info->features & CURL_VERSION_ZSTD, "zstd");
+#endif
+    return list;
+}
+
+CURL* Downloader::acquireHandle(const std::string& url) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        auto it = idleHandles.find(hostOf(url));
+        if (it != idleHandles.end() && !it->second.empty()) {
+            CURL* curl = it->second.back();
+            it->second.pop_back();
+            ++handleHits;
+            return curl;
+        }
+    }
+    ++handleMisses;
+    CURL* curl = curl_easy_init();
+    if (curl) setupHandle(curl);
+    return curl;
+}
 
+void Downloader::releaseHandle(const std::string& url, CURL* curl) {
+    if (!curl) return;
+    // reset drops per-transfer options but keeps the handle's connection and caches
+    curl_easy_reset(curl);
+    setupHandle(curl);
+    std::lock_guard<std::mutex> lock(poolMutex);
+    idleHandles[hostOf(url)].push_back(curl);
+}
+
+void Downloader::noteAttempt(CURL* curl, BodySink* sink) {
+    uint64_t decoded = 0;
+    if (sink) std::swap(decoded, sink->delivered);
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    if (connects == 0) ++connectionsReused;
+    else connectionsOpened += static_cast<size_t>(connects);
+    if (!metricsRecorder) return;
+
+    // all *_TIME_T values are microseconds since the start of the attempt
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, firstByte = 0, total = 0, bytes = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &firstByte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+
+    Metrics& mr = *metricsRecorder;
+    mr.add(Counter::Requests);
+    mr.add(Counter::BytesDown, static_cast<uint64_t>(bytes));
+    mr.add(Counter::BytesDecoded, decoded);
+    if (connects > 0) { // reused connections report 0 for these phases
+        mr.observe(Hist::Dns, static_cast<uint64_t>(dns));
+        mr.observe(Hist::Connect, static_cast<uint64_t>(std::max<curl_off_t>(connect - dns, 0)));
+        if (tls > 0) mr.observe(Hist::Tls, static_cast<uint64_t>(std::max<curl_off_t>(tls - connect, 0)));
+    }
+    if (firstByte > 0) {
+        mr.observe(Hist::FirstByte, static_cast<uint64_t>(std::max<curl_off_t>(firstByte - pretransfer, 0)));
+        mr.observe(Hist::Transfer, static_cast<uint64_t>(std::max<curl_off_t>(total - firstByte, 0)));
+    }
+    mr.observe(Hist::Total, static_cast<uint64_t>(total));
+}
+
+PoolStats Downloader::poolStats() const {
+    PoolStats stats;
+    stats.handleHits = handleHits.load();
+    stats.handleMisses = handleMisses.load();
+    stats.connectionsReused = connectionsReused.load();
+    stats.connectionsOpened = connectionsOpened.load();
+    return stats;
+}
+
+std::string Downloader::downloadPage(const std::string& url) {
+    StringSink buffer;
+    if (!downloadPage(url, buffer)) return "";
+    return std::move(buffer.body);
+}
+
+bool Downloader::downloadPage(const std::string& url, BodySink& sink) {
+    CURL* curl = acquireHandle(url);
+    if (!curl) {
+        LOG_ERROR("Downloader", "curl_easy_init failed");
+        return false;
+    }
+
+    // cache -> archive -> sink, so the archive also sees bodies the cache serves
+    std::unique_ptr<ArchiveTransfer> archived;
+    if (archive) archived = std::make_unique<ArchiveTransfer>(*archive, sink);
+    BodySink& inner = archived ? static_cast<BodySink&>(*archived) : sink;
+    std::unique_ptr<CachedTransfer> cached;
+    if (cache) {
+        cached = std::make_unique<CachedTransfer>(*cache, url, inner);
+        cached->prepare(curl);
+    }
+    BodySink& target = cached ? static_cast<BodySink&>(*cached) : inner;
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    attachSink(curl, &target);
+
+    // this API is synchronous, so the caller's thread waits out pacing and backoff here;
+    // the pipeline goes through AsyncDownloader, which parks transfers instead
+    const std::string host = hostOf(url);
+    auto notBefore = std::chrono::steady_clock::now();
+    bool retriable = true;
     for (int attempt = 1; attempt <= maxRetries; ++attempt) {
-        buffer.clear();
+        auto start = std::max(notBefore, scheduler.reserve(host, std::chrono::steady_clock::now()));
+        std::this_thread::sleep_until(start);
+        if (attempt > 1) target.onRestart();
         CURLcode res = curl_easy_perform(curl);
+        noteAttempt(curl, &target);
 
         long response_code = 0;
         curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
 
         if (res == CURLE_OK && response_code >= 200 && response_code < 400) {
-            curl_easy_cleanup(curl);
-			return buffer; // successfull download
+            bool ok = !cached || cached->finish(response_code);
+            if (ok && archived) archived->finish(curl, url, response_code);
+            releaseHandle(url, curl);
+            return ok; // successfull download
         }
-        else if (response_code == 429) {
-            char* retry_after = nullptr;
+        auto now = std::chrono::steady_clock::now();
+        if (response_code == 429) {
+            curl_off_t retry_after = 0; // seconds, 0 when the header is absent
             curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
-            int wait = retry_after ? atoi(retry_after) : (1 << (attempt - 1));
-            std::this_thread::sleep_for(std::chrono::seconds(wait));
-            continue;
+            auto wait = retry_after > 0 ? std::chrono::milliseconds(retry_after * 1000) : HostScheduler::backoff(attempt);
+            notBefore = scheduler.throttle(host, now, wait);
         }
         else if (response_code >= 400 && response_code < 500) { // client error — don't retry
+            retriable = false;
             break;
         }
-
-        std::cerr << "[Downloader] attempt " << attempt
-            << " failed for " << url
-            << " (curl=" << curl_easy_strerror(res)
-            << ", http=" << response_code << ")\n";
-
-        // exponencial backoff: 200ms * 2^(attempt-1)
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(200 * (1 << (attempt - 1))));
+        else if (oversize(res, &target)) {
+            LOG_RATE(LogLevel::Warn, 1000, "Downloader", "{} is larger than the page cap of {} bytes", url, maxPageBytes);
+            if (metricsRecorder) metricsRecorder->add(Counter::OversizePages);
+            retriable = false;
+            break;
+        }
+        else {
+            LOG_RATE(LogLevel::Warn, 1000, "Downloader", "attempt {} failed for {} (curl={}, http={})",
+                attempt, url, curl_easy_strerror(res), response_code);
+            notBefore = now + HostScheduler::backoff(attempt);
+        }
+        if (attempt < maxRetries) {
+            scheduler.noteRetry(host);
+            if (metricsRecorder) metricsRecorder->add(Counter::Retries);
+        }
     }
 
-    curl_easy_cleanup(curl);
-    std::cerr << "[Downloader] failed to download URL after " << maxRetries
-        << " attempts: " << url << "\n";
-    return "";
+    if (retriable) scheduler.noteAbandoned(host);
+    if (metricsRecorder) metricsRecorder->add(Counter::Failures);
+    releaseHandle(url, curl);
+    LOG_RATE(LogLevel::Error, 1000, "Downloader", "failed to download URL after {} attempts: {}",
+        maxRetries, url);
+    return false;
 }
\ No newline at end of file
@@ -1,15 +1,195 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:09
+// Date and time of the last changes: 18.10.2026. 05:30
 
 #pragma once
+#include "HostScheduler.hpp"
+#include "Metrics.hpp"
+#include "ResponseCache.hpp"
+#include <curl/curl.h>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct PoolStats {
+    size_t handleHits = 0;        // easy handle taken from the per-host pool
+    size_t handleMisses = 0;      // easy handle had to be created
+    size_t connectionsReused = 0; // transfer went over an already open connection
+    size_t connectionsOpened = 0; // transfer needed a new TCP/TLS connection
+};
+
+// Receives a response body chunk by chunk, as curl delivers it.
+class BodySink {
+public:
+    virtual ~BodySink() = default;
+    virtual void onData(std::string_view chunk) = 0;
+    // the transfer is being retried: everything delivered so far is void
+    virtual void onRestart() = 0;
+    // before the first chunk of an attempt, when the response announced a Content-Length
+    // (the size on the wire: a compressed body decodes to more)
+    virtual void onExpectedSize(uint64_t) {}
+    // the whole body at once from a memory-mapped cache file (a 304 served from the cache);
+    // a sink that can read it from the mapping keeps the pointer instead of copying
+    virtual void onMapped(std::shared_ptr<MappedBody> body) { onData(body->view()); }
+    // a larger Content-Length is not trusted for pre-sizing a buffer
+    static constexpr uint64_t maxPresize = 64 * 1024 * 1024;
+    // the transfer was aborted because its body outgrew the downloader's per-page cap
+    bool oversize() const { return overLimit; }
+
+private:
+    friend class Downloader;
+    CURL* handle = nullptr; // set by Downloader::attachSink
+    uint64_t delivered = 0; // decoded bytes passed through writeToSink since the last attempt was noted
+    uint64_t limit = 0;     // per-page cap on decoded bytes, 0 = none
+    bool overLimit = false;
+};
+
+// buffers the whole body in a string
+class StringSink : public BodySink {
+public:
+    std::string body;
+    void onData(std::string_view chunk) override { body.append(chunk.data(), chunk.size()); }
+    void onRestart() override { body.clear(); }
+    void onExpectedSize(uint64_t bytes) override;
+};
+
+// One cached request: sends If-None-Match/If-Modified-Since when the cache has the page,
+// records the response's ETag/Last-Modified and writes a fresh body to the cache while
+// forwarding it to the real sink. Set it as CURLOPT_WRITEDATA in place of that sink.
+class CachedTransfer : public BodySink {
+public:
+    CachedTransfer(ResponseCache& cache, const std::string& url, BodySink& target);
+    ~CachedTransfer();
+    CachedTransfer(const CachedTransfer&) = delete;
+    CachedTransfer& operator=(const CachedTransfer&) = delete;
+
+    // add the conditional headers and the header callback to a handle
+    void prepare(CURL* curl);
+    void onData(std::string_view chunk) override;
+    void onRestart() override;
+    void onExpectedSize(uint64_t bytes) override { target.onExpectedSize(bytes); }
+    // after a successful transfer: a 304 hands the mapped body to the target (onMapped),
+    // a 200 with validators is committed to the cache; false if the body could not be delivered
+    bool finish(long response_code);
+
+private:
+    ResponseCache& cache;
+    std::string url;
+    BodySink& target;
+    std::shared_ptr<MappedBody> cached; // present when a conditional request was sent
+    CacheValidators sent;
+    CacheValidators received;
+    std::unique_ptr<ResponseCache::Writer> writer;
+    curl_slist* headers = nullptr;
+
+    static size_t onHeader(char* data, size_t size, size_t nitems, void* self);
+};
+
+class PageArchive;
+
+// Keeps a copy of the body for a PageArchive while forwarding it to the real sink. Placed
+// between a CachedTransfer and the target, so a body served from the cache after a 304 is
+// archived as well.
+class ArchiveTransfer : public BodySink {
+public:
+    ArchiveTransfer(PageArchive& archive, BodySink& target) : archive(archive), target(target) {}
+    void onData(std::string_view chunk) override;
+    void onRestart() override;
+    void onExpectedSize(uint64_t bytes) override;
+    void onMapped(std::shared_ptr<MappedBody> mapped) override;
+    // after a successful transfer: hands the body and the response headers to the archive
+    void finish(CURL* curl, const std::string& url, long response_code);
+
+private:
+    PageArchive& archive;
+    BodySink& target;
+    std::string body;
+};
 
 class Downloader {
     int timeoutSec;
     int maxRetries;
+    bool http2;
+    bool compress;
+    uint64_t maxPageBytes = 0;
+    ResponseCache* cache = nullptr;
+    PageArchive* archive = nullptr;
+    Metrics* metricsRecorder = nullptr;
+    HostScheduler scheduler; // per-host pacing, Retry-After and retry statistics
+
+    // DNS cache and TLS sessions are shared by every handle. Open connections are not: each
+    // handle keeps the ones it opened (and goes back to the pool under their host), while
+    // handles in AsyncDownloader's multi handle use the multi's connection cache
+    CURLSH* share = nullptr;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+    // idle easy handles, keyed by host so a handle goes back to the host it last talked to
+    std::mutex poolMutex;
+    std::unordered_map<std::string, std::vector<CURL*>> idleHandles;
+
+    std::atomic<size_t> handleHits{ 0 };
+    std::atomic<size_t> handleMisses{ 0 };
+    std::atomic<size_t> connectionsReused{ 0 };
+    std::atomic<size_t> connectionsOpened{ 0 };
+
+    static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlockShare(CURL* handle, curl_lock_data data, void* userptr);
 public:
-    Downloader(int timeout_seconds = 10, int max_retries = 3);
+    Downloader(int timeout_seconds = 10, int max_retries = 3, bool use_http2 = false, bool compressed = true);
+    ~Downloader();
+    Downloader(const Downloader&) = delete;
+    Downloader& operator=(const Downloader&) = delete;
+
     // download page content; returns empty string on permanent failure
     std::string downloadPage(const std::string& url);
-};
\ No newline at end of file
+    // stream page content into sink while it arrives; false on permanent failure
+    bool downloadPage(const std::string& url, BodySink& sink);
+    // CURLOPT_WRITEFUNCTION forwarding to the BodySink given as CURLOPT_WRITEDATA
+    static size_t writeToSink(char* data, size_t size, size_t nmemb, void* sink);
+    // make sink the body target of curl (write function, data and the per-page cap)
+    void attachSink(CURL* curl, BodySink* sink) const;
+
+    // apply the common transfer options (timeout, redirects, user agent, shared caches) to an easy handle
+    void setupHandle(CURL* curl) const;
+    int retries() const { return maxRetries; }
+    bool useHttp2() const { return http2; }
+    bool compressed() const { return compress; }
+    // cap on one page's body, 0 = none. Applied before the transfer from a Content-Length
+    // (CURLOPT_MAXFILESIZE_LARGE) and while it arrives to the decoded bytes, so neither a
+    // chunked response nor a small compressed one can grow a buffer past it. Such pages
+    // fail without a retry. Set it before the handles are created.
+    void setMaxPageBytes(uint64_t bytes) { maxPageBytes = bytes; }
+    uint64_t maxPageSize() const { return maxPageBytes; }
+    // the attempt was stopped at the page cap; retrying would only fetch the same bytes again
+    static bool oversize(CURLcode code, const BodySink* sink) {
+        return code == CURLE_FILESIZE_EXCEEDED || (sink && sink->oversize());
+    }
+    // content codings this libcurl can decode, as offered in Accept-Encoding ("gzip, deflate, br, zstd")
+    static std::string acceptedEncodings();
+    // revalidate against (and fill) a persistent response cache; nullptr disables it
+    void setCache(ResponseCache* response_cache) { cache = response_cache; }
+    ResponseCache* responseCache() const { return cache; }
+    // write every successfully downloaded page to an archive; nullptr disables it
+    void setArchive(PageArchive* page_archive) { archive = page_archive; }
+    PageArchive* pageArchive() const { return archive; }
+    HostScheduler& hostScheduler() { return scheduler; }
+    // hot-path metrics of every attempt; nullptr disables them
+    void setMetrics(Metrics* recorder) { metricsRecorder = recorder; }
+    Metrics* metrics() const { return metricsRecorder; }
+
+    // per-host handle pool; safe to call from any thread. A handle serves one transfer at a
+    // time and keeps its connections while idle, so the next request to that host reuses them
+    CURL* acquireHandle(const std::string& url);
+    void releaseHandle(const std::string& url, CURL* curl);
+    // record whether a finished attempt reused a pooled connection and, with metrics
+    // enabled, its timing breakdown and size on the wire and after decoding (sink is the
+    // handle's CURLOPT_WRITEDATA)
+    void noteAttempt(CURL* curl, BodySink* sink);
+    PoolStats poolStats() const;
+};
+
+// host part of an absolute URL ("https://host:port/path" -> "host:port")
+std::string hostOf(const std::string& url);
@@ -0,0 +1,92 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 05:50
+
+#include "HostScheduler.hpp"
+#include <algorithm>
+#include <random>
+
+HostScheduler::HostScheduler(HostLimit defaults) : defaults(defaults) {}
+
+void HostScheduler::setDefaultLimit(HostLimit limit) {
+    std::lock_guard<std::mutex> lock(m);
+    defaults = limit;
+    for (auto& h : hosts) {
+        if (overrides.count(h.first) == 0) h.second.limit = limit;
+    }
+}
+
+void HostScheduler::setLimit(const std::string& host, HostLimit limit) {
+    std::lock_guard<std::mutex> lock(m);
+    overrides[host] = limit;
+    auto it = hosts.find(host);
+    if (it != hosts.end()) it->second.limit = limit;
+}
+
+HostScheduler::Host& HostScheduler::hostLocked(const std::string& host) {
+    auto it = hosts.find(host);
+    if (it != hosts.end()) return it->second;
+    Host& h = hosts[host];
+    auto o = overrides.find(host);
+    h.limit = (o != overrides.end()) ? o->second : defaults;
+    return h;
+}
+
+HostScheduler::Clock::time_point HostScheduler::reserve(const std::string& host, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m);
+    Host& h = hostLocked(host);
+    ++h.stats.requests;
+
+    Clock::time_point start = std::max(now, h.blocked);
+    if (h.limit.rate > 0.0) {
+        Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / h.limit.rate));
+        // in double: a burst of 2.5 allows one and a half intervals of slack, not one
+        Clock::duration tolerance = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, Clock::period>(
+            static_cast<double>(interval.count()) * (std::max(h.limit.burst, 1.0) - 1.0)));
+        // GCRA: a request conforms once now >= tat - tolerance
+        start = std::max(start, h.tat - tolerance);
+        h.tat = std::max(h.tat, start) + interval;
+    }
+    if (start > now) ++h.stats.delayed;
+    return start;
+}
+
+HostScheduler::Clock::time_point HostScheduler::throttle(const std::string& host, Clock::time_point now,
+    std::chrono::milliseconds wait) {
+    std::lock_guard<std::mutex> lock(m);
+    Host& h = hostLocked(host);
+    ++h.stats.throttled;
+    h.blocked = std::max(h.blocked, now + wait);
+    return h.blocked;
+}
+
+HostScheduler::Clock::time_point HostScheduler::blockedUntil(const std::string& host) const {
+    std::lock_guard<std::mutex> lock(m);
+    auto it = hosts.find(host);
+    return it == hosts.end() ? Clock::time_point() : it->second.blocked;
+}
+
+std::chrono::milliseconds HostScheduler::backoff(int attempt) {
+    static thread_local std::minstd_rand rng(std::random_device{}());
+    long long d = 200LL << std::min(std::max(attempt - 1, 0), 20);
+    d = std::min<long long>(d, 30000);
+    std::uniform_int_distribution<long long> jitter(d / 2, d);
+    return std::chrono::milliseconds(jitter(rng));
+}
+
+void HostScheduler::noteRetry(const std::string& host) {
+    std::lock_guard<std::mutex> lock(m);
+    ++hostLocked(host).stats.retried;
+}
+
+void HostScheduler::noteAbandoned(const std::string& host) {
+    std::lock_guard<std::mutex> lock(m);
+    ++hostLocked(host).stats.abandoned;
+}
+
+std::map<std::string, HostStats> HostScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(m);
+    std::map<std::string, HostStats> out;
+    for (const auto& h : hosts) out[h.first] = h.second.stats;
+    return out;
+}
@@ -0,0 +1,66 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 19:10
+
+#pragma once
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct HostLimit {
+    double rate = 0.0;  // requests per second, 0 = unlimited
+    double burst = 4.0; // requests that may go out back to back
+};
+
+struct HostStats {
+    size_t requests = 0;  // request slots handed out
+    size_t delayed = 0;   // requests that had to wait for the host's bucket or a Retry-After
+    size_t throttled = 0; // 429 responses
+    size_t retried = 0;   // attempts scheduled again after a failure
+    size_t abandoned = 0; // requests given up after the last retry
+};
+
+// Per-host request pacing. Each host has a token bucket (kept as a GCRA "theoretical arrival
+// time", so a reservation is O(1) and never has to be re-checked) and a "blocked until" time
+// set by 429 responses. Callers ask when a request may start and park it until then; nothing
+// here sleeps. Thread-safe.
+class HostScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit HostScheduler(HostLimit defaults = HostLimit());
+    void setDefaultLimit(HostLimit limit);
+    void setLimit(const std::string& host, HostLimit limit);
+
+    // takes the host's next request slot; returns when the request may start (now or later)
+    Clock::time_point reserve(const std::string& host, Clock::time_point now);
+    // 429 received: nothing goes to host before now + wait; returns that time
+    Clock::time_point throttle(const std::string& host, Clock::time_point now, std::chrono::milliseconds wait);
+    Clock::time_point blockedUntil(const std::string& host) const;
+
+    // exponential backoff with jitter for a 1-based attempt: uniform in [d/2, d],
+    // d = 200 ms * 2^(attempt-1), capped at 30 s
+    static std::chrono::milliseconds backoff(int attempt);
+
+    void noteRetry(const std::string& host);
+    void noteAbandoned(const std::string& host);
+    std::map<std::string, HostStats> stats() const;
+
+private:
+    struct Host {
+        HostLimit limit;
+        Clock::time_point tat;     // theoretical arrival time of the next request
+        Clock::time_point blocked; // Retry-After horizon
+        HostStats stats;
+    };
+
+    mutable std::mutex m;
+    HostLimit defaults;
+    std::unordered_map<std::string, HostLimit> overrides;
+    std::unordered_map<std::string, Host> hosts;
+
+    // expects m to be held
+    Host& hostLocked(const std::string& host);
+};
@@ -0,0 +1,2497 @@
+﻿// Project: Parallel Web Scraper
+// Generated by tools/gen_html_entities.py - do not edit by hand.
+
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+struct HtmlEntity {
+    std::string_view name;  // without '&' and ';'
+    std::string_view value; // UTF-8
+};
+
+constexpr size_t kHtmlEntityCount = 2125;
+constexpr size_t kHtmlEntityMaxName = 31;
+constexpr uint32_t kHtmlEntitySlotMask = 4095;
+constexpr uint32_t kHtmlEntityBucketMask = 1023;
+constexpr uint16_t kHtmlEntityEmptySlot = 0xFFFF;
+
+constexpr uint32_t entityHash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : name) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+inline constexpr HtmlEntity kHtmlEntities[kHtmlEntityCount] = {
+    { "AElig", "\xC3\x86" },
+    { "AMP", "&" },
+    { "Aacute", "\xC3\x81" },
+    { "Abreve", "\xC4\x82" },
+    { "Acirc", "\xC3\x82" },
+    { "Acy", "\xD0\x90" },
+    { "Afr", "\xF0\x9D\x94\x84" },
+    { "Agrave", "\xC3\x80" },
+    { "Alpha", "\xCE\x91" },
+    { "Amacr", "\xC4\x80" },
+    { "And", "\xE2\xA9\x93" },
+    { "Aogon", "\xC4\x84" },
+    { "Aopf", "\xF0\x9D\x94\xB8" },
+    { "ApplyFunction", "\xE2\x81\xA1" },
+    { "Aring", "\xC3\x85" },
+    { "Ascr", "\xF0\x9D\x92\x9C" },
+    { "Assign", "\xE2\x89\x94" },
+    { "Atilde", "\xC3\x83" },
+    { "Auml", "\xC3\x84" },
+    { "Backslash", "\xE2\x88\x96" },
+    { "Barv", "\xE2\xAB\xA7" },
+    { "Barwed", "\xE2\x8C\x86" },
+    { "Bcy", "\xD0\x91" },
+    { "Because", "\xE2\x88\xB5" },
+    { "Bernoullis", "\xE2\x84\xAC" },
+    { "Beta", "\xCE\x92" },
+    { "Bfr", "\xF0\x9D\x94\x85" },
+    { "Bopf", "\xF0\x9D\x94\xB9" },
+    { "Breve", "\xCB\x98" },
+    { "Bscr", "\xE2\x84\xAC" },
+    { "Bumpeq", "\xE2\x89\x8E" },
+    { "CHcy", "\xD0\xA7" },
+    { "COPY", "\xC2\xA9" },
+    { "Cacute", "\xC4\x86" },
+    { "Cap", "\xE2\x8B\x92" },
+    { "CapitalDifferentialD", "\xE2\x85\x85" },
+    { "Cayleys", "\xE2\x84\xAD" },
+    { "Ccaron", "\xC4\x8C" },
+    { "Ccedil", "\xC3\x87" },
+    { "Ccirc", "\xC4\x88" },
+    { "Cconint", "\xE2\x88\xB0" },
+    { "Cdot", "\xC4\x8A" },
+    { "Cedilla", "\xC2\xB8" },
+    { "CenterDot", "\xC2\xB7" },
+    { "Cfr", "\xE2\x84\xAD" },
+    { "Chi", "\xCE\xA7" },
+    { "CircleDot", "\xE2\x8A\x99" },
+    { "CircleMinus", "\xE2\x8A\x96" },
+    { "CirclePlus", "\xE2\x8A\x95" },
+    { "CircleTimes", "\xE2\x8A\x97" },
+    { "ClockwiseContourIntegral", "\xE2\x88\xB2" },
+    { "CloseCurlyDoubleQuote", "\xE2\x80\x9D" },
+    { "CloseCurlyQuote", "\xE2\x80\x99" },
+    { "Colon", "\xE2\x88\xB7" },
+    { "Colone", "\xE2\xA9\xB4" },
+    { "Congruent", "\xE2\x89\xA1" },
+    { "Conint", "\xE2\x88\xAF" },
+    { "ContourIntegral", "\xE2\x88\xAE" },
+    { "Copf", "\xE2\x84\x82" },
+    { "Coproduct", "\xE2\x88\x90" },
+    { "CounterClockwiseContourIntegral", "\xE2\x88\xB3" },
+    { "Cross", "\xE2\xA8\xAF" },
+    { "Cscr", "\xF0\x9D\x92\x9E" },
+    { "Cup", "\xE2\x8B\x93" },
+    { "CupCap", "\xE2\x89\x8D" },
+    { "DD", "\xE2\x85\x85" },
+    { "DDotrahd", "\xE2\xA4\x91" },
+    { "DJcy", "\xD0\x82" },
+    { "DScy", "\xD0\x85" },
+    { "DZcy", "\xD0\x8F" },
+    { "Dagger", "\xE2\x80\xA1" },
+    { "Darr", "\xE2\x86\xA1" },
+    { "Dashv", "\xE2\xAB\xA4" },
+    { "Dcaron", "\xC4\x8E" },
+    { "Dcy", "\xD0\x94" },
+    { "Del", "\xE2\x88\x87" },
+    { "Delta", "\xCE\x94" },
+    { "Dfr", "\xF0\x9D\x94\x87" },
+    { "DiacriticalAcute", "\xC2\xB4" },
+    { "DiacriticalDot", "\xCB\x99" },
+    { "DiacriticalDoubleAcute", "\xCB\x9D" },
+    { "DiacriticalGrave", "`" },
+    { "DiacriticalTilde", "\xCB\x9C" },
+    { "Diamond", "\xE2\x8B\x84" },
+    { "DifferentialD", "\xE2\x85\x86" },
+    { "Dopf", "\xF0\x9D\x94\xBB" },
+    { "Dot", "\xC2\xA8" },
+    { "DotDot", "\xE2\x83\x9C" },
+    { "DotEqual", "\xE2\x89\x90" },
+    { "DoubleContourIntegral", "\xE2\x88\xAF" },
+    { "DoubleDot", "\xC2\xA8" },
+    { "DoubleDownArrow", "\xE2\x87\x93" },
+    { "DoubleLeftArrow", "\xE2\x87\x90" },
+    { "DoubleLeftRightArrow", "\xE2\x87\x94" },
+    { "DoubleLeftTee", "\xE2\xAB\xA4" },
+    { "DoubleLongLeftArrow", "\xE2\x9F\xB8" },
+    { "DoubleLongLeftRightArrow", "\xE2\x9F\xBA" },
+    { "DoubleLongRightArrow", "\xE2\x9F\xB9" },
+    { "DoubleRightArrow", "\xE2\x87\x92" },
+    { "DoubleRightTee", "\xE2\x8A\xA8" },
+    { "DoubleUpArrow", "\xE2\x87\x91" },
+    { "DoubleUpDownArrow", "\xE2\x87\x95" },
+    { "DoubleVerticalBar", "\xE2\x88\xA5" },
+    { "DownArrow", "\xE2\x86\x93" },
+    { "DownArrowBar", "\xE2\xA4\x93" },
+    { "DownArrowUpArrow", "\xE2\x87\xB5" },
+    { "DownBreve", "\xCC\x91" },
+    { "DownLeftRightVector", "\xE2\xA5\x90" },
+    { "DownLeftTeeVector", "\xE2\xA5\x9E" },
+    { "DownLeftVector", "\xE2\x86\xBD" },
+    { "DownLeftVectorBar", "\xE2\xA5\x96" },
+    { "DownRightTeeVector", "\xE2\xA5\x9F" },
+    { "DownRightVector", "\xE2\x87\x81" },
+    { "DownRightVectorBar", "\xE2\xA5\x97" },
+    { "DownTee", "\xE2\x8A\xA4" },
+    { "DownTeeArrow", "\xE2\x86\xA7" },
+    { "Downarrow", "\xE2\x87\x93" },
+    { "Dscr", "\xF0\x9D\x92\x9F" },
+    { "Dstrok", "\xC4\x90" },
+    { "ENG", "\xC5\x8A" },
+    { "ETH", "\xC3\x90" },
+    { "Eacute", "\xC3\x89" },
+    { "Ecaron", "\xC4\x9A" },
+    { "Ecirc", "\xC3\x8A" },
+    { "Ecy", "\xD0\xAD" },
+    { "Edot", "\xC4\x96" },
+    { "Efr", "\xF0\x9D\x94\x88" },
+    { "Egrave", "\xC3\x88" },
+    { "Element", "\xE2\x88\x88" },
+    { "Emacr", "\xC4\x92" },
+    { "EmptySmallSquare", "\xE2\x97\xBB" },
+    { "EmptyVerySmallSquare", "\xE2\x96\xAB" },
+    { "Eogon", "\xC4\x98" },
+    { "Eopf", "\xF0\x9D\x94\xBC" },
+    { "Epsilon", "\xCE\x95" },
+    { "Equal", "\xE2\xA9\xB5" },
+    { "EqualTilde", "\xE2\x89\x82" },
+    { "Equilibrium", "\xE2\x87\x8C" },
+    { "Escr", "\xE2\x84\xB0" },
+    { "Esim", "\xE2\xA9\xB3" },
+    { "Eta", "\xCE\x97" },
+    { "Euml", "\xC3\x8B" },
+    { "Exists", "\xE2\x88\x83" },
+    { "ExponentialE", "\xE2\x85\x87" },
+    { "Fcy", "\xD0\xA4" },
+    { "Ffr", "\xF0\x9D\x94\x89" },
+    { "FilledSmallSquare", "\xE2\x97\xBC" },
+    { "FilledVerySmallSquare", "\xE2\x96\xAA" },
+    { "Fopf", "\xF0\x9D\x94\xBD" },
+    { "ForAll", "\xE2\x88\x80" },
+    { "Fouriertrf", "\xE2\x84\xB1" },
+    { "Fscr", "\xE2\x84\xB1" },
+    { "GJcy", "\xD0\x83" },
+    { "GT", ">" },
+    { "Gamma", "\xCE\x93" },
+    { "Gammad", "\xCF\x9C" },
+    { "Gbreve", "\xC4\x9E" },
+    { "Gcedil", "\xC4\xA2" },
+    { "Gcirc", "\xC4\x9C" },
+    { "Gcy", "\xD0\x93" },
+    { "Gdot", "\xC4\xA0" },
+    { "Gfr", "\xF0\x9D\x94\x8A" },
+    { "Gg", "\xE2\x8B\x99" },
+    { "Gopf", "\xF0\x9D\x94\xBE" },
+    { "GreaterEqual", "\xE2\x89\xA5" },
+    { "GreaterEqualLess", "\xE2\x8B\x9B" },
+    { "GreaterFullEqual", "\xE2\x89\xA7" },
+    { "GreaterGreater", "\xE2\xAA\xA2" },
+    { "GreaterLess", "\xE2\x89\xB7" },
+    { "GreaterSlantEqual", "\xE2\xA9\xBE" },
+    { "GreaterTilde", "\xE2\x89\xB3" },
+    { "Gscr", "\xF0\x9D\x92\xA2" },
+    { "Gt", "\xE2\x89\xAB" },
+    { "HARDcy", "\xD0\xAA" },
+    { "Hacek", "\xCB\x87" },
+    { "Hat", "^" },
+    { "Hcirc", "\xC4\xA4" },
+    { "Hfr", "\xE2\x84\x8C" },
+    { "HilbertSpace", "\xE2\x84\x8B" },
+    { "Hopf", "\xE2\x84\x8D" },
+    { "HorizontalLine", "\xE2\x94\x80" },
+    { "Hscr", "\xE2\x84\x8B" },
+    { "Hstrok", "\xC4\xA6" },
+    { "HumpDownHump", "\xE2\x89\x8E" },
+    { "HumpEqual", "\xE2\x89\x8F" },
+    { "IEcy", "\xD0\x95" },
+    { "IJlig", "\xC4\xB2" },
+    { "IOcy", "\xD0\x81" },
+    { "Iacute", "\xC3\x8D" },
+    { "Icirc", "\xC3\x8E" },
+    { "Icy", "\xD0\x98" },
+    { "Idot", "\xC4\xB0" },
+    { "Ifr", "\xE2\x84\x91" },
+    { "Igrave", "\xC3\x8C" },
+    { "Im", "\xE2\x84\x91" },
+    { "Imacr", "\xC4\xAA" },
+    { "ImaginaryI", "\xE2\x85\x88" },
+    { "Implies", "\xE2\x87\x92" },
+    { "Int", "\xE2\x88\xAC" },
+    { "Integral", "\xE2\x88\xAB" },
+    { "Intersection", "\xE2\x8B\x82" },
+    { "InvisibleComma", "\xE2\x81\xA3" },
+    { "InvisibleTimes", "\xE2\x81\xA2" },
+    { "Iogon", "\xC4\xAE" },
+    { "Iopf", "\xF0\x9D\x95\x80" },
+    { "Iota", "\xCE\x99" },
+    { "Iscr", "\xE2\x84\x90" },
+    { "Itilde", "\xC4\xA8" },
+    { "Iukcy", "\xD0\x86" },
+    { "Iuml", "\xC3\x8F" },
+    { "Jcirc", "\xC4\xB4" },
+    { "Jcy", "\xD0\x99" },
+    { "Jfr", "\xF0\x9D\x94\x8D" },
+    { "Jopf", "\xF0\x9D\x95\x81" },
+    { "Jscr", "\xF0\x9D\x92\xA5" },
+    { "Jsercy", "\xD0\x88" },
+    { "Jukcy", "\xD0\x84" },
+    { "KHcy", "\xD0\xA5" },
+    { "KJcy", "\xD0\x8C" },
+    { "Kappa", "\xCE\x9A" },
+    { "Kcedil", "\xC4\xB6" },
+    { "Kcy", "\xD0\x9A" },
+    { "Kfr", "\xF0\x9D\x94\x8E" },
+    { "Kopf", "\xF0\x9D\x95\x82" },
+    { "Kscr", "\xF0\x9D\x92\xA6" },
+    { "LJcy", "\xD0\x89" },
+    { "LT", "<" },
+    { "Lacute", "\xC4\xB9" },
+    { "Lambda", "\xCE\x9B" },
+    { "Lang", "\xE2\x9F\xAA" },
+    { "Laplacetrf", "\xE2\x84\x92" },
+    { "Larr", "\xE2\x86\x9E" },
+    { "Lcaron", "\xC4\xBD" },
+    { "Lcedil", "\xC4\xBB" },
+    { "Lcy", "\xD0\x9B" },
+    { "LeftAngleBracket", "\xE2\x9F\xA8" },
+    { "LeftArrow", "\xE2\x86\x90" },
+    { "LeftArrowBar", "\xE2\x87\xA4" },
+    { "LeftArrowRightArrow", "\xE2\x87\x86" },
+    { "LeftCeiling", "\xE2\x8C\x88" },
+    { "LeftDoubleBracket", "\xE2\x9F\xA6" },
+    { "LeftDownTeeVector", "\xE2\xA5\xA1" },
+    { "LeftDownVector", "\xE2\x87\x83" },
+    { "LeftDownVectorBar", "\xE2\xA5\x99" },
+    { "LeftFloor", "\xE2\x8C\x8A" },
+    { "LeftRightArrow", "\xE2\x86\x94" },
+    { "LeftRightVector", "\xE2\xA5\x8E" },
+    { "LeftTee", "\xE2\x8A\xA3" },
+    { "LeftTeeArrow", "\xE2\x86\xA4" },
+    { "LeftTeeVector", "\xE2\xA5\x9A" },
+    { "LeftTriangle", "\xE2\x8A\xB2" },
+    { "LeftTriangleBar", "\xE2\xA7\x8F" },
+    { "LeftTriangleEqual", "\xE2\x8A\xB4" },
+    { "LeftUpDownVector", "\xE2\xA5\x91" },
+    { "LeftUpTeeVector", "\xE2\xA5\xA0" },
+    { "LeftUpVector", "\xE2\x86\xBF" },
+    { "LeftUpVectorBar", "\xE2\xA5\x98" },
+    { "LeftVector", "\xE2\x86\xBC" },
+    { "LeftVectorBar", "\xE2\xA5\x92" },
+    { "Leftarrow", "\xE2\x87\x90" },
+    { "Leftrightarrow", "\xE2\x87\x94" },
+    { "LessEqualGreater", "\xE2\x8B\x9A" },
+    { "LessFullEqual", "\xE2\x89\xA6" },
+    { "LessGreater", "\xE2\x89\xB6" },
+    { "LessLess", "\xE2\xAA\xA1" },
+    { "LessSlantEqual", "\xE2\xA9\xBD" },
+    { "LessTilde", "\xE2\x89\xB2" },
+    { "Lfr", "\xF0\x9D\x94\x8F" },
+    { "Ll", "\xE2\x8B\x98" },
+    { "Lleftarrow", "\xE2\x87\x9A" },
+    { "Lmidot", "\xC4\xBF" },
+    { "LongLeftArrow", "\xE2\x9F\xB5" },
+    { "LongLeftRightArrow", "\xE2\x9F\xB7" },
+    { "LongRightArrow", "\xE2\x9F\xB6" },
+    { "Longleftarrow", "\xE2\x9F\xB8" },
+    { "Longleftrightarrow", "\xE2\x9F\xBA" },
+    { "Longrightarrow", "\xE2\x9F\xB9" },
+    { "Lopf", "\xF0\x9D\x95\x83" },
+    { "LowerLeftArrow", "\xE2\x86\x99" },
+    { "LowerRightArrow", "\xE2\x86\x98" },
+    { "Lscr", "\xE2\x84\x92" },
+    { "Lsh", "\xE2\x86\xB0" },
+    { "Lstrok", "\xC5\x81" },
+    { "Lt", "\xE2\x89\xAA" },
+    { "Map", "\xE2\xA4\x85" },
+    { "Mcy", "\xD0\x9C" },
+    { "MediumSpace", "\xE2\x81\x9F" },
+    { "Mellintrf", "\xE2\x84\xB3" },
+    { "Mfr", "\xF0\x9D\x94\x90" },
+    { "MinusPlus", "\xE2\x88\x93" },
+    { "Mopf", "\xF0\x9D\x95\x84" },
+    { "Mscr", "\xE2\x84\xB3" },
+    { "Mu", "\xCE\x9C" },
+    { "NJcy", "\xD0\x8A" },
+    { "Nacute", "\xC5\x83" },
+    { "Ncaron", "\xC5\x87" },
+    { "Ncedil", "\xC5\x85" },
+    { "Ncy", "\xD0\x9D" },
+    { "NegativeMediumSpace", "\xE2\x80\x8B" },
+    { "NegativeThickSpace", "\xE2\x80\x8B" },
+    { "NegativeThinSpace", "\xE2\x80\x8B" },
+    { "NegativeVeryThinSpace", "\xE2\x80\x8B" },
+    { "NestedGreaterGreater", "\xE2\x89\xAB" },
+    { "NestedLessLess", "\xE2\x89\xAA" },
+    { "NewLine", "\x0A" },
+    { "Nfr", "\xF0\x9D\x94\x91" },
+    { "NoBreak", "\xE2\x81\xA0" },
+    { "NonBreakingSpace", "\xC2\xA0" },
+    { "Nopf", "\xE2\x84\x95" },
+    { "Not", "\xE2\xAB\xAC" },
+    { "NotCongruent", "\xE2\x89\xA2" },
+    { "NotCupCap", "\xE2\x89\xAD" },
+    { "NotDoubleVerticalBar", "\xE2\x88\xA6" },
+    { "NotElement", "\xE2\x88\x89" },
+    { "NotEqual", "\xE2\x89\xA0" },
+    { "NotEqualTilde", "\xE2\x89\x82\xCC\xB8" },
+    { "NotExists", "\xE2\x88\x84" },
+    { "NotGreater", "\xE2\x89\xAF" },
+    { "NotGreaterEqual", "\xE2\x89\xB1" },
+    { "NotGreaterFullEqual", "\xE2\x89\xA7\xCC\xB8" },
+    { "NotGreaterGreater", "\xE2\x89\xAB\xCC\xB8" },
+    { "NotGreaterLess", "\xE2\x89\xB9" },
+    { "NotGreaterSlantEqual", "\xE2\xA9\xBE\xCC\xB8" },
+    { "NotGreaterTilde", "\xE2\x89\xB5" },
+    { "NotHumpDownHump", "\xE2\x89\x8E\xCC\xB8" },
+    { "NotHumpEqual", "\xE2\x89\x8F\xCC\xB8" },
+    { "NotLeftTriangle", "\xE2\x8B\xAA" },
+    { "NotLeftTriangleBar", "\xE2\xA7\x8F\xCC\xB8" },
+    { "NotLeftTriangleEqual", "\xE2\x8B\xAC" },
+    { "NotLess", "\xE2\x89\xAE" },
+    { "NotLessEqual", "\xE2\x89\xB0" },
+    { "NotLessGreater", "\xE2\x89\xB8" },
+    { "NotLessLess", "\xE2\x89\xAA\xCC\xB8" },
+    { "NotLessSlantEqual", "\xE2\xA9\xBD\xCC\xB8" },
+    { "NotLessTilde", "\xE2\x89\xB4" },
+    { "NotNestedGreaterGreater", "\xE2\xAA\xA2\xCC\xB8" },
+    { "NotNestedLessLess", "\xE2\xAA\xA1\xCC\xB8" },
+    { "NotPrecedes", "\xE2\x8A\x80" },
+    { "NotPrecedesEqual", "\xE2\xAA\xAF\xCC\xB8" },
+    { "NotPrecedesSlantEqual", "\xE2\x8B\xA0" },
+    { "NotReverseElement", "\xE2\x88\x8C" },
+    { "NotRightTriangle", "\xE2\x8B\xAB" },
+    { "NotRightTriangleBar", "\xE2\xA7\x90\xCC\xB8" },
+    { "NotRightTriangleEqual", "\xE2\x8B\xAD" },
+    { "NotSquareSubset", "\xE2\x8A\x8F\xCC\xB8" },
+    { "NotSquareSubsetEqual", "\xE2\x8B\xA2" },
+    { "NotSquareSuperset", "\xE2\x8A\x90\xCC\xB8" },
+    { "NotSquareSupersetEqual", "\xE2\x8B\xA3" },
+    { "NotSubset", "\xE2\x8A\x82\xE2\x83\x92" },
+    { "NotSubsetEqual", "\xE2\x8A\x88" },
+    { "NotSucceeds", "\xE2\x8A\x81" },
+    { "NotSucceedsEqual", "\xE2\xAA\xB0\xCC\xB8" },
+    { "NotSucceedsSlantEqual", "\xE2\x8B\xA1" },
+    { "NotSucceedsTilde", "\xE2\x89\xBF\xCC\xB8" },
+    { "NotSuperset", "\xE2\x8A\x83\xE2\x83\x92" },
+    { "NotSupersetEqual", "\xE2\x8A\x89" },
+    { "NotTilde", "\xE2\x89\x81" },
+    { "NotTildeEqual", "\xE2\x89\x84" },
+    { "NotTildeFullEqual", "\xE2\x89\x87" },
+    { "NotTildeTilde", "\xE2\x89\x89" },
+    { "NotVerticalBar", "\xE2\x88\xA4" },
+    { "Nscr", "\xF0\x9D\x92\xA9" },
+    { "Ntilde", "\xC3\x91" },
+    { "Nu", "\xCE\x9D" },
+    { "OElig", "\xC5\x92" },
+    { "Oacute", "\xC3\x93" },
+    { "Ocirc", "\xC3\x94" },
+    { "Ocy", "\xD0\x9E" },
+    { "Odblac", "\xC5\x90" },
+    { "Ofr", "\xF0\x9D\x94\x92" },
+    { "Ograve", "\xC3\x92" },
+    { "Omacr", "\xC5\x8C" },
+    { "Omega", "\xCE\xA9" },
+    { "Omicron", "\xCE\x9F" },
+    { "Oopf", "\xF0\x9D\x95\x86" },
+    { "OpenCurlyDoubleQuote", "\xE2\x80\x9C" },
+    { "OpenCurlyQuote", "\xE2\x80\x98" },
+    { "Or", "\xE2\xA9\x94" },
+    { "Oscr", "\xF0\x9D\x92\xAA" },
+    { "Oslash", "\xC3\x98" },
+    { "Otilde", "\xC3\x95" },
+    { "Otimes", "\xE2\xA8\xB7" },
+    { "Ouml", "\xC3\x96" },
+    { "OverBar", "\xE2\x80\xBE" },
+    { "OverBrace", "\xE2\x8F\x9E" },
+    { "OverBracket", "\xE2\x8E\xB4" },
+    { "OverParenthesis", "\xE2\x8F\x9C" },
+    { "PartialD", "\xE2\x88\x82" },
+    { "Pcy", "\xD0\x9F" },
+    { "Pfr", "\xF0\x9D\x94\x93" },
+    { "Phi", "\xCE\xA6" },
+    { "Pi", "\xCE\xA0" },
+    { "PlusMinus", "\xC2\xB1" },
+    { "Poincareplane", "\xE2\x84\x8C" },
+    { "Popf", "\xE2\x84\x99" },
+    { "Pr", "\xE2\xAA\xBB" },
+    { "Precedes", "\xE2\x89\xBA" },
+    { "PrecedesEqual", "\xE2\xAA\xAF" },
+    { "PrecedesSlantEqual", "\xE2\x89\xBC" },
+    { "PrecedesTilde", "\xE2\x89\xBE" },
+    { "Prime", "\xE2\x80\xB3" },
+    { "Product", "\xE2\x88\x8F" },
+    { "Proportion", "\xE2\x88\xB7" },
+    { "Proportional", "\xE2\x88\x9D" },
+    { "Pscr", "\xF0\x9D\x92\xAB" },
+    { "Psi", "\xCE\xA8" },
+    { "QUOT", "\x22" },
+    { "Qfr", "\xF0\x9D\x94\x94" },
+    { "Qopf", "\xE2\x84\x9A" },
+    { "Qscr", "\xF0\x9D\x92\xAC" },
+    { "RBarr", "\xE2\xA4\x90" },
+    { "REG", "\xC2\xAE" },
+    { "Racute", "\xC5\x94" },
+    { "Rang", "\xE2\x9F\xAB" },
+    { "Rarr", "\xE2\x86\xA0" },
+    { "Rarrtl", "\xE2\xA4\x96" },
+    { "Rcaron", "\xC5\x98" },
+    { "Rcedil", "\xC5\x96" },
+    { "Rcy", "\xD0\xA0" },
+    { "Re", "\xE2\x84\x9C" },
+    { "ReverseElement", "\xE2\x88\x8B" },
+    { "ReverseEquilibrium", "\xE2\x87\x8B" },
+    { "ReverseUpEquilibrium", "\xE2\xA5\xAF" },
+    { "Rfr", "\xE2\x84\x9C" },
+    { "Rho", "\xCE\xA1" },
+    { "RightAngleBracket", "\xE2\x9F\xA9" },
+    { "RightArrow", "\xE2\x86\x92" },
+    { "RightArrowBar", "\xE2\x87\xA5" },
+    { "RightArrowLeftArrow", "\xE2\x87\x84" },
+    { "RightCeiling", "\xE2\x8C\x89" },
+    { "RightDoubleBracket", "\xE2\x9F\xA7" },
+    { "RightDownTeeVector", "\xE2\xA5\x9D" },
+    { "RightDownVector", "\xE2\x87\x82" },
+    { "RightDownVectorBar", "\xE2\xA5\x95" },
+    { "RightFloor", "\xE2\x8C\x8B" },
+    { "RightTee", "\xE2\x8A\xA2" },
+    { "RightTeeArrow", "\xE2\x86\xA6" },
+    { "RightTeeVector", "\xE2\xA5\x9B" },
+    { "RightTriangle", "\xE2\x8A\xB3" },
+    { "RightTriangleBar", "\xE2\xA7\x90" },
+    { "RightTriangleEqual", "\xE2\x8A\xB5" },
+    { "RightUpDownVector", "\xE2\xA5\x8F" },
+    { "RightUpTeeVector", "\xE2\xA5\x9C" },
+    { "RightUpVector", "\xE2\x86\xBE" },
+    { "RightUpVectorBar", "\xE2\xA5\x94" },
+    { "RightVector", "\xE2\x87\x80" },
+    { "RightVectorBar", "\xE2\xA5\x93" },
+    { "Rightarrow", "\xE2\x87\x92" },
+    { "Ropf", "\xE2\x84\x9D" },
+    { "RoundImplies", "\xE2\xA5\xB0" },
+    { "Rrightarrow", "\xE2\x87\x9B" },
+    { "Rscr", "\xE2\x84\x9B" },
+    { "Rsh", "\xE2\x86\xB1" },
+    { "RuleDelayed", "\xE2\xA7\xB4" },
+    { "SHCHcy", "\xD0\xA9" },
+    { "SHcy", "\xD0\xA8" },
+    { "SOFTcy", "\xD0\xAC" },
+    { "Sacute", "\xC5\x9A" },
+    { "Sc", "\xE2\xAA\xBC" },
+    { "Scaron", "\xC5\xA0" },
+    { "Scedil", "\xC5\x9E" },
+    { "Scirc", "\xC5\x9C" },
+    { "Scy", "\xD0\xA1" },
+    { "Sfr", "\xF0\x9D\x94\x96" },
+    { "ShortDownArrow", "\xE2\x86\x93" },
+    { "ShortLeftArrow", "\xE2\x86\x90" },
+    { "ShortRightArrow", "\xE2\x86\x92" },
+    { "ShortUpArrow", "\xE2\x86\x91" },
+    { "Sigma", "\xCE\xA3" },
+    { "SmallCircle", "\xE2\x88\x98" },
+    { "Sopf", "\xF0\x9D\x95\x8A" },
+    { "Sqrt", "\xE2\x88\x9A" },
+    { "Square", "\xE2\x96\xA1" },
+    { "SquareIntersection", "\xE2\x8A\x93" },
+    { "SquareSubset", "\xE2\x8A\x8F" },
+    { "SquareSubsetEqual", "\xE2\x8A\x91" },
+    { "SquareSuperset", "\xE2\x8A\x90" },
+    { "SquareSupersetEqual", "\xE2\x8A\x92" },
+    { "SquareUnion", "\xE2\x8A\x94" },
+    { "Sscr", "\xF0\x9D\x92\xAE" },
+    { "Star", "\xE2\x8B\x86" },
+    { "Sub", "\xE2\x8B\x90" },
+    { "Subset", "\xE2\x8B\x90" },
+    { "SubsetEqual", "\xE2\x8A\x86" },
+    { "Succeeds", "\xE2\x89\xBB" },
+    { "SucceedsEqual", "\xE2\xAA\xB0" },
+    { "SucceedsSlantEqual", "\xE2\x89\xBD" },
+    { "SucceedsTilde", "\xE2\x89\xBF" },
+    { "SuchThat", "\xE2\x88\x8B" },
+    { "Sum", "\xE2\x88\x91" },
+    { "Sup", "\xE2\x8B\x91" },
+    { "Superset", "\xE2\x8A\x83" },
+    { "SupersetEqual", "\xE2\x8A\x87" },
+    { "Supset", "\xE2\x8B\x91" },
+    { "THORN", "\xC3\x9E" },
+    { "TRADE", "\xE2\x84\xA2" },
+    { "TSHcy", "\xD0\x8B" },
+    { "TScy", "\xD0\xA6" },
+    { "Tab", "\x09" },
+    { "Tau", "\xCE\xA4" },
+    { "Tcaron", "\xC5\xA4" },
+    { "Tcedil", "\xC5\xA2" },
+    { "Tcy", "\xD0\xA2" },
+    { "Tfr", "\xF0\x9D\x94\x97" },
+    { "Therefore", "\xE2\x88\xB4" },
+    { "Theta", "\xCE\x98" },
+    { "ThickSpace", "\xE2\x81\x9F\xE2\x80\x8A" },
+    { "ThinSpace", "\xE2\x80\x89" },
+    { "Tilde", "\xE2\x88\xBC" },
+    { "TildeEqual", "\xE2\x89\x83" },
+    { "TildeFullEqual", "\xE2\x89\x85" },
+    { "TildeTilde", "\xE2\x89\x88" },
+    { "Topf", "\xF0\x9D\x95\x8B" },
+    { "TripleDot", "\xE2\x83\x9B" },
+    { "Tscr", "\xF0\x9D\x92\xAF" },
+    { "Tstrok", "\xC5\xA6" },
+    { "Uacute", "\xC3\x9A" },
+    { "Uarr", "\xE2\x86\x9F" },
+    { "Uarrocir", "\xE2\xA5\x89" },
+    { "Ubrcy", "\xD0\x8E" },
+    { "Ubreve", "\xC5\xAC" },
+    { "Ucirc", "\xC3\x9B" },
+    { "Ucy", "\xD0\xA3" },
+    { "Udblac", "\xC5\xB0" },
+    { "Ufr", "\xF0\x9D\x94\x98" },
+    { "Ugrave", "\xC3\x99" },
+    { "Umacr", "\xC5\xAA" },
+    { "UnderBar", "_" },
+    { "UnderBrace", "\xE2\x8F\x9F" },
+    { "UnderBracket", "\xE2\x8E\xB5" },
+    { "UnderParenthesis", "\xE2\x8F\x9D" },
+    { "Union", "\xE2\x8B\x83" },
+    { "UnionPlus", "\xE2\x8A\x8E" },
+    { "Uogon", "\xC5\xB2" },
+    { "Uopf", "\xF0\x9D\x95\x8C" },
+    { "UpArrow", "\xE2\x86\x91" },
+    { "UpArrowBar", "\xE2\xA4\x92" },
+    { "UpArrowDownArrow", "\xE2\x87\x85" },
+    { "UpDownArrow", "\xE2\x86\x95" },
+    { "UpEquilibrium", "\xE2\xA5\xAE" },
+    { "UpTee", "\xE2\x8A\xA5" },
+    { "UpTeeArrow", "\xE2\x86\xA5" },
+    { "Uparrow", "\xE2\x87\x91" },
+    { "Updownarrow", "\xE2\x87\x95" },
+    { "UpperLeftArrow", "\xE2\x86\x96" },
+    { "UpperRightArrow", "\xE2\x86\x97" },
+    { "Upsi", "\xCF\x92" },
+    { "Upsilon", "\xCE\xA5" },
+    { "Uring", "\xC5\xAE" },
+    { "Uscr", "\xF0\x9D\x92\xB0" },
+    { "Utilde", "\xC5\xA8" },
+    { "Uuml", "\xC3\x9C" },
+    { "VDash", "\xE2\x8A\xAB" },
+    { "Vbar", "\xE2\xAB\xAB" },
+    { "Vcy", "\xD0\x92" },
+    { "Vdash", "\xE2\x8A\xA9" },
+    { "Vdashl", "\xE2\xAB\xA6" },
+    { "Vee", "\xE2\x8B\x81" },
+    { "Verbar", "\xE2\x80\x96" },
+    { "Vert", "\xE2\x80\x96" },
+    { "VerticalBar", "\xE2\x88\xA3" },
+    { "VerticalLine", "|" },
+    { "VerticalSeparator", "\xE2\x9D\x98" },
+    { "VerticalTilde", "\xE2\x89\x80" },
+    { "VeryThinSpace", "\xE2\x80\x8A" },
+    { "Vfr", "\xF0\x9D\x94\x99" },
+    { "Vopf", "\xF0\x9D\x95\x8D" },
+    { "Vscr", "\xF0\x9D\x92\xB1" },
+    { "Vvdash", "\xE2\x8A\xAA" },
+    { "Wcirc", "\xC5\xB4" },
+    { "Wedge", "\xE2\x8B\x80" },
+    { "Wfr", "\xF0\x9D\x94\x9A" },
+    { "Wopf", "\xF0\x9D\x95\x8E" },
+    { "Wscr", "\xF0\x9D\x92\xB2" },
+    { "Xfr", "\xF0\x9D\x94\x9B" },
+    { "Xi", "\xCE\x9E" },
+    { "Xopf", "\xF0\x9D\x95\x8F" },
+    { "Xscr", "\xF0\x9D\x92\xB3" },
+    { "YAcy", "\xD0\xAF" },
+    { "YIcy", "\xD0\x87" },
+    { "YUcy", "\xD0\xAE" },
+    { "Yacute", "\xC3\x9D" },
+    { "Ycirc", "\xC5\xB6" },
+    { "Ycy", "\xD0\xAB" },
+    { "Yfr", "\xF0\x9D\x94\x9C" },
+    { "Yopf", "\xF0\x9D\x95\x90" },
+    { "Yscr", "\xF0\x9D\x92\xB4" },
+    { "Yuml", "\xC5\xB8" },
+    { "ZHcy", "\xD0\x96" },
+    { "Zacute", "\xC5\xB9" },
+    { "Zcaron", "\xC5\xBD" },
+    { "Zcy", "\xD0\x97" },
+    { "Zdot", "\xC5\xBB" },
+    { "ZeroWidthSpace", "\xE2\x80\x8B" },
+    { "Zeta", "\xCE\x96" },
+    { "Zfr", "\xE2\x84\xA8" },
+    { "Zopf", "\xE2\x84\xA4" },
+    { "Zscr", "\xF0\x9D\x92\xB5" },
+    { "aacute", "\xC3\xA1" },
+    { "abreve", "\xC4\x83" },
+    { "ac", "\xE2\x88\xBE" },
+    { "acE", "\xE2\x88\xBE\xCC\xB3" },
+    { "acd", "\xE2\x88\xBF" },
+    { "acirc", "\xC3\xA2" },
+    { "acute", "\xC2\xB4" },
+    { "acy", "\xD0\xB0" },
+    { "aelig", "\xC3\xA6" },
+    { "af", "\xE2\x81\xA1" },
+    { "afr", "\xF0\x9D\x94\x9E" },
+    { "agrave", "\xC3\xA0" },
+    { "alefsym", "\xE2\x84\xB5" },
+    { "aleph", "\xE2\x84\xB5" },
+    { "alpha", "\xCE\xB1" },
+    { "amacr", "\xC4\x81" },
+    { "amalg", "\xE2\xA8\xBF" },
+    { "amp", "&" },
+    { "and", "\xE2\x88\xA7" },
+    { "andand", "\xE2\xA9\x95" },
+    { "andd", "\xE2\xA9\x9C" },
+    { "andslope", "\xE2\xA9\x98" },
+    { "andv", "\xE2\xA9\x9A" },
+    { "ang", "\xE2\x88\xA0" },
+    { "ange", "\xE2\xA6\xA4" },
+    { "angle", "\xE2\x88\xA0" },
+    { "angmsd", "\xE2\x88\xA1" },
+    { "angmsdaa", "\xE2\xA6\xA8" },
+    { "angmsdab", "\xE2\xA6\xA9" },
+    { "angmsdac", "\xE2\xA6\xAA" },
+    { "angmsdad", "\xE2\xA6\xAB" },
+    { "angmsdae", "\xE2\xA6\xAC" },
+    { "angmsdaf", "\xE2\xA6\xAD" },
+    { "angmsdag", "\xE2\xA6\xAE" },
+    { "angmsdah", "\xE2\xA6\xAF" },
+    { "angrt", "\xE2\x88\x9F" },
+    { "angrtvb", "\xE2\x8A\xBE" },
+    { "angrtvbd", "\xE2\xA6\x9D" },
+    { "angsph", "\xE2\x88\xA2" },
+    { "angst", "\xC3\x85" },
+    { "angzarr", "\xE2\x8D\xBC" },
+    { "aogon", "\xC4\x85" },
+    { "aopf", "\xF0\x9D\x95\x92" },
+    { "ap", "\xE2\x89\x88" },
+    { "apE", "\xE2\xA9\xB0" },
+    { "apacir", "\xE2\xA9\xAF" },
+    { "ape", "\xE2\x89\x8A" },
+    { "apid", "\xE2\x89\x8B" },
+    { "apos", "'" },
+    { "approx", "\xE2\x89\x88" },
+    { "approxeq", "\xE2\x89\x8A" },
+    { "aring", "\xC3\xA5" },
+    { "ascr", "\xF0\x9D\x92\xB6" },
+    { "ast", "*" },
+    { "asymp", "\xE2\x89\x88" },
+    { "asympeq", "\xE2\x89\x8D" },
+    { "atilde", "\xC3\xA3" },
+    { "auml", "\xC3\xA4" },
+    { "awconint", "\xE2\x88\xB3" },
+    { "awint", "\xE2\xA8\x91" },
+    { "bNot", "\xE2\xAB\xAD" },
+    { "backcong", "\xE2\x89\x8C" },
+    { "backepsilon", "\xCF\xB6" },
+    { "backprime", "\xE2\x80\xB5" },
+    { "backsim", "\xE2\x88\xBD" },
+    { "backsimeq", "\xE2\x8B\x8D" },
+    { "barvee", "\xE2\x8A\xBD" },
+    { "barwed", "\xE2\x8C\x85" },
+    { "barwedge", "\xE2\x8C\x85" },
+    { "bbrk", "\xE2\x8E\xB5" },
+    { "bbrktbrk", "\xE2\x8E\xB6" },
+    { "bcong", "\xE2\x89\x8C" },
+    { "bcy", "\xD0\xB1" },
+    { "bdquo", "\xE2\x80\x9E" },
+    { "becaus", "\xE2\x88\xB5" },
+    { "because", "\xE2\x88\xB5" },
+    { "bemptyv", "\xE2\xA6\xB0" },
+    { "bepsi", "\xCF\xB6" },
+    { "bernou", "\xE2\x84\xAC" },
+    { "beta", "\xCE\xB2" },
+    { "beth", "\xE2\x84\xB6" },
+    { "between", "\xE2\x89\xAC" },
+    { "bfr", "\xF0\x9D\x94\x9F" },
+    { "bigcap", "\xE2\x8B\x82" },
+    { "bigcirc", "\xE2\x97\xAF" },
+    { "bigcup", "\xE2\x8B\x83" },
+    { "bigodot", "\xE2\xA8\x80" },
+    { "bigoplus", "\xE2\xA8\x81" },
+    { "bigotimes", "\xE2\xA8\x82" },
+    { "bigsqcup", "\xE2\xA8\x86" },
+    { "bigstar", "\xE2\x98\x85" },
+    { "bigtriangledown", "\xE2\x96\xBD" },
+    { "bigtriangleup", "\xE2\x96\xB3" },
+    { "biguplus", "\xE2\xA8\x84" },
+    { "bigvee", "\xE2\x8B\x81" },
+    { "bigwedge", "\xE2\x8B\x80" },
+    { "bkarow", "\xE2\xA4\x8D" },
+    { "blacklozenge", "\xE2\xA7\xAB" },
+    { "blacksquare", "\xE2\x96\xAA" },
+    { "blacktriangle", "\xE2\x96\xB4" },
+    { "blacktriangledown", "\xE2\x96\xBE" },
+    { "blacktriangleleft", "\xE2\x97\x82" },
+    { "blacktriangleright", "\xE2\x96\xB8" },
+    { "blank", "\xE2\x90\xA3" },
+    { "blk12", "\xE2\x96\x92" },
+    { "blk14", "\xE2\x96\x91" },
+    { "blk34", "\xE2\x96\x93" },
+    { "block", "\xE2\x96\x88" },
+    { "bne", "=\xE2\x83\xA5" },
+    { "bnequiv", "\xE2\x89\xA1\xE2\x83\xA5" },
+    { "bnot", "\xE2\x8C\x90" },
+    { "bopf", "\xF0\x9D\x95\x93" },
+    { "bot", "\xE2\x8A\xA5" },
+    { "bottom", "\xE2\x8A\xA5" },
+    { "bowtie", "\xE2\x8B\x88" },
+    { "boxDL", "\xE2\x95\x97" },
+    { "boxDR", "\xE2\x95\x94" },
+    { "boxDl", "\xE2\x95\x96" },
+    { "boxDr", "\xE2\x95\x93" },
+    { "boxH", "\xE2\x95\x90" },
+    { "boxHD", "\xE2\x95\xA6" },
+    { "boxHU", "\xE2\x95\xA9" },
+    { "boxHd", "\xE2\x95\xA4" },
+    { "boxHu", "\xE2\x95\xA7" },
+    { "boxUL", "\xE2\x95\x9D" },
+    { "boxUR", "\xE2\x95\x9A" },
+    { "boxUl", "\xE2\x95\x9C" },
+    { "boxUr", "\xE2\x95\x99" },
+    { "boxV", "\xE2\x95\x91" },
+    { "boxVH", "\xE2\x95\xAC" },
+    { "boxVL", "\xE2\x95\xA3" },
+    { "boxVR", "\xE2\x95\xA0" },
+    { "boxVh", "\xE2\x95\xAB" },
+    { "boxVl", "\xE2\x95\xA2" },
+    { "boxVr", "\xE2\x95\x9F" },
+    { "boxbox", "\xE2\xA7\x89" },
+    { "boxdL", "\xE2\x95\x95" },
+    { "boxdR", "\xE2\x95\x92" },
+    { "boxdl", "\xE2\x94\x90" },
+    { "boxdr", "\xE2\x94\x8C" },
+    { "boxh", "\xE2\x94\x80" },
+    { "boxhD", "\xE2\x95\xA5" },
+    { "boxhU", "\xE2\x95\xA8" },
+    { "boxhd", "\xE2\x94\xAC" },
+    { "boxhu", "\xE2\x94\xB4" },
+    { "boxminus", "\xE2\x8A\x9F" },
+    { "boxplus", "\xE2\x8A\x9E" },
+    { "boxtimes", "\xE2\x8A\xA0" },
+    { "boxuL", "\xE2\x95\x9B" },
+    { "boxuR", "\xE2\x95\x98" },
+    { "boxul", "\xE2\x94\x98" },
+    { "boxur", "\xE2\x94\x94" },
+    { "boxv", "\xE2\x94\x82" },
+    { "boxvH", "\xE2\x95\xAA" },
+    { "boxvL", "\xE2\x95\xA1" },
+    { "boxvR", "\xE2\x95\x9E" },
+    { "boxvh", "\xE2\x94\xBC" },
+    { "boxvl", "\xE2\x94\xA4" },
+    { "boxvr", "\xE2\x94\x9C" },
+    { "bprime", "\xE2\x80\xB5" },
+    { "breve", "\xCB\x98" },
+    { "brvbar", "\xC2\xA6" },
+    { "bscr", "\xF0\x9D\x92\xB7" },
+    { "bsemi", "\xE2\x81\x8F" },
+    { "bsim", "\xE2\x88\xBD" },
+    { "bsime", "\xE2\x8B\x8D" },
+    { "bsol", "\x5C" },
+    { "bsolb", "\xE2\xA7\x85" },
+    { "bsolhsub", "\xE2\x9F\x88" },
+    { "bull", "\xE2\x80\xA2" },
+    { "bullet", "\xE2\x80\xA2" },
+    { "bump", "\xE2\x89\x8E" },
+    { "bumpE", "\xE2\xAA\xAE" },
+    { "bumpe", "\xE2\x89\x8F" },
+    { "bumpeq", "\xE2\x89\x8F" },
+    { "cacute", "\xC4\x87" },
+    { "cap", "\xE2\x88\xA9" },
+    { "capand", "\xE2\xA9\x84" },
+    { "capbrcup", "\xE2\xA9\x89" },
+    { "capcap", "\xE2\xA9\x8B" },
+    { "capcup", "\xE2\xA9\x87" },
+    { "capdot", "\xE2\xA9\x80" },
+    { "caps", "\xE2\x88\xA9\xEF\xB8\x80" },
+    { "caret", "\xE2\x81\x81" },
+    { "caron", "\xCB\x87" },
+    { "ccaps", "\xE2\xA9\x8D" },
+    { "ccaron", "\xC4\x8D" },
+    { "ccedil", "\xC3\xA7" },
+    { "ccirc", "\xC4\x89" },
+    { "ccups", "\xE2\xA9\x8C" },
+    { "ccupssm", "\xE2\xA9\x90" },
+    { "cdot", "\xC4\x8B" },
+    { "cedil", "\xC2\xB8" },
+    { "cemptyv", "\xE2\xA6\xB2" },
+    { "cent", "\xC2\xA2" },
+    { "centerdot", "\xC2\xB7" },
+    { "cfr", "\xF0\x9D\x94\xA0" },
+    { "chcy", "\xD1\x87" },
+    { "check", "\xE2\x9C\x93" },
+    { "checkmark", "\xE2\x9C\x93" },
+    { "chi", "\xCF\x87" },
+    { "cir", "\xE2\x97\x8B" },
+    { "cirE", "\xE2\xA7\x83" },
+    { "circ", "\xCB\x86" },
+    { "circeq", "\xE2\x89\x97" },
+    { "circlearrowleft", "\xE2\x86\xBA" },
+    { "circlearrowright", "\xE2\x86\xBB" },
+    { "circledR", "\xC2\xAE" },
+    { "circledS", "\xE2\x93\x88" },
+    { "circledast", "\xE2\x8A\x9B" },
+    { "circledcirc", "\xE2\x8A\x9A" },
+    { "circleddash", "\xE2\x8A\x9D" },
+    { "cire", "\xE2\x89\x97" },
+    { "cirfnint", "\xE2\xA8\x90" },
+    { "cirmid", "\xE2\xAB\xAF" },
+    { "cirscir", "\xE2\xA7\x82" },
+    { "clubs", "\xE2\x99\xA3" },
+    { "clubsuit", "\xE2\x99\xA3" },
+    { "colon", ":" },
+    { "colone", "\xE2\x89\x94" },
+    { "coloneq", "\xE2\x89\x94" },
+    { "comma", "," },
+    { "commat", "@" },
+    { "comp", "\xE2\x88\x81" },
+    { "compfn", "\xE2\x88\x98" },
+    { "complement", "\xE2\x88\x81" },
+    { "complexes", "\xE2\x84\x82" },
+    { "cong", "\xE2\x89\x85" },
+    { "congdot", "\xE2\xA9\xAD" },
+    { "conint", "\xE2\x88\xAE" },
+    { "copf", "\xF0\x9D\x95\x94" },
+    { "coprod", "\xE2\x88\x90" },
+    { "copy", "\xC2\xA9" },
+    { "copysr", "\xE2\x84\x97" },
+    { "crarr", "\xE2\x86\xB5" },
+    { "cross", "\xE2\x9C\x97" },
+    { "cscr", "\xF0\x9D\x92\xB8" },
+    { "csub", "\xE2\xAB\x8F" },
+    { "csube", "\xE2\xAB\x91" },
+    { "csup", "\xE2\xAB\x90" },
+    { "csupe", "\xE2\xAB\x92" },
+    { "ctdot", "\xE2\x8B\xAF" },
+    { "cudarrl", "\xE2\xA4\xB8" },
+    { "cudarrr", "\xE2\xA4\xB5" },
+    { "cuepr", "\xE2\x8B\x9E" },
+    { "cuesc", "\xE2\x8B\x9F" },
+    { "cularr", "\xE2\x86\xB6" },
+    { "cularrp", "\xE2\xA4\xBD" },
+    { "cup", "\xE2\x88\xAA" },
+    { "cupbrcap", "\xE2\xA9\x88" },
+    { "cupcap", "\xE2\xA9\x86" },
+    { "cupcup", "\xE2\xA9\x8A" },
+    { "cupdot", "\xE2\x8A\x8D" },
+    { "cupor", "\xE2\xA9\x85" },
+    { "cups", "\xE2\x88\xAA\xEF\xB8\x80" },
+    { "curarr", "\xE2\x86\xB7" },
+    { "curarrm", "\xE2\xA4\xBC" },
+    { "curlyeqprec", "\xE2\x8B\x9E" },
+    { "curlyeqsucc", "\xE2\x8B\x9F" },
+    { "curlyvee", "\xE2\x8B\x8E" },
+    { "curlywedge", "\xE2\x8B\x8F" },
+    { "curren", "\xC2\xA4" },
+    { "curvearrowleft", "\xE2\x86\xB6" },
+    { "curvearrowright", "\xE2\x86\xB7" },
+    { "cuvee", "\xE2\x8B\x8E" },
+    { "cuwed", "\xE2\x8B\x8F" },
+    { "cwconint", "\xE2\x88\xB2" },
+    { "cwint", "\xE2\x88\xB1" },
+    { "cylcty", "\xE2\x8C\xAD" },
+    { "dArr", "\xE2\x87\x93" },
+    { "dHar", "\xE2\xA5\xA5" },
+    { "dagger", "\xE2\x80\xA0" },
+    { "daleth", "\xE2\x84\xB8" },
+    { "darr", "\xE2\x86\x93" },
+    { "dash", "\xE2\x80\x90" },
+    { "dashv", "\xE2\x8A\xA3" },
+    { "dbkarow", "\xE2\xA4\x8F" },
+    { "dblac", "\xCB\x9D" },
+    { "dcaron", "\xC4\x8F" },
+    { "dcy", "\xD0\xB4" },
+    { "dd", "\xE2\x85\x86" },
+    { "ddagger", "\xE2\x80\xA1" },
+    { "ddarr", "\xE2\x87\x8A" },
+    { "ddotseq", "\xE2\xA9\xB7" },
+    { "deg", "\xC2\xB0" },
+    { "delta", "\xCE\xB4" },
+    { "demptyv", "\xE2\xA6\xB1" },
+    { "dfisht", "\xE2\xA5\xBF" },
+    { "dfr", "\xF0\x9D\x94\xA1" },
+    { "dharl", "\xE2\x87\x83" },
+    { "dharr", "\xE2\x87\x82" },
+    { "diam", "\xE2\x8B\x84" },
+    { "diamond", "\xE2\x8B\x84" },
+    { "diamondsuit", "\xE2\x99\xA6" },
+    { "diams", "\xE2\x99\xA6" },
+    { "die", "\xC2\xA8" },
+    { "digamma", "\xCF\x9D" },
+    { "disin", "\xE2\x8B\xB2" },
+    { "div", "\xC3\xB7" },
+    { "divide", "\xC3\xB7" },
+    { "divideontimes", "\xE2\x8B\x87" },
+    { "divonx", "\xE2\x8B\x87" },
+    { "djcy", "\xD1\x92" },
+    { "dlcorn", "\xE2\x8C\x9E" },
+    { "dlcrop", "\xE2\x8C\x8D" },
+    { "dollar", "$" },
+    { "dopf", "\xF0\x9D\x95\x95" },
+    { "dot", "\xCB\x99" },
+    { "doteq", "\xE2\x89\x90" },
+    { "doteqdot", "\xE2\x89\x91" },
+    { "dotminus", "\xE2\x88\xB8" },
+    { "dotplus", "\xE2\x88\x94" },
+    { "dotsquare", "\xE2\x8A\xA1" },
+    { "doublebarwedge", "\xE2\x8C\x86" },
+    { "downarrow", "\xE2\x86\x93" },
+    { "downdownarrows", "\xE2\x87\x8A" },
+    { "downharpoonleft", "\xE2\x87\x83" },
+    { "downharpoonright", "\xE2\x87\x82" },
+    { "drbkarow", "\xE2\xA4\x90" },
+    { "drcorn", "\xE2\x8C\x9F" },
+    { "drcrop", "\xE2\x8C\x8C" },
+    { "dscr", "\xF0\x9D\x92\xB9" },
+    { "dscy", "\xD1\x95" },
+    { "dsol", "\xE2\xA7\xB6" },
+    { "dstrok", "\xC4\x91" },
+    { "dtdot", "\xE2\x8B\xB1" },
+    { "dtri", "\xE2\x96\xBF" },
+    { "dtrif", "\xE2\x96\xBE" },
+    { "duarr", "\xE2\x87\xB5" },
+    { "duhar", "\xE2\xA5\xAF" },
+    { "dwangle", "\xE2\xA6\xA6" },
+    { "dzcy", "\xD1\x9F" },
+    { "dzigrarr", "\xE2\x9F\xBF" },
+    { "eDDot", "\xE2\xA9\xB7" },
+    { "eDot", "\xE2\x89\x91" },
+    { "eacute", "\xC3\xA9" },
+    { "easter", "\xE2\xA9\xAE" },
+    { "ecaron", "\xC4\x9B" },
+    { "ecir", "\xE2\x89\x96" },
+    { "ecirc", "\xC3\xAA" },
+    { "ecolon", "\xE2\x89\x95" },
+    { "ecy", "\xD1\x8D" },
+    { "edot", "\xC4\x97" },
+    { "ee", "\xE2\x85\x87" },
+    { "efDot", "\xE2\x89\x92" },
+    { "efr", "\xF0\x9D\x94\xA2" },
+    { "eg", "\xE2\xAA\x9A" },
+    { "egrave", "\xC3\xA8" },
+    { "egs", "\xE2\xAA\x96" },
+    { "egsdot", "\xE2\xAA\x98" },
+    { "el", "\xE2\xAA\x99" },
+    { "elinters", "\xE2\x8F\xA7" },
+    { "ell", "\xE2\x84\x93" },
+    { "els", "\xE2\xAA\x95" },
+    { "elsdot", "\xE2\xAA\x97" },
+    { "emacr", "\xC4\x93" },
+    { "empty", "\xE2\x88\x85" },
+    { "emptyset", "\xE2\x88\x85" },
+    { "emptyv", "\xE2\x88\x85" },
+    { "emsp13", "\xE2\x80\x84" },
+    { "emsp14", "\xE2\x80\x85" },
+    { "emsp", "\xE2\x80\x83" },
+    { "eng", "\xC5\x8B" },
+    { "ensp", "\xE2\x80\x82" },
+    { "eogon", "\xC4\x99" },
+    { "eopf", "\xF0\x9D\x95\x96" },
+    { "epar", "\xE2\x8B\x95" },
+    { "eparsl", "\xE2\xA7\xA3" },
+    { "eplus", "\xE2\xA9\xB1" },
+    { "epsi", "\xCE\xB5" },
+    { "epsilon", "\xCE\xB5" },
+    { "epsiv", "\xCF\xB5" },
+    { "eqcirc", "\xE2\x89\x96" },
+    { "eqcolon", "\xE2\x89\x95" },
+    { "eqsim", "\xE2\x89\x82" },
+    { "eqslantgtr", "\xE2\xAA\x96" },
+    { "eqslantless", "\xE2\xAA\x95" },
+    { "equals", "=" },
+    { "equest", "\xE2\x89\x9F" },
+    { "equiv", "\xE2\x89\xA1" },
+    { "equivDD", "\xE2\xA9\xB8" },
+    { "eqvparsl", "\xE2\xA7\xA5" },
+    { "erDot", "\xE2\x89\x93" },
+    { "erarr", "\xE2\xA5\xB1" },
+    { "escr", "\xE2\x84\xAF" },
+    { "esdot", "\xE2\x89\x90" },
+    { "esim", "\xE2\x89\x82" },
+    { "eta", "\xCE\xB7" },
+    { "eth", "\xC3\xB0" },
+    { "euml", "\xC3\xAB" },
+    { "euro", "\xE2\x82\xAC" },
+    { "excl", "!" },
+    { "exist", "\xE2\x88\x83" },
+    { "expectation", "\xE2\x84\xB0" },
+    { "exponentiale", "\xE2\x85\x87" },
+    { "fallingdotseq", "\xE2\x89\x92" },
+    { "fcy", "\xD1\x84" },
+    { "female", "\xE2\x99\x80" },
+    { "ffilig", "\xEF\xAC\x83" },
+    { "fflig", "\xEF\xAC\x80" },
+    { "ffllig", "\xEF\xAC\x84" },
+    { "ffr", "\xF0\x9D\x94\xA3" },
+    { "filig", "\xEF\xAC\x81" },
+    { "fjlig", "fj" },
+    { "flat", "\xE2\x99\xAD" },
+    { "fllig", "\xEF\xAC\x82" },
+    { "fltns", "\xE2\x96\xB1" },
+    { "fnof", "\xC6\x92" },
+    { "fopf", "\xF0\x9D\x95\x97" },
+    { "forall", "\xE2\x88\x80" },
+    { "fork", "\xE2\x8B\x94" },
+    { "forkv", "\xE2\xAB\x99" },
+    { "fpartint", "\xE2\xA8\x8D" },
+    { "frac12", "\xC2\xBD" },
+    { "frac13", "\xE2\x85\x93" },
+    { "frac14", "\xC2\xBC" },
+    { "frac15", "\xE2\x85\x95" },
+    { "frac16", "\xE2\x85\x99" },
+    { "frac18", "\xE2\x85\x9B" },
+    { "frac23", "\xE2\x85\x94" },
+    { "frac25", "\xE2\x85\x96" },
+    { "frac34", "\xC2\xBE" },
+    { "frac35", "\xE2\x85\x97" },
+    { "frac38", "\xE2\x85\x9C" },
+    { "frac45", "\xE2\x85\x98" },
+    { "frac56", "\xE2\x85\x9A" },
+    { "frac58", "\xE2\x85\x9D" },
+    { "frac78", "\xE2\x85\x9E" },
+    { "frasl", "\xE2\x81\x84" },
+    { "frown", "\xE2\x8C\xA2" },
+    { "fscr", "\xF0\x9D\x92\xBB" },
+    { "gE", "\xE2\x89\xA7" },
+    { "gEl", "\xE2\xAA\x8C" },
+    { "gacute", "\xC7\xB5" },
+    { "gamma", "\xCE\xB3" },
+    { "gammad", "\xCF\x9D" },
+    { "gap", "\xE2\xAA\x86" },
+    { "gbreve", "\xC4\x9F" },
+    { "gcirc", "\xC4\x9D" },
+    { "gcy", "\xD0\xB3" },
+    { "gdot", "\xC4\xA1" },
+    { "ge", "\xE2\x89\xA5" },
+    { "gel", "\xE2\x8B\x9B" },
+    { "geq", "\xE2\x89\xA5" },
+    { "geqq", "\xE2\x89\xA7" },
+    { "geqslant", "\xE2\xA9\xBE" },
+    { "ges", "\xE2\xA9\xBE" },
+    { "gescc", "\xE2\xAA\xA9" },
+    { "gesdot", "\xE2\xAA\x80" },
+    { "gesdoto", "\xE2\xAA\x82" },
+    { "gesdotol", "\xE2\xAA\x84" },
+    { "gesl", "\xE2\x8B\x9B\xEF\xB8\x80" },
+    { "gesles", "\xE2\xAA\x94" },
+    { "gfr", "\xF0\x9D\x94\xA4" },
+    { "gg", "\xE2\x89\xAB" },
+    { "ggg", "\xE2\x8B\x99" },
+    { "gimel", "\xE2\x84\xB7" },
+    { "gjcy", "\xD1\x93" },
+    { "gl", "\xE2\x89\xB7" },
+    { "glE", "\xE2\xAA\x92" },
+    { "gla", "\xE2\xAA\xA5" },
+    { "glj", "\xE2\xAA\xA4" },
+    { "gnE", "\xE2\x89\xA9" },
+    { "gnap", "\xE2\xAA\x8A" },
+    { "gnapprox", "\xE2\xAA\x8A" },
+    { "gne", "\xE2\xAA\x88" },
+    { "gneq", "\xE2\xAA\x88" },
+    { "gneqq", "\xE2\x89\xA9" },
+    { "gnsim", "\xE2\x8B\xA7" },
+    { "gopf", "\xF0\x9D\x95\x98" },
+    { "grave", "`" },
+    { "gscr", "\xE2\x84\x8A" },
+    { "gsim", "\xE2\x89\xB3" },
+    { "gsime", "\xE2\xAA\x8E" },
+    { "gsiml", "\xE2\xAA\x90" },
+    { "gt", ">" },
+    { "gtcc", "\xE2\xAA\xA7" },
+    { "gtcir", "\xE2\xA9\xBA" },
+    { "gtdot", "\xE2\x8B\x97" },
+    { "gtlPar", "\xE2\xA6\x95" },
+    { "gtquest", "\xE2\xA9\xBC" },
+    { "gtrapprox", "\xE2\xAA\x86" },
+    { "gtrarr", "\xE2\xA5\xB8" },
+    { "gtrdot", "\xE2\x8B\x97" },
+    { "gtreqless", "\xE2\x8B\x9B" },
+    { "gtreqqless", "\xE2\xAA\x8C" },
+    { "gtrless", "\xE2\x89\xB7" },
+    { "gtrsim", "\xE2\x89\xB3" },
+    { "gvertneqq", "\xE2\x89\xA9\xEF\xB8\x80" },
+    { "gvnE", "\xE2\x89\xA9\xEF\xB8\x80" },
+    { "hArr", "\xE2\x87\x94" },
+    { "hairsp", "\xE2\x80\x8A" },
+    { "half", "\xC2\xBD" },
+    { "hamilt", "\xE2\x84\x8B" },
+    { "hardcy", "\xD1\x8A" },
+    { "harr", "\xE2\x86\x94" },
+    { "harrcir", "\xE2\xA5\x88" },
+    { "harrw", "\xE2\x86\xAD" },
+    { "hbar", "\xE2\x84\x8F" },
+    { "hcirc", "\xC4\xA5" },
+    { "hearts", "\xE2\x99\xA5" },
+    { "heartsuit", "\xE2\x99\xA5" },
+    { "hellip", "\xE2\x80\xA6" },
+    { "hercon", "\xE2\x8A\xB9" },
+    { "hfr", "\xF0\x9D\x94\xA5" },
+    { "hksearow", "\xE2\xA4\xA5" },
+    { "hkswarow", "\xE2\xA4\xA6" },
+    { "hoarr", "\xE2\x87\xBF" },
+    { "homtht", "\xE2\x88\xBB" },
+    { "hookleftarrow", "\xE2\x86\xA9" },
+    { "hookrightarrow", "\xE2\x86\xAA" },
+    { "hopf", "\xF0\x9D\x95\x99" },
+    { "horbar", "\xE2\x80\x95" },
+    { "hscr", "\xF0\x9D\x92\xBD" },
+    { "hslash", "\xE2\x84\x8F" },
+    { "hstrok", "\xC4\xA7" },
+    { "hybull", "\xE2\x81\x83" },
+    { "hyphen", "\xE2\x80\x90" },
+    { "iacute", "\xC3\xAD" },
+    { "ic", "\xE2\x81\xA3" },
+    { "icirc", "\xC3\xAE" },
+    { "icy", "\xD0\xB8" },
+    { "iecy", "\xD0\xB5" },
+    { "iexcl", "\xC2\xA1" },
+    { "iff", "\xE2\x87\x94" },
+    { "ifr", "\xF0\x9D\x94\xA6" },
+    { "igrave", "\xC3\xAC" },
+    { "ii", "\xE2\x85\x88" },
+    { "iiiint", "\xE2\xA8\x8C" },
+    { "iiint", "\xE2\x88\xAD" },
+    { "iinfin", "\xE2\xA7\x9C" },
+    { "iiota", "\xE2\x84\xA9" },
+    { "ijlig", "\xC4\xB3" },
+    { "imacr", "\xC4\xAB" },
+    { "image", "\xE2\x84\x91" },
+    { "imagline", "\xE2\x84\x90" },
+    { "imagpart", "\xE2\x84\x91" },
+    { "imath", "\xC4\xB1" },
+    { "imof", "\xE2\x8A\xB7" },
+    { "imped", "\xC6\xB5" },
+    { "in", "\xE2\x88\x88" },
+    { "incare", "\xE2\x84\x85" },
+    { "infin", "\xE2\x88\x9E" },
+    { "infintie", "\xE2\xA7\x9D" },
+    { "inodot", "\xC4\xB1" },
+    { "int", "\xE2\x88\xAB" },
+    { "intcal", "\xE2\x8A\xBA" },
+    { "integers", "\xE2\x84\xA4" },
+    { "intercal", "\xE2\x8A\xBA" },
+    { "intlarhk", "\xE2\xA8\x97" },
+    { "intprod", "\xE2\xA8\xBC" },
+    { "iocy", "\xD1\x91" },
+    { "iogon", "\xC4\xAF" },
+    { "iopf", "\xF0\x9D\x95\x9A" },
+    { "iota", "\xCE\xB9" },
+    { "iprod", "\xE2\xA8\xBC" },
+    { "iquest", "\xC2\xBF" },
+    { "iscr", "\xF0\x9D\x92\xBE" },
+    { "isin", "\xE2\x88\x88" },
+    { "isinE", "\xE2\x8B\xB9" },
+    { "isindot", "\xE2\x8B\xB5" },
+    { "isins", "\xE2\x8B\xB4" },
+    { "isinsv", "\xE2\x8B\xB3" },
+    { "isinv", "\xE2\x88\x88" },
+    { "it", "\xE2\x81\xA2" },
+    { "itilde", "\xC4\xA9" },
+    { "iukcy", "\xD1\x96" },
+    { "iuml", "\xC3\xAF" },
+    { "jcirc", "\xC4\xB5" },
+    { "jcy", "\xD0\xB9" },
+    { "jfr", "\xF0\x9D\x94\xA7" },
+    { "jmath", "\xC8\xB7" },
+    { "jopf", "\xF0\x9D\x95\x9B" },
+    { "jscr", "\xF0\x9D\x92\xBF" },
+    { "jsercy", "\xD1\x98" },
+    { "jukcy", "\xD1\x94" },
+    { "kappa", "\xCE\xBA" },
+    { "kappav", "\xCF\xB0" },
+    { "kcedil", "\xC4\xB7" },
+    { "kcy", "\xD0\xBA" },
+    { "kfr", "\xF0\x9D\x94\xA8" },
+    { "kgreen", "\xC4\xB8" },
+    { "khcy", "\xD1\x85" },
+    { "kjcy", "\xD1\x9C" },
+    { "kopf", "\xF0\x9D\x95\x9C" },
+    { "kscr", "\xF0\x9D\x93\x80" },
+    { "lAarr", "\xE2\x87\x9A" },
+    { "lArr", "\xE2\x87\x90" },
+    { "lAtail", "\xE2\xA4\x9B" },
+    { "lBarr", "\xE2\xA4\x8E" },
+    { "lE", "\xE2\x89\xA6" },
+    { "lEg", "\xE2\xAA\x8B" },
+    { "lHar", "\xE2\xA5\xA2" },
+    { "lacute", "\xC4\xBA" },
+    { "laemptyv", "\xE2\xA6\xB4" },
+    { "lagran", "\xE2\x84\x92" },
+    { "lambda", "\xCE\xBB" },
+    { "lang", "\xE2\x9F\xA8" },
+    { "langd", "\xE2\xA6\x91" },
+    { "langle", "\xE2\x9F\xA8" },
+    { "lap", "\xE2\xAA\x85" },
+    { "laquo", "\xC2\xAB" },
+    { "larr", "\xE2\x86\x90" },
+    { "larrb", "\xE2\x87\xA4" },
+    { "larrbfs", "\xE2\xA4\x9F" },
+    { "larrfs", "\xE2\xA4\x9D" },
+    { "larrhk", "\xE2\x86\xA9" },
+    { "larrlp", "\xE2\x86\xAB" },
+    { "larrpl", "\xE2\xA4\xB9" },
+    { "larrsim", "\xE2\xA5\xB3" },
+    { "larrtl", "\xE2\x86\xA2" },
+    { "lat", "\xE2\xAA\xAB" },
+    { "latail", "\xE2\xA4\x99" },
+    { "late", "\xE2\xAA\xAD" },
+    { "lates", "\xE2\xAA\xAD\xEF\xB8\x80" },
+    { "lbarr", "\xE2\xA4\x8C" },
+    { "lbbrk", "\xE2\x9D\xB2" },
+    { "lbrace", "{" },
+    { "lbrack", "[" },
+    { "lbrke", "\xE2\xA6\x8B" },
+    { "lbrksld", "\xE2\xA6\x8F" },
+    { "lbrkslu", "\xE2\xA6\x8D" },
+    { "lcaron", "\xC4\xBE" },
+    { "lcedil", "\xC4\xBC" },
+    { "lceil", "\xE2\x8C\x88" },
+    { "lcub", "{" },
+    { "lcy", "\xD0\xBB" },
+    { "ldca", "\xE2\xA4\xB6" },
+    { "ldquo", "\x22" },
+    { "ldquor", "\xE2\x80\x9E" },
+    { "ldrdhar", "\xE2\xA5\xA7" },
+    { "ldrushar", "\xE2\xA5\x8B" },
+    { "ldsh", "\xE2\x86\xB2" },
+    { "le", "\xE2\x89\xA4" },
+    { "leftarrow", "\xE2\x86\x90" },
+    { "leftarrowtail", "\xE2\x86\xA2" },
+    { "leftharpoondown", "\xE2\x86\xBD" },
+    { "leftharpoonup", "\xE2\x86\xBC" },
+    { "leftleftarrows", "\xE2\x87\x87" },
+    { "leftrightarrow", "\xE2\x86\x94" },
+    { "leftrightarrows", "\xE2\x87\x86" },
+    { "leftrightharpoons", "\xE2\x87\x8B" },
+    { "leftrightsquigarrow", "\xE2\x86\xAD" },
+    { "leftthreetimes", "\xE2\x8B\x8B" },
+    { "leg", "\xE2\x8B\x9A" },
+    { "leq", "\xE2\x89\xA4" },
+    { "leqq", "\xE2\x89\xA6" },
+    { "leqslant", "\xE2\xA9\xBD" },
+    { "les", "\xE2\xA9\xBD" },
+    { "lescc", "\xE2\xAA\xA8" },
+    { "lesdot", "\xE2\xA9\xBF" },
+    { "lesdoto", "\xE2\xAA\x81" },
+    { "lesdotor", "\xE2\xAA\x83" },
+    { "lesg", "\xE2\x8B\x9A\xEF\xB8\x80" },
+    { "lesges", "\xE2\xAA\x93" },
+    { "lessapprox", "\xE2\xAA\x85" },
+    { "lessdot", "\xE2\x8B\x96" },
+    { "lesseqgtr", "\xE2\x8B\x9A" },
+    { "lesseqqgtr", "\xE2\xAA\x8B" },
+    { "lessgtr", "\xE2\x89\xB6" },
+    { "lesssim", "\xE2\x89\xB2" },
+    { "lfisht", "\xE2\xA5\xBC" },
+    { "lfloor", "\xE2\x8C\x8A" },
+    { "lfr", "\xF0\x9D\x94\xA9" },
+    { "lg", "\xE2\x89\xB6" },
+    { "lgE", "\xE2\xAA\x91" },
+    { "lhard", "\xE2\x86\xBD" },
+    { "lharu", "\xE2\x86\xBC" },
+    { "lharul", "\xE2\xA5\xAA" },
+    { "lhblk", "\xE2\x96\x84" },
+    { "ljcy", "\xD1\x99" },
+    { "ll", "\xE2\x89\xAA" },
+    { "llarr", "\xE2\x87\x87" },
+    { "llcorner", "\xE2\x8C\x9E" },
+    { "llhard", "\xE2\xA5\xAB" },
+    { "lltri", "\xE2\x97\xBA" },
+    { "lmidot", "\xC5\x80" },
+    { "lmoust", "\xE2\x8E\xB0" },
+    { "lmoustache", "\xE2\x8E\xB0" },
+    { "lnE", "\xE2\x89\xA8" },
+    { "lnap", "\xE2\xAA\x89" },
+    { "lnapprox", "\xE2\xAA\x89" },
+    { "lne", "\xE2\xAA\x87" },
+    { "lneq", "\xE2\xAA\x87" },
+    { "lneqq", "\xE2\x89\xA8" },
+    { "lnsim", "\xE2\x8B\xA6" },
+    { "loang", "\xE2\x9F\xAC" },
+    { "loarr", "\xE2\x87\xBD" },
+    { "lobrk", "\xE2\x9F\xA6" },
+    { "longleftarrow", "\xE2\x9F\xB5" },
+    { "longleftrightarrow", "\xE2\x9F\xB7" },
+    { "longmapsto", "\xE2\x9F\xBC" },
+    { "longrightarrow", "\xE2\x9F\xB6" },
+    { "looparrowleft", "\xE2\x86\xAB" },
+    { "looparrowright", "\xE2\x86\xAC" },
+    { "lopar", "\xE2\xA6\x85" },
+    { "lopf", "\xF0\x9D\x95\x9D" },
+    { "loplus", "\xE2\xA8\xAD" },
+    { "lotimes", "\xE2\xA8\xB4" },
+    { "lowast", "\xE2\x88\x97" },
+    { "lowbar", "_" },
+    { "loz", "\xE2\x97\x8A" },
+    { "lozenge", "\xE2\x97\x8A" },
+    { "lozf", "\xE2\xA7\xAB" },
+    { "lpar", "(" },
+    { "lparlt", "\xE2\xA6\x93" },
+    { "lrarr", "\xE2\x87\x86" },
+    { "lrcorner", "\xE2\x8C\x9F" },
+    { "lrhar", "\xE2\x87\x8B" },
+    { "lrhard", "\xE2\xA5\xAD" },
+    { "lrm", "\xE2\x80\x8E" },
+    { "lrtri", "\xE2\x8A\xBF" },
+    { "lsaquo", "\xE2\x80\xB9" },
+    { "lscr", "\xF0\x9D\x93\x81" },
+    { "lsh", "\xE2\x86\xB0" },
+    { "lsim", "\xE2\x89\xB2" },
+    { "lsime", "\xE2\xAA\x8D" },
+    { "lsimg", "\xE2\xAA\x8F" },
+    { "lsqb", "[" },
+    { "lsquo", "\xE2\x80\x98" },
+    { "lsquor", "\xE2\x80\x9A" },
+    { "lstrok", "\xC5\x82" },
+    { "lt", "<" },
+    { "ltcc", "\xE2\xAA\xA6" },
+    { "ltcir", "\xE2\xA9\xB9" },
+    { "ltdot", "\xE2\x8B\x96" },
+    { "lthree", "\xE2\x8B\x8B" },
+    { "ltimes", "\xE2\x8B\x89" },
+    { "ltlarr", "\xE2\xA5\xB6" },
+    { "ltquest", "\xE2\xA9\xBB" },
+    { "ltrPar", "\xE2\xA6\x96" },
+    { "ltri", "\xE2\x97\x83" },
+    { "ltrie", "\xE2\x8A\xB4" },
+    { "ltrif", "\xE2\x97\x82" },
+    { "lurdshar", "\xE2\xA5\x8A" },
+    { "luruhar", "\xE2\xA5\xA6" },
+    { "lvertneqq", "\xE2\x89\xA8\xEF\xB8\x80" },
+    { "lvnE", "\xE2\x89\xA8\xEF\xB8\x80" },
+    { "mDDot", "\xE2\x88\xBA" },
+    { "macr", "\xC2\xAF" },
+    { "male", "\xE2\x99\x82" },
+    { "malt", "\xE2\x9C\xA0" },
+    { "maltese", "\xE2\x9C\xA0" },
+    { "map", "\xE2\x86\xA6" },
+    { "mapsto", "\xE2\x86\xA6" },
+    { "mapstodown", "\xE2\x86\xA7" },
+    { "mapstoleft", "\xE2\x86\xA4" },
+    { "mapstoup", "\xE2\x86\xA5" },
+    { "marker", "\xE2\x96\xAE" },
+    { "mcomma", "\xE2\xA8\xA9" },
+    { "mcy", "\xD0\xBC" },
+    { "mdash", "\xE2\x80\x94" },
+    { "measuredangle", "\xE2\x88\xA1" },
+    { "mfr", "\xF0\x9D\x94\xAA" },
+    { "mho", "\xE2\x84\xA7" },
+    { "micro", "\xC2\xB5" },
+    { "mid", "\xE2\x88\xA3" },
+    { "midast", "*" },
+    { "midcir", "\xE2\xAB\xB0" },
+    { "middot", "\xC2\xB7" },
+    { "minus", "\xE2\x88\x92" },
+    { "minusb", "\xE2\x8A\x9F" },
+    { "minusd", "\xE2\x88\xB8" },
+    { "minusdu", "\xE2\xA8\xAA" },
+    { "mlcp", "\xE2\xAB\x9B" },
+    { "mldr", "\xE2\x80\xA6" },
+    { "mnplus", "\xE2\x88\x93" },
+    { "models", "\xE2\x8A\xA7" },
+    { "mopf", "\xF0\x9D\x95\x9E" },
+    { "mp", "\xE2\x88\x93" },
+    { "mscr", "\xF0\x9D\x93\x82" },
+    { "mstpos", "\xE2\x88\xBE" },
+    { "mu", "\xCE\xBC" },
+    { "multimap", "\xE2\x8A\xB8" },
+    { "mumap", "\xE2\x8A\xB8" },
+    { "nGg", "\xE2\x8B\x99\xCC\xB8" },
+    { "nGt", "\xE2\x89\xAB\xE2\x83\x92" },
+    { "nGtv", "\xE2\x89\xAB\xCC\xB8" },
+    { "nLeftarrow", "\xE2\x87\x8D" },
+    { "nLeftrightarrow", "\xE2\x87\x8E" },
+    { "nLl", "\xE2\x8B\x98\xCC\xB8" },
+    { "nLt", "\xE2\x89\xAA\xE2\x83\x92" },
+    { "nLtv", "\xE2\x89\xAA\xCC\xB8" },
+    { "nRightarrow", "\xE2\x87\x8F" },
+    { "nVDash", "\xE2\x8A\xAF" },
+    { "nVdash", "\xE2\x8A\xAE" },
+    { "nabla", "\xE2\x88\x87" },
+    { "nacute", "\xC5\x84" },
+    { "nang", "\xE2\x88\xA0\xE2\x83\x92" },
+    { "nap", "\xE2\x89\x89" },
+    { "napE", "\xE2\xA9\xB0\xCC\xB8" },
+    { "napid", "\xE2\x89\x8B\xCC\xB8" },
+    { "napos", "\xC5\x89" },
+    { "napprox", "\xE2\x89\x89" },
+    { "natur", "\xE2\x99\xAE" },
+    { "natural", "\xE2\x99\xAE" },
+    { "naturals", "\xE2\x84\x95" },
+    { "nbsp", " " },
+    { "nbump", "\xE2\x89\x8E\xCC\xB8" },
+    { "nbumpe", "\xE2\x89\x8F\xCC\xB8" },
+    { "ncap", "\xE2\xA9\x83" },
+    { "ncaron", "\xC5\x88" },
+    { "ncedil", "\xC5\x86" },
+    { "ncong", "\xE2\x89\x87" },
+    { "ncongdot", "\xE2\xA9\xAD\xCC\xB8" },
+    { "ncup", "\xE2\xA9\x82" },
+    { "ncy", "\xD0\xBD" },
+    { "ndash", "\xE2\x80\x93" },
+    { "ne", "\xE2\x89\xA0" },
+    { "neArr", "\xE2\x87\x97" },
+    { "nearhk", "\xE2\xA4\xA4" },
+    { "nearr", "\xE2\x86\x97" },
+    { "nearrow", "\xE2\x86\x97" },
+    { "nedot", "\xE2\x89\x90\xCC\xB8" },
+    { "nequiv", "\xE2\x89\xA2" },
+    { "nesear", "\xE2\xA4\xA8" },
+    { "nesim", "\xE2\x89\x82\xCC\xB8" },
+    { "nexist", "\xE2\x88\x84" },
+    { "nexists", "\xE2\x88\x84" },
+    { "nfr", "\xF0\x9D\x94\xAB" },
+    { "ngE", "\xE2\x89\xA7\xCC\xB8" },
+    { "nge", "\xE2\x89\xB1" },
+    { "ngeq", "\xE2\x89\xB1" },
+    { "ngeqq", "\xE2\x89\xA7\xCC\xB8" },
+    { "ngeqslant", "\xE2\xA9\xBE\xCC\xB8" },
+    { "nges", "\xE2\xA9\xBE\xCC\xB8" },
+    { "ngsim", "\xE2\x89\xB5" },
+    { "ngt", "\xE2\x89\xAF" },
+    { "ngtr", "\xE2\x89\xAF" },
+    { "nhArr", "\xE2\x87\x8E" },
+    { "nharr", "\xE2\x86\xAE" },
+    { "nhpar", "\xE2\xAB\xB2" },
+    { "ni", "\xE2\x88\x8B" },
+    { "nis", "\xE2\x8B\xBC" },
+    { "nisd", "\xE2\x8B\xBA" },
+    { "niv", "\xE2\x88\x8B" },
+    { "njcy", "\xD1\x9A" },
+    { "nlArr", "\xE2\x87\x8D" },
+    { "nlE", "\xE2\x89\xA6\xCC\xB8" },
+    { "nlarr", "\xE2\x86\x9A" },
+    { "nldr", "\xE2\x80\xA5" },
+    { "nle", "\xE2\x89\xB0" },
+    { "nleftarrow", "\xE2\x86\x9A" },
+    { "nleftrightarrow", "\xE2\x86\xAE" },
+    { "nleq", "\xE2\x89\xB0" },
+    { "nleqq", "\xE2\x89\xA6\xCC\xB8" },
+    { "nleqslant", "\xE2\xA9\xBD\xCC\xB8" },
+    { "nles", "\xE2\xA9\xBD\xCC\xB8" },
+    { "nless", "\xE2\x89\xAE" },
+    { "nlsim", "\xE2\x89\xB4" },
+    { "nlt", "\xE2\x89\xAE" },
+    { "nltri", "\xE2\x8B\xAA" },
+    { "nltrie", "\xE2\x8B\xAC" },
+    { "nmid", "\xE2\x88\xA4" },
+    { "nopf", "\xF0\x9D\x95\x9F" },
+    { "not", "\xC2\xAC" },
+    { "notin", "\xE2\x88\x89" },
+    { "notinE", "\xE2\x8B\xB9\xCC\xB8" },
+    { "notindot", "\xE2\x8B\xB5\xCC\xB8" },
+    { "notinva", "\xE2\x88\x89" },
+    { "notinvb", "\xE2\x8B\xB7" },
+    { "notinvc", "\xE2\x8B\xB6" },
+    { "notni", "\xE2\x88\x8C" },
+    { "notniva", "\xE2\x88\x8C" },
+    { "notnivb", "\xE2\x8B\xBE" },
+    { "notnivc", "\xE2\x8B\xBD" },
+    { "npar", "\xE2\x88\xA6" },
+    { "nparallel", "\xE2\x88\xA6" },
+    { "nparsl", "\xE2\xAB\xBD\xE2\x83\xA5" },
+    { "npart", "\xE2\x88\x82\xCC\xB8" },
+    { "npolint", "\xE2\xA8\x94" },
+    { "npr", "\xE2\x8A\x80" },
+    { "nprcue", "\xE2\x8B\xA0" },
+    { "npre", "\xE2\xAA\xAF\xCC\xB8" },
+    { "nprec", "\xE2\x8A\x80" },
+    { "npreceq", "\xE2\xAA\xAF\xCC\xB8" },
+    { "nrArr", "\xE2\x87\x8F" },
+    { "nrarr", "\xE2\x86\x9B" },
+    { "nrarrc", "\xE2\xA4\xB3\xCC\xB8" },
+    { "nrarrw", "\xE2\x86\x9D\xCC\xB8" },
+    { "nrightarrow", "\xE2\x86\x9B" },
+    { "nrtri", "\xE2\x8B\xAB" },
+    { "nrtrie", "\xE2\x8B\xAD" },
+    { "nsc", "\xE2\x8A\x81" },
+    { "nsccue", "\xE2\x8B\xA1" },
+    { "nsce", "\xE2\xAA\xB0\xCC\xB8" },
+    { "nscr", "\xF0\x9D\x93\x83" },
+    { "nshortmid", "\xE2\x88\xA4" },
+    { "nshortparallel", "\xE2\x88\xA6" },
+    { "nsim", "\xE2\x89\x81" },
+    { "nsime", "\xE2\x89\x84" },
+    { "nsimeq", "\xE2\x89\x84" },
+    { "nsmid", "\xE2\x88\xA4" },
+    { "nspar", "\xE2\x88\xA6" },
+    { "nsqsube", "\xE2\x8B\xA2" },
+    { "nsqsupe", "\xE2\x8B\xA3" },
+    { "nsub", "\xE2\x8A\x84" },
+    { "nsubE", "\xE2\xAB\x85\xCC\xB8" },
+    { "nsube", "\xE2\x8A\x88" },
+    { "nsubset", "\xE2\x8A\x82\xE2\x83\x92" },
+    { "nsubseteq", "\xE2\x8A\x88" },
+    { "nsubseteqq", "\xE2\xAB\x85\xCC\xB8" },
+    { "nsucc", "\xE2\x8A\x81" },
+    { "nsucceq", "\xE2\xAA\xB0\xCC\xB8" },
+    { "nsup", "\xE2\x8A\x85" },
+    { "nsupE", "\xE2\xAB\x86\xCC\xB8" },
+    { "nsupe", "\xE2\x8A\x89" },
+    { "nsupset", "\xE2\x8A\x83\xE2\x83\x92" },
+    { "nsupseteq", "\xE2\x8A\x89" },
+    { "nsupseteqq", "\xE2\xAB\x86\xCC\xB8" },
+    { "ntgl", "\xE2\x89\xB9" },
+    { "ntilde", "\xC3\xB1" },
+    { "ntlg", "\xE2\x89\xB8" },
+    { "ntriangleleft", "\xE2\x8B\xAA" },
+    { "ntrianglelefteq", "\xE2\x8B\xAC" },
+    { "ntriangleright", "\xE2\x8B\xAB" },
+    { "ntrianglerighteq", "\xE2\x8B\xAD" },
+    { "nu", "\xCE\xBD" },
+    { "num", "#" },
+    { "numero", "\xE2\x84\x96" },
+    { "numsp", "\xE2\x80\x87" },
+    { "nvDash", "\xE2\x8A\xAD" },
+    { "nvHarr", "\xE2\xA4\x84" },
+    { "nvap", "\xE2\x89\x8D\xE2\x83\x92" },
+    { "nvdash", "\xE2\x8A\xAC" },
+    { "nvge", "\xE2\x89\xA5\xE2\x83\x92" },
+    { "nvgt", ">\xE2\x83\x92" },
+    { "nvinfin", "\xE2\xA7\x9E" },
+    { "nvlArr", "\xE2\xA4\x82" },
+    { "nvle", "\xE2\x89\xA4\xE2\x83\x92" },
+    { "nvlt", "<\xE2\x83\x92" },
+    { "nvltrie", "\xE2\x8A\xB4\xE2\x83\x92" },
+    { "nvrArr", "\xE2\xA4\x83" },
+    { "nvrtrie", "\xE2\x8A\xB5\xE2\x83\x92" },
+    { "nvsim", "\xE2\x88\xBC\xE2\x83\x92" },
+    { "nwArr", "\xE2\x87\x96" },
+    { "nwarhk", "\xE2\xA4\xA3" },
+    { "nwarr", "\xE2\x86\x96" },
+    { "nwarrow", "\xE2\x86\x96" },
+    { "nwnear", "\xE2\xA4\xA7" },
+    { "oS", "\xE2\x93\x88" },
+    { "oacute", "\xC3\xB3" },
+    { "oast", "\xE2\x8A\x9B" },
+    { "ocir", "\xE2\x8A\x9A" },
+    { "ocirc", "\xC3\xB4" },
+    { "ocy", "\xD0\xBE" },
+    { "odash", "\xE2\x8A\x9D" },
+    { "odblac", "\xC5\x91" },
+    { "odiv", "\xE2\xA8\xB8" },
+    { "odot", "\xE2\x8A\x99" },
+    { "odsold", "\xE2\xA6\xBC" },
+    { "oelig", "\xC5\x93" },
+    { "ofcir", "\xE2\xA6\xBF" },
+    { "ofr", "\xF0\x9D\x94\xAC" },
+    { "ogon", "\xCB\x9B" },
+    { "ograve", "\xC3\xB2" },
+    { "ogt", "\xE2\xA7\x81" },
+    { "ohbar", "\xE2\xA6\xB5" },
+    { "ohm", "\xCE\xA9" },
+    { "oint", "\xE2\x88\xAE" },
+    { "olarr", "\xE2\x86\xBA" },
+    { "olcir", "\xE2\xA6\xBE" },
+    { "olcross", "\xE2\xA6\xBB" },
+    { "oline", "\xE2\x80\xBE" },
+    { "olt", "\xE2\xA7\x80" },
+    { "omacr", "\xC5\x8D" },
+    { "omega", "\xCF\x89" },
+    { "omicron", "\xCE\xBF" },
+    { "omid", "\xE2\xA6\xB6" },
+    { "ominus", "\xE2\x8A\x96" },
+    { "oopf", "\xF0\x9D\x95\xA0" },
+    { "opar", "\xE2\xA6\xB7" },
+    { "operp", "\xE2\xA6\xB9" },
+    { "oplus", "\xE2\x8A\x95" },
+    { "or", "\xE2\x88\xA8" },
+    { "orarr", "\xE2\x86\xBB" },
+    { "ord", "\xE2\xA9\x9D" },
+    { "order", "\xE2\x84\xB4" },
+    { "orderof", "\xE2\x84\xB4" },
+    { "ordf", "\xC2\xAA" },
+    { "ordm", "\xC2\xBA" },
+    { "origof", "\xE2\x8A\xB6" },
+    { "oror", "\xE2\xA9\x96" },
+    { "orslope", "\xE2\xA9\x97" },
+    { "orv", "\xE2\xA9\x9B" },
+    { "oscr", "\xE2\x84\xB4" },
+    { "oslash", "\xC3\xB8" },
+    { "osol", "\xE2\x8A\x98" },
+    { "otilde", "\xC3\xB5" },
+    { "otimes", "\xE2\x8A\x97" },
+    { "otimesas", "\xE2\xA8\xB6" },
+    { "ouml", "\xC3\xB6" },
+    { "ovbar", "\xE2\x8C\xBD" },
+    { "par", "\xE2\x88\xA5" },
+    { "para", "\xC2\xB6" },
+    { "parallel", "\xE2\x88\xA5" },
+    { "parsim", "\xE2\xAB\xB3" },
+    { "parsl", "\xE2\xAB\xBD" },
+    { "part", "\xE2\x88\x82" },
+    { "pcy", "\xD0\xBF" },
+    { "percnt", "%" },
+    { "period", "." },
+    { "permil", "\xE2\x80\xB0" },
+    { "perp", "\xE2\x8A\xA5" },
+    { "pertenk", "\xE2\x80\xB1" },
+    { "pfr", "\xF0\x9D\x94\xAD" },
+    { "phi", "\xCF\x86" },
+    { "phiv", "\xCF\x95" },
+    { "phmmat", "\xE2\x84\xB3" },
+    { "phone", "\xE2\x98\x8E" },
+    { "pi", "\xCF\x80" },
+    { "pitchfork", "\xE2\x8B\x94" },
+    { "piv", "\xCF\x96" },
+    { "planck", "\xE2\x84\x8F" },
+    { "planckh", "\xE2\x84\x8E" },
+    { "plankv", "\xE2\x84\x8F" },
+    { "plus", "+" },
+    { "plusacir", "\xE2\xA8\xA3" },
+    { "plusb", "\xE2\x8A\x9E" },
+    { "pluscir", "\xE2\xA8\xA2" },
+    { "plusdo", "\xE2\x88\x94" },
+    { "plusdu", "\xE2\xA8\xA5" },
+    { "pluse", "\xE2\xA9\xB2" },
+    { "plusmn", "\xC2\xB1" },
+    { "plussim", "\xE2\xA8\xA6" },
+    { "plustwo", "\xE2\xA8\xA7" },
+    { "pm", "\xC2\xB1" },
+    { "pointint", "\xE2\xA8\x95" },
+    { "popf", "\xF0\x9D\x95\xA1" },
+    { "pound", "\xC2\xA3" },
+    { "pr", "\xE2\x89\xBA" },
+    { "prE", "\xE2\xAA\xB3" },
+    { "prap", "\xE2\xAA\xB7" },
+    { "prcue", "\xE2\x89\xBC" },
+    { "pre", "\xE2\xAA\xAF" },
+    { "prec", "\xE2\x89\xBA" },
+    { "precapprox", "\xE2\xAA\xB7" },
+    { "preccurlyeq", "\xE2\x89\xBC" },
+    { "preceq", "\xE2\xAA\xAF" },
+    { "precnapprox", "\xE2\xAA\xB9" },
+    { "precneqq", "\xE2\xAA\xB5" },
+    { "precnsim", "\xE2\x8B\xA8" },
+    { "precsim", "\xE2\x89\xBE" },
+    { "prime", "\xE2\x80\xB2" },
+    { "primes", "\xE2\x84\x99" },
+    { "prnE", "\xE2\xAA\xB5" },
+    { "prnap", "\xE2\xAA\xB9" },
+    { "prnsim", "\xE2\x8B\xA8" },
+    { "prod", "\xE2\x88\x8F" },
+    { "profalar", "\xE2\x8C\xAE" },
+    { "profline", "\xE2\x8C\x92" },
+    { "profsurf", "\xE2\x8C\x93" },
+    { "prop", "\xE2\x88\x9D" },
+    { "propto", "\xE2\x88\x9D" },
+    { "prsim", "\xE2\x89\xBE" },
+    { "prurel", "\xE2\x8A\xB0" },
+    { "pscr", "\xF0\x9D\x93\x85" },
+    { "psi", "\xCF\x88" },
+    { "puncsp", "\xE2\x80\x88" },
+    { "qfr", "\xF0\x9D\x94\xAE" },
+    { "qint", "\xE2\xA8\x8C" },
+    { "qopf", "\xF0\x9D\x95\xA2" },
+    { "qprime", "\xE2\x81\x97" },
+    { "qscr", "\xF0\x9D\x93\x86" },
+    { "quaternions", "\xE2\x84\x8D" },
+    { "quatint", "\xE2\xA8\x96" },
+    { "quest", "?" },
+    { "questeq", "\xE2\x89\x9F" },
+    { "quot", "\x22" },
+    { "rAarr", "\xE2\x87\x9B" },
+    { "rArr", "\xE2\x87\x92" },
+    { "rAtail", "\xE2\xA4\x9C" },
+    { "rBarr", "\xE2\xA4\x8F" },
+    { "rHar", "\xE2\xA5\xA4" },
+    { "race", "\xE2\x88\xBD\xCC\xB1" },
+    { "racute", "\xC5\x95" },
+    { "radic", "\xE2\x88\x9A" },
+    { "raemptyv", "\xE2\xA6\xB3" },
+    { "rang", "\xE2\x9F\xA9" },
+    { "rangd", "\xE2\xA6\x92" },
+    { "range", "\xE2\xA6\xA5" },
+    { "rangle", "\xE2\x9F\xA9" },
+    { "raquo", "\xC2\xBB" },
+    { "rarr", "\xE2\x86\x92" },
+    { "rarrap", "\xE2\xA5\xB5" },
+    { "rarrb", "\xE2\x87\xA5" },
+    { "rarrbfs", "\xE2\xA4\xA0" },
+    { "rarrc", "\xE2\xA4\xB3" },
+    { "rarrfs", "\xE2\xA4\x9E" },
+    { "rarrhk", "\xE2\x86\xAA" },
+    { "rarrlp", "\xE2\x86\xAC" },
+    { "rarrpl", "\xE2\xA5\x85" },
+    { "rarrsim", "\xE2\xA5\xB4" },
+    { "rarrtl", "\xE2\x86\xA3" },
+    { "rarrw", "\xE2\x86\x9D" },
+    { "ratail", "\xE2\xA4\x9A" },
+    { "ratio", "\xE2\x88\xB6" },
+    { "rationals", "\xE2\x84\x9A" },
+    { "rbarr", "\xE2\xA4\x8D" },
+    { "rbbrk", "\xE2\x9D\xB3" },
+    { "rbrace", "}" },
+    { "rbrack", "]" },
+    { "rbrke", "\xE2\xA6\x8C" },
+    { "rbrksld", "\xE2\xA6\x8E" },
+    { "rbrkslu", "\xE2\xA6\x90" },
+    { "rcaron", "\xC5\x99" },
+    { "rcedil", "\xC5\x97" },
+    { "rceil", "\xE2\x8C\x89" },
+    { "rcub", "}" },
+    { "rcy", "\xD1\x80" },
+    { "rdca", "\xE2\xA4\xB7" },
+    { "rdldhar", "\xE2\xA5\xA9" },
+    { "rdquo", "\x22" },
+    { "rdquor", "\xE2\x80\x9D" },
+    { "rdsh", "\xE2\x86\xB3" },
+    { "real", "\xE2\x84\x9C" },
+    { "realine", "\xE2\x84\x9B" },
+    { "realpart", "\xE2\x84\x9C" },
+    { "reals", "\xE2\x84\x9D" },
+    { "rect", "\xE2\x96\xAD" },
+    { "reg", "\xC2\xAE" },
+    { "rfisht", "\xE2\xA5\xBD" },
+    { "rfloor", "\xE2\x8C\x8B" },
+    { "rfr", "\xF0\x9D\x94\xAF" },
+    { "rhard", "\xE2\x87\x81" },
+    { "rharu", "\xE2\x87\x80" },
+    { "rharul", "\xE2\xA5\xAC" },
+    { "rho", "\xCF\x81" },
+    { "rhov", "\xCF\xB1" },
+    { "rightarrow", "\xE2\x86\x92" },
+    { "rightarrowtail", "\xE2\x86\xA3" },
+    { "rightharpoondown", "\xE2\x87\x81" },
+    { "rightharpoonup", "\xE2\x87\x80" },
+    { "rightleftarrows", "\xE2\x87\x84" },
+    { "rightleftharpoons", "\xE2\x87\x8C" },
+    { "rightrightarrows", "\xE2\x87\x89" },
+    { "rightsquigarrow", "\xE2\x86\x9D" },
+    { "rightthreetimes", "\xE2\x8B\x8C" },
+    { "ring", "\xCB\x9A" },
+    { "risingdotseq", "\xE2\x89\x93" },
+    { "rlarr", "\xE2\x87\x84" },
+    { "rlhar", "\xE2\x87\x8C" },
+    { "rlm", "\xE2\x80\x8F" },
+    { "rmoust", "\xE2\x8E\xB1" },
+    { "rmoustache", "\xE2\x8E\xB1" },
+    { "rnmid", "\xE2\xAB\xAE" },
+    { "roang", "\xE2\x9F\xAD" },
+    { "roarr", "\xE2\x87\xBE" },
+    { "robrk", "\xE2\x9F\xA7" },
+    { "ropar", "\xE2\xA6\x86" },
+    { "ropf", "\xF0\x9D\x95\xA3" },
+    { "roplus", "\xE2\xA8\xAE" },
+    { "rotimes", "\xE2\xA8\xB5" },
+    { "rpar", ")" },
+    { "rpargt", "\xE2\xA6\x94" },
+    { "rppolint", "\xE2\xA8\x92" },
+    { "rrarr", "\xE2\x87\x89" },
+    { "rsaquo", "\xE2\x80\xBA" },
+    { "rscr", "\xF0\x9D\x93\x87" },
+    { "rsh", "\xE2\x86\xB1" },
+    { "rsqb", "]" },
+    { "rsquo", "'" },
+    { "rsquor", "\xE2\x80\x99" },
+    { "rthree", "\xE2\x8B\x8C" },
+    { "rtimes", "\xE2\x8B\x8A" },
+    { "rtri", "\xE2\x96\xB9" },
+    { "rtrie", "\xE2\x8A\xB5" },
+    { "rtrif", "\xE2\x96\xB8" },
+    { "rtriltri", "\xE2\xA7\x8E" },
+    { "ruluhar", "\xE2\xA5\xA8" },
+    { "rx", "\xE2\x84\x9E" },
+    { "sacute", "\xC5\x9B" },
+    { "sbquo", "\xE2\x80\x9A" },
+    { "sc", "\xE2\x89\xBB" },
+    { "scE", "\xE2\xAA\xB4" },
+    { "scap", "\xE2\xAA\xB8" },
+    { "scaron", "\xC5\xA1" },
+    { "sccue", "\xE2\x89\xBD" },
+    { "sce", "\xE2\xAA\xB0" },
+    { "scedil", "\xC5\x9F" },
+    { "scirc", "\xC5\x9D" },
+    { "scnE", "\xE2\xAA\xB6" },
+    { "scnap", "\xE2\xAA\xBA" },
+    { "scnsim", "\xE2\x8B\xA9" },
+    { "scpolint", "\xE2\xA8\x93" },
+    { "scsim", "\xE2\x89\xBF" },
+    { "scy", "\xD1\x81" },
+    { "sdot", "\xE2\x8B\x85" },
+    { "sdotb", "\xE2\x8A\xA1" },
+    { "sdote", "\xE2\xA9\xA6" },
+    { "seArr", "\xE2\x87\x98" },
+    { "searhk", "\xE2\xA4\xA5" },
+    { "searr", "\xE2\x86\x98" },
+    { "searrow", "\xE2\x86\x98" },
+    { "sect", "\xC2\xA7" },
+    { "semi", ";" },
+    { "seswar", "\xE2\xA4\xA9" },
+    { "setminus", "\xE2\x88\x96" },
+    { "setmn", "\xE2\x88\x96" },
+    { "sext", "\xE2\x9C\xB6" },
+    { "sfr", "\xF0\x9D\x94\xB0" },
+    { "sfrown", "\xE2\x8C\xA2" },
+    { "sharp", "\xE2\x99\xAF" },
+    { "shchcy", "\xD1\x89" },
+    { "shcy", "\xD1\x88" },
+    { "shortmid", "\xE2\x88\xA3" },
+    { "shortparallel", "\xE2\x88\xA5" },
+    { "shy", "\xC2\xAD" },
+    { "sigma", "\xCF\x83" },
+    { "sigmaf", "\xCF\x82" },
+    { "sigmav", "\xCF\x82" },
+    { "sim", "\xE2\x88\xBC" },
+    { "simdot", "\xE2\xA9\xAA" },
+    { "sime", "\xE2\x89\x83" },
+    { "simeq", "\xE2\x89\x83" },
+    { "simg", "\xE2\xAA\x9E" },
+    { "simgE", "\xE2\xAA\xA0" },
+    { "siml", "\xE2\xAA\x9D" },
+    { "simlE", "\xE2\xAA\x9F" },
+    { "simne", "\xE2\x89\x86" },
+    { "simplus", "\xE2\xA8\xA4" },
+    { "simrarr", "\xE2\xA5\xB2" },
+    { "slarr", "\xE2\x86\x90" },
+    { "smallsetminus", "\xE2\x88\x96" },
+    { "smashp", "\xE2\xA8\xB3" },
+    { "smeparsl", "\xE2\xA7\xA4" },
+    { "smid", "\xE2\x88\xA3" },
+    { "smile", "\xE2\x8C\xA3" },
+    { "smt", "\xE2\xAA\xAA" },
+    { "smte", "\xE2\xAA\xAC" },
+    { "smtes", "\xE2\xAA\xAC\xEF\xB8\x80" },
+    { "softcy", "\xD1\x8C" },
+    { "sol", "/" },
+    { "solb", "\xE2\xA7\x84" },
+    { "solbar", "\xE2\x8C\xBF" },
+    { "sopf", "\xF0\x9D\x95\xA4" },
+    { "spades", "\xE2\x99\xA0" },
+    { "spadesuit", "\xE2\x99\xA0" },
+    { "spar", "\xE2\x88\xA5" },
+    { "sqcap", "\xE2\x8A\x93" },
+    { "sqcaps", "\xE2\x8A\x93\xEF\xB8\x80" },
+    { "sqcup", "\xE2\x8A\x94" },
+    { "sqcups", "\xE2\x8A\x94\xEF\xB8\x80" },
+    { "sqsub", "\xE2\x8A\x8F" },
+    { "sqsube", "\xE2\x8A\x91" },
+    { "sqsubset", "\xE2\x8A\x8F" },
+    { "sqsubseteq", "\xE2\x8A\x91" },
+    { "sqsup", "\xE2\x8A\x90" },
+    { "sqsupe", "\xE2\x8A\x92" },
+    { "sqsupset", "\xE2\x8A\x90" },
+    { "sqsupseteq", "\xE2\x8A\x92" },
+    { "squ", "\xE2\x96\xA1" },
+    { "square", "\xE2\x96\xA1" },
+    { "squarf", "\xE2\x96\xAA" },
+    { "squf", "\xE2\x96\xAA" },
+    { "srarr", "\xE2\x86\x92" },
+    { "sscr", "\xF0\x9D\x93\x88" },
+    { "ssetmn", "\xE2\x88\x96" },
+    { "ssmile", "\xE2\x8C\xA3" },
+    { "sstarf", "\xE2\x8B\x86" },
+    { "star", "\xE2\x98\x86" },
+    { "starf", "\xE2\x98\x85" },
+    { "straightepsilon", "\xCF\xB5" },
+    { "straightphi", "\xCF\x95" },
+    { "strns", "\xC2\xAF" },
+    { "sub", "\xE2\x8A\x82" },
+    { "subE", "\xE2\xAB\x85" },
+    { "subdot", "\xE2\xAA\xBD" },
+    { "sube", "\xE2\x8A\x86" },
+    { "subedot", "\xE2\xAB\x83" },
+    { "submult", "\xE2\xAB\x81" },
+    { "subnE", "\xE2\xAB\x8B" },
+    { "subne", "\xE2\x8A\x8A" },
+    { "subplus", "\xE2\xAA\xBF" },
+    { "subrarr", "\xE2\xA5\xB9" },
+    { "subset", "\xE2\x8A\x82" },
+    { "subseteq", "\xE2\x8A\x86" },
+    { "subseteqq", "\xE2\xAB\x85" },
+    { "subsetneq", "\xE2\x8A\x8A" },
+    { "subsetneqq", "\xE2\xAB\x8B" },
+    { "subsim", "\xE2\xAB\x87" },
+    { "subsub", "\xE2\xAB\x95" },
+    { "subsup", "\xE2\xAB\x93" },
+    { "succ", "\xE2\x89\xBB" },
+    { "succapprox", "\xE2\xAA\xB8" },
+    { "succcurlyeq", "\xE2\x89\xBD" },
+    { "succeq", "\xE2\xAA\xB0" },
+    { "succnapprox", "\xE2\xAA\xBA" },
+    { "succneqq", "\xE2\xAA\xB6" },
+    { "succnsim", "\xE2\x8B\xA9" },
+    { "succsim", "\xE2\x89\xBF" },
+    { "sum", "\xE2\x88\x91" },
+    { "sung", "\xE2\x99\xAA" },
+    { "sup1", "\xC2\xB9" },
+    { "sup2", "\xC2\xB2" },
+    { "sup3", "\xC2\xB3" },
+    { "sup", "\xE2\x8A\x83" },
+    { "supE", "\xE2\xAB\x86" },
+    { "supdot", "\xE2\xAA\xBE" },
+    { "supdsub", "\xE2\xAB\x98" },
+    { "supe", "\xE2\x8A\x87" },
+    { "supedot", "\xE2\xAB\x84" },
+    { "suphsol", "\xE2\x9F\x89" },
+    { "suphsub", "\xE2\xAB\x97" },
+    { "suplarr", "\xE2\xA5\xBB" },
+    { "supmult", "\xE2\xAB\x82" },
+    { "supnE", "\xE2\xAB\x8C" },
+    { "supne", "\xE2\x8A\x8B" },
+    { "supplus", "\xE2\xAB\x80" },
+    { "supset", "\xE2\x8A\x83" },
+    { "supseteq", "\xE2\x8A\x87" },
+    { "supseteqq", "\xE2\xAB\x86" },
+    { "supsetneq", "\xE2\x8A\x8B" },
+    { "supsetneqq", "\xE2\xAB\x8C" },
+    { "supsim", "\xE2\xAB\x88" },
+    { "supsub", "\xE2\xAB\x94" },
+    { "supsup", "\xE2\xAB\x96" },
+    { "swArr", "\xE2\x87\x99" },
+    { "swarhk", "\xE2\xA4\xA6" },
+    { "swarr", "\xE2\x86\x99" },
+    { "swarrow", "\xE2\x86\x99" },
+    { "swnwar", "\xE2\xA4\xAA" },
+    { "szlig", "\xC3\x9F" },
+    { "target", "\xE2\x8C\x96" },
+    { "tau", "\xCF\x84" },
+    { "tbrk", "\xE2\x8E\xB4" },
+    { "tcaron", "\xC5\xA5" },
+    { "tcedil", "\xC5\xA3" },
+    { "tcy", "\xD1\x82" },
+    { "tdot", "\xE2\x83\x9B" },
+    { "telrec", "\xE2\x8C\x95" },
+    { "tfr", "\xF0\x9D\x94\xB1" },
+    { "there4", "\xE2\x88\xB4" },
+    { "therefore", "\xE2\x88\xB4" },
+    { "theta", "\xCE\xB8" },
+    { "thetasym", "\xCF\x91" },
+    { "thetav", "\xCF\x91" },
+    { "thickapprox", "\xE2\x89\x88" },
+    { "thicksim", "\xE2\x88\xBC" },
+    { "thinsp", "\xE2\x80\x89" },
+    { "thkap", "\xE2\x89\x88" },
+    { "thksim", "\xE2\x88\xBC" },
+    { "thorn", "\xC3\xBE" },
+    { "tilde", "\xCB\x9C" },
+    { "times", "\xC3\x97" },
+    { "timesb", "\xE2\x8A\xA0" },
+    { "timesbar", "\xE2\xA8\xB1" },
+    { "timesd", "\xE2\xA8\xB0" },
+    { "tint", "\xE2\x88\xAD" },
+    { "toea", "\xE2\xA4\xA8" },
+    { "top", "\xE2\x8A\xA4" },
+    { "topbot", "\xE2\x8C\xB6" },
+    { "topcir", "\xE2\xAB\xB1" },
+    { "topf", "\xF0\x9D\x95\xA5" },
+    { "topfork", "\xE2\xAB\x9A" },
+    { "tosa", "\xE2\xA4\xA9" },
+    { "tprime", "\xE2\x80\xB4" },
+    { "trade", "\xE2\x84\xA2" },
+    { "triangle", "\xE2\x96\xB5" },
+    { "triangledown", "\xE2\x96\xBF" },
+    { "triangleleft", "\xE2\x97\x83" },
+    { "trianglelefteq", "\xE2\x8A\xB4" },
+    { "triangleq", "\xE2\x89\x9C" },
+    { "triangleright", "\xE2\x96\xB9" },
+    { "trianglerighteq", "\xE2\x8A\xB5" },
+    { "tridot", "\xE2\x97\xAC" },
+    { "trie", "\xE2\x89\x9C" },
+    { "triminus", "\xE2\xA8\xBA" },
+    { "triplus", "\xE2\xA8\xB9" },
+    { "trisb", "\xE2\xA7\x8D" },
+    { "tritime", "\xE2\xA8\xBB" },
+    { "trpezium", "\xE2\x8F\xA2" },
+    { "tscr", "\xF0\x9D\x93\x89" },
+    { "tscy", "\xD1\x86" },
+    { "tshcy", "\xD1\x9B" },
+    { "tstrok", "\xC5\xA7" },
+    { "twixt", "\xE2\x89\xAC" },
+    { "twoheadleftarrow", "\xE2\x86\x9E" },
+    { "twoheadrightarrow", "\xE2\x86\xA0" },
+    { "uArr", "\xE2\x87\x91" },
+    { "uHar", "\xE2\xA5\xA3" },
+    { "uacute", "\xC3\xBA" },
+    { "uarr", "\xE2\x86\x91" },
+    { "ubrcy", "\xD1\x9E" },
+    { "ubreve", "\xC5\xAD" },
+    { "ucirc", "\xC3\xBB" },
+    { "ucy", "\xD1\x83" },
+    { "udarr", "\xE2\x87\x85" },
+    { "udblac", "\xC5\xB1" },
+    { "udhar", "\xE2\xA5\xAE" },
+    { "ufisht", "\xE2\xA5\xBE" },
+    { "ufr", "\xF0\x9D\x94\xB2" },
+    { "ugrave", "\xC3\xB9" },
+    { "uharl", "\xE2\x86\xBF" },
+    { "uharr", "\xE2\x86\xBE" },
+    { "uhblk", "\xE2\x96\x80" },
+    { "ulcorn", "\xE2\x8C\x9C" },
+    { "ulcorner", "\xE2\x8C\x9C" },
+    { "ulcrop", "\xE2\x8C\x8F" },
+    { "ultri", "\xE2\x97\xB8" },
+    { "umacr", "\xC5\xAB" },
+    { "uml", "\xC2\xA8" },
+    { "uogon", "\xC5\xB3" },
+    { "uopf", "\xF0\x9D\x95\xA6" },
+    { "uparrow", "\xE2\x86\x91" },
+    { "updownarrow", "\xE2\x86\x95" },
+    { "upharpoonleft", "\xE2\x86\xBF" },
+    { "upharpoonright", "\xE2\x86\xBE" },
+    { "uplus", "\xE2\x8A\x8E" },
+    { "upsi", "\xCF\x85" },
+    { "upsih", "\xCF\x92" },
+    { "upsilon", "\xCF\x85" },
+    { "upuparrows", "\xE2\x87\x88" },
+    { "urcorn", "\xE2\x8C\x9D" },
+    { "urcorner", "\xE2\x8C\x9D" },
+    { "urcrop", "\xE2\x8C\x8E" },
+    { "uring", "\xC5\xAF" },
+    { "urtri", "\xE2\x97\xB9" },
+    { "uscr", "\xF0\x9D\x93\x8A" },
+    { "utdot", "\xE2\x8B\xB0" },
+    { "utilde", "\xC5\xA9" },
+    { "utri", "\xE2\x96\xB5" },
+    { "utrif", "\xE2\x96\xB4" },
+    { "uuarr", "\xE2\x87\x88" },
+    { "uuml", "\xC3\xBC" },
+    { "uwangle", "\xE2\xA6\xA7" },
+    { "vArr", "\xE2\x87\x95" },
+    { "vBar", "\xE2\xAB\xA8" },
+    { "vBarv", "\xE2\xAB\xA9" },
+    { "vDash", "\xE2\x8A\xA8" },
+    { "vangrt", "\xE2\xA6\x9C" },
+    { "varepsilon", "\xCF\xB5" },
+    { "varkappa", "\xCF\xB0" },
+    { "varnothing", "\xE2\x88\x85" },
+    { "varphi", "\xCF\x95" },
+    { "varpi", "\xCF\x96" },
+    { "varpropto", "\xE2\x88\x9D" },
+    { "varr", "\xE2\x86\x95" },
+    { "varrho", "\xCF\xB1" },
+    { "varsigma", "\xCF\x82" },
+    { "varsubsetneq", "\xE2\x8A\x8A\xEF\xB8\x80" },
+    { "varsubsetneqq", "\xE2\xAB\x8B\xEF\xB8\x80" },
+    { "varsupsetneq", "\xE2\x8A\x8B\xEF\xB8\x80" },
+    { "varsupsetneqq", "\xE2\xAB\x8C\xEF\xB8\x80" },
+    { "vartheta", "\xCF\x91" },
+    { "vartriangleleft", "\xE2\x8A\xB2" },
+    { "vartriangleright", "\xE2\x8A\xB3" },
+    { "vcy", "\xD0\xB2" },
+    { "vdash", "\xE2\x8A\xA2" },
+    { "vee", "\xE2\x88\xA8" },
+    { "veebar", "\xE2\x8A\xBB" },
+    { "veeeq", "\xE2\x89\x9A" },
+    { "vellip", "\xE2\x8B\xAE" },
+    { "verbar", "|" },
+    { "vert", "|" },
+    { "vfr", "\xF0\x9D\x94\xB3" },
+    { "vltri", "\xE2\x8A\xB2" },
+    { "vnsub", "\xE2\x8A\x82\xE2\x83\x92" },
+    { "vnsup", "\xE2\x8A\x83\xE2\x83\x92" },
+    { "vopf", "\xF0\x9D\x95\xA7" },
+    { "vprop", "\xE2\x88\x9D" },
+    { "vrtri", "\xE2\x8A\xB3" },
+    { "vscr", "\xF0\x9D\x93\x8B" },
+    { "vsubnE", "\xE2\xAB\x8B\xEF\xB8\x80" },
+    { "vsubne", "\xE2\x8A\x8A\xEF\xB8\x80" },
+    { "vsupnE", "\xE2\xAB\x8C\xEF\xB8\x80" },
+    { "vsupne", "\xE2\x8A\x8B\xEF\xB8\x80" },
+    { "vzigzag", "\xE2\xA6\x9A" },
+    { "wcirc", "\xC5\xB5" },
+    { "wedbar", "\xE2\xA9\x9F" },
+    { "wedge", "\xE2\x88\xA7" },
+    { "wedgeq", "\xE2\x89\x99" },
+    { "weierp", "\xE2\x84\x98" },
+    { "wfr", "\xF0\x9D\x94\xB4" },
+    { "wopf", "\xF0\x9D\x95\xA8" },
+    { "wp", "\xE2\x84\x98" },
+    { "wr", "\xE2\x89\x80" },
+    { "wreath", "\xE2\x89\x80" },
+    { "wscr", "\xF0\x9D\x93\x8C" },
+    { "xcap", "\xE2\x8B\x82" },
+    { "xcirc", "\xE2\x97\xAF" },
+    { "xcup", "\xE2\x8B\x83" },
+    { "xdtri", "\xE2\x96\xBD" },
+    { "xfr", "\xF0\x9D\x94\xB5" },
+    { "xhArr", "\xE2\x9F\xBA" },
+    { "xharr", "\xE2\x9F\xB7" },
+    { "xi", "\xCE\xBE" },
+    { "xlArr", "\xE2\x9F\xB8" },
+    { "xlarr", "\xE2\x9F\xB5" },
+    { "xmap", "\xE2\x9F\xBC" },
+    { "xnis", "\xE2\x8B\xBB" },
+    { "xodot", "\xE2\xA8\x80" },
+    { "xopf", "\xF0\x9D\x95\xA9" },
+    { "xoplus", "\xE2\xA8\x81" },
+    { "xotime", "\xE2\xA8\x82" },
+    { "xrArr", "\xE2\x9F\xB9" },
+    { "xrarr", "\xE2\x9F\xB6" },
+    { "xscr", "\xF0\x9D\x93\x8D" },
+    { "xsqcup", "\xE2\xA8\x86" },
+    { "xuplus", "\xE2\xA8\x84" },
+    { "xutri", "\xE2\x96\xB3" },
+    { "xvee", "\xE2\x8B\x81" },
+    { "xwedge", "\xE2\x8B\x80" },
+    { "yacute", "\xC3\xBD" },
+    { "yacy", "\xD1\x8F" },
+    { "ycirc", "\xC5\xB7" },
+    { "ycy", "\xD1\x8B" },
+    { "yen", "\xC2\xA5" },
+    { "yfr", "\xF0\x9D\x94\xB6" },
+    { "yicy", "\xD1\x97" },
+    { "yopf", "\xF0\x9D\x95\xAA" },
+    { "yscr", "\xF0\x9D\x93\x8E" },
+    { "yucy", "\xD1\x8E" },
+    { "yuml", "\xC3\xBF" },
+    { "zacute", "\xC5\xBA" },
+    { "zcaron", "\xC5\xBE" },
+    { "zcy", "\xD0\xB7" },
+    { "zdot", "\xC5\xBC" },
+    { "zeetrf", "\xE2\x84\xA8" },
+    { "zeta", "\xCE\xB6" },
+    { "zfr", "\xF0\x9D\x94\xB7" },
+    { "zhcy", "\xD0\xB6" },
+    { "zigrarr", "\xE2\x87\x9D" },
+    { "zopf", "\xF0\x9D\x95\xAB" },
+    { "zscr", "\xF0\x9D\x93\x8F" },
+    { "zwj", "\xE2\x80\x8D" },
+    { "zwnj", "\xE2\x80\x8C" },
+};
+
+// displacement seed per bucket of entityHash(name, 0)
+inline constexpr uint16_t kHtmlEntitySeeds[kHtmlEntityBucketMask + 1] = {
+    2, 1, 2, 1, 1, 4, 2, 2, 1, 1, 2, 0, 1, 2, 1, 4,
+    2, 2, 2, 1, 3, 1, 0, 1, 2, 1, 1, 1, 1, 1, 2, 3,
+    2, 1, 1, 1, 1, 1, 0, 9, 1, 3, 1, 1, 0, 0, 1, 1,
+    3, 1, 7, 2, 1, 3, 0, 0, 4, 1, 1, 1, 3, 1, 1, 3,
+    3, 1, 1, 2, 1, 2, 1, 1, 1, 1, 2, 1, 5, 2, 3, 8,
+    4, 8, 3, 1, 1, 9, 4, 8, 2, 6, 7, 3, 1, 1, 2, 1,
+    6, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 4, 4, 1,
+    1, 1, 1, 3, 0, 2, 1, 1, 6, 1, 1, 1, 1, 1, 4, 3,
+    0, 2, 2, 1, 0, 3, 0, 1, 8, 1, 9, 1, 0, 0, 1, 48,
+    1, 1, 1, 5, 1, 1, 1, 1, 1, 1, 6, 1, 1, 4, 1, 1,
+    1, 3, 1, 1, 1, 1, 5, 2, 1, 1, 1, 2, 7, 1, 0, 2,
+    3, 1, 1, 4, 1, 1, 4, 1, 1, 0, 9, 5, 3, 0, 2, 1,
+    1, 3, 3, 3, 3, 1, 0, 2, 1, 3, 4, 0, 2, 1, 5, 4,
+    1, 1, 1, 13, 1, 0, 1, 1, 3, 8, 3, 1, 1, 2, 1, 3,
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 2, 5, 1, 1, 1, 1,
+    2, 1, 7, 2, 1, 0, 1, 9, 3, 1, 0, 1, 2, 2, 1, 1,
+    1, 1, 1, 1, 3, 3, 1, 0, 1, 8, 1, 1, 4, 8, 2, 2,
+    2, 0, 0, 3, 2, 18, 1, 1, 1, 2, 1, 7, 1, 1, 3, 1,
+    0, 7, 1, 2, 2, 3, 2, 2, 0, 2, 17, 3, 2, 1, 9, 5,
+    2, 7, 1, 2, 0, 2, 4, 0, 1, 0, 17, 3, 0, 5, 1, 2,
+    1, 2, 0, 1, 4, 2, 2, 1, 3, 2, 2, 1, 3, 1, 4, 3,
+    0, 1, 1, 1, 1, 1, 0, 1, 1, 4, 2, 1, 1, 1, 1, 1,
+    1, 1, 2, 3, 0, 1, 0, 1, 4, 10, 1, 4, 1, 0, 2, 3,
+    2, 2, 1, 1, 3, 1, 0, 1, 1, 1, 3, 1, 1, 9, 0, 1,
+    1, 5, 2, 3, 1, 2, 1, 0, 0, 1, 1, 0, 3, 64, 1, 4,
+    16, 1, 1, 2, 1, 3, 11, 1, 8, 8, 3, 1, 0, 2, 3, 9,
+    1, 3, 13, 1, 2, 27, 3, 6, 64, 3, 1, 0, 1, 3, 1, 0,
+    0, 2, 2, 2, 1, 4, 0, 1, 4, 1, 4, 6, 1, 3, 1, 2,
+    2, 0, 0, 5, 3, 1, 4, 2, 2, 1, 1, 7, 8, 33, 2, 2,
+    4, 1, 1, 1, 3, 1, 2, 6, 4, 2, 2, 1, 1, 3, 1, 2,
+    1, 4, 1, 1, 0, 1, 3, 1, 2, 4, 2, 2, 2, 1, 10, 5,
+    2, 4, 1, 38, 1, 3, 4, 1, 1, 3, 4, 1, 1, 2, 1, 1,
+    1, 0, 2, 5, 2, 8, 1, 1, 0, 1, 1, 5, 3, 1, 4, 0,
+    2, 5, 1, 6, 6, 2, 1, 0, 1, 1, 4, 1, 4, 1, 1, 3,
+    1, 2, 3, 22, 2, 6, 2, 2, 2, 2, 0, 1, 1, 2, 3, 5,
+    2, 8, 1, 66, 2, 2, 32, 1, 1, 1, 1, 6, 0, 1, 3, 0,
+    1, 4, 1, 3, 1, 0, 1, 11, 1, 2, 1, 8, 1, 1, 0, 1,
+    1, 0, 0, 3, 1, 1, 2, 1, 1, 2, 64, 6, 1, 1, 1, 12,
+    0, 0, 3, 1, 1, 1, 7, 1, 2, 64, 5, 0, 1, 1, 0, 1,
+    1, 4, 4, 4, 31, 1, 2, 1, 0, 64, 1, 3, 5, 1, 66, 1,
+    4, 1, 0, 3, 1, 0, 0, 1, 9, 6, 1, 6, 2, 4, 1, 1,
+    2, 3, 1, 0, 1, 1, 1, 4, 1, 2, 0, 1, 3, 7, 1, 2,
+    2, 4, 0, 33, 1, 0, 0, 2, 9, 0, 0, 1, 1, 6, 1, 1,
+    4, 1, 3, 0, 2, 1, 0, 3, 0, 0, 0, 1, 1, 2, 41, 1,
+    4, 5, 5, 0, 3, 1, 1, 3, 6, 1, 5, 1, 4, 5, 2, 4,
+    1, 13, 1, 1, 2, 3, 2, 3, 1, 4, 2, 2, 1, 3, 1, 1,
+    33, 2, 1, 2, 3, 2, 2, 2, 11, 3, 3, 1, 14, 0, 6, 2,
+    0, 1, 1, 4, 3, 25, 2, 1, 8, 3, 1, 0, 1, 1, 1, 1,
+    0, 0, 1, 1, 0, 3, 3, 2, 1, 1, 1, 1, 0, 2, 2, 2,
+    1, 5, 3, 7, 1, 1, 2, 9, 1, 3, 2, 3, 0, 0, 7, 12,
+    1, 1, 36, 2, 7, 1, 0, 5, 0, 3, 1, 1, 0, 1, 2, 7,
+    1, 7, 2, 1, 1, 1, 2, 1, 1, 8, 1, 1, 3, 2, 2, 2,
+    64, 1, 5, 5, 1, 1, 4, 40, 2, 1, 9, 2, 2, 1, 0, 4,
+    0, 1, 3, 2, 0, 2, 1, 2, 1, 5, 2, 1, 0, 11, 1, 2,
+    1, 1, 2, 1, 2, 5, 2, 0, 4, 2, 1, 1, 3, 0, 5, 12,
+    5, 3, 0, 2, 4, 1, 31, 39, 65, 5, 1, 2, 2, 1, 2, 2,
+    1, 0, 3, 0, 2, 3, 2, 5, 4, 0, 4, 6, 0, 4, 0, 3,
+    6, 2, 1, 1, 0, 0, 2, 3, 8, 1, 1, 1, 16, 1, 4, 0,
+    1, 2, 1, 2, 1, 7, 0, 1, 5, 4, 1, 1, 11, 1, 1, 3,
+    1, 0, 2, 58, 4, 3, 3, 1, 2, 2, 4, 2, 3, 1, 0, 0,
+    2, 1, 3, 3, 3, 2, 2, 1, 3, 1, 0, 6, 1, 60, 1, 1,
+    1, 3, 3, 1, 5, 1, 5, 1, 1, 1, 2, 5, 1, 3, 2, 0,
+    16, 5, 1, 1, 4, 3, 6, 1, 0, 7, 1, 4, 1, 1, 2, 3,
+    15, 1, 5, 1, 0, 1, 4, 2, 4, 1, 1, 1, 2, 1, 1, 1,
+};
+
+// slot -> index into kHtmlEntities, kHtmlEntityEmptySlot when unused
+inline constexpr uint16_t kHtmlEntitySlots[kHtmlEntitySlotMask + 1] = {
+    823, 1076, 1891, 696, 65535, 382, 65535, 619, 65535, 1654, 647, 65535, 459, 725, 1321, 1828,
+    65535, 65535, 65535, 655, 65535, 4, 1950, 65535, 65535, 65535, 65535, 65535, 832, 65535, 65535, 2020,
+    65535, 370, 65535, 65535, 757, 1102, 65535, 939, 65535, 65535, 65535, 65535, 65535, 65535, 65535, 267,
+    1517, 65535, 65535, 65535, 65535, 65535, 65535, 435, 1849, 65535, 65535, 65535, 65535, 1786, 65535, 1552,
+    633, 785, 394, 65535, 1307, 65535, 375, 2062, 1643, 65535, 65535, 65535, 65535, 2038, 65535, 65535,
+    65535, 1922, 791, 65535, 1231, 65535, 1145, 1158, 2067, 65535, 176, 65535, 65535, 65535, 2006, 537,
+    13, 65535, 65535, 65535, 242, 65535, 65535, 65535, 65535, 65535, 557, 65535, 1483, 928, 778, 856,
+    65535, 65535, 411, 1011, 65535, 65535, 65535, 65535, 543, 38, 65535, 65535, 996, 739, 570, 65535,
+    1084, 65535, 65535, 65535, 751, 745, 65535, 65535, 65535, 1041, 1006, 1370, 65535, 65535, 360, 1609,
+    1460, 1269, 158, 2101, 65535, 65535, 65535, 65535, 682, 209, 805, 65535, 1218, 1462, 453, 1529,
+    65535, 1446, 1814, 65535, 65535, 65535, 65535, 157, 1653, 417, 1937, 65535, 65535, 65535, 65535, 65535,
+    65535, 484, 1672, 1620, 65535, 65535, 414, 145, 1415, 78, 65535, 2009, 858, 1467, 65535, 65535,
+    1985, 65535, 65535, 65535, 1616, 1665, 65535, 1677, 65535, 2039, 65535, 65535, 65535, 1351, 1294, 1706,
+    300, 65535, 65535, 65535, 469, 65535, 154, 2111, 65535, 1275, 1847, 65535, 1048, 941, 65535, 65535,
+    65535, 65535, 737, 65535, 1839, 415, 65535, 874, 65535, 144, 65535, 67, 65535, 754, 467, 1116,
+    65535, 397, 65535, 103, 1745, 35, 1060, 65535, 65535, 85, 65535, 930, 1878, 65535, 96, 123,
+    65535, 1081, 65535, 1069, 977, 1789, 1349, 65535, 65535, 1731, 2084, 1835, 65535, 186, 65535, 168,
+    1808, 65535, 65535, 65535, 2117, 65535, 65535, 65535, 65535, 1018, 65535, 65535, 688, 1140, 65535, 65535,
+    65535, 65535, 260, 1026, 65535, 1342, 65535, 65535, 65535, 993, 1393, 65535, 1559, 1132, 339, 65535,
+    1948, 1265, 65535, 65535, 65535, 65535, 65535, 1865, 65535, 65535, 1984, 834, 76, 1840, 283, 1021,
+    65535, 152, 1594, 65535, 1453, 65535, 65535, 124, 1705, 65535, 1253, 65535, 172, 165, 1226, 65535,
+    1036, 818, 1083, 65535, 65535, 1481, 65535, 1921, 65535, 65535, 65535, 65535, 134, 728, 65535, 65535,
+    114, 65535, 2024, 65535, 236, 65535, 60, 192, 1355, 65535, 65535, 1086, 65535, 65535, 847, 65535,
+    65535, 65535, 65535, 65535, 2065, 65535, 65535, 1757, 65535, 65535, 32, 243, 65535, 424, 1660, 632,
+    1043, 515, 1267, 356, 65535, 1160, 989, 279, 376, 83, 1790, 65535, 495, 65535, 1004, 65535,
+    923, 220, 65535, 208, 1240, 1898, 616, 1302, 1816, 524, 65535, 65535, 65535, 1860, 1841, 1750,
+    1945, 1647, 65535, 1411, 65535, 1037, 65535, 2120, 308, 65535, 2106, 284, 65535, 482, 511, 1679,
+    65535, 1291, 65535, 65535, 1780, 65535, 65535, 982, 65535, 65535, 65535, 1936, 65535, 219, 46, 65535,
+    1809, 65535, 932, 1289, 1347, 65535, 65535, 1306, 65535, 845, 65535, 1702, 2035, 65535, 1293, 65535,
+    521, 65535, 65535, 368, 750, 1931, 544, 65535, 65535, 587, 65535, 1371, 65535, 65535, 1770, 1214,
+    1197, 2022, 536, 65535, 1516, 65535, 1448, 65535, 1621, 211, 2027, 2124, 65535, 981, 1821, 65535,
+    1205, 65535, 65535, 65535, 44, 949, 65535, 65535, 65535, 65535, 65535, 65535, 65535, 1727, 57, 65535,
+    65535, 65535, 954, 1733, 1754, 65535, 371, 1600, 1648, 65535, 1834, 257, 205, 65535, 65535, 65535,
+    65535, 135, 1329, 1710, 65535, 65535, 65535, 1379, 65535, 1845, 65535, 65535, 65535, 65535, 907, 65535,
+    65535, 1442, 65535, 642, 1386, 65535, 91, 367, 958, 1278, 65535, 65535, 1713, 65535, 389, 1829,
+    2095, 207, 457, 1441, 65535, 2059, 1264, 221, 65535, 1783, 65535, 65535, 1848, 1182, 65535, 65535,
+    1967, 1534, 65535, 2107, 1223, 65535, 65535, 1975, 597, 65535, 65535, 1884, 1487, 1119, 821, 65535,
+    65535, 65535, 2055, 1568, 65535, 782, 65535, 1703, 625, 65535, 1914, 65535, 1101, 65535, 454, 65535,
+    787, 387, 65535, 677, 1210, 1137, 65535, 23, 65535, 65535, 109, 65535, 65535, 1862, 65535, 494,
+    65535, 65535, 65535, 473, 65535, 65535, 65535, 1739, 332, 485, 65535, 65535, 65535, 304, 65535, 65535,
+    65535, 1769, 65535, 493, 65535, 1810, 65535, 65535, 1266, 65535, 65535, 1404, 250, 2092, 1615, 1880,
+    65535, 743, 1123, 65535, 1173, 65535, 65535, 470, 65535, 969, 65535, 947, 1000, 609, 1919, 65535,
+    65535, 65535, 1863, 998, 340, 1127, 276, 65535, 1039, 65535, 65535, 385, 1457, 905, 2097, 1125,
+    65535, 174, 1589, 65535, 1699, 65535, 974, 1489, 2123, 65535, 65535, 42, 65535, 1392, 1412, 708,
+    106, 862, 1126, 65535, 1103, 65535, 491, 65535, 2046, 65535, 65535, 65535, 65535, 590, 65535, 65535,
+    405, 50, 65535, 1375, 1358, 65535, 65535, 65535, 1777, 65535, 514, 65535, 380, 1613, 65535, 65535,
+    65535, 65535, 65535, 65535, 65535, 199, 1428, 65535, 1178, 65535, 65535, 65535, 65535, 65535, 572, 1641,
+    197, 65535, 1071, 652, 65535, 288, 1633, 1409, 707, 1523, 65535, 65535, 65535, 65535, 65535, 689,
+    149, 65535, 2075, 1986, 1822, 1112, 65535, 65535, 1328, 686, 65535, 65535, 65535, 65535, 933, 383,
+    65535, 1189, 2089, 2116, 65535, 562, 65535, 65535, 1947, 1014, 591, 65535, 766, 65535, 836, 65535,
+    65535, 1773, 1659, 125, 65535, 1969, 65535, 2007, 65535, 65535, 65535, 65535, 577, 1438, 1981, 811,
+    65535, 65535, 65535, 65535, 65535, 65535, 1027, 65535, 1779, 65535, 82, 65535, 1772, 65535, 1837, 225,
+    65535, 65535, 1853, 65535, 944, 667, 302, 65535, 65535, 1689, 1756, 497, 65535, 835, 828, 65535,
+    65535, 65, 65535, 65535, 717, 65535, 1995, 65535, 65535, 175, 65535, 65535, 726, 65535, 65535, 65535,
+    65535, 65535, 65535, 65535, 24, 1991, 65535, 814, 1694, 65535, 65535, 65535, 65535, 65535, 1273, 65535,
+    65535, 1518, 426, 65535, 1142, 65535, 1926, 65535, 423, 294, 65535, 65535, 65535, 65535, 65535, 183,
+    65535, 1560, 224, 65535, 452, 705, 65535, 65535, 65535, 65535, 1519, 65535, 1910, 1470, 65535, 1344,
+    65535, 65535, 781, 1748, 65535, 1574, 65535, 753, 770, 65535, 161, 65535, 65535, 65535, 65535, 65535,
+    712, 967, 1930, 65535, 1570, 1807, 1055, 65535, 297, 65535, 65535, 1191, 104, 1492, 138, 65535,
+    65535, 65535, 65535, 65535, 1097, 65535, 65535, 65535, 1484, 65535, 65535, 65535, 65535, 1229, 65535, 65535,
+    479, 190, 65535, 1296, 849, 65535, 437, 65535, 1368, 65535, 65535, 447, 65535, 65535, 1181, 65535,
+    1166, 65535, 65535, 65535, 296, 65535, 34, 994, 65535, 65535, 1319, 687, 65535, 65535, 1806, 65535,
+    65535, 65535, 65535, 65535, 729, 1536, 65535, 641, 1092, 1700, 65535, 65535, 65535, 65535, 65535, 65535,
+    65535, 1927, 488, 65535, 65535, 299, 950, 1217, 1003, 520, 65535, 65535, 1512, 1513, 65535, 65535,
+    665, 797, 65535, 864, 65535, 65535, 65535, 65535, 65535, 65535, 65535, 1141, 65535, 65535, 65535, 2,
+    1380, 65535, 1875, 1831, 65535, 117, 472, 354, 65535, 1844, 1673, 65535, 1992, 65535, 65535, 120,
+    1889, 684, 65535, 65535, 65535, 854, 65535, 65535, 65535, 373, 1486, 65535, 65535, 65535, 940, 1033,
+    1530, 59, 65535, 2085, 1618, 65535, 65535, 65535, 65535, 898, 1952, 1725, 65535, 461, 139, 41,
+    65535, 65535, 65535, 65535, 195, 960, 772, 258, 65535, 65535, 248, 65535, 674, 1373, 65535, 518,
+    65535, 1765, 582, 465, 1023, 549, 65535, 519, 47, 65535, 1066, 65535, 988, 65535, 65535, 1501,
+    65535, 65535, 65535, 1025, 1, 1527, 65535, 274, 65535, 1752, 65535, 913, 1085, 65535, 1968, 531,
+    65535, 65535, 1674, 65535, 65535, 1134, 896, 1334, 65535, 65535, 1916, 156, 65535, 65535, 65535, 65535,
+    626, 65535, 1248, 65535, 65535, 65535, 65535, 65535, 81, 649, 65535, 646, 1667, 65535, 229, 8,
+    65535, 889, 1514, 2049, 65535, 1074, 65535, 1554, 133, 307, 918, 65535, 1258, 65535, 65535, 1622,
+    65535, 65535, 746, 65535, 65535, 65535, 1685, 2051, 65535, 65535, 1575, 65535, 71, 65535, 331, 65535,
+    1209, 65535, 65535, 65535, 1593, 623, 65535, 1059, 838, 1825, 65535, 1597, 65535, 386, 829, 65535,
+    1395, 1723, 65535, 65535, 65535, 1079, 1911, 65535, 420, 65535, 1459, 545, 1902, 801, 1873, 65535,
+    1670, 873, 542, 65535, 569, 2043, 894, 1695, 65535, 65535, 65535, 65535, 827, 1966, 1528, 65535,
+    600, 1455, 1973, 65535, 1252, 1443, 65535, 742, 1345, 130, 1799, 65535, 108, 478, 959, 65535,
+    1587, 65535, 65535, 744, 65535, 65535, 1955, 65535, 1854, 65535, 1535, 1040, 65535, 65535, 1002, 188,
+    94, 65535, 433, 65535, 362, 1509, 65535, 65535, 65535, 1032, 973, 65535, 65535, 523, 353, 65535,
+    65535, 1999, 713, 180, 65535, 65535, 65535, 466, 65535, 239, 350, 1693, 65535, 65535, 65535, 65535,
+    2013, 65535, 1900, 227, 65535, 65535, 1427, 311, 65535, 1988, 1401, 1507, 610, 826, 378, 500,
+    879, 369, 1385, 65535, 65535, 1736, 1833, 1895, 2060, 1687, 65535, 162, 65535, 462, 65535, 65535,
+    65535, 1669, 65535, 2080, 65535, 1070, 1650, 735, 1152, 65535, 65535, 65535, 388, 65535, 1250, 65535,
+    65535, 399, 292, 351, 65535, 1130, 249, 439, 1005, 1929, 678, 65535, 1956, 1120, 342, 65535,
+    1983, 65535, 65535, 65535, 65535, 65535, 87, 1951, 65535, 268, 1387, 722, 1515, 65535, 65535, 1711,
+    3, 917, 65535, 691, 815, 1029, 65535, 1208, 65535, 1017, 65535, 65535, 1196, 62, 65535, 65535,
+    65535, 65535, 65535, 65535, 65535, 458, 1644, 65535, 65535, 1082, 1215, 450, 1257, 1222, 346, 65535,
+    886, 358, 65535, 65535, 65535, 1391, 1734, 857, 65535, 65535, 1972, 65535, 700, 1290, 65535, 65535,
+    65535, 65535, 963, 1607, 1499, 163, 65535, 65535, 1601, 1724, 65535, 65535, 501, 65535, 65535, 1192,
+    65535, 1335, 65535, 1135, 184, 1175, 65535, 65535, 65535, 2032, 65535, 65535, 777, 65535, 261, 65535,
+    1364, 65535, 348, 65535, 666, 1317, 1093, 65535, 65535, 1424, 502, 65535, 1463, 65535, 65535, 483,
+    65535, 310, 256, 65535, 2054, 344, 65535, 65535, 262, 65535, 1136, 65535, 1195, 65535, 65535, 768,
+    1410, 65535, 198, 65535, 65535, 65535, 1909, 65535, 1800, 607, 65535, 1544, 442, 510, 65535, 65535,
+    65535, 65535, 65535, 65535, 635, 65535, 65535, 921, 1505, 1590, 1073, 463, 65535, 65535, 65535, 65535,
+    1211, 1008, 1811, 327, 1431, 2015, 966, 65535, 65535, 65535, 555, 65535, 374, 1716, 2105, 235,
+    65535, 1336, 866, 2094, 65535, 65535, 65535, 516, 846, 955, 305, 65535, 2098, 2048, 65535, 392,
+    65535, 951, 1794, 1753, 1227, 1903, 65535, 900, 65535, 65535, 964, 65535, 65535, 231, 65535, 65535,
+    2069, 565, 65535, 1758, 1819, 65535, 65535, 65535, 65535, 65535, 65535, 1356, 65535, 630, 1128, 65535,
+    1407, 65535, 1709, 1067, 1707, 65535, 65535, 611, 875, 65535, 65535, 65535, 65535, 65535, 1276, 65535,
+    1732, 65535, 1749, 65535, 733, 408, 65535, 306, 2040, 65535, 476, 65535, 556, 885, 320, 65535,
+    65535, 2002, 65535, 65535, 65535, 1857, 721, 6, 1408, 968, 65535, 65535, 222, 324, 840, 65535,
+    65535, 602, 1153, 65535, 271, 2078, 65535, 65535, 65535, 65535, 65535, 1925, 65535, 65535, 65535, 65535,
+    65535, 65535, 65535, 64, 65535, 65535, 65535, 1868, 65535, 111, 357, 264, 1241, 65535, 65535, 1494,
+    65535, 65535, 65535, 2018, 65535, 1129, 1720, 527, 65535, 1323, 65535, 1165, 65535, 1299, 1645, 65535,
+    65535, 1592, 65535, 65535, 786, 65535, 65535, 719, 2045, 48, 65535, 65535, 1867, 1532, 65535, 65535,
+    128, 65535, 65535, 333, 65535, 1322, 178, 65535, 1625, 1316, 65535, 65535, 65535, 937, 65535, 65535,
+    65535, 1180, 2056, 422, 487, 548, 65535, 547, 65535, 576, 65535, 412, 1147, 65535, 65535, 65535,
+    2113, 1212, 361, 65535, 247, 118, 1243, 1553, 326, 65535, 65535, 808, 802, 1963, 1569, 65535,
+    65535, 2044, 706, 65535, 1803, 716, 658, 65535, 1414, 254, 2017, 65535, 65535, 1605, 65535, 185,
+    65535, 842, 1061, 65535, 65535, 58, 65535, 65535, 2119, 771, 1144, 65535, 171, 65535, 1034, 2073,
+    1855, 65535, 65535, 65535, 672, 1179, 65535, 372, 65535, 929, 1924, 65535, 575, 881, 529, 65535,
+    65535, 1444, 65535, 65535, 251, 65535, 65535, 56, 65535, 65535, 65535, 1315, 65535, 65535, 65535, 1675,
+    65535, 532, 65535, 986, 65535, 65535, 65535, 65535, 65535, 660, 1244, 65535, 583, 234, 65535, 65535,
+    65535, 65535, 1016, 1088, 65535, 65535, 65535, 1193, 1629, 65535, 65535, 1971, 1324, 683, 63, 65535,
+    65535, 65535, 404, 784, 136, 65535, 20, 2057, 1787, 629, 1277, 1339, 65535, 1352, 1133, 2008,
+    2102, 65535, 65535, 2058, 871, 65535, 65535, 976, 1255, 65535, 1740, 1461, 65535, 65535, 65535, 1075,
+    65535, 1341, 65535, 1096, 65535, 65535, 65535, 65535, 15, 528, 65535, 210, 65535, 65535, 65535, 1245,
+    1640, 65535, 65535, 1095, 752, 65535, 65535, 1676, 1056, 65535, 65535, 65535, 65535, 1078, 1190, 893,
+    853, 65535, 65535, 259, 1658, 65535, 1979, 65535, 65535, 883, 1105, 999, 127, 65535, 65535, 1106,
+    65535, 366, 65535, 65535, 65535, 65535, 65535, 65535, 903, 65535, 65535, 65535, 1497, 65535, 65535, 65535,
+    65535, 65535, 65535, 65535, 65535, 65535, 65535, 2016, 65535, 1038, 65535, 226, 1279, 27, 65535, 65535,
+    52, 419, 1280, 1155, 18, 1934, 263, 1458, 825, 65535, 1735, 925, 65535, 1423, 79, 1859,
+    65535, 997, 65535, 1583, 763, 443, 65535, 553, 1237, 538, 352, 153, 65535, 995, 1186, 1763,
+    65535, 869, 65535, 65535, 65535, 1199, 945, 762, 1917, 65535, 90, 1714, 65535, 65535, 65535, 1591,
+    65535, 464, 1202, 65535, 723, 65535, 669, 65535, 2014, 65535, 65535, 1440, 1813, 1608, 65535, 107,
+    603, 817, 65535, 1398, 65535, 65535, 65535, 80, 1546, 1464, 496, 804, 65535, 65535, 65535, 432,
+    65535, 65535, 1521, 1478, 65535, 65535, 65535, 65535, 1662, 690, 1537, 65535, 65535, 155, 2118, 1454,
+    718, 2011, 1285, 1692, 65535, 2068, 2041, 2081, 65535, 1941, 65535, 65535, 855, 65535, 908, 1580,
+    301, 1325, 911, 65535, 1304, 65535, 65535, 65535, 702, 65535, 1254, 116, 65535, 65535, 892, 1905,
+    850, 1595, 1019, 615, 65535, 709, 202, 1824, 446, 1367, 1396, 65535, 1766, 65535, 65535, 65535,
+    232, 65535, 65535, 65535, 550, 65535, 1830, 732, 636, 65535, 1221, 2091, 238, 1946, 406, 1354,
+    65535, 65535, 65535, 65535, 1630, 65535, 1842, 43, 65535, 1216, 65535, 1365, 628, 438, 1970, 39,
+    65535, 1010, 1894, 65535, 65535, 65535, 1007, 65535, 1447, 65535, 65535, 65535, 1090, 65535, 65535, 1174,
+    65535, 2064, 1430, 92, 65535, 65535, 65535, 65535, 1832, 1704, 1846, 598, 589, 65535, 217, 698,
+    870, 68, 65535, 1678, 761, 65535, 65535, 65535, 65535, 65535, 65535, 240, 65535, 431, 65535, 1366,
+    65535, 1080, 65535, 1309, 65535, 831, 65535, 2042, 65535, 860, 1915, 65535, 593, 1993, 526, 65535,
+    1146, 65535, 1866, 65535, 1744, 65535, 65535, 65535, 65535, 65535, 65535, 364, 1663, 203, 759, 65535,
+    65535, 65535, 65535, 451, 1117, 65535, 74, 65535, 410, 1850, 65535, 1418, 19, 1465, 65535, 66,
+    65535, 112, 65535, 1405, 1338, 65535, 65535, 1928, 1506, 65535, 1295, 605, 985, 2028, 65535, 788,
+    65535, 65535, 468, 876, 65535, 1308, 65535, 1540, 65535, 738, 890, 65535, 65535, 65535, 1511, 440,
+    97, 612, 65535, 65535, 65535, 1072, 1957, 65535, 246, 1234, 65535, 65535, 65535, 65535, 1313, 65535,
+    65535, 1624, 65535, 381, 551, 65535, 65535, 2108, 694, 65535, 1434, 2001, 65535, 1422, 65535, 65535,
+    65535, 1471, 613, 65535, 1664, 1818, 65535, 317, 1742, 65535, 1270, 65535, 65535, 65535, 65535, 574,
+    65535, 65535, 65535, 65535, 65535, 277, 379, 65535, 1994, 1545, 65535, 65535, 1604, 65535, 65535, 65535,
+    1636, 65535, 65535, 1510, 65535, 65535, 638, 65535, 65535, 1013, 65535, 1543, 65535, 65535, 65535, 160,
+    65535, 1502, 65535, 65535, 65535, 93, 65535, 65535, 65535, 355, 65535, 1869, 286, 65535, 65535, 809,
+    1150, 1858, 490, 65535, 1450, 1420, 65535, 65535, 65535, 65535, 1235, 475, 65535, 427, 456, 65535,
+    1962, 1456, 830, 541, 65535, 65535, 65535, 1923, 65535, 2036, 189, 65535, 282, 1852, 1651, 1581,
+    1188, 1361, 65535, 65535, 329, 1996, 65535, 1551, 65535, 1432, 841, 1715, 151, 2050, 65535, 1719,
+    65535, 65535, 1397, 1474, 1451, 1940, 105, 622, 65535, 65535, 65535, 218, 65535, 72, 65535, 65535,
+    287, 839, 65535, 65535, 1610, 65535, 1872, 65535, 1588, 359, 65535, 86, 631, 213, 316, 335,
+    2019, 65535, 129, 70, 65535, 65535, 65535, 65535, 65535, 2025, 695, 2110, 1741, 1817, 65535, 65535,
+    769, 65535, 460, 430, 1357, 1698, 504, 65535, 65535, 21, 314, 65535, 65535, 65535, 1094, 65535,
+    65535, 65535, 1747, 65535, 65535, 55, 1149, 65535, 1417, 65535, 65535, 749, 65535, 409, 861, 65535,
+    65535, 65535, 1297, 1785, 756, 1030, 961, 65535, 65535, 773, 1826, 291, 65535, 1170, 1249, 65535,
+    662, 181, 65535, 1263, 65535, 65535, 1058, 1479, 65535, 65535, 1896, 65535, 65535, 1717, 69, 65535,
+    1436, 65535, 1795, 65535, 65535, 65535, 65535, 699, 65535, 65535, 1874, 65535, 1743, 1100, 245, 65535,
+    65535, 65535, 820, 65535, 1077, 1220, 65535, 65535, 2099, 65535, 909, 65535, 1225, 540, 65535, 65535,
+    65535, 65535, 848, 65535, 1098, 2071, 65535, 1778, 1768, 65535, 1631, 953, 436, 65535, 1326, 65535,
+    1856, 659, 65535, 1311, 627, 65535, 2093, 65535, 65535, 65535, 1722, 65535, 1204, 281, 65535, 902,
+    413, 65535, 26, 206, 65535, 1798, 65535, 727, 65535, 844, 693, 65535, 578, 65535, 1426, 65535,
+    65535, 65535, 1549, 65535, 65535, 141, 65535, 1997, 65535, 65535, 142, 65535, 444, 863, 65535, 65535,
+    65535, 901, 65535, 573, 1912, 65535, 884, 65535, 100, 65535, 65535, 65535, 65535, 2037, 897, 65535,
+    1259, 65535, 65535, 1449, 65535, 65535, 146, 1572, 65535, 1656, 204, 65535, 1691, 916, 65535, 640,
+    714, 65535, 65535, 65535, 65535, 65535, 1107, 65535, 65535, 566, 2029, 65535, 65535, 278, 65535, 65535,
+    1262, 920, 1050, 65535, 65535, 65535, 65535, 685, 1576, 318, 65535, 780, 65535, 173, 1746, 793,
+    498, 65535, 65535, 1792, 2010, 40, 65535, 65535, 1567, 1503, 692, 65535, 65535, 65535, 65535, 65535,
+    65535, 65535, 65535, 65535, 65535, 477, 65535, 65535, 65535, 1820, 65535, 859, 910, 65535, 65535, 65535,
+    1300, 1031, 581, 65535, 65535, 65535, 65535, 1118, 65535, 822, 347, 65535, 65535, 65535, 599, 12,
+    1213, 2031, 2082, 65535, 65535, 720, 65535, 65535, 663, 1124, 65535, 1256, 1738, 2021, 1876, 1035,
+    819, 1987, 1791, 65535, 1788, 65535, 1755, 481, 2103, 65535, 323, 2005, 1477, 65535, 65535, 65535,
+    65535, 580, 774, 65535, 1236, 579, 65535, 1887, 1655, 508, 1612, 65535, 65535, 594, 1472, 65535,
+    1167, 65535, 65535, 1363, 65535, 65535, 1861, 2003, 65535, 65535, 1761, 1305, 1561, 65535, 65535, 102,
+    1684, 65535, 843, 65535, 65535, 65535, 679, 150, 1469, 1904, 957, 1942, 65535, 1525, 1340, 363,
+    65535, 201, 1198, 65535, 65535, 88, 65535, 65535, 1333, 992, 65535, 2034, 965, 65535, 2088, 888,
+    0, 65535, 65535, 65535, 170, 798, 280, 724, 1496, 65535, 321, 65535, 1383, 53, 65535, 1562,
+    65535, 2114, 812, 1247, 272, 65535, 65535, 244, 984, 904, 767, 2063, 1022, 1661, 2070, 65535,
+    1429, 65535, 255, 65535, 293, 1376, 1812, 65535, 65535, 1331, 1053, 425, 1730, 266, 1935, 1164,
+    1623, 65535, 54, 65535, 65535, 65535, 65535, 1143, 65535, 77, 65535, 604, 65535, 1283, 65535, 65535,
+    1242, 65535, 1416, 643, 65535, 65535, 1274, 65535, 65535, 65535, 1767, 65535, 1228, 1377, 65535, 65535,
+    65535, 65535, 65535, 2000, 1114, 187, 65535, 1943, 65535, 1251, 563, 65535, 1913, 65535, 1524, 65535,
+    1599, 65535, 65535, 65535, 65535, 800, 760, 2109, 1390, 65535, 1564, 1958, 65535, 1012, 65535, 585,
+    65535, 1585, 65535, 230, 1683, 1797, 560, 65535, 65535, 65535, 1161, 65535, 65535, 567, 65535, 65535,
+    65535, 1619, 65535, 1113, 65535, 1760, 1708, 65535, 65535, 65535, 110, 887, 322, 65535, 1168, 65535,
+    1233, 65535, 65535, 1099, 65535, 935, 65535, 1598, 65535, 1964, 65535, 65535, 65535, 503, 65535, 65535,
+    65535, 65535, 1764, 1015, 164, 401, 621, 1960, 65535, 1400, 65535, 1362, 65535, 65535, 65535, 121,
+    65535, 65535, 1183, 65535, 1327, 1989, 65535, 1261, 65535, 148, 65535, 16, 1938, 1642, 65535, 65535,
+    740, 1051, 971, 1908, 1976, 1974, 65535, 65535, 872, 65535, 65535, 193, 390, 978, 65535, 65535,
+    1298, 65535, 252, 65535, 65535, 620, 65535, 1131, 1439, 2086, 65535, 84, 194, 65535, 65535, 65535,
+    65535, 65535, 65535, 65535, 65535, 403, 65535, 1558, 113, 65535, 2121, 65535, 65535, 926, 65535, 1482,
+    525, 1804, 65535, 65535, 535, 1933, 1577, 65535, 65535, 789, 65535, 730, 653, 65535, 65535, 1959,
+    65535, 65535, 337, 65535, 1851, 65535, 65535, 303, 65535, 65535, 65535, 65535, 65535, 65535, 656, 1001,
+    1920, 169, 65535, 65535, 65535, 878, 65535, 65535, 648, 645, 1157, 65535, 65535, 1586, 1555, 65535,
+    592, 65535, 65535, 65535, 65535, 65535, 391, 1697, 65535, 65535, 1314, 65535, 65535, 931, 65535, 65535,
+    670, 1671, 755, 65535, 65535, 65535, 65535, 65535, 65535, 400, 65535, 429, 1272, 65535, 95, 987,
+    1491, 65535, 1696, 65535, 1042, 65535, 877, 943, 200, 434, 65535, 1836, 1890, 517, 1542, 891,
+    65535, 895, 65535, 584, 65535, 65535, 65535, 65535, 936, 65535, 65535, 530, 919, 1871, 1802, 65535,
+    65535, 1176, 65535, 65535, 1452, 1369, 65535, 65535, 1224, 65535, 65535, 65535, 1823, 65535, 865, 65535,
+    1796, 764, 338, 816, 1406, 65535, 345, 65535, 65535, 639, 65535, 1068, 65535, 1582, 65535, 1728,
+    65535, 65535, 1346, 65535, 65535, 552, 147, 65535, 65535, 2122, 512, 867, 2004, 1563, 65535, 325,
+    675, 65535, 912, 65535, 65535, 241, 290, 65535, 1978, 601, 196, 65535, 1330, 65535, 65535, 315,
+    65535, 216, 65535, 1879, 1801, 915, 775, 270, 979, 492, 1870, 89, 1751, 1445, 65535, 65535,
+    509, 65535, 75, 65535, 30, 65535, 65535, 65535, 65535, 289, 65535, 65535, 65535, 65535, 65535, 65535,
+    972, 65535, 1533, 1350, 1381, 650, 1203, 65535, 703, 474, 1343, 65535, 1998, 65535, 65535, 65535,
+    65535, 65535, 65535, 65535, 1843, 1435, 65535, 65535, 1087, 407, 1372, 1159, 65535, 65535, 65535, 65535,
+    1635, 946, 506, 980, 65535, 33, 191, 65535, 65535, 779, 1781, 65535, 934, 65535, 1206, 65535,
+    803, 65535, 65535, 65535, 65535, 65535, 65535, 1566, 776, 1154, 2052, 349, 65535, 1171, 1548, 1091,
+    704, 65535, 65535, 1954, 2083, 179, 1238, 65535, 65535, 233, 65535, 65535, 65535, 65535, 65535, 1637,
+    1413, 2061, 1899, 29, 343, 99, 65535, 1690, 119, 1052, 177, 65535, 65535, 65535, 1009, 65535,
+    942, 1063, 65535, 65535, 65535, 65535, 65535, 65535, 65535, 534, 65535, 1382, 65535, 65535, 65535, 65535,
+    65535, 65535, 65535, 1282, 1360, 65535, 65535, 899, 810, 65535, 608, 65535, 1638, 65535, 65535, 499,
+    65535, 1359, 1476, 65535, 813, 1578, 65535, 1782, 65535, 906, 65535, 558, 65535, 65535, 1827, 1268,
+    143, 65535, 416, 65535, 65535, 65535, 2012, 65535, 65535, 661, 65535, 49, 1281, 65535, 1062, 65535,
+    65535, 65535, 65535, 65535, 1657, 65535, 65535, 65535, 1388, 65535, 65535, 65535, 65535, 65535, 65535, 513,
+    445, 1901, 65535, 65535, 1774, 65535, 1239, 65535, 65535, 65535, 1045, 65535, 65535, 65535, 65535, 336,
+    65535, 924, 65535, 1287, 1057, 73, 65535, 880, 1230, 65535, 65535, 65535, 65535, 65535, 1762, 1965,
+    1990, 480, 1815, 65535, 651, 65535, 1219, 711, 65535, 65535, 65535, 1169, 65535, 680, 214, 65535,
+    98, 65535, 1776, 65535, 65535, 522, 1089, 65535, 65535, 1389, 65535, 1500, 65535, 2074, 65535, 65535,
+    644, 1531, 65535, 65535, 1163, 65535, 65535, 65535, 65535, 1893, 833, 65535, 11, 65535, 546, 313,
+    1632, 65535, 2066, 65535, 65535, 65535, 65535, 1712, 561, 65535, 65535, 65535, 970, 990, 65535, 65535,
+    65535, 1646, 65535, 1172, 65535, 65535, 365, 65535, 65535, 65535, 1611, 1721, 65535, 1185, 618, 1932,
+    1046, 65535, 65535, 2026, 65535, 65535, 65535, 65535, 1024, 166, 1729, 65535, 65535, 51, 65535, 1480,
+    65535, 1353, 65535, 65535, 384, 1020, 1111, 505, 65535, 65535, 65535, 1475, 65535, 65535, 65535, 1596,
+    1466, 991, 65535, 428, 1260, 65535, 22, 319, 654, 126, 65535, 65535, 65535, 65535, 1138, 65535,
+    65535, 65535, 65535, 2112, 65535, 1421, 65535, 614, 676, 65535, 1148, 377, 65535, 65535, 1508, 1286,
+    1686, 65535, 65535, 1109, 1953, 1737, 65535, 65535, 747, 65535, 65535, 617, 65535, 1771, 65535, 65535,
+    765, 715, 65535, 65535, 1522, 1726, 1602, 568, 65535, 1565, 657, 334, 5, 1949, 65535, 851,
+    1526, 1557, 634, 65535, 1881, 65535, 1668, 101, 441, 1682, 65535, 65535, 65535, 1207, 65535, 65535,
+    65535, 65535, 65535, 65535, 65535, 65535, 983, 65535, 398, 1187, 237, 65535, 586, 489, 65535, 448,
+    1649, 65535, 65535, 1200, 922, 2023, 65535, 65535, 65535, 1907, 1104, 65535, 65535, 741, 1626, 1759,
+    1614, 1044, 1793, 65535, 65535, 65535, 65535, 2100, 2076, 65535, 1320, 65535, 65535, 159, 65535, 1162,
+    65535, 1437, 65535, 1490, 65535, 65535, 758, 65535, 1374, 1139, 606, 2033, 673, 734, 1603, 131,
+    559, 1606, 65535, 1348, 1028, 65535, 65535, 65535, 140, 65535, 65535, 65535, 1885, 65535, 1883, 65535,
+    65535, 65535, 1541, 1122, 455, 1064, 1617, 167, 792, 65535, 1906, 65535, 554, 65535, 65535, 852,
+    1312, 65535, 1310, 65535, 393, 1402, 7, 28, 65535, 36, 65535, 1652, 65535, 65535, 273, 65535,
+    1425, 215, 45, 449, 1271, 418, 710, 65535, 65535, 1468, 65535, 65535, 65535, 65535, 65535, 65535,
+    65535, 1303, 65535, 65535, 132, 1977, 65535, 65535, 65535, 65535, 65535, 65535, 14, 65535, 65535, 1918,
+    65535, 1419, 975, 65535, 65535, 2077, 1520, 137, 65535, 65535, 1288, 65535, 65535, 1877, 486, 1337,
+    65535, 65535, 65535, 1961, 65535, 1065, 1332, 65535, 65535, 65535, 564, 1539, 1634, 736, 664, 1886,
+    402, 395, 1301, 65535, 1681, 65535, 962, 65535, 65535, 927, 65535, 312, 65535, 65535, 65535, 2090,
+    65535, 65535, 65535, 2072, 65535, 65535, 65535, 328, 1292, 65535, 65535, 1888, 65535, 1982, 65535, 65535,
+    533, 748, 1433, 65535, 65535, 65535, 2115, 790, 1488, 1403, 65535, 796, 1550, 1980, 1628, 1184,
+    65535, 31, 65535, 1384, 65535, 1110, 65535, 1882, 298, 65535, 2087, 624, 701, 65535, 868, 952,
+    65535, 65535, 1939, 65535, 1115, 65535, 182, 65535, 65535, 807, 65535, 65535, 1156, 65535, 1194, 65535,
+    824, 1571, 1838, 1399, 1897, 65535, 1473, 17, 596, 65535, 65535, 65535, 65535, 65535, 65535, 65535,
+    65535, 65535, 539, 1121, 285, 396, 1493, 1639, 1579, 65535, 421, 956, 61, 1232, 1049, 795,
+    65535, 671, 65535, 65535, 2053, 223, 2104, 948, 1547, 1573, 1666, 1538, 65535, 65535, 275, 65535,
+    1318, 882, 65535, 1246, 806, 65535, 65535, 65535, 65535, 1944, 65535, 1394, 1177, 65535, 637, 228,
+    65535, 65535, 65535, 65535, 1784, 65535, 65535, 10, 65535, 1718, 65535, 1054, 65535, 212, 65535, 697,
+    65535, 1680, 37, 65535, 65535, 65535, 65535, 1485, 1378, 265, 65535, 65535, 330, 65535, 65535, 65535,
+    1556, 65535, 65535, 1201, 595, 1892, 1047, 295, 1151, 1688, 1504, 65535, 1284, 65535, 668, 25,
+    65535, 799, 2030, 9, 1498, 65535, 65535, 837, 65535, 731, 1627, 2096, 65535, 65535, 938, 1584,
+    65535, 65535, 471, 681, 65535, 1495, 1775, 588, 269, 914, 122, 1108, 115, 1805, 783, 341,
+    794, 1701, 65535, 507, 2047, 65535, 1864, 253, 309, 2079, 65535, 65535, 65535, 571, 65535, 65535,
+};
+
+// perfect-hash lookup; nullptr when name is not an HTML5 entity
+constexpr const HtmlEntity* findHtmlEntity(std::string_view name) {
+    if (name.empty() || name.size() > kHtmlEntityMaxName) return nullptr;
+    uint32_t seed = kHtmlEntitySeeds[entityHash(name, 0) & kHtmlEntityBucketMask];
+    uint16_t index = kHtmlEntitySlots[entityHash(name, seed) & kHtmlEntitySlotMask];
+    if (index == kHtmlEntityEmptySlot || kHtmlEntities[index].name != name) return nullptr;
+    return &kHtmlEntities[index];
+}
+
+static_assert(findHtmlEntity("amp") != nullptr && findHtmlEntity("amp")->value == "&",
+    "entity table and entityHash() are out of sync");
@@ -0,0 +1,232 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 22:40
+
+#include "Log.hpp"
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+
+bool parseLogLevel(std::string_view name, LogLevel& level) {
+    static const std::pair<const char*, LogLevel> names[] = {
+        { "trace", LogLevel::Trace }, { "debug", LogLevel::Debug }, { "info", LogLevel::Info },
+        { "warn", LogLevel::Warn }, { "error", LogLevel::Error }, { "off", LogLevel::Off },
+    };
+    for (const auto& n : names) {
+        if (name == n.first) {
+            level = n.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Single-producer single-consumer ring of records. head is only written by the owning
+// thread, tail only by the writer thread; each side keeps to its own cache line.
+struct Logger::Ring {
+    static constexpr uint64_t capacity = 1024;
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+    uint64_t cachedTail = 0; // producer's last view of tail
+    alignas(64) std::atomic<uint64_t> tail{ 0 };
+    alignas(64) std::atomic<size_t> dropped{ 0 };
+    std::atomic<bool> retired{ false };
+    std::unique_ptr<LogRecord[]> slots{ new LogRecord[capacity] };
+};
+
+struct Logger::ThreadRing {
+    std::shared_ptr<Ring> ring;
+    ~ThreadRing() {
+        if (ring) ring->retired.store(true, std::memory_order_release);
+    }
+};
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() {
+    worker = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+Logger::Ring& Logger::local() {
+    thread_local ThreadRing handle;
+    if (!handle.ring) {
+        handle.ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(handle.ring);
+    }
+    return *handle.ring;
+}
+
+LogRecord* Logger::reserve() {
+    Ring& r = local();
+    uint64_t h = r.head.load(std::memory_order_relaxed);
+    if (h - r.cachedTail >= Ring::capacity) {
+        r.cachedTail = r.tail.load(std::memory_order_acquire);
+        if (h - r.cachedTail >= Ring::capacity) {
+            r.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    return &r.slots[h % Ring::capacity];
+}
+
+void Logger::commit() {
+    Ring& r = local();
+    r.head.store(r.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(m);
+    uint64_t target = ++flushRequests;
+    wake.notify_all();
+    flushed.wait(lock, [&] { return flushesDone >= target || stopping; });
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(m);
+    for (;;) {
+        wake.wait_for(lock, std::chrono::milliseconds(5), [this] { return stopping || flushRequests != flushesDone; });
+        uint64_t target = flushRequests;
+        bool last = stopping;
+        lock.unlock();
+        drain();
+        lock.lock();
+        flushesDone = target;
+        flushed.notify_all();
+        if (last) break;
+    }
+}
+
+static void appendArg(std::string& out, const LogRecord& r, size_t& at) {
+    if (at >= r.used) return;
+    char buf[32];
+    auto type = static_cast<Logger::ArgType>(r.payload[at++]);
+    switch (type) {
+    case Logger::Signed: {
+        int64_t v;
+        std::memcpy(&v, r.payload + at, sizeof(v));
+        at += sizeof(v);
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr - buf);
+        break;
+    }
+    case Logger::Unsigned: {
+        uint64_t v;
+        std::memcpy(&v, r.payload + at, sizeof(v));
+        at += sizeof(v);
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr - buf);
+        break;
+    }
+    case Logger::Float: {
+        double v;
+        std::memcpy(&v, r.payload + at, sizeof(v));
+        at += sizeof(v);
+        int n = std::snprintf(buf, sizeof(buf), "%g", v); // what operator<< prints by default
+        if (n > 0) out.append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+        break;
+    }
+    case Logger::Text: {
+        uint16_t len;
+        std::memcpy(&len, r.payload + at, 2);
+        out.append(r.payload + at + 2, len);
+        at += 2 + len;
+        break;
+    }
+    }
+}
+
+static void formatRecord(std::string& out, const LogRecord& r) {
+    out += '[';
+    out += r.tag;
+    out += "] ";
+    size_t at = 0;
+    for (const char* f = r.format; *f; ++f) {
+        if (f[0] == '{' && f[1] == '}') {
+            appendArg(out, r, at);
+            ++f;
+        }
+        else {
+            out += *f;
+        }
+    }
+    if (r.truncated) out += " [...]";
+    if (r.suppressed) {
+        out += " (";
+        out += std::to_string(r.suppressed);
+        out += " similar messages suppressed)";
+    }
+    out += '\n';
+}
+
+size_t Logger::drain() {
+    std::vector<std::shared_ptr<Ring>> current;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        current = rings;
+    }
+    std::vector<LogRecord> batch;
+    size_t lost = 0;
+    for (const auto& ring : current) {
+        uint64_t t = ring->tail.load(std::memory_order_relaxed);
+        uint64_t h = ring->head.load(std::memory_order_acquire);
+        for (; t != h; ++t) batch.push_back(ring->slots[t % Ring::capacity]);
+        ring->tail.store(h, std::memory_order_release);
+        lost += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    // rings of exited threads go once they are empty
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring>& r) {
+            return r->retired.load(std::memory_order_acquire) &&
+                r->tail.load(std::memory_order_relaxed) == r->head.load(std::memory_order_acquire);
+            }), rings.end());
+    }
+
+    // threads are drained one after another; time order makes the output read naturally
+    std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+        return a.time < b.time;
+        });
+    std::string text;
+    bool toErr = false;
+    auto emit = [&] {
+        if (text.empty()) return;
+        (toErr ? std::cerr : std::cout).write(text.data(), static_cast<std::streamsize>(text.size()));
+        text.clear();
+    };
+    for (const auto& r : batch) {
+        bool err = r.level >= static_cast<uint8_t>(LogLevel::Warn);
+        if (err != toErr) {
+            emit();
+            toErr = err;
+        }
+        formatRecord(text, r);
+    }
+    emit();
+    if (lost > 0) {
+        droppedTotal.fetch_add(lost, std::memory_order_relaxed);
+        std::cerr << "[Log] " << lost << " messages dropped (ring full)\n";
+    }
+    if (!batch.empty()) std::cout.flush();
+    return batch.size();
+}
+
+bool LogRateLimit::allow(uint64_t& suppressed) {
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    int64_t next = nextAllowed.load(std::memory_order_relaxed);
+    if (now < next || !nextAllowed.compare_exchange_strong(next, now + interval.count(), std::memory_order_relaxed)) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = skipped.exchange(0, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,200 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 22:40
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : int { Trace = 0, Debug, Info, Warn, Error, Off };
+
+// levels below this are compiled out (e.g. -DPWS_LOG_MIN_LEVEL=2 keeps Info and above)
+#ifndef PWS_LOG_MIN_LEVEL
+#define PWS_LOG_MIN_LEVEL 0
+#endif
+
+// "trace", "debug", "info", "warn", "error" or "off"; false when name is none of them
+bool parseLogLevel(std::string_view name, LogLevel& level);
+
+// One fixed-size record in a thread's ring. Arguments are stored encoded (type byte + value,
+// strings copied and cut to what fits) and only formatted by the writer thread.
+struct LogRecord {
+    static constexpr size_t payloadSize = 216;
+    std::chrono::steady_clock::time_point time;
+    const char* tag;
+    const char* format;      // "{}" marks an argument
+    uint64_t suppressed;     // similar messages dropped by a rate limit since the last one
+    uint8_t level;
+    uint8_t truncated;       // arguments that did not fit are left out
+    uint16_t used;
+    char payload[payloadSize];
+};
+
+// Asynchronous logger. Every thread writes into its own single-producer ring (lock-free: a
+// relaxed/acquire pair per record, no shared cache line with other producers); a background
+// thread drains all rings every few milliseconds, orders the records by time, formats them
+// and writes Warn and above to std::cerr, the rest to std::cout. A full ring drops the record
+// (counted and reported) instead of blocking the caller. Use the LOG_* macros: a disabled
+// level costs one relaxed load, a level under PWS_LOG_MIN_LEVEL nothing at all.
+class Logger {
+public:
+    static Logger& instance();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+    void setLevel(LogLevel level) { minLevel.store(static_cast<int>(level), std::memory_order_relaxed); }
+    LogLevel level() const { return static_cast<LogLevel>(minLevel.load(std::memory_order_relaxed)); }
+
+    template <typename... Args>
+    void write(LogLevel level, const char* tag, uint64_t suppressed, const char* format, const Args&... args) {
+        LogRecord* r = reserve();
+        if (!r) return;
+        r->time = std::chrono::steady_clock::now();
+        r->tag = tag;
+        r->format = format;
+        r->suppressed = suppressed;
+        r->level = static_cast<uint8_t>(level);
+        r->truncated = 0;
+        r->used = 0;
+        (encode(*r, args), ...);
+        commit();
+    }
+
+    // blocks until everything logged before the call has been written
+    void flush();
+    size_t dropped() const { return droppedTotal.load(std::memory_order_relaxed); }
+
+    enum ArgType : uint8_t { Signed, Unsigned, Float, Text };
+
+private:
+    struct Ring;
+    struct ThreadRing; // thread_local handle, retires the ring when its thread exits
+
+    Logger();
+    static inline std::atomic<int> minLevel{ static_cast<int>(LogLevel::Info) };
+    std::atomic<size_t> droppedTotal{ 0 };
+
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    std::mutex m;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    uint64_t flushRequests = 0;
+    uint64_t flushesDone = 0;
+    bool stopping = false;
+    std::thread worker;
+
+    Ring& local();
+    LogRecord* reserve();
+    void commit();
+    void run();
+    size_t drain();
+
+    static void put(LogRecord& r, ArgType type, const void* data, size_t n) {
+        size_t room = LogRecord::payloadSize - r.used;
+        if (r.truncated || room < 1 + (type == Text ? 2 : n)) {
+            r.truncated = 1;
+            return;
+        }
+        r.payload[r.used++] = static_cast<char>(type);
+        if (type == Text) {
+            uint16_t len = static_cast<uint16_t>(std::min(n, room - 3));
+            std::memcpy(r.payload + r.used, &len, 2);
+            std::memcpy(r.payload + r.used + 2, data, len);
+            r.used = static_cast<uint16_t>(r.used + 2 + len);
+            return;
+        }
+        std::memcpy(r.payload + r.used, data, n);
+        r.used = static_cast<uint16_t>(r.used + n);
+    }
+    template <typename T>
+    static void encode(LogRecord& r, const T& v) {
+        if constexpr (std::is_same_v<T, bool>) {
+            int64_t x = v ? 1 : 0;
+            put(r, Signed, &x, sizeof(x));
+        }
+        else if constexpr (std::is_same_v<T, char>) {
+            put(r, Text, &v, 1);
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            int64_t x = v;
+            put(r, Signed, &x, sizeof(x));
+        }
+        else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            uint64_t x = static_cast<uint64_t>(v);
+            put(r, Unsigned, &x, sizeof(x));
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            double x = v;
+            put(r, Float, &x, sizeof(x));
+        }
+        else {
+            std::string_view s(v);
+            put(r, Text, s.data(), s.size());
+        }
+    }
+};
+
+// At most one message per interval from one call site; the next one that gets through
+// reports how many were suppressed in between.
+class LogRateLimit {
+public:
+    explicit LogRateLimit(std::chrono::milliseconds interval) : interval(interval) {}
+    bool allow(uint64_t& suppressed);
+
+private:
+    std::chrono::steady_clock::duration interval;
+    std::atomic<int64_t> nextAllowed{ 0 }; // steady_clock ticks
+    std::atomic<uint64_t> skipped{ 0 };
+};
+
+#define LOG_AT(lvl, tag, ...)                                                                    \
+    do {                                                                                         \
+        if constexpr (static_cast<int>(lvl) >= PWS_LOG_MIN_LEVEL) {                              \
+            if (Logger::enabled(lvl)) Logger::instance().write(lvl, tag, 0, __VA_ARGS__);        \
+        }                                                                                        \
+    } while (0)
+
+// one message per interval_ms from this call site
+#define LOG_RATE(lvl, interval_ms, tag, ...)                                                     \
+    do {                                                                                         \
+        if constexpr (static_cast<int>(lvl) >= PWS_LOG_MIN_LEVEL) {                              \
+            static LogRateLimit logRateLimit_{ std::chrono::milliseconds(interval_ms) };         \
+            uint64_t logSuppressed_ = 0;                                                         \
+            if (Logger::enabled(lvl) && logRateLimit_.allow(logSuppressed_))                     \
+                Logger::instance().write(lvl, tag, logSuppressed_, __VA_ARGS__);                 \
+        }                                                                                        \
+    } while (0)
+
+// every n-th message from this call site
+#define LOG_SAMPLE(lvl, n, tag, ...)                                                             \
+    do {                                                                                         \
+        if constexpr (static_cast<int>(lvl) >= PWS_LOG_MIN_LEVEL) {                              \
+            static std::atomic<uint64_t> logSampleCount_{ 0 };                                   \
+            if (Logger::enabled(lvl) &&                                                          \
+                logSampleCount_.fetch_add(1, std::memory_order_relaxed) % (n) == 0)              \
+                Logger::instance().write(lvl, tag, 0, __VA_ARGS__);                              \
+        }                                                                                        \
+    } while (0)
+
+#define LOG_TRACE(tag, ...) LOG_AT(LogLevel::Trace, tag, __VA_ARGS__)
+#define LOG_DEBUG(tag, ...) LOG_AT(LogLevel::Debug, tag, __VA_ARGS__)
+#define LOG_INFO(tag, ...) LOG_AT(LogLevel::Info, tag, __VA_ARGS__)
+#define LOG_WARN(tag, ...) LOG_AT(LogLevel::Warn, tag, __VA_ARGS__)
+#define LOG_ERROR(tag, ...) LOG_AT(LogLevel::Error, tag, __VA_ARGS__)
@@ -0,0 +1,62 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#include "MemoryBudget.hpp"
+#include <algorithm>
+
+static int64_t nowTicks() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+MemoryBudget::MemoryBudget(size_t limit_bytes, double high_water, double low_water)
+    : limitBytes(limit_bytes) {
+    high_water = std::clamp(high_water, 0.0, 1.0);
+    low_water = std::clamp(low_water, 0.0, high_water);
+    high = static_cast<size_t>(static_cast<double>(limitBytes) * high_water);
+    low = static_cast<size_t>(static_cast<double>(limitBytes) * low_water);
+}
+
+void MemoryBudget::charge(size_t bytes) {
+    if (bytes == 0) return;
+    size_t now = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t top = peak.load(std::memory_order_relaxed);
+    while (now > top && !peak.compare_exchange_weak(top, now, std::memory_order_relaxed)) {}
+    if (limitBytes && now >= high && !throttled.load(std::memory_order_relaxed)
+        && !throttled.exchange(true, std::memory_order_acq_rel)) {
+        throttledSince.store(nowTicks(), std::memory_order_relaxed);
+        throttles.fetch_add(1, std::memory_order_relaxed);
+        // a release may have passed the low mark before the flag was up; the charger
+        // holds what it charged, so its own release will pump again afterwards
+        if (current.load(std::memory_order_relaxed) <= low && throttled.exchange(false, std::memory_order_acq_rel))
+            throttledTicks.fetch_add(nowTicks() - throttledSince.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void MemoryBudget::release(size_t bytes) {
+    if (bytes == 0) return;
+    size_t now = current.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+    if (now <= low && throttled.load(std::memory_order_relaxed)
+        && throttled.exchange(false, std::memory_order_acq_rel)) {
+        throttledTicks.fetch_add(nowTicks() - throttledSince.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        std::lock_guard<std::recursive_mutex> lock(resumeMutex);
+        if (resume) resume();
+    }
+}
+
+void MemoryBudget::setResume(std::function<void()> fn) {
+    std::lock_guard<std::recursive_mutex> lock(resumeMutex);
+    resume = std::move(fn);
+}
+
+MemoryBudgetStats MemoryBudget::stats() const {
+    MemoryBudgetStats s;
+    s.limit = limitBytes;
+    s.current = current.load(std::memory_order_relaxed);
+    s.peak = peak.load(std::memory_order_relaxed);
+    s.throttles = throttles.load(std::memory_order_relaxed);
+    int64_t ticks = throttledTicks.load(std::memory_order_relaxed);
+    if (throttled.load(std::memory_order_relaxed)) ticks += nowTicks() - throttledSince.load(std::memory_order_relaxed);
+    s.throttledSeconds = std::chrono::duration<double>(std::chrono::steady_clock::duration(ticks)).count();
+    return s;
+}
@@ -0,0 +1,60 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+struct MemoryBudgetStats {
+    size_t limit = 0;
+    size_t current = 0;
+    size_t peak = 0;
+    size_t throttles = 0;   // times usage reached the high-water mark
+    double throttledSeconds = 0.0;
+};
+
+// Byte budget of what the pipeline holds at once: bodies and parser state of the pages being
+// downloaded or waiting to be stored, and results queued for the exporter and the checkpoint.
+// Holders charge() what they keep and release() it when it is gone. New downloads are
+// admitted while usage is below the high-water mark; once it reaches the mark admission
+// stops until usage falls back to the low-water mark, and the resume callback is called
+// from the thread whose release() got it there. Admitted pages still grow after admission,
+// so usage can pass the limit by up to the pages in flight times the per-page cap.
+// A limit of 0 only counts.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit_bytes = 0, double high_water = 0.9, double low_water = 0.7);
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    // thread-safe
+    void charge(size_t bytes);
+    void release(size_t bytes);
+    bool admits() const { return !throttled.load(std::memory_order_acquire); }
+    size_t used() const { return current.load(std::memory_order_relaxed); }
+    size_t limit() const { return limitBytes; }
+    size_t highWater() const { return high; }
+    size_t lowWater() const { return low; }
+    MemoryBudgetStats stats() const;
+
+    // nullptr for none; once it returns, the previous callback is not running anymore
+    void setResume(std::function<void()> fn);
+
+private:
+    size_t limitBytes;
+    size_t high;
+    size_t low;
+    std::atomic<size_t> current{ 0 };
+    std::atomic<size_t> peak{ 0 };
+    std::atomic<bool> throttled{ false };
+    std::atomic<size_t> throttles{ 0 };
+    std::atomic<int64_t> throttledSince{ 0 }; // steady_clock ticks
+    std::atomic<int64_t> throttledTicks{ 0 };
+    std::recursive_mutex resumeMutex; // resume() may end up releasing again
+    std::function<void()> resume;
+};
@@ -0,0 +1,225 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr size_t histCount = static_cast<size_t>(Hist::Count_);
+constexpr size_t counterCount = static_cast<size_t>(Counter::Count_);
+constexpr size_t gaugeCount = static_cast<size_t>(Gauge::Count_);
+
+std::atomic<uint64_t> nextMetricsId{ 1 };
+
+// only the owning thread writes a slot, so a plain load + store is enough
+inline void bump(std::atomic<uint64_t>& a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+int highestBit(uint64_t v) {
+    int b = 0;
+    while (v >>= 1) ++b;
+    return b;
+}
+
+} // namespace
+
+size_t HistogramLayout::index(uint64_t v) {
+    if (v < 2 * subCount) return static_cast<size_t>(v);
+    v = std::min<uint64_t>(v, (uint64_t(1) << maxBits) - 1);
+    int shift = highestBit(v) - subBits;
+    return static_cast<size_t>(2 * subCount + (shift - 1) * subCount + ((v >> shift) - subCount));
+}
+
+uint64_t HistogramLayout::lowerBound(size_t i) {
+    if (i < 2 * subCount) return i;
+    size_t k = i - 2 * subCount;
+    return (subCount + k % subCount) << (k / subCount + 1);
+}
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(HistogramLayout::upperBound(i), max);
+    }
+    return max;
+}
+
+const char* metricName(Hist h) {
+    static const char* names[] = { "dns_seconds", "connect_seconds", "tls_seconds", "first_byte_seconds",
+        "transfer_seconds", "request_seconds", "link_stage_seconds", "parse_stage_seconds", "store_stage_seconds" };
+    static_assert(sizeof(names) / sizeof(names[0]) == histCount, "one name per histogram");
+    return names[static_cast<size_t>(h)];
+}
+
+const char* metricName(Counter c) {
+    static const char* names[] = { "requests_total", "failures_total", "retries_total",
+        "downloaded_bytes_total", "decoded_bytes_total", "pages_parsed_total", "records_stored_total",
+        "link_allocations_total", "parse_allocations_total", "store_allocations_total",
+        "oversize_pages_total" };
+    static_assert(sizeof(names) / sizeof(names[0]) == counterCount, "one name per counter");
+    return names[static_cast<size_t>(c)];
+}
+
+const char* metricName(Gauge g) {
+    static const char* names[] = { "downloading_pages", "buffered_pages", "memory_budget_bytes" };
+    static_assert(sizeof(names) / sizeof(names[0]) == gaugeCount, "one name per gauge");
+    return names[static_cast<size_t>(g)];
+}
+
+struct Metrics::Slot {
+    std::array<std::array<std::atomic<uint64_t>, HistogramLayout::buckets>, histCount> buckets;
+    std::array<std::atomic<uint64_t>, histCount> sums;
+    std::array<std::atomic<uint64_t>, histCount> maxes;
+    std::array<std::atomic<uint64_t>, counterCount> counters;
+
+    Slot() {
+        for (auto& h : buckets)
+            for (auto& b : h) b.store(0, std::memory_order_relaxed);
+        for (auto& s : sums) s.store(0, std::memory_order_relaxed);
+        for (auto& s : maxes) s.store(0, std::memory_order_relaxed);
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+    }
+};
+
+Metrics::Metrics() : id(nextMetricsId++), started(std::chrono::steady_clock::now()) {
+    for (auto& g : gauges) g.store(0, std::memory_order_relaxed);
+}
+
+Metrics::~Metrics() = default;
+
+Metrics::Slot& Metrics::local() {
+    // ids are never reused, so entries of destroyed instances are simply never matched again
+    thread_local std::vector<std::pair<uint64_t, Slot*>> cache;
+    for (const auto& e : cache) {
+        if (e.first == id) return *e.second;
+    }
+    std::lock_guard<std::mutex> lock(m);
+    slots.push_back(std::make_unique<Slot>());
+    cache.emplace_back(id, slots.back().get());
+    return *slots.back();
+}
+
+void Metrics::observe(Hist h, uint64_t micros) {
+    Slot& s = local();
+    size_t i = static_cast<size_t>(h);
+    bump(s.buckets[i][HistogramLayout::index(micros)], 1);
+    bump(s.sums[i], micros);
+    if (micros > s.maxes[i].load(std::memory_order_relaxed)) s.maxes[i].store(micros, std::memory_order_relaxed);
+}
+
+void Metrics::add(Counter c, uint64_t n) {
+    bump(local().counters[static_cast<size_t>(c)], n);
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot out;
+    out.uptimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::lock_guard<std::mutex> lock(m);
+    for (const auto& slot : slots) {
+        for (size_t h = 0; h < histCount; ++h) {
+            HistogramSnapshot& hs = out.histograms[h];
+            for (size_t b = 0; b < HistogramLayout::buckets; ++b) {
+                uint64_t n = slot->buckets[h][b].load(std::memory_order_relaxed);
+                hs.counts[b] += n;
+                hs.count += n;
+            }
+            hs.sum += slot->sums[h].load(std::memory_order_relaxed);
+            hs.max = std::max(hs.max, slot->maxes[h].load(std::memory_order_relaxed));
+        }
+        for (size_t c = 0; c < counterCount; ++c) out.counters[c] += slot->counters[c].load(std::memory_order_relaxed);
+    }
+    for (size_t g = 0; g < gaugeCount; ++g) out.gauges[g] = gauges[g].load(std::memory_order_relaxed);
+    return out;
+}
+
+void Metrics::writePrometheus(std::ostream& out, const MetricsSnapshot& s) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (size_t c = 0; c < counterCount; ++c) {
+        std::string name = std::string("scraper_") + metricName(static_cast<Counter>(c));
+        out << "# TYPE " << name << " counter\n" << name << " " << s.counters[c] << "\n";
+    }
+    for (size_t g = 0; g < gaugeCount; ++g) {
+        std::string name = std::string("scraper_") + metricName(static_cast<Gauge>(g));
+        out << "# TYPE " << name << " gauge\n" << name << " " << s.gauges[g] << "\n";
+    }
+    for (size_t h = 0; h < histCount; ++h) {
+        const HistogramSnapshot& hs = s.histograms[h];
+        std::string name = std::string("scraper_") + metricName(static_cast<Hist>(h));
+        out << "# TYPE " << name << " summary\n";
+        for (double q : quantiles)
+            out << name << "{quantile=\"" << q << "\"} " << hs.quantile(q) / 1e6 << "\n";
+        out << name << "_sum " << hs.sum / 1e6 << "\n" << name << "_count " << hs.count << "\n";
+    }
+    out << "# TYPE scraper_uptime_seconds gauge\nscraper_uptime_seconds " << s.uptimeSeconds << "\n";
+}
+
+void Metrics::writeJson(std::ostream& out, const MetricsSnapshot& s) {
+    auto now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    out << "{\"timestamp\":" << static_cast<long long>(now) << ",\"uptime_s\":" << s.uptimeSeconds << ",\"counters\":{";
+    for (size_t c = 0; c < counterCount; ++c)
+        out << (c ? "," : "") << "\"" << metricName(static_cast<Counter>(c)) << "\":" << s.counters[c];
+    out << "},\"gauges\":{";
+    for (size_t g = 0; g < gaugeCount; ++g)
+        out << (g ? "," : "") << "\"" << metricName(static_cast<Gauge>(g)) << "\":" << s.gauges[g];
+    out << "},\"histograms_us\":{";
+    for (size_t h = 0; h < histCount; ++h) {
+        const HistogramSnapshot& hs = s.histograms[h];
+        out << (h ? "," : "") << "\"" << metricName(static_cast<Hist>(h)) << "\":{\"count\":" << hs.count
+            << ",\"sum\":" << hs.sum << ",\"p50\":" << hs.quantile(0.5) << ",\"p90\":" << hs.quantile(0.9)
+            << ",\"p99\":" << hs.quantile(0.99) << ",\"max\":" << hs.max << "}";
+    }
+    out << "}}\n";
+}
+
+MetricsExporter::MetricsExporter(const Metrics& metrics, std::chrono::milliseconds interval,
+    std::string prometheus_path, std::string json_path)
+    : metrics(metrics), interval(std::max(interval, std::chrono::milliseconds(10))),
+    promPath(std::move(prometheus_path)), jsonPath(std::move(json_path)) {
+    worker = std::thread([this] {
+        std::unique_lock<std::mutex> lock(m);
+        while (!wake.wait_for(lock, this->interval, [this] { return stopping; })) {
+            lock.unlock();
+            writeNow();
+            lock.lock();
+        }
+    });
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    writeNow();
+}
+
+void MetricsExporter::writeNow() {
+    MetricsSnapshot s = metrics.snapshot();
+    if (!promPath.empty()) {
+        // replaced in one step, so a scraper never reads a half-written file
+        std::string tmp = promPath + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            Metrics::writePrometheus(out, s);
+        }
+#ifdef _WIN32
+        std::remove(promPath.c_str());
+#endif
+        if (std::rename(tmp.c_str(), promPath.c_str()) != 0) std::remove(tmp.c_str());
+    }
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath, std::ios::app);
+        Metrics::writeJson(out, s);
+    }
+}
@@ -0,0 +1,148 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// latency distributions, all in microseconds
+enum class Hist {
+    Dns,        // name lookup (new connections only)
+    Connect,    // TCP handshake (new connections only)
+    Tls,        // TLS handshake (new https connections only)
+    FirstByte,  // request sent until the first response byte
+    Transfer,   // first byte until the end of the body
+    Total,      // whole attempt as seen by curl
+    LinkStage,  // link extraction and frontier update of one page
+    ParseStage, // record parsing (incl. entity decoding) of one page
+    StoreStage, // storing the records of one page
+    Count_
+};
+
+enum class Counter {
+    Requests,      // attempts finished by curl
+    Failures,      // pages given up after the last retry
+    Retries,       // attempts scheduled again
+    BytesDown,     // body bytes received, as sent (compressed when the server encoded them)
+    BytesDecoded,  // body bytes handed to the sinks after content decoding
+    PagesParsed,
+    RecordsStored,
+    LinkAllocations,  // heap allocations made by the link stage (see Allocations.hpp)
+    ParseAllocations, // ... by the parse stage
+    StoreAllocations, // ... by the store stage
+    OversizePages,    // transfers aborted at the per-page size cap
+    Count_
+};
+
+enum class Gauge {
+    Downloading, // pages handed to the downloader and not yet delivered
+    Buffered,    // pages downloaded and not yet stored
+    BudgetBytes, // bytes charged to the pipeline's MemoryBudget
+    Count_
+};
+
+// Log-linear bucket layout in the spirit of HdrHistogram: values below 32 get exact buckets,
+// above that every power of two is split into 16 buckets (at most 6.25% relative error).
+// Values are capped at 2^40 us (~12 days).
+struct HistogramLayout {
+    static constexpr int subBits = 4;
+    static constexpr uint64_t subCount = uint64_t(1) << subBits;
+    static constexpr int maxBits = 40;
+    static constexpr size_t buckets = 2 * subCount + (maxBits - subBits - 1) * subCount;
+
+    static size_t index(uint64_t v);
+    static uint64_t lowerBound(size_t i);
+    static uint64_t upperBound(size_t i) { return i + 1 < buckets ? lowerBound(i + 1) - 1 : lowerBound(i); }
+};
+
+struct HistogramSnapshot {
+    std::array<uint64_t, HistogramLayout::buckets> counts{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    // upper bound of the bucket holding quantile q (0..1); 0 when empty
+    uint64_t quantile(double q) const;
+};
+
+struct MetricsSnapshot {
+    double uptimeSeconds = 0.0;
+    std::array<HistogramSnapshot, static_cast<size_t>(Hist::Count_)> histograms;
+    std::array<uint64_t, static_cast<size_t>(Counter::Count_)> counters{};
+    std::array<int64_t, static_cast<size_t>(Gauge::Count_)> gauges{};
+};
+
+const char* metricName(Hist h);
+const char* metricName(Counter c);
+const char* metricName(Gauge g);
+
+// Hot-path metrics. Every thread records into its own slot (found through a thread_local
+// cache, allocated on the thread's first use), so recording is a few uncontended relaxed
+// stores and no cache line is shared between writers. snapshot() sums the slots; it may run
+// concurrently with recording and then sees each value either before or after an update.
+class Metrics {
+public:
+    Metrics();
+    ~Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void observe(Hist h, uint64_t micros);
+    void observe(Hist h, std::chrono::steady_clock::duration d) {
+        observe(h, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+    }
+    void add(Counter c, uint64_t n = 1);
+    void set(Gauge g, int64_t value) { gauges[static_cast<size_t>(g)].store(value, std::memory_order_relaxed); }
+
+    MetricsSnapshot snapshot() const;
+
+    // Prometheus text exposition format: counters, gauges, and summaries with
+    // 0.5/0.9/0.99/0.999 quantiles in seconds
+    static void writePrometheus(std::ostream& out, const MetricsSnapshot& s);
+    // one JSON object on a single line
+    static void writeJson(std::ostream& out, const MetricsSnapshot& s);
+
+private:
+    struct Slot;
+
+    const uint64_t id;
+    std::chrono::steady_clock::time_point started;
+    std::array<std::atomic<int64_t>, static_cast<size_t>(Gauge::Count_)> gauges{};
+    mutable std::mutex m;
+    std::deque<std::unique_ptr<Slot>> slots;
+
+    Slot& local();
+};
+
+// Writes a snapshot every interval while a run goes on: the Prometheus file is replaced
+// (for a node_exporter textfile collector or a scrape via a static file server), JSON
+// snapshots are appended one per line. A last snapshot is written on destruction.
+class MetricsExporter {
+public:
+    MetricsExporter(const Metrics& metrics, std::chrono::milliseconds interval,
+        std::string prometheus_path, std::string json_path);
+    ~MetricsExporter();
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void writeNow();
+
+private:
+    const Metrics& metrics;
+    std::chrono::milliseconds interval;
+    std::string promPath;
+    std::string jsonPath;
+    std::mutex m;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+};
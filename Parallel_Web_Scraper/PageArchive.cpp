@@ -0,0 +1,359 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 02:00
+
+#include "PageArchive.hpp"
+#include "Log.hpp"
+#include "ParseCache.hpp"
+
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <limits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// the index: magic, then one 16-byte entry per record in host byte order (little-endian on
+// every target of this project); an all-zero entry is a slot whose record was never written
+static const char indexMagic[8] = { 'P', 'W', 'S', 'A', 'R', 'C', '1', '\0' };
+static constexpr size_t indexEntryBytes = 16;
+
+// ------------------ Positional file -------------------
+// Writes at explicit offsets (pwrite / overlapped WriteFile), so concurrent writers to
+// disjoint ranges need neither a lock nor a shared file position.
+class PageArchive::File {
+public:
+    ~File() {
+#ifdef _WIN32
+        if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+#else
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    bool open(const std::string& path, bool truncate) {
+#ifdef _WIN32
+        handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(handle, &size)) return false;
+        bytes = static_cast<uint64_t>(size.QuadPart);
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        bytes = static_cast<uint64_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    // size when it was opened
+    uint64_t size() const { return bytes; }
+
+    bool writeAt(uint64_t offset, const void* src, size_t n) {
+        const char* p = static_cast<const char*>(src);
+        while (n > 0) {
+#ifdef _WIN32
+            OVERLAPPED at = {};
+            at.Offset = static_cast<DWORD>(offset);
+            at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(n, 1u << 30));
+            DWORD written = 0;
+            if (!WriteFile(handle, p, chunk, &written, &at) || written == 0) return false;
+#else
+            ssize_t written = ::pwrite(fd, p, n, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+#endif
+            p += written;
+            n -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+    uint64_t bytes = 0;
+};
+
+struct PageArchive::Record {
+    std::string url;
+    std::string headers;
+    std::string body;
+    std::chrono::system_clock::time_point fetched;
+};
+
+// ------------------ Writer -------------------
+PageArchive::PageArchive(std::string dir)
+    : dir(std::move(dir)), arena(tbb::this_task_arena::max_concurrency(), 0) {
+    // a graph spawns its tasks into the arena it was constructed in
+    arena.execute([this] {
+        graph.reset(new tbb::flow::graph);
+        writer.reset(new tbb::flow::function_node<Record*>(*graph, tbb::flow::unlimited,
+            [this](Record* r) {
+                std::unique_ptr<Record> owned(r);
+                write(*owned);
+                if (budget) budget->release(owned->body.size());
+            }));
+        });
+}
+
+PageArchive::~PageArchive() {
+    flush();
+}
+
+bool PageArchive::open(bool truncate) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    data.reset(new File);
+    index.reset(new File);
+    if (!data->open((fs::path(dir) / "pages.warc.gz").string(), truncate) ||
+        !index->open((fs::path(dir) / "pages.idx").string(), truncate)) {
+        LOG_ERROR("PageArchive", "Cannot write an archive in {}", dir);
+        data.reset();
+        index.reset();
+        return false;
+    }
+    uint64_t indexBytes = index->size();
+    if (indexBytes < sizeof(indexMagic)) {
+        // new (or truncated) archive: records are only trusted behind a complete index header
+        if (!index->writeAt(0, indexMagic, sizeof(indexMagic))) return false;
+        indexBytes = sizeof(indexMagic);
+    }
+    // continuing: new records go after the existing ones; a slot cut short by a crash is dropped
+    slots = (indexBytes - sizeof(indexMagic)) / indexEntryBytes;
+    dataEnd = data->size();
+    if (slots > 0) LOG_INFO("PageArchive", "Continuing {} with {} records", dir, slots.load());
+    return true;
+}
+
+void PageArchive::append(std::string url, std::string headers, std::string body) {
+    if (!data) return;
+    if (budget) budget->charge(body.size());
+    writer->try_put(new Record{ std::move(url), std::move(headers), std::move(body), std::chrono::system_clock::now() });
+}
+
+void PageArchive::flush() {
+    if (graph) arena.execute([this] { graph->wait_for_all(); });
+}
+
+ArchiveStats PageArchive::stats() const {
+    ArchiveStats st;
+    st.records = static_cast<size_t>(slots.load());
+    st.rawBytes = rawBytes.load();
+    st.storedBytes = static_cast<size_t>(dataEnd.load());
+    st.failed = failed.load();
+    return st;
+}
+
+// WARC-Date: UTC, second precision
+static std::string warcDate(std::chrono::system_clock::time_point at) {
+    std::time_t t = std::chrono::system_clock::to_time_t(at);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &t);
+#else
+    gmtime_r(&t, &utc);
+#endif
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return buf;
+}
+
+// random-looking (version 4 layout) record id; unique per URL, body and moment of capture
+static std::string recordId(const std::string& url, const std::string& body, uint64_t nanos) {
+    uint64_t hi = contentHash(url, nanos);
+    uint64_t lo = contentHash(body, hi);
+    hi = (hi & ~0xF000ull) | 0x4000ull;
+    lo = (lo & ~(3ull << 62)) | (2ull << 62);
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%012llx",
+        static_cast<unsigned>(hi >> 32), static_cast<unsigned>((hi >> 16) & 0xFFFF),
+        static_cast<unsigned>(hi & 0xFFFF), static_cast<unsigned>(lo >> 48),
+        static_cast<unsigned long long>(lo & 0xFFFFFFFFFFFFull));
+    return buf;
+}
+
+void PageArchive::write(const Record& r) {
+    uint64_t nanos = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(r.fetched.time_since_epoch()).count());
+    // the record block is the HTTP response: header lines, blank line, body
+    size_t block = r.headers.size() + 2 + r.body.size();
+    std::string head;
+    head.reserve(256 + r.url.size());
+    head += "WARC/1.0\r\nWARC-Type: response\r\nWARC-Record-ID: <urn:uuid:";
+    head += recordId(r.url, r.body, nanos);
+    head += ">\r\nWARC-Date: ";
+    head += warcDate(r.fetched);
+    head += "\r\nWARC-Target-URI: ";
+    head += r.url;
+    head += "\r\nContent-Type: application/http;msgtype=response\r\nContent-Length: ";
+    head += std::to_string(block);
+    head += "\r\n\r\n";
+    static const char crlf[] = "\r\n\r\n";
+    size_t raw = head.size() + block + 4;
+    if (raw > std::numeric_limits<uint32_t>::max()) {
+        LOG_RATE(LogLevel::Warn, 1000, "PageArchive", "{} is too large to archive", r.url);
+        ++failed;
+        return;
+    }
+
+    // each record is a gzip member of its own; level 1, since this runs next to the crawl
+    z_stream z{};
+    if (deflateInit2(&z, 1, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        ++failed;
+        return;
+    }
+    std::string out(deflateBound(&z, static_cast<uLong>(raw)), '\0');
+    z.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    z.avail_out = static_cast<uInt>(out.size());
+    auto feed = [&z](const char* p, size_t n, int flush) {
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(p));
+        z.avail_in = static_cast<uInt>(n);
+        return deflate(&z, flush);
+    };
+    feed(head.data(), head.size(), Z_NO_FLUSH);
+    feed(r.headers.data(), r.headers.size(), Z_NO_FLUSH);
+    feed(crlf, 2, Z_NO_FLUSH);
+    feed(r.body.data(), r.body.size(), Z_NO_FLUSH);
+    int rc = feed(crlf, 4, Z_FINISH);
+    size_t stored = z.total_out;
+    deflateEnd(&z);
+    if (rc != Z_STREAM_END) {
+        ++failed;
+        return;
+    }
+
+    // reserve the byte range and the index slot, then write both without a lock
+    uint64_t offset = dataEnd.fetch_add(stored);
+    uint64_t slot = slots.fetch_add(1);
+    char entry[indexEntryBytes];
+    uint32_t stored32 = static_cast<uint32_t>(stored), raw32 = static_cast<uint32_t>(raw);
+    std::memcpy(entry, &offset, 8);
+    std::memcpy(entry + 8, &stored32, 4);
+    std::memcpy(entry + 12, &raw32, 4);
+    if (!data->writeAt(offset, out.data(), stored) ||
+        !index->writeAt(sizeof(indexMagic) + slot * indexEntryBytes, entry, sizeof(entry))) {
+        LOG_RATE(LogLevel::Error, 1000, "PageArchive", "Write failed for {} in {}", r.url, dir);
+        ++failed;
+        return;
+    }
+    rawBytes += raw;
+}
+
+static bool equalsNoCase(const char* a, const char* b) {
+    for (; *a && *b; ++a, ++b) {
+        if (std::tolower(static_cast<unsigned char>(*a)) != std::tolower(static_cast<unsigned char>(*b))) return false;
+    }
+    return *a == *b;
+}
+
+std::string PageArchive::responseHeaders(CURL* curl, long response_code, size_t body_size) {
+    long version = 0;
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+    const char* protocol = version == CURL_HTTP_VERSION_2_0 ? "HTTP/2"
+        : version == CURL_HTTP_VERSION_3 ? "HTTP/3"
+        : version == CURL_HTTP_VERSION_1_0 ? "HTTP/1.0" : "HTTP/1.1";
+    // a 304 was answered with the cached body, so the archive holds it as the 200 it stands for
+    long status = response_code == 304 ? 200 : response_code;
+    std::string headers = std::string(protocol) + " " + std::to_string(status) + (status == 200 ? " OK" : "") + "\r\n";
+
+    // headers of the last request, i.e. the final response after redirects
+    curl_header* prev = nullptr;
+    while (curl_header* h = curl_easy_nextheader(curl, CURLH_HEADER, -1, prev)) {
+        prev = h;
+        // the body is stored decoded and whole
+        if (equalsNoCase(h->name, "Content-Encoding") || equalsNoCase(h->name, "Transfer-Encoding") ||
+            equalsNoCase(h->name, "Content-Length")) continue;
+        headers += h->name;
+        headers += ": ";
+        headers += h->value;
+        headers += "\r\n";
+    }
+    headers += "Content-Length: " + std::to_string(body_size) + "\r\n";
+    return headers;
+}
+
+// ------------------ Reader -------------------
+bool ArchiveReader::open(const std::string& dir) {
+    data = MappedBody::open((fs::path(dir) / "pages.warc.gz").string());
+    auto idx = MappedBody::open((fs::path(dir) / "pages.idx").string());
+    if (!data || !idx) {
+        LOG_ERROR("ArchiveReader", "No archive in {}", dir);
+        return false;
+    }
+    std::string_view view = idx->view();
+    if (view.size() < sizeof(indexMagic) || std::memcmp(view.data(), indexMagic, sizeof(indexMagic)) != 0) {
+        LOG_ERROR("ArchiveReader", "{} is not an archive index", dir);
+        return false;
+    }
+    entries.clear();
+    size_t total = data->view().size();
+    for (size_t pos = sizeof(indexMagic); pos + indexEntryBytes <= view.size(); pos += indexEntryBytes) {
+        Entry e;
+        std::memcpy(&e.offset, view.data() + pos, 8);
+        std::memcpy(&e.stored, view.data() + pos + 8, 4);
+        std::memcpy(&e.raw, view.data() + pos + 12, 4);
+        if (e.stored == 0 || e.offset + e.stored > total) continue; // never written
+        entries.push_back(e);
+    }
+    // file order, so a replay walks the mapping front to back
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+    return true;
+}
+
+size_t ArchiveReader::storedBytes() const {
+    return data ? data->view().size() : 0;
+}
+
+bool ArchiveReader::read(size_t i, std::string& scratch, std::string_view& url, std::string_view& payload) const {
+    const Entry& e = entries[i];
+    scratch.resize(e.raw);
+    z_stream z{};
+    if (inflateInit2(&z, 15 + 16) != Z_OK) return false;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data->view().data() + e.offset));
+    z.avail_in = e.stored;
+    z.next_out = reinterpret_cast<Bytef*>(&scratch[0]);
+    z.avail_out = e.raw;
+    int rc = inflate(&z, Z_FINISH);
+    inflateEnd(&z);
+    if (rc != Z_STREAM_END || z.total_out != e.raw) return false;
+
+    // WARC header, then the HTTP response: its header, then the body up to the record's CRLFCRLF
+    std::string_view rec(scratch);
+    size_t warcEnd = rec.find("\r\n\r\n");
+    if (warcEnd == std::string_view::npos) return false;
+    static const char uriField[] = "\r\nWARC-Target-URI: ";
+    size_t u = rec.substr(0, warcEnd).find(uriField);
+    if (u == std::string_view::npos) return false;
+    u += sizeof(uriField) - 1;
+    url = rec.substr(u, rec.find("\r\n", u) - u);
+    size_t httpEnd = rec.find("\r\n\r\n", warcEnd + 4);
+    if (httpEnd == std::string_view::npos || rec.size() < httpEnd + 4 + 4) return false;
+    payload = rec.substr(httpEnd + 4, rec.size() - 4 - (httpEnd + 4));
+    return true;
+}
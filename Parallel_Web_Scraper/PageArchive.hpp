@@ -0,0 +1,98 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 02:00
+
+#pragma once
+#include "MemoryBudget.hpp"
+#include "ResponseCache.hpp"
+
+#include <tbb/flow_graph.h>
+#include <tbb/task_arena.h>
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ArchiveStats {
+    size_t records = 0;     // responses in the archive, including ones from earlier runs
+    size_t rawBytes = 0;    // WARC records before compression
+    size_t storedBytes = 0; // size of the .warc.gz
+    size_t failed = 0;      // records that could not be written
+};
+
+// Append-only archive of the raw responses of a run, so the dataset can be analysed again
+// offline. <dir>/pages.warc.gz holds one WARC/1.0 response record per page (URL, timestamp,
+// the HTTP status line and headers, the body), each compressed as its own gzip member, so
+// the file is a regular .warc.gz and any record can be inflated on its own.
+// <dir>/pages.idx holds the offset and sizes of every record. append() is thread-safe:
+// a record reserves its file range and index slot with two atomic additions and is then
+// written with positional writes, so compressing and writing pages never serializes
+// the download threads. Compression runs as a TBB task, off the caller's thread; curl hands
+// over decoded bodies, so they are compressed again (zlib level 1) rather than kept as sent.
+class PageArchive {
+public:
+    explicit PageArchive(std::string dir);
+    ~PageArchive(); // waits for the queued records
+    PageArchive(const PageArchive&) = delete;
+    PageArchive& operator=(const PageArchive&) = delete;
+
+    // start a new archive (truncate = true) or continue the one in dir
+    bool open(bool truncate);
+    // headers: the HTTP status line and header lines, each ending in CRLF, without the blank line
+    void append(std::string url, std::string headers, std::string body);
+    // block until every appended record is on disk
+    void flush();
+    ArchiveStats stats() const;
+    const std::string& directory() const { return dir; }
+    // queued bodies are charged until they have been written; set before the first append
+    void setBudget(MemoryBudget* memory_budget) { budget = memory_budget; }
+
+    // the HTTP header block of the response curl just finished, as archived: the final
+    // response after redirects, without the transfer and content codings that curl removed
+    static std::string responseHeaders(CURL* curl, long response_code, size_t body_size);
+
+private:
+    class File;
+    struct Record;
+    std::string dir;
+    std::unique_ptr<File> data;
+    std::unique_ptr<File> index;
+    std::atomic<uint64_t> dataEnd{ 0 };
+    std::atomic<uint64_t> slots{ 0 };
+    std::atomic<size_t> rawBytes{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    MemoryBudget* budget = nullptr;
+    // records are compressed and written by graph tasks: a try_put from the downloader's
+    // I/O thread never blocks
+    tbb::task_arena arena;
+    std::unique_ptr<tbb::flow::graph> graph;
+    std::unique_ptr<tbb::flow::function_node<Record*>> writer;
+
+    void write(const Record& r);
+};
+
+// Memory-mapped archive written by PageArchive. The index is read once; records are inflated
+// on demand, so any number of threads can read different records at the same time.
+class ArchiveReader {
+public:
+    bool open(const std::string& dir);
+    size_t size() const { return entries.size(); }
+    // compressed bytes of the archive
+    size_t storedBytes() const;
+    // inflates record i into scratch; url and payload (the response body) point into it
+    bool read(size_t i, std::string& scratch, std::string_view& url, std::string_view& payload) const;
+
+private:
+    struct Entry {
+        uint64_t offset;
+        uint32_t stored;
+        uint32_t raw;
+    };
+    std::shared_ptr<MappedBody> data;
+    std::vector<Entry> entries;
+};
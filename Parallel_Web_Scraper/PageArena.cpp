@@ -0,0 +1,53 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 23:40
+
+#include "PageArena.hpp"
+#include <algorithm>
+#include <cstring>
+
+// an arena never keeps more than this across pages, whatever one page needed
+static constexpr size_t maxKeptBytes = 1 << 20;
+
+PageArena::PageArena(size_t initial_size)
+    : block(new char[std::max<size_t>(initial_size, 64)]), blockSize(std::max<size_t>(initial_size, 64)) {
+}
+
+std::string_view PageArena::store(std::string_view s) {
+    if (s.empty()) return std::string_view();
+    char* data;
+    if (blockSize - used >= s.size()) {
+        data = block.get() + used;
+        used += s.size();
+    }
+    else {
+        if (overflowLeft < s.size()) {
+            size_t size = std::max(s.size(), blockSize);
+            overflow.emplace_back(new char[size]);
+            overflowNext = overflow.back().get();
+            overflowLeft = size;
+        }
+        data = overflowNext;
+        overflowNext += s.size();
+        overflowLeft -= s.size();
+        overflowBytes += s.size();
+    }
+    std::memcpy(data, s.data(), s.size());
+    return std::string_view(data, s.size());
+}
+
+void PageArena::reset() {
+    if (!overflow.empty()) {
+        // next time everything this page needed fits in the main block
+        size_t size = std::min(used + overflowBytes, maxKeptBytes);
+        if (size > blockSize) {
+            block.reset(new char[size]);
+            blockSize = size;
+        }
+        overflow.clear();
+    }
+    used = 0;
+    overflowBytes = 0;
+    overflowNext = nullptr;
+    overflowLeft = 0;
+}
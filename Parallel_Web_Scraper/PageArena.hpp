@@ -0,0 +1,36 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 23:40
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Monotonic arena for the transient bytes of one page (decoded titles). Stores only bump a
+// pointer; reset() forgets everything at once but keeps the memory, grown to what the
+// largest page needed, so a warmed-up arena does not allocate at all. Not thread-safe:
+// one page is parsed by one thread at a time.
+class PageArena {
+public:
+    explicit PageArena(size_t initial_size = 4096);
+    PageArena(const PageArena&) = delete;
+    PageArena& operator=(const PageArena&) = delete;
+
+    // copy of s, valid until reset()
+    std::string_view store(std::string_view s);
+    void reset();
+    size_t bytesUsed() const { return used + overflowBytes; }
+    size_t capacity() const { return blockSize; }
+
+private:
+    std::unique_ptr<char[]> block;
+    size_t blockSize;
+    size_t used = 0;
+    // blocks taken once the main one was full; merged into it by reset()
+    std::vector<std::unique_ptr<char[]>> overflow;
+    size_t overflowBytes = 0;
+    char* overflowNext = nullptr;
+    size_t overflowLeft = 0;
+};
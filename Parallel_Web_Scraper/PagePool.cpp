@@ -0,0 +1,98 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 05:30
+
+#include "PagePool.hpp"
+#include <algorithm>
+
+void Page::onData(std::string_view chunk) {
+    if (!streamed) {
+        body.append(chunk.data(), chunk.size());
+    }
+    else {
+        parser.feed(chunk);
+        if (collectLinks) linkExtractor.feed(chunk);
+    }
+    account();
+}
+
+void Page::onMapped(std::shared_ptr<MappedBody> whole) {
+    if (streamed) onData(whole->view()); // the parser reads it in place either way
+    else mapped = std::move(whole);
+}
+
+void Page::onRestart() {
+    body.clear();
+    mapped.reset();
+    parser.reset();
+    linkExtractor.reset();
+    account();
+}
+
+void Page::onExpectedSize(uint64_t bytes) {
+    if (!streamed) body.reserve(static_cast<size_t>(std::min(bytes, maxPresize)));
+}
+
+void Page::account() {
+    if (!budget) return;
+    size_t held = body.size() + parser.heldBytes();
+    if (held > charged) budget->charge(held - charged);
+    else budget->release(charged - held);
+    charged = held;
+}
+
+void Page::clear(size_t maxBodyBytes) {
+    if (budget) budget->release(charged);
+    budget = nullptr;
+    charged = 0;
+    if (body.capacity() > maxBodyBytes) std::string().swap(body);
+    else body.clear();
+    mapped.reset();
+    parser.reset();
+    linkExtractor.reset();
+    links.clear();
+    streamed = false;
+    collectLinks = false;
+    ok = false;
+}
+
+PagePool::PagePool(size_t max_idle, size_t max_body_bytes)
+    : maxIdle(max_idle), maxBodyBytes(max_body_bytes) {
+}
+
+PagePool::~PagePool() {
+    for (Page* page : idle) delete page;
+}
+
+PagePool::Handle PagePool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (!idle.empty()) {
+            Page* page = idle.back();
+            idle.pop_back();
+            reused.fetch_add(1, std::memory_order_relaxed);
+            return adopt(page);
+        }
+    }
+    created.fetch_add(1, std::memory_order_relaxed);
+    return adopt(new Page);
+}
+
+void PagePool::release(Page* page) {
+    page->clear(maxBodyBytes);
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (idle.size() < maxIdle) {
+            idle.push_back(page);
+            return;
+        }
+    }
+    delete page;
+}
+
+PagePoolStats PagePool::stats() const {
+    PagePoolStats s;
+    s.created = created.load(std::memory_order_relaxed);
+    s.reused = reused.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,86 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 05:30
+
+#pragma once
+#include "Analyzer.hpp"
+#include "CrawlFrontier.hpp"
+#include "Downloader.hpp"
+#include "MemoryBudget.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Everything the pipeline keeps for one page. As the body target of a transfer it either
+// buffers the body or (streamed) feeds the parser and link extractor chunk by chunk.
+// Pages are recycled through a PagePool: the body buffer, the parser's window, arena and
+// record array and the link list keep their capacity from one page to the next.
+struct Page : BodySink {
+    CrawlFrontier::Item item;
+    std::string body;
+    std::shared_ptr<MappedBody> mapped; // the body when it came from the response cache
+    PageParser parser;
+    LinkExtractor linkExtractor;
+    std::vector<std::string> links;
+    bool streamed = false;     // parsed while it arrived
+    bool collectLinks = false; // streamed page of a crawl that follows its links
+    bool ok = false;           // downloaded; a failed page stays pending in a checkpoint
+    MemoryBudget* budget = nullptr; // charged with what the page holds, nullptr = not accounted
+    size_t charged = 0;
+
+    void onData(std::string_view chunk) override;
+    void onRestart() override;
+    void onExpectedSize(uint64_t bytes) override;
+    void onMapped(std::shared_ptr<MappedBody> body) override;
+    // the downloaded body, buffered or mapped; empty for a streamed page
+    std::string_view text() const { return mapped ? mapped->view() : std::string_view(body); }
+    // brings the budget's charge up (or down) to the body and parser bytes held now (a mapped
+    // body is page cache, not heap, and is not charged);
+    // called as data arrives and after parsing. Sizes, not capacities: the buffers a
+    // recycled page keeps are bounded by the pool instead.
+    void account();
+    // ready for the next page; a body buffer above maxBodyBytes is given back and the
+    // budget's charge released
+    void clear(size_t maxBodyBytes = 4 * 1024 * 1024);
+};
+
+struct PagePoolStats {
+    size_t created = 0; // pages that had to be allocated
+    size_t reused = 0;  // pages handed out again
+};
+
+// Free list of pages. acquire() hands out a move-only handle that puts the page back when
+// it goes away; at most maxIdle pages are kept.
+class PagePool {
+public:
+    struct Return {
+        PagePool* pool = nullptr;
+        void operator()(Page* page) const { pool->release(page); }
+    };
+    using Handle = std::unique_ptr<Page, Return>;
+
+    explicit PagePool(size_t max_idle, size_t max_body_bytes = 4 * 1024 * 1024);
+    ~PagePool();
+    PagePool(const PagePool&) = delete;
+    PagePool& operator=(const PagePool&) = delete;
+
+    // thread-safe
+    Handle acquire();
+    // takes a page back under a handle after it travelled as a raw pointer
+    // (flow graph messages are copied, so they carry Page* instead of the handle)
+    Handle adopt(Page* page) { return Handle(page, Return{ this }); }
+    PagePoolStats stats() const;
+
+private:
+    size_t maxIdle;
+    size_t maxBodyBytes;
+    std::mutex m;
+    std::vector<Page*> idle;
+    std::atomic<size_t> created{ 0 };
+    std::atomic<size_t> reused{ 0 };
+
+    void release(Page* page);
+};
@@ -0,0 +1,182 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:40
+
+#include "ParseCache.hpp"
+#include <algorithm>
+#include <cstring>
+
+// ------------------ XXH64 -------------------
+static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// little-endian reads; every target of this project is little-endian
+static inline uint64_t read64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * prime2;
+    return rotl(acc, 31) * prime1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t v) {
+    acc ^= round64(0, v);
+    return acc * prime1 + prime4;
+}
+
+uint64_t contentHash(std::string_view data, uint64_t seed) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+    uint64_t h;
+    if (data.size() >= 32) {
+        uint64_t v1 = seed + prime1 + prime2, v2 = seed + prime2, v3 = seed, v4 = seed - prime1;
+        const char* limit = end - 32;
+        do { // four independent lanes, 32 bytes per iteration
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else {
+        h = seed + prime5;
+    }
+    h += static_cast<uint64_t>(data.size());
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ round64(0, read64(p)), 27) * prime1 + prime4;
+    if (p + 4 <= end) {
+        h = rotl(h ^ (static_cast<uint64_t>(read32(p)) * prime1), 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) h = rotl(h ^ (static_cast<uint8_t>(*p) * prime5), 11) * prime1;
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ------------------ ParseCache -------------------
+ParseCache::ParseCache(size_t max_entries, size_t max_bytes, size_t shard_count)
+    : shardCount(std::clamp<size_t>(shard_count, 1, std::max<size_t>(max_entries, 1))) {
+    shards.reset(new Shard[shardCount]);
+    maxEntries = std::max<size_t>((max_entries + shardCount - 1) / shardCount, 1);
+    maxBytes = max_bytes ? std::max<size_t>(max_bytes / shardCount, 1) : 0;
+}
+
+ParseCache::Key ParseCache::key(std::string_view body) const {
+    Key k;
+    k.body = body.size();
+    if (volatileRegions.empty()) {
+        k.hash = contentHash(body);
+        k.length = body.size();
+        return k;
+    }
+    // the stable stretches are chained through the seed, so nothing is copied
+    size_t pos = 0;
+    while (pos < body.size()) {
+        size_t cut = std::string_view::npos, resume = body.size();
+        for (const auto& r : volatileRegions) {
+            if (r.begin.empty()) continue;
+            size_t b = body.find(r.begin, pos);
+            if (b == std::string_view::npos || b >= cut) continue;
+            size_t e = r.end.empty() ? std::string_view::npos : body.find(r.end, b + r.begin.size());
+            cut = b;
+            resume = e == std::string_view::npos ? body.size() : e + r.end.size();
+        }
+        std::string_view stable = body.substr(pos, cut == std::string_view::npos ? std::string_view::npos : cut - pos);
+        k.hash = contentHash(stable, k.hash);
+        k.length += stable.size();
+        if (cut == std::string_view::npos) break;
+        pos = resume;
+    }
+    return k;
+}
+
+bool ParseCache::lookup(const Key& k, PageParser& parser) {
+    std::shared_ptr<const Memo> memo;
+    {
+        Shard& s = shardOf(k.hash);
+        std::lock_guard<std::mutex> lock(s.m);
+        auto it = s.byHash.find(k.hash);
+        if (it != s.byHash.end() && it->second->second->length == k.length) {
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            memo = it->second->second;
+        }
+    }
+    if (!memo) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    parser.restore(memo->records, memo->result, k.body); // copied outside the lock
+    return true;
+}
+
+void ParseCache::insert(const Key& k, const PageParser& parser) {
+    auto memo = std::make_shared<Memo>();
+    const std::vector<BookView>& records = parser.parsedRecords();
+    size_t titleBytes = 0;
+    for (const auto& r : records) titleBytes += r.title.size();
+    memo->titles.reserve(titleBytes); // no reallocation below, the views stay valid
+    memo->records.reserve(records.size());
+    for (const auto& r : records) {
+        const char* at = memo->titles.data() + memo->titles.size();
+        memo->titles.append(r.title.data(), r.title.size());
+        memo->records.push_back(BookView{ std::string_view(at, r.title.size()), r.price, r.rating });
+    }
+    memo->result = parser.parsedResult();
+    memo->length = k.length;
+    size_t bytes = memo->bytes();
+
+    Shard& s = shardOf(k.hash);
+    std::lock_guard<std::mutex> lock(s.m);
+    auto it = s.byHash.find(k.hash);
+    if (it != s.byHash.end()) { // parsed twice at once, or a hash collision: the newer wins
+        s.bytes -= it->second->second->bytes();
+        s.lru.erase(it->second);
+        s.byHash.erase(it);
+    }
+    s.lru.emplace_front(k.hash, std::move(memo));
+    s.byHash[k.hash] = s.lru.begin();
+    s.bytes += bytes;
+    while (s.lru.size() > 1 && (s.lru.size() > maxEntries || (maxBytes && s.bytes > maxBytes))) {
+        s.bytes -= s.lru.back().second->bytes();
+        s.byHash.erase(s.lru.back().first);
+        s.lru.pop_back();
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ParseCacheStats ParseCache::stats() const {
+    ParseCacheStats st;
+    st.hits = hits.load(std::memory_order_relaxed);
+    st.misses = misses.load(std::memory_order_relaxed);
+    st.evictions = evictions.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].m);
+        st.entries += shards[i].lru.size();
+        st.bytes += shards[i].bytes;
+    }
+    return st;
+}
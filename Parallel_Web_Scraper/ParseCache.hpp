@@ -0,0 +1,95 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:40
+
+#pragma once
+#include "Analyzer.hpp"
+#include "Common.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct ParseCacheStats {
+    size_t hits = 0;      // pages answered from the cache, not parsed
+    size_t misses = 0;    // pages parsed (and stored)
+    size_t evictions = 0; // entries dropped by the LRU limits
+    size_t entries = 0;
+    size_t bytes = 0;     // titles and records held
+};
+
+// Part of a page that changes between fetches of the same content (a timestamp, a session
+// token, an ad slot): from each occurrence of begin up to and including the next end.
+struct VolatileRegion {
+    std::string begin;
+    std::string end;
+};
+
+// 64-bit xxHash (XXH64) of data; 8 bytes per step, so far faster than FNV on whole pages
+uint64_t contentHash(std::string_view data, uint64_t seed = 0);
+
+// Memoized Analyzer results keyed by the content of the page: identical bodies (a repeated
+// catalogue page, mirror URLs, the serial pass over pages the pipeline already parsed) are
+// answered with the stored records and aggregate instead of being parsed again. The key is
+// the XXH64 of the body with the volatile regions left out, plus the length of what was
+// hashed. A volatile region must not contain records, or a changed page would be answered
+// with the old ones. The cache is split into shards, each with its own lock and LRU list;
+// max_entries and max_bytes (0 = none) are divided among them, so eviction is LRU within
+// a shard. Thread-safe.
+class ParseCache {
+public:
+    struct Key {
+        uint64_t hash = 0;
+        size_t length = 0; // bytes hashed
+        size_t body = 0;   // bytes of the page
+    };
+
+    explicit ParseCache(size_t max_entries, size_t max_bytes = 0, size_t shards = 16);
+    ParseCache(const ParseCache&) = delete;
+    ParseCache& operator=(const ParseCache&) = delete;
+
+    // set before the cache is used
+    void setVolatileRegions(std::vector<VolatileRegion> regions) { volatileRegions = std::move(regions); }
+    Key key(std::string_view body) const;
+    // loads the page stored under k into parser (as if it had been fed); false on a miss
+    bool lookup(const Key& k, PageParser& parser);
+    // stores what parser holds for the page of k
+    void insert(const Key& k, const PageParser& parser);
+    ParseCacheStats stats() const;
+
+private:
+    // one page's records; the views point into titles
+    struct Memo {
+        std::string titles;
+        std::vector<BookView> records;
+        AnalysisResult result;
+        size_t length = 0; // hashed bytes, checked against the key
+        size_t bytes() const {
+            return sizeof(Memo) + titles.size() + records.size() * sizeof(BookView) + result.maxPriceTitle.size();
+        }
+    };
+    using Entry = std::pair<uint64_t, std::shared_ptr<const Memo>>;
+    struct Shard {
+        std::mutex m;
+        std::list<Entry> lru; // most recently used at the front
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> byHash;
+        size_t bytes = 0;
+    };
+
+    std::vector<VolatileRegion> volatileRegions;
+    std::unique_ptr<Shard[]> shards;
+    size_t shardCount;
+    size_t maxEntries; // per shard
+    size_t maxBytes;   // per shard, 0 = none
+    std::atomic<size_t> hits{ 0 };
+    std::atomic<size_t> misses{ 0 };
+    std::atomic<size_t> evictions{ 0 };
+
+    Shard& shardOf(uint64_t hash) { return shards[(hash >> 32) % shardCount]; }
+};
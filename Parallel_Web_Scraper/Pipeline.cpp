@@ -0,0 +1,357 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 05:30
+
+#include "Pipeline.hpp"
+#include "Allocations.hpp"
+#include "AsyncDownloader.hpp"
+#include "CrawlCheckpoint.hpp"
+#include "Log.hpp"
+#include "PagePool.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/flow_graph.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+
+// ------------------ Serial run -------------------
+Result runSerial(const std::vector<std::string>& urls,
+    Downloader& downloader,
+    Analyzer& analyzer,
+    Storage& storage,
+    std::ostream& out,
+    bool streamParse) {
+    auto start = std::chrono::steady_clock::now();
+
+    Page page; // one page's buffers, reused for every url
+    for (const auto& url : urls) {
+        try {
+            page.clear();
+            page.streamed = streamParse;
+            if (!downloader.downloadPage(url, page) || (!streamParse && page.text().empty())) {
+                LOG_RATE(LogLevel::Warn, 1000, "serial", "Failed to download: {}", url);
+                continue;
+            }
+            if (streamParse) {
+                LOG_DEBUG("serial", "Downloaded and parsed {} (length={})", url, page.parser.bytesFed());
+            }
+            else {
+                LOG_DEBUG("serial", "Downloaded {} (length={})", url, page.text().size());
+                analyzer.parsePage(page.text(), page.parser);
+            }
+            storage.storeResult(page.parser.parsedResult());
+            storage.storeRecords(page.parser.parsedRecords());
+            storage.incrementPagesProcessed();
+        }
+        catch (const std::exception& ex) {
+            LOG_ERROR("serial", "Exception: {} for {}", ex.what(), url);
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    int pages = storage.pagesProcessed();
+    AnalysisResult total = storage.getAggregatedResult();
+    double avgPrice = (total.bookCount ? total.totalPrice / total.bookCount : 0.0);
+    double throughput = (seconds > 0.0 ? pages / seconds : pages);
+
+    out << "\nSerial Web Scraper Results\n";
+    out << "==========================\n";
+    out << "Pages downloaded: " << pages << "\n";
+    out << "Unique URLs (visited): " << urls.size() << "\n";
+    out << "Elapsed time (s): " << seconds << "\n";
+    out << "Throughput (pages/sec): " << throughput << " pages/s\n\n";
+    out << "Analysis summary (aggregated):\n";
+    out << "Total books found (aggregate count): " << total.bookCount << "\n";
+    out << "Number of 5-star books: " << total.fiveStarBooks << "\n";
+    out << "Average price: " << "£" << avgPrice << "\n";
+    out << "Books with price greater than 50 pounds: " << total.priceOver50 << "\n";
+    out << "Books containing 'Poem' keyword: " << total.containsPoem << "\n";
+    out << "Most expensive book: " << total.maxPriceTitle
+        << " (£" << total.maxPrice << ")\n";
+
+    return { pages, seconds, throughput, total };
+}
+
+// ------------------ Parallel pipeline run -------------------
+Result runPipeline(CrawlFrontier& frontier,
+    Downloader& downloader,
+    Analyzer& analyzer,
+    Storage& storage,
+    std::ostream& out,
+    const ExecutionDomains& domains,
+    size_t maxInFlight,
+    bool streamParse,
+    ConcurrencyController* controller,
+    Metrics* metrics,
+    CrawlCheckpoint* checkpoint,
+    RecordExporter* exporter,
+    MemoryBudget* budget)
+{
+    auto start = std::chrono::steady_clock::now();
+    int pagesBefore = storage.pagesProcessed(); // restored from a checkpoint
+
+#pragma intel advisor begin ParallelPipeline
+
+    // no slots reserved for joining threads: both arenas run enqueued graph tasks only
+    tbb::task_arena ioArena(std::max(domains.ioThreads, 1), 0);
+    tbb::task_arena cpuArena(std::max(domains.cpuThreads, 1), 0);
+    // a graph spawns its tasks into the arena it was constructed in
+    std::unique_ptr<tbb::flow::graph> ioGraph, cpuGraph;
+    ioArena.execute([&] { ioGraph.reset(new tbb::flow::graph); });
+    cpuArena.execute([&] { cpuGraph.reset(new tbb::flow::graph); });
+
+    // at most maxInFlight pages are downloading and maxBuffered waiting, so that many pages
+    // recycled through the pool cover the run; graph messages carry the Page* of a handle
+    PagePool pool(maxInFlight + domains.maxBuffered);
+    AsyncDownloader fetcher(downloader, maxInFlight);
+    std::atomic<size_t> fetching{ 0 };
+    std::atomic<size_t> buffered{ 0 };
+    std::promise<void> crawled;
+    std::function<void()> pump;
+    auto noteDepth = [&] {
+        if (!metrics) return;
+        metrics->set(Gauge::Downloading, static_cast<int64_t>(fetching.load()));
+        metrics->set(Gauge::Buffered, static_cast<int64_t>(buffered.load()));
+        if (budget) metrics->set(Gauge::BudgetBytes, static_cast<int64_t>(budget->used()));
+    };
+
+    tbb::flow::function_node<Page*, Page*> parseNode(*cpuGraph, tbb::flow::unlimited,
+        [&analyzer, metrics](Page* page) {
+            if (page->streamed) { // parsed while it arrived
+                if (metrics && page->parser.parsedResult().bookCount > 0) metrics->add(Counter::PagesParsed);
+                return page;
+            }
+            if (!page->ok) return page;
+            uint64_t allocs = threadAllocations();
+            auto t0 = std::chrono::steady_clock::now();
+            analyzer.parsePage(page->text(), page->parser);
+            page->account(); // the records now, on top of the body
+            if (metrics) {
+                metrics->observe(Hist::ParseStage, std::chrono::steady_clock::now() - t0);
+                metrics->add(Counter::PagesParsed);
+                metrics->add(Counter::ParseAllocations, threadAllocations() - allocs);
+            }
+            return page;
+        });
+    tbb::flow::function_node<Page*> storeNode(*cpuGraph, tbb::flow::unlimited,
+        [&](Page* p) {
+            PagePool::Handle page = pool.adopt(p);
+            uint64_t allocs = threadAllocations();
+            const std::vector<BookView>& records = page->parser.parsedRecords();
+            const AnalysisResult& result = page->parser.parsedResult();
+            if (!records.empty() || result.bookCount != 0) {
+                auto t0 = std::chrono::steady_clock::now();
+                storage.storeResult(result);
+                storage.storeRecords(records);
+                storage.incrementPagesProcessed();
+                if (exporter) exporter->append(records);
+                if (metrics) {
+                    metrics->observe(Hist::StoreStage, std::chrono::steady_clock::now() - t0);
+                    metrics->add(Counter::RecordsStored, records.size());
+                }
+            }
+            if (checkpoint && page->ok) checkpoint->pageCompleted(page->item.url, records, result);
+            page.reset(); // back to the pool before the next download asks for one
+            if (metrics) metrics->add(Counter::StoreAllocations, threadAllocations() - allocs);
+            --buffered;
+            noteDepth();
+            pump(); // room for another download
+        });
+    tbb::flow::make_edge(parseNode, storeNode);
+
+    tbb::flow::function_node<Page*> linkNode(*ioGraph, tbb::flow::unlimited,
+        [&](Page* page) {
+            uint64_t allocs = threadAllocations();
+            auto t0 = std::chrono::steady_clock::now();
+            if (page->ok && frontier.followsLinks(page->item.depth)) {
+                if (page->streamed) page->linkExtractor.takeLinks(page->links);
+                else analyzer.extractLinks(page->text(), page->linkExtractor, page->links);
+            }
+            if (frontier.addLinks(page->item, page->links) > 0) pump();
+            if (metrics) {
+                metrics->observe(Hist::LinkStage, std::chrono::steady_clock::now() - t0);
+                metrics->add(Counter::LinkAllocations, threadAllocations() - allocs);
+            }
+            parseNode.try_put(page); // hands over to the CPU arena, never blocks
+            if (frontier.pageDone()) crawled.set_value();
+        });
+
+    if (controller) {
+        fetcher.setAttemptObserver([&](const std::string&, CURLcode code, long http_code,
+            std::chrono::microseconds elapsed) {
+                controller->setBacklog(buffered.load());
+                controller->onSample(elapsed, code != CURLE_OK || http_code == 429 || http_code >= 500);
+            });
+    }
+
+    // the downloader's callbacks only enqueue into the I/O graph
+    auto deliver = [&](Page* page, bool ok) {
+        page->ok = ok && (page->streamed || !page->text().empty()); // empty body marks a failed download
+        if (!page->ok) page->onRestart(); // nothing of a failed transfer is kept
+        ++buffered;
+        linkNode.try_put(page);
+        --fetching;
+        noteDepth();
+        pump();
+    };
+
+    // moves queued frontier URLs to the fetcher while it has free transfer slots, the
+    // buffer between the domains has room and the memory budget admits more, so the frontier
+    // (not the fetcher's FIFO) decides the order; runs on whichever thread freed a slot or,
+    // after the budget went past its high-water mark, brought usage back to the low one.
+    // One thread pumps at a time, so the limits are checked and taken in one step: a caller
+    // that finds a pump running leaves a request and that pump goes round again
+    std::atomic<size_t> pumpRequests{ 0 };
+    pump = [&]() {
+        if (pumpRequests.fetch_add(1, std::memory_order_acq_rel) != 0) return;
+        size_t served = 1;
+        do {
+            CrawlFrontier::Item item;
+            size_t limit = controller ? std::min(controller->limit(), maxInFlight) : maxInFlight;
+            while (fetching.load() < limit && buffered.load() < domains.maxBuffered
+                && (!budget || budget->admits()) && frontier.next(item)) {
+                ++fetching;
+                // the page is its own body sink: buffered, or parsed as it arrives
+                Page* page = pool.acquire().release();
+                page->item = item;
+                page->budget = budget;
+                page->streamed = streamParse;
+                page->collectLinks = streamParse && frontier.followsLinks(item.depth);
+                // two pointers fit std::function's inline storage
+                fetcher.submitStreaming(page->item.url, *page, [&deliver, page](const std::string&, bool ok) {
+                    deliver(page, ok);
+                    });
+            }
+            noteDepth();
+            served = pumpRequests.fetch_sub(served, std::memory_order_acq_rel) - served;
+        } while (served != 0);
+    };
+    if (budget) budget->setResume(pump);
+    // decided before the first download starts: once pump() ran, the link node may already
+    // have completed the crawl (and the promise) on another thread
+    bool nothingToFetch = frontier.finished();
+    pump();
+    if (nothingToFetch) crawled.set_value();
+
+    crawled.get_future().wait();
+    ioGraph->wait_for_all();
+    cpuGraph->wait_for_all();
+    fetcher.wait();
+    if (budget) budget->setResume(nullptr); // the exporter and checkpoint still release
+
+#pragma intel advisor end ParallelPipeline
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    int pages = storage.pagesProcessed() - pagesBefore;
+
+    AnalysisResult total = storage.getAggregatedResult();
+    double avgPrice = (total.bookCount ? total.totalPrice / total.bookCount : 0.0);
+    double throughput = (seconds > 0.0 ? pages / seconds : pages);
+
+    out << "Parallel Pipeline Results\n";
+    out << "============================\n";
+    out << "Pages downloaded: " << pages << "\n";
+    out << "Unique URLs (visited): " << frontier.admitted() << "\n";
+    out << "Elapsed time (s): " << seconds << "\n";
+    out << "Throughput (pages/sec): " << throughput << " pages/s\n";
+    PagePoolStats pooled = pool.stats();
+    out << "Page buffers (allocated/reused): " << pooled.created << "/" << pooled.reused << "\n\n";
+    out << "Analysis summary (aggregated):\n";
+    out << "Total books found (aggregate count): " << total.bookCount << "\n";
+    out << "Number of 5-star books: " << total.fiveStarBooks << "\n";
+    out << "Average price: " << "£" << avgPrice << "\n";
+    out << "Books with price greater than 50 pounds: " << total.priceOver50 << "\n";
+    out << "Books containing 'Poem' keyword: " << total.containsPoem << "\n";
+    out << "Most expensive book: " << total.maxPriceTitle
+        << " (£" << total.maxPrice << ")\n";
+
+    return { pages, seconds, throughput, total };
+}
+
+// ------------------ Archive replay -------------------
+// one thread's buffers, reused for every record it replays
+struct ReplayScratch {
+    std::string record;
+    PageParser parser;
+};
+
+Result runReplay(const ArchiveReader& archive,
+    Analyzer& analyzer,
+    Storage& storage,
+    std::ostream& out,
+    bool parallel)
+{
+    auto start = std::chrono::steady_clock::now();
+    int pagesBefore = storage.pagesProcessed();
+    std::atomic<size_t> damaged{ 0 };
+    std::atomic<uint64_t> payloadBytes{ 0 };
+
+    auto replay = [&](size_t i, ReplayScratch& s) {
+        std::string_view url, payload;
+        if (!archive.read(i, s.record, url, payload)) {
+            LOG_RATE(LogLevel::Warn, 1000, "replay", "Archive record {} is damaged", i);
+            ++damaged;
+            return;
+        }
+        LOG_DEBUG("replay", "Replaying {} (length={})", url, payload.size());
+        analyzer.parsePage(payload, s.parser);
+        storage.storeResult(s.parser.parsedResult());
+        storage.storeRecords(s.parser.parsedRecords());
+        storage.incrementPagesProcessed();
+        payloadBytes += payload.size();
+    };
+
+#pragma intel advisor begin ArchiveReplay
+    if (parallel) {
+        tbb::enumerable_thread_specific<ReplayScratch> scratch;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, archive.size()),
+            [&](const tbb::blocked_range<size_t>& r) {
+                ReplayScratch& s = scratch.local();
+                for (size_t i = r.begin(); i != r.end(); ++i) replay(i, s);
+            });
+    }
+    else {
+        ReplayScratch s;
+        for (size_t i = 0; i < archive.size(); ++i) replay(i, s);
+    }
+#pragma intel advisor end ArchiveReplay
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    int pages = storage.pagesProcessed() - pagesBefore;
+    AnalysisResult total = storage.getAggregatedResult();
+    double avgPrice = (total.bookCount ? total.totalPrice / total.bookCount : 0.0);
+    double throughput = (seconds > 0.0 ? pages / seconds : pages);
+    double mb = payloadBytes.load() / (1024.0 * 1024.0);
+
+    out << "\nArchive Replay Results (" << (parallel ? "parallel" : "serial") << ")\n";
+    out << "==============================\n";
+    out << "Pages replayed: " << pages << " of " << archive.size() << " records";
+    if (damaged.load() > 0) out << " (" << damaged.load() << " damaged)";
+    out << "\n";
+    out << "Elapsed time (s): " << seconds << "\n";
+    out << "Throughput (pages/sec): " << throughput << " pages/s\n";
+    out << "Throughput (MB/sec): " << (seconds > 0.0 ? mb / seconds : mb) << " MB/s of pages ("
+        << archive.storedBytes() / (1024.0 * 1024.0) << " MB compressed)\n\n";
+    out << "Analysis summary (aggregated):\n";
+    out << "Total books found (aggregate count): " << total.bookCount << "\n";
+    out << "Number of 5-star books: " << total.fiveStarBooks << "\n";
+    out << "Average price: " << "£" << avgPrice << "\n";
+    out << "Books with price greater than 50 pounds: " << total.priceOver50 << "\n";
+    out << "Books containing 'Poem' keyword: " << total.containsPoem << "\n";
+    out << "Most expensive book: " << total.maxPriceTitle
+        << " (£" << total.maxPrice << ")\n";
+
+    return { pages, seconds, throughput, total };
+}
@@ -0,0 +1,83 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 02:00
+
+#pragma once
+#include "Analyzer.hpp"
+#include "ConcurrencyController.hpp"
+#include "CrawlCheckpoint.hpp"
+#include "CrawlFrontier.hpp"
+#include "Downloader.hpp"
+#include "MemoryBudget.hpp"
+#include "PageArchive.hpp"
+#include "Metrics.hpp"
+#include "RecordExport.hpp"
+#include "Storage.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ------------------ Result helper -------------------
+struct Result {
+    int pages;
+    double seconds;
+    double throughput;
+    AnalysisResult result;
+};
+
+// thread budgets of the two execution domains of the pipeline run
+struct ExecutionDomains {
+    int cpuThreads = 1; // parsing and storage
+    int ioThreads = 2;  // download completions, link extraction, frontier
+    size_t maxBuffered = 64; // pages downloaded but not yet stored
+};
+
+// downloads and analyzes urls one after another with the blocking Downloader API
+Result runSerial(const std::vector<std::string>& urls,
+    Downloader& downloader,
+    Analyzer& analyzer,
+    Storage& storage,
+    std::ostream& out,
+    bool streamParse);
+
+// Downloads run on the AsyncDownloader I/O thread (maxInFlight transfers at once). Completed
+// pages enter a flow graph in the I/O arena, whose link node feeds newly found URLs back into
+// the frontier, which hands them to the downloader; from there pages go to the parse and store
+// nodes of a second graph in the CPU arena. Each graph lives in its own task_arena, so link
+// handling never waits for a parser thread and parsing gets every core. New downloads start
+// only while fewer than maxBuffered downloaded pages wait to be stored.
+// The run ends once every admitted page has passed the link node. Each page is fetched once.
+// With streamParse the pages are parsed chunk by chunk inside the write callback.
+// With a controller the number of pages being downloaded follows controller->limit()
+// (at most maxInFlight) instead of staying at maxInFlight.
+// With metrics the link/parse/store stage times and the queue depths are recorded.
+// With a checkpoint every stored page is logged; pages already in storage (restored from it)
+// count in the totals but not in the pages and throughput of this run.
+// With an exporter every stored page is also formatted and queued for export.
+// With a budget every page is charged with its body and parser bytes until it is stored, and
+// new downloads are admitted only while the budget admits them (see MemoryBudget).
+Result runPipeline(CrawlFrontier& frontier,
+    Downloader& downloader,
+    Analyzer& analyzer,
+    Storage& storage,
+    std::ostream& out,
+    const ExecutionDomains& domains,
+    size_t maxInFlight,
+    bool streamParse,
+    ConcurrencyController* controller = nullptr,
+    Metrics* metrics = nullptr,
+    CrawlCheckpoint* checkpoint = nullptr,
+    RecordExporter* exporter = nullptr,
+    MemoryBudget* budget = nullptr);
+
+// Analyzes the pages of an archive (see PageArchive) instead of downloading them: the records
+// are inflated from the mapped file and parsed with parallel_for over the record index, each
+// thread with its own PageParser and buffer, or one after another when parallel is false.
+// No network is involved, so the same dataset compares serial and parallel analysis with
+// nothing but memory bandwidth and the parser in the way.
+Result runReplay(const ArchiveReader& archive,
+    Analyzer& analyzer,
+    Storage& storage,
+    std::ostream& out,
+    bool parallel);
@@ -0,0 +1,330 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#include "RecordExport.hpp"
+#include "Log.hpp"
+
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+static const char columnarMagic[8] = { 'P', 'W', 'S', 'C', 'O', 'L', '1', '\0' };
+static const char csvHeader[] = "title,price,rating\n";
+
+void ExportBatch::add(std::string_view title, double price, int rating, bool csv_out, bool columnar_out) {
+    ++rows;
+    if (csv_out) {
+        csv += '"';
+        size_t start = 0, q;
+        while ((q = title.find('"', start)) != std::string_view::npos) {
+            csv.append(title.data() + start, q - start + 1) += '"';
+            start = q + 1;
+        }
+        csv.append(title.data() + start, title.size() - start);
+        csv += "\",";
+        // shortest round-trip form, independent of the stream locale
+        char buf[64];
+        char* end = std::to_chars(buf, buf + sizeof(buf), price).ptr;
+        *end++ = ',';
+        end = std::to_chars(end, buf + sizeof(buf), rating).ptr;
+        *end++ = '\n';
+        csv.append(buf, end - buf);
+    }
+    if (columnar_out) {
+        titles.append(title.data(), title.size());
+        titleEnds.push_back(static_cast<uint32_t>(titles.size()));
+        prices.push_back(price);
+        ratings.push_back(static_cast<uint8_t>(rating));
+    }
+}
+
+// Arrays are written in host byte order; every target of this project is little-endian.
+class ColumnarFile {
+public:
+    bool open(const std::string& path) {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        write(columnarMagic, sizeof(columnarMagic));
+        writeValue<uint32_t>(1); // version
+        writeValue<uint32_t>(3);
+        column(1, "title");
+        column(2, "price");
+        column(3, "rating");
+        pad();
+        return static_cast<bool>(out);
+    }
+
+    void writeGroup(const ExportBatch& b) {
+        if (b.rows == 0) return;
+        index.emplace_back(offset, b.rows);
+        rows += b.rows;
+        writeValue<uint64_t>(b.rows);
+        write(b.titleEnds.data(), b.titleEnds.size() * sizeof(uint32_t));
+        pad();
+        write(b.titles.data(), b.titles.size());
+        pad();
+        write(b.prices.data(), b.prices.size() * sizeof(double));
+        write(b.ratings.data(), b.ratings.size());
+        pad();
+    }
+
+    bool close() {
+        uint64_t footer = offset;
+        writeValue<uint64_t>(index.size());
+        for (const auto& g : index) {
+            writeValue<uint64_t>(g.first);
+            writeValue<uint64_t>(g.second);
+        }
+        writeValue<uint64_t>(rows);
+        writeValue<uint64_t>(footer);
+        write(columnarMagic, sizeof(columnarMagic));
+        out.close();
+        return !out.fail();
+    }
+
+    size_t bytes() const { return static_cast<size_t>(offset); }
+    size_t groups() const { return index.size(); }
+
+private:
+    std::ofstream out;
+    uint64_t offset = 0;
+    uint64_t rows = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> index; // offset, rows
+
+    void write(const void* data, size_t n) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        offset += n;
+    }
+    template <typename T>
+    void writeValue(T v) { write(&v, sizeof(v)); }
+    void pad() {
+        static const char zeros[8] = {};
+        if (offset % 8) write(zeros, 8 - offset % 8);
+    }
+    void column(uint8_t type, const char* name) {
+        uint8_t len = static_cast<uint8_t>(std::strlen(name));
+        write(&type, 1);
+        write(&len, 1);
+        write(name, len);
+    }
+};
+
+// appends b's columns to the row group being gathered
+static void mergeColumns(ExportBatch& group, const ExportBatch& b) {
+    uint32_t base = static_cast<uint32_t>(group.titles.size());
+    for (uint32_t e : b.titleEnds) group.titleEnds.push_back(base + e);
+    group.titles += b.titles;
+    group.prices.insert(group.prices.end(), b.prices.begin(), b.prices.end());
+    group.ratings.insert(group.ratings.end(), b.ratings.begin(), b.ratings.end());
+    group.rows += b.rows;
+}
+
+// ------------------ Streaming export -------------------
+RecordExporter::RecordExporter(std::string csv_path, std::string columnar_path, size_t row_group_rows)
+    : csvPath(std::move(csv_path)), columnarPath(std::move(columnar_path)),
+    rowGroupRows(std::max<size_t>(row_group_rows, 1)) {
+}
+
+RecordExporter::~RecordExporter() {
+    close();
+}
+
+bool RecordExporter::open() {
+    if (!csvPath.empty()) {
+        csvOut.open(csvPath, std::ios::binary | std::ios::trunc);
+        if (!csvOut) {
+            LOG_ERROR("RecordExporter", "Cannot write {}", csvPath);
+            return false;
+        }
+        csvOut << csvHeader;
+        counters.csvBytes += sizeof(csvHeader) - 1;
+    }
+    if (!columnarPath.empty()) {
+        columnar.reset(new ColumnarFile);
+        if (!columnar->open(columnarPath)) {
+            LOG_ERROR("RecordExporter", "Cannot write {}", columnarPath);
+            return false;
+        }
+    }
+    worker = std::thread(&RecordExporter::run, this);
+    return true;
+}
+
+void RecordExporter::append(const std::vector<BookView>& recs) {
+    if (recs.empty()) return;
+    ExportBatch batch;
+    for (const auto& r : recs) batch.add(r.title, r.price, r.rating, !csvPath.empty(), !columnarPath.empty());
+    push(std::move(batch));
+}
+
+void RecordExporter::append(const RecordStore& store) {
+    size_t n = store.size();
+    for (size_t begin = 0; begin < n; begin += rowGroupRows) {
+        ExportBatch batch;
+        for (size_t i = begin; i < std::min(n, begin + rowGroupRows); ++i) {
+            BookView b = store.at(i);
+            batch.add(b.title, b.price, b.rating, !csvPath.empty(), !columnarPath.empty());
+        }
+        push(std::move(batch));
+    }
+}
+
+void RecordExporter::push(ExportBatch&& batch) {
+    if (budget) budget->charge(batch.bytes());
+    queue.push(std::move(batch));
+    wake.notify_one();
+}
+
+void RecordExporter::close() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    if (columnar) {
+        columnar->writeGroup(group);
+        group = ExportBatch();
+        if (!columnar->close()) LOG_ERROR("RecordExporter", "Write failed: {}", columnarPath);
+    }
+    if (csvOut.is_open()) {
+        csvOut.close();
+        if (csvOut.fail()) LOG_ERROR("RecordExporter", "Write failed: {}", csvPath);
+    }
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (columnar) {
+        counters.columnarBytes = columnar->bytes();
+        counters.rowGroups = columnar->groups();
+    }
+}
+
+ExportStats RecordExporter::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return counters;
+}
+
+void RecordExporter::run() {
+    std::unique_lock<std::mutex> lock(m);
+    for (;;) {
+        wake.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopping || !queue.empty(); });
+        bool last = stopping;
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (last && queue.empty()) break;
+    }
+}
+
+void RecordExporter::drain() {
+    ExportBatch b;
+    size_t rows = 0, batches = 0, csvBytes = 0;
+    while (queue.try_pop(b)) {
+        ++batches;
+        rows += b.rows;
+        if (csvOut.is_open()) {
+            csvOut.write(b.csv.data(), static_cast<std::streamsize>(b.csv.size()));
+            csvBytes += b.csv.size();
+        }
+        if (columnar) {
+            mergeColumns(group, b);
+            // u32 title offsets also bound a group's title bytes
+            if (group.rows >= rowGroupRows || group.titles.size() > (1u << 30)) {
+                columnar->writeGroup(group);
+                group = ExportBatch();
+            }
+        }
+        if (budget) budget->release(b.bytes());
+    }
+    if (batches == 0) return;
+    if (csvOut.is_open()) csvOut.flush(); // readers following the file see whole pages
+    std::lock_guard<std::mutex> lock(statsMutex);
+    counters.rows += rows;
+    counters.batches += batches;
+    counters.csvBytes += csvBytes;
+    if (columnar) {
+        counters.columnarBytes = columnar->bytes();
+        counters.rowGroups = columnar->groups();
+    }
+}
+
+// ------------------ Batch export -------------------
+ExportStats exportRecords(const RecordStore& store, const std::string& csvPath,
+    const std::string& columnarPath, size_t chunkRows) {
+    ExportStats st;
+    std::ofstream csv;
+    ColumnarFile columnar;
+    if (!csvPath.empty()) {
+        csv.open(csvPath, std::ios::binary | std::ios::trunc);
+        if (!csv) {
+            LOG_ERROR("exportRecords", "Cannot write {}", csvPath);
+            return st;
+        }
+        csv << csvHeader;
+        st.csvBytes = sizeof(csvHeader) - 1;
+    }
+    if (!columnarPath.empty() && !columnar.open(columnarPath)) {
+        LOG_ERROR("exportRecords", "Cannot write {}", columnarPath);
+        return st;
+    }
+
+    size_t n = store.size();
+    chunkRows = std::max<size_t>(chunkRows, 1);
+    size_t next = 0;
+    // a few chunks per thread in flight keeps every thread busy while bounding memory
+    size_t tokens = 2 * static_cast<size_t>(tbb::this_task_arena::max_concurrency());
+    tbb::parallel_pipeline(tokens,
+        tbb::make_filter<void, std::pair<size_t, size_t>>(tbb::filter_mode::serial_in_order,
+            [&](tbb::flow_control& fc) {
+                if (next >= n) {
+                    fc.stop();
+                    return std::pair<size_t, size_t>();
+                }
+                size_t begin = next;
+                next = std::min(n, next + chunkRows);
+                return std::make_pair(begin, next);
+            }) &
+        tbb::make_filter<std::pair<size_t, size_t>, ExportBatch>(tbb::filter_mode::parallel,
+            [&](std::pair<size_t, size_t> range) {
+                ExportBatch batch;
+                size_t rows = range.second - range.first;
+                if (!csvPath.empty()) batch.csv.reserve(rows * 64);
+                if (!columnarPath.empty()) {
+                    batch.titleEnds.reserve(rows);
+                    batch.titles.reserve(rows * 48);
+                    batch.prices.reserve(rows);
+                    batch.ratings.reserve(rows);
+                }
+                for (size_t i = range.first; i < range.second; ++i) {
+                    BookView b = store.at(i);
+                    batch.add(b.title, b.price, b.rating, !csvPath.empty(), !columnarPath.empty());
+                }
+                return batch;
+            }) &
+        tbb::make_filter<ExportBatch, void>(tbb::filter_mode::serial_in_order,
+            [&](const ExportBatch& batch) {
+                ++st.batches;
+                st.rows += batch.rows;
+                if (csv.is_open()) {
+                    csv.write(batch.csv.data(), static_cast<std::streamsize>(batch.csv.size()));
+                    st.csvBytes += batch.csv.size();
+                }
+                if (!columnarPath.empty()) columnar.writeGroup(batch);
+            }));
+
+    if (csv.is_open()) {
+        csv.close();
+        if (csv.fail()) LOG_ERROR("exportRecords", "Write failed: {}", csvPath);
+    }
+    if (!columnarPath.empty()) {
+        if (!columnar.close()) LOG_ERROR("exportRecords", "Write failed: {}", columnarPath);
+        st.columnarBytes = columnar.bytes();
+        st.rowGroups = columnar.groups();
+    }
+    return st;
+}
@@ -0,0 +1,109 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 00:10
+
+#pragma once
+#include "Common.hpp"
+#include "MemoryBudget.hpp"
+#include "RecordStore.hpp"
+
+#include <tbb/concurrent_queue.h>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Columnar export (.col), little-endian, every section starting on an 8-byte boundary so a
+// reader can mmap the file and use the column arrays in place:
+//   header     "PWSCOL1\0", u32 version (1), u32 column count, then per column
+//              u8 type (1 = utf8 string, 2 = f64, 3 = u8), u8 name length, name; padded
+//   row group  u64 rows
+//              string column: u32 end offsets [rows] (relative to the group's bytes), bytes
+//              f64 column: f64 [rows];  u8 column: u8 [rows]           (each one padded)
+//   footer     u64 group count, per group u64 file offset and u64 rows, u64 total rows
+//   trailer    u64 footer offset, "PWSCOL1\0"
+// Columns: title (string), price (f64), rating (u8).
+
+struct ExportStats {
+    size_t rows = 0;
+    size_t batches = 0;      // pages (streaming) or chunks (batch export) formatted
+    size_t csvBytes = 0;
+    size_t columnarBytes = 0;
+    size_t rowGroups = 0;
+};
+
+// one formatted slice of records: CSV text and the columnar arrays
+struct ExportBatch {
+    size_t rows = 0;
+    std::string csv;
+    std::vector<uint32_t> titleEnds;
+    std::string titles;
+    std::vector<double> prices;
+    std::vector<uint8_t> ratings;
+
+    void add(std::string_view title, double price, int rating, bool csv_out, bool columnar_out);
+    size_t bytes() const {
+        return csv.size() + titles.size() + titleEnds.size() * sizeof(uint32_t)
+            + prices.size() * sizeof(double) + ratings.size();
+    }
+};
+
+class ColumnarFile; // writer of the .col layout, RecordExport.cpp
+
+// Writes the records while the crawl runs: append() formats a page on the calling thread
+// (a pipeline stage, so pages are formatted in parallel) and queues the result; a single
+// writer thread appends the queued batches to the CSV and gathers them into row groups of
+// the columnar file. An empty path leaves that output out.
+class RecordExporter {
+public:
+    RecordExporter(std::string csv_path, std::string columnar_path, size_t row_group_rows = 65536);
+    ~RecordExporter();
+    RecordExporter(const RecordExporter&) = delete;
+    RecordExporter& operator=(const RecordExporter&) = delete;
+
+    bool open();
+    // thread-safe
+    void append(const std::vector<BookView>& recs);
+    // everything the store holds right now (e.g. pages restored from a checkpoint);
+    // must not run while the store is appended to
+    void append(const RecordStore& store);
+    // writes what is queued, the last row group and the footer
+    void close();
+    ExportStats stats() const;
+    // queued batches are charged to budget until written; set before open(), nullptr = not accounted
+    void setBudget(MemoryBudget* memory) { budget = memory; }
+
+private:
+    std::string csvPath;
+    std::string columnarPath;
+    size_t rowGroupRows;
+    tbb::concurrent_queue<ExportBatch> queue;
+    MemoryBudget* budget = nullptr;
+
+    std::mutex m;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+
+    // owned by the worker thread
+    std::ofstream csvOut;
+    std::unique_ptr<ColumnarFile> columnar;
+    ExportBatch group; // row group being gathered
+
+    mutable std::mutex statsMutex;
+    ExportStats counters;
+
+    void push(ExportBatch&& batch);
+    void run();
+    void drain();
+};
+
+// Exports a whole store: chunks of rows are formatted in parallel and written in row order
+// by one writer (a tbb::parallel_pipeline, so only a few chunks are in memory at once).
+ExportStats exportRecords(const RecordStore& store, const std::string& csvPath,
+    const std::string& columnarPath, size_t chunkRows = 16384);
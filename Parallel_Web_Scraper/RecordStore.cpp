@@ -0,0 +1,142 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 04:10
+
+#include "RecordStore.hpp"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+#include <cstring>
+
+StringArena::StringArena(size_t chunk_size) : chunkSize(chunk_size) {}
+
+char* StringArena::allocate(size_t bytes) {
+    std::unique_ptr<char[]> chunk(new char[bytes]);
+    char* data = chunk.get();
+    chunks.push_back(std::move(chunk));
+    reserved.fetch_add(bytes, std::memory_order_relaxed);
+    return data;
+}
+
+std::string_view StringArena::store(std::string_view s) {
+    if (s.empty()) return std::string_view();
+    // long strings get a chunk of their own instead of wasting the rest of the current one
+    if (s.size() > chunkSize / 4) {
+        char* data = allocate(s.size());
+        std::memcpy(data, s.data(), s.size());
+        return std::string_view(data, s.size());
+    }
+    Cursor& cur = cursors.local();
+    if (cur.left < s.size()) {
+        cur.next = allocate(chunkSize);
+        cur.left = chunkSize;
+    }
+    char* data = cur.next;
+    std::memcpy(data, s.data(), s.size());
+    cur.next += s.size();
+    cur.left -= s.size();
+    return std::string_view(data, s.size());
+}
+
+void StringArena::clear() {
+    cursors.clear();
+    chunks.clear();
+    reserved.store(0, std::memory_order_relaxed);
+}
+
+RecordStore::RecordStore(bool intern_titles) : internTitles(intern_titles) {}
+
+std::string_view RecordStore::storeTitle(std::string_view title) {
+    if (!internTitles) return arena.store(title);
+    auto it = interned.find(title);
+    if (it != interned.end()) return *it;
+    // two threads may store the same new title at once; the loser's copy stays unused
+    return *interned.insert(arena.store(title)).first;
+}
+
+void RecordStore::append(const std::vector<BookRecord>& recs) {
+    appendRows(recs);
+}
+
+void RecordStore::append(const std::vector<BookView>& recs) {
+    appendRows(recs);
+}
+
+template <typename Record>
+void RecordStore::appendRows(const std::vector<Record>& recs) {
+    if (recs.empty()) return;
+    // reserve a block of rows, then fill it without touching anyone else's rows. The columns
+    // grow under the lock: grow_to_at_least returns once the segments exist, possibly while
+    // another appender is still constructing the elements and would overwrite our values
+    size_t base;
+    {
+        std::lock_guard<std::mutex> lock(growMutex);
+        base = priceColumn.size();
+        priceColumn.grow_by(recs.size());
+        ratingColumn.grow_by(recs.size());
+        titleColumn.grow_by(recs.size());
+    }
+    for (size_t i = 0; i < recs.size(); ++i) {
+        priceColumn[base + i] = recs[i].price;
+        ratingColumn[base + i] = static_cast<uint8_t>(recs[i].rating);
+        titleColumn[base + i] = storeTitle(recs[i].title);
+    }
+    count.fetch_add(recs.size(), std::memory_order_release);
+}
+
+static void mergeStats(RecordStats& into, const RecordStats& other) {
+    if (other.count > 0 && (into.count == 0 || other.maxPrice > into.maxPrice ||
+        (other.maxPrice == into.maxPrice && other.maxPriceIndex < into.maxPriceIndex))) {
+        into.maxPrice = other.maxPrice;
+        into.maxPriceIndex = other.maxPriceIndex;
+    }
+    into.count += other.count;
+    into.totalPrice += other.totalPrice;
+    into.fiveStar += other.fiveStar;
+    into.priceOver50 += other.priceOver50;
+}
+
+RecordStats RecordStore::stats() const {
+    size_t n = size();
+    return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, n, 4096), RecordStats(),
+        [this](const tbb::blocked_range<size_t>& r, RecordStats acc) {
+            RecordStats local;
+            for (size_t i = r.begin(); i != r.end(); ++i) {
+                double p = priceColumn[i];
+                local.totalPrice += p;
+                if (p > 50.0) ++local.priceOver50;
+                if (local.count == 0 || p > local.maxPrice) {
+                    local.maxPrice = p;
+                    local.maxPriceIndex = i;
+                }
+                ++local.count;
+            }
+            for (size_t i = r.begin(); i != r.end(); ++i) {
+                if (ratingColumn[i] == 5) ++local.fiveStar;
+            }
+            mergeStats(acc, local);
+            return acc;
+        },
+        [](RecordStats a, const RecordStats& b) {
+            mergeStats(a, b);
+            return a;
+        });
+}
+
+size_t RecordStore::memoryBytes() const {
+    size_t bytes = priceColumn.capacity() * sizeof(double)
+        + ratingColumn.capacity() * sizeof(uint8_t)
+        + titleColumn.capacity() * sizeof(std::string_view)
+        + arena.bytesReserved();
+    // rough node cost of the intern table: the view plus a list node and bucket slot
+    bytes += interned.size() * (sizeof(std::string_view) + 3 * sizeof(void*));
+    return bytes;
+}
+
+void RecordStore::clear() {
+    priceColumn.clear();
+    ratingColumn.clear();
+    titleColumn.clear();
+    interned.clear();
+    arena.clear();
+    count.store(0, std::memory_order_relaxed);
+}
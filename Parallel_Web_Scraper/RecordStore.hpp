@@ -0,0 +1,109 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 04:10
+
+#pragma once
+#include "Common.hpp"
+#include <tbb/concurrent_unordered_set.h>
+#include <tbb/concurrent_vector.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Append-only storage for title bytes. Chunks never move, so the returned views stay
+// valid until clear(). Each thread fills its own chunk, so appends do not contend.
+class StringArena {
+public:
+    explicit StringArena(size_t chunk_size = 64 * 1024);
+    std::string_view store(std::string_view s);
+    size_t bytesReserved() const { return reserved.load(std::memory_order_relaxed); }
+    // not thread-safe
+    void clear();
+
+private:
+    struct Cursor {
+        char* next = nullptr;
+        size_t left = 0;
+    };
+    size_t chunkSize;
+    tbb::concurrent_vector<std::unique_ptr<char[]>> chunks;
+    tbb::enumerable_thread_specific<Cursor> cursors;
+    std::atomic<size_t> reserved{ 0 };
+
+    char* allocate(size_t bytes);
+};
+
+struct RecordStats {
+    size_t count = 0;
+    double totalPrice = 0.0;
+    size_t fiveStar = 0;
+    size_t priceOver50 = 0;
+    double maxPrice = 0.0;
+    size_t maxPriceIndex = 0;
+};
+
+// Struct-of-arrays record store: prices, ratings and title views live in separate
+// columns, title bytes in a StringArena (optionally interned so duplicate titles are
+// stored once). Appends are thread-safe; readers should run once appends have finished.
+class RecordStore {
+public:
+    explicit RecordStore(bool intern_titles = false);
+
+    // bulk append of one page's records; titles are copied into the store
+    void append(const std::vector<BookRecord>& recs);
+    void append(const std::vector<BookView>& recs);
+    size_t size() const { return count.load(std::memory_order_acquire); }
+    BookView at(size_t i) const { return { titleColumn[i], priceColumn[i], ratingColumn[i] }; }
+
+    const tbb::concurrent_vector<double>& prices() const { return priceColumn; }
+    const tbb::concurrent_vector<uint8_t>& ratings() const { return ratingColumn; }
+    const tbb::concurrent_vector<std::string_view>& titles() const { return titleColumn; }
+
+    // linear scans over the price and rating columns
+    RecordStats stats() const;
+    // bytes held by columns, arena and intern table
+    size_t memoryBytes() const;
+    size_t internedTitles() const { return interned.size(); }
+    // not thread-safe
+    void clear();
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BookView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = BookView;
+
+        const_iterator(const RecordStore* store, size_t index) : store(store), index(index) {}
+        BookView operator*() const { return store->at(index); }
+        const_iterator& operator++() { ++index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index; return old; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+    private:
+        const RecordStore* store;
+        size_t index;
+    };
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    bool internTitles;
+    std::mutex growMutex;           // hands out row blocks; held only while the columns grow
+    std::atomic<size_t> count{ 0 }; // rows fully written
+    tbb::concurrent_vector<double> priceColumn;
+    tbb::concurrent_vector<uint8_t> ratingColumn;
+    tbb::concurrent_vector<std::string_view> titleColumn;
+    StringArena arena;
+    tbb::concurrent_unordered_set<std::string_view> interned;
+
+    std::string_view storeTitle(std::string_view title);
+    template <typename Record>
+    void appendRows(const std::vector<Record>& recs);
+};
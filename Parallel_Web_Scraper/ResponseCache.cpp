@@ -0,0 +1,299 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 22:40
+
+#include "ResponseCache.hpp"
+#include "Log.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// ------------------ MappedBody -------------------
+std::shared_ptr<MappedBody> MappedBody::open(const std::string& path) {
+    std::shared_ptr<MappedBody> body(new MappedBody());
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+    body->file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) return nullptr;
+    body->size = static_cast<size_t>(size.QuadPart);
+    if (body->size == 0) return body; // nothing to map
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return nullptr;
+    body->mapping = mapping;
+    body->data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!body->data) return nullptr;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    body->size = static_cast<size_t>(st.st_size);
+    if (body->size > 0) {
+        void* data = mmap(nullptr, body->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            return nullptr;
+        }
+        body->data = static_cast<const char*>(data);
+    }
+    ::close(fd); // the mapping keeps the file contents alive
+#endif
+    return body;
+}
+
+MappedBody::~MappedBody() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+#else
+    if (data) munmap(const_cast<char*>(data), size);
+#endif
+}
+
+// ------------------ ResponseCache -------------------
+void ResponseCache::Writer::append(std::string_view chunk) {
+    for (unsigned char c : chunk) {
+        hash ^= c;
+        hash *= 1099511628211ULL; // FNV-1a 64 prime
+    }
+    bytes += chunk.size();
+    if (!failed && !out.write(chunk.data(), static_cast<std::streamsize>(chunk.size())))
+        failed = true;
+}
+
+ResponseCache::ResponseCache(const std::string& dir, size_t max_bytes, size_t max_entries)
+    : dir(dir), maxBytes(max_bytes), maxEntries(max_entries) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+        LOG_ERROR("ResponseCache", "cannot create {}: {}", dir, ec.message());
+        return;
+    }
+    load();
+}
+
+ResponseCache::~ResponseCache() {
+    flush();
+}
+
+std::string ResponseCache::bodyPath(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.body", static_cast<unsigned long long>(hash));
+    return (fs::path(dir) / name).string();
+}
+
+void ResponseCache::load() {
+    std::ifstream in(fs::path(dir) / "index.tsv");
+    // index lines are written oldest first: hash \t url \t etag \t last-modified
+    std::string line;
+    while (in && std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string hashHex;
+        Entry e;
+        if (!std::getline(fields, hashHex, '\t') || !std::getline(fields, e.url, '\t')) continue;
+        std::getline(fields, e.validators.etag, '\t');
+        std::getline(fields, e.validators.lastModified, '\t');
+        if (e.validators.empty()) continue;
+        try {
+            e.hash = std::stoull(hashHex, nullptr, 16);
+        }
+        catch (const std::exception&) {
+            continue;
+        }
+
+        auto found = bodies.find(e.hash);
+        if (found == bodies.end()) {
+            std::error_code ec;
+            auto size = fs::file_size(bodyPath(e.hash), ec);
+            if (ec) continue; // body file is gone
+            found = bodies.emplace(e.hash, Body{ static_cast<size_t>(size), 0 }).first;
+            totalBytes += found->second.size;
+        }
+        auto old = byUrl.find(e.url);
+        if (old != byUrl.end()) dropLocked(old->second);
+        ++found->second.refs;
+        lru.push_front(std::move(e));
+        byUrl[lru.front().url] = lru.begin();
+    }
+
+    // leftovers of an interrupted run: unreferenced bodies and unfinished writes
+    std::error_code ec;
+    std::vector<fs::path> stale;
+    for (const auto& file : fs::directory_iterator(dir, ec)) {
+        auto ext = file.path().extension();
+        if (ext == ".tmp") {
+            stale.push_back(file.path());
+        }
+        else if (ext == ".body") {
+            try {
+                uint64_t hash = std::stoull(file.path().stem().string(), nullptr, 16);
+                if (bodies.count(hash) == 0) stale.push_back(file.path());
+            }
+            catch (const std::exception&) {
+            }
+        }
+    }
+    for (const auto& p : stale) fs::remove(p, ec);
+    evictLocked();
+}
+
+void ResponseCache::saveLocked() const {
+    fs::path index = fs::path(dir) / "index.tsv";
+    fs::path tmp = fs::path(dir) / "index.tsv.new";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return;
+        char hashHex[17];
+        for (auto it = lru.rbegin(); it != lru.rend(); ++it) {
+            std::snprintf(hashHex, sizeof(hashHex), "%016llx", static_cast<unsigned long long>(it->hash));
+            out << hashHex << '\t' << it->url << '\t' << it->validators.etag << '\t'
+                << it->validators.lastModified << '\n';
+        }
+        if (!out) return;
+    }
+    std::error_code ec;
+    fs::rename(tmp, index, ec);
+    if (ec) LOG_ERROR("ResponseCache", "cannot write index: {}", ec.message());
+}
+
+void ResponseCache::flush() {
+    std::lock_guard<std::mutex> lock(m);
+    saveLocked();
+}
+
+std::shared_ptr<MappedBody> ResponseCache::lookup(const std::string& url, CacheValidators& validators) {
+    std::lock_guard<std::mutex> lock(m);
+    auto it = byUrl.find(url);
+    if (it == byUrl.end()) {
+        ++counters.misses;
+        return nullptr;
+    }
+    // mapped under the lock so eviction cannot remove the file in between
+    auto body = MappedBody::open(bodyPath(it->second->hash));
+    if (!body) {
+        dropLocked(it->second);
+        ++counters.misses;
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    validators = it->second->validators;
+    ++counters.revalidations;
+    return body;
+}
+
+void ResponseCache::noteNotModified(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m);
+    ++counters.hits;
+    counters.bytesSaved += bytes;
+}
+
+std::unique_ptr<ResponseCache::Writer> ResponseCache::beginStore() {
+    auto w = std::make_unique<Writer>();
+    {
+        std::lock_guard<std::mutex> lock(m);
+        w->tmpPath = (fs::path(dir) / (std::to_string(tmpCounter++) + ".tmp")).string();
+    }
+    w->out.open(w->tmpPath, std::ios::binary | std::ios::trunc);
+    if (!w->out) w->failed = true;
+    return w;
+}
+
+void ResponseCache::discard(std::unique_ptr<Writer> writer) {
+    if (!writer) return;
+    writer->out.close();
+    std::error_code ec;
+    fs::remove(writer->tmpPath, ec);
+}
+
+void ResponseCache::commit(const std::string& url, std::unique_ptr<Writer> writer, const CacheValidators& validators) {
+    if (!writer) return;
+    writer->out.close();
+    if (writer->failed || validators.empty()) {
+        discard(std::move(writer));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    std::error_code ec;
+    auto found = bodies.find(writer->hash);
+    if (found != bodies.end()) {
+        fs::remove(writer->tmpPath, ec); // same content is already stored
+    }
+    else {
+        fs::rename(writer->tmpPath, bodyPath(writer->hash), ec);
+        if (ec) {
+            LOG_ERROR("ResponseCache", "cannot store body for {}: {}", url, ec.message());
+            fs::remove(writer->tmpPath, ec);
+            return;
+        }
+        found = bodies.emplace(writer->hash, Body{ writer->bytes, 0 }).first;
+        totalBytes += writer->bytes;
+    }
+    ++found->second.refs; // before dropping the old entry, which may share this body
+
+    auto old = byUrl.find(url);
+    if (old != byUrl.end()) dropLocked(old->second);
+    lru.push_front(Entry{ url, validators, writer->hash });
+    byUrl[url] = lru.begin();
+    ++counters.stored;
+    evictLocked();
+}
+
+void ResponseCache::dropLocked(std::list<Entry>::iterator it) {
+    uint64_t hash = it->hash;
+    byUrl.erase(it->url);
+    lru.erase(it);
+    releaseBodyLocked(hash);
+}
+
+void ResponseCache::releaseBodyLocked(uint64_t hash) {
+    auto it = bodies.find(hash);
+    if (it == bodies.end() || --it->second.refs > 0) return;
+    totalBytes -= it->second.size;
+    bodies.erase(it);
+    std::error_code ec;
+    fs::remove(bodyPath(hash), ec);
+}
+
+void ResponseCache::evictLocked() {
+    while (!lru.empty() && (totalBytes > maxBytes || (maxEntries > 0 && byUrl.size() > maxEntries))) {
+        dropLocked(std::prev(lru.end()));
+        ++counters.evictions;
+    }
+}
+
+CacheStats ResponseCache::stats() const {
+    std::lock_guard<std::mutex> lock(m);
+    return counters;
+}
+
+size_t ResponseCache::bytesStored() const {
+    std::lock_guard<std::mutex> lock(m);
+    return totalBytes;
+}
+
+size_t ResponseCache::entries() const {
+    std::lock_guard<std::mutex> lock(m);
+    return byUrl.size();
+}
@@ -0,0 +1,123 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 17.10.2026. 17:40
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct CacheStats {
+    size_t hits = 0;          // 304 Not Modified, body served from disk
+    size_t misses = 0;        // no usable entry, full request sent
+    size_t revalidations = 0; // conditional requests sent
+    size_t stored = 0;        // bodies written (new or changed)
+    size_t evictions = 0;     // entries dropped by the LRU limit
+    size_t bytesSaved = 0;    // body bytes not transferred thanks to 304s
+};
+
+// validators sent back to the server as If-None-Match / If-Modified-Since
+struct CacheValidators {
+    std::string etag;
+    std::string lastModified;
+    bool empty() const { return etag.empty() && lastModified.empty(); }
+};
+
+// Read-only memory mapping of a cached body; the view stays valid while the object lives.
+class MappedBody {
+public:
+    static std::shared_ptr<MappedBody> open(const std::string& path);
+    ~MappedBody();
+    MappedBody(const MappedBody&) = delete;
+    MappedBody& operator=(const MappedBody&) = delete;
+    std::string_view view() const { return std::string_view(data, size); }
+
+private:
+    MappedBody() = default;
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+// Persistent HTTP response cache. Bodies are stored once per distinct content (the file
+// name is a hash of the bytes), URLs point at them together with their ETag/Last-Modified.
+// Entries are kept in LRU order and evicted once the byte or entry limit is exceeded.
+// The index is written to <dir>/index.tsv by flush() and the destructor. Thread-safe.
+class ResponseCache {
+public:
+    // max_entries == 0 means no entry limit
+    ResponseCache(const std::string& dir, size_t max_bytes, size_t max_entries = 0);
+    ~ResponseCache();
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    // Body being written while it downloads; the content hash is computed on the fly.
+    class Writer {
+    public:
+        void append(std::string_view chunk);
+        size_t size() const { return bytes; }
+    private:
+        friend class ResponseCache;
+        std::string tmpPath;
+        std::ofstream out;
+        uint64_t hash = 1469598103934665603ULL; // FNV-1a 64 offset basis
+        size_t bytes = 0;
+        bool failed = false;
+    };
+
+    // Looks up url and maps its body. Returns nullptr (and counts a miss) when there is
+    // nothing to revalidate; otherwise fills validators and counts a revalidation.
+    std::shared_ptr<MappedBody> lookup(const std::string& url, CacheValidators& validators);
+    // the server answered 304 for a body returned by lookup()
+    void noteNotModified(size_t bytes);
+
+    std::unique_ptr<Writer> beginStore();
+    // completes a 200 response: moves the body into place and points url at it
+    void commit(const std::string& url, std::unique_ptr<Writer> writer, const CacheValidators& validators);
+    // drop a writer whose transfer failed or is being retried
+    void discard(std::unique_ptr<Writer> writer);
+
+    void flush();
+    CacheStats stats() const;
+    size_t bytesStored() const;
+    size_t entries() const;
+
+private:
+    struct Entry {
+        std::string url;
+        CacheValidators validators;
+        uint64_t hash = 0;
+    };
+    struct Body {
+        size_t size = 0;
+        size_t refs = 0;
+    };
+
+    std::string dir;
+    size_t maxBytes;
+    size_t maxEntries;
+
+    mutable std::mutex m;
+    std::list<Entry> lru; // most recently used at the front
+    std::unordered_map<std::string, std::list<Entry>::iterator> byUrl;
+    std::unordered_map<uint64_t, Body> bodies;
+    size_t totalBytes = 0;
+    size_t tmpCounter = 0;
+    CacheStats counters;
+
+    std::string bodyPath(uint64_t hash) const;
+    void load();
+    void saveLocked() const;
+    // the following expect m to be held
+    void dropLocked(std::list<Entry>::iterator it);
+    void releaseBodyLocked(uint64_t hash);
+    void evictLocked();
+};
@@ -1,32 +1,26 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:34
+// Date and time of the last changes: 18.10.2026. 01:20
 
 #include "Storage.hpp"
-#include <tbb/concurrent_vector.h>
-
-tbb::concurrent_vector<BookRecord> records;
 
 void Storage::storeResult(const AnalysisResult& result) {
-    std::lock_guard<std::mutex> lock(m);
-    results.push_back(result);
+    partials.local().mergeFrom(result); // no lock: each thread updates its own partial
 }
 
 void Storage::storeRecords(const std::vector<BookRecord>& recs) {
-    for (const auto& r : recs) records.push_back(r); // thread-safe
+    records.append(recs);
+    if (analytics) analytics->add(recs);
 }
 
-std::vector<BookRecord> Storage::snapshotRecords() const {
-    std::vector<BookRecord> out;
-    out.reserve(records.size());
-    for (const auto& r : records) out.push_back(r);
-    return out;
+void Storage::storeRecords(const std::vector<BookView>& recs) {
+    records.append(recs);
+    if (analytics) analytics->add(recs);
 }
 
 AnalysisResult Storage::getAggregatedResult() const {
     AnalysisResult total;
-    std::lock_guard<std::mutex> lock(m);
-    for (const auto& r : results) total.mergeFrom(r);
+    partials.combine_each([&total](const AnalysisResult& r) { total.mergeFrom(r); });
     return total;
 }
 
@@ -39,8 +33,7 @@ int Storage::pagesProcessed() const {
 }
 
 void Storage::reset() {
-    std::lock_guard<std::mutex> lock(m);
-    results.clear();
+    partials.clear();
     pages.store(0, std::memory_order_relaxed);
     records.clear();
-}
\ No newline at end of file
+}
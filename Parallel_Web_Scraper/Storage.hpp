@@ -1,28 +1,38 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:11
+// Date and time of the last changes: 18.10.2026. 01:20
 
 #pragma once
+#include "Analytics.hpp"
 #include "Analyzer.hpp"
 #include "Common.hpp"
-#include <tbb/concurrent_vector.h>
+#include "RecordStore.hpp"
+#include <tbb/combinable.h>
 #include <atomic>
-#include <mutex>
 #include <vector>
 
 class Storage {
-    mutable std::mutex m;
-    std::vector<AnalysisResult> results;
-    tbb::concurrent_vector<BookRecord> records; // thread-safe append
+    // per-thread partial aggregates; merged only when a snapshot is taken
+    mutable tbb::combinable<AnalysisResult> partials;
+    RecordStore records; // columnar, thread-safe append
+    AnalyticsEngine* analytics = nullptr;
     std::atomic<int> pages{ 0 };
 public:
+    // intern_titles: keep one copy of each distinct title
+    explicit Storage(bool intern_titles = false) : records(intern_titles) {}
+
     void storeResult(const AnalysisResult& result);
+    // stored records are also added to the engine's queries; nullptr = none
+    void setAnalytics(AnalyticsEngine* engine) { analytics = engine; }
+    // bulk append of one page; titles are copied into the store's arena
     void storeRecords(const std::vector<BookRecord>& records);
+    void storeRecords(const std::vector<BookView>& records);
     AnalysisResult getAggregatedResult() const;
     int pagesProcessed() const;
     void incrementPagesProcessed();
+    // not thread-safe: call only while no stage is storing
     void reset();
 
-    // accessor for recorded books
-    std::vector<BookRecord> snapshotRecords() const;
-};
\ No newline at end of file
+    // read-only view of the recorded books, valid until reset(); nothing is copied
+    const RecordStore& recordsView() const { return records; }
+};
@@ -0,0 +1,180 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 02:50
+
+// Randomized check of the ByteScan implementations: every ISA the CPU runs is forced in turn
+// and each function is compared with a naive reference on random texts. Lengths run from 0
+// to ~300 and texts start at random alignments, so the vector loops, their tails and the
+// misaligned starts all get exercised. Exits with 1 if any ISA disagrees with the reference;
+// the first mismatches are printed.
+//   bytescan_test [--iterations N] [--seed S]
+
+#include "../ByteScan.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr size_t npos = std::string_view::npos;
+
+char fold(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+bool matchesAt(std::string_view s, size_t pos, std::string_view needle) {
+    if (s.size() - pos < needle.size()) return false;
+    for (size_t k = 0; k < needle.size(); ++k) {
+        if (fold(s[pos + k]) != fold(needle[k])) return false;
+    }
+    return true;
+}
+
+size_t refFindByte(std::string_view s, char c, size_t from) {
+    for (size_t i = from; i < s.size(); ++i) if (s[i] == c) return i;
+    return npos;
+}
+
+size_t refFindAnyOf(std::string_view s, std::string_view set, size_t from) {
+    for (size_t i = from; i < s.size(); ++i) if (set.find(s[i]) != npos) return i;
+    return npos;
+}
+
+size_t refFindNoCase(std::string_view s, std::string_view needle, size_t from) {
+    if (needle.empty()) return from <= s.size() ? from : npos;
+    for (size_t i = from; i < s.size(); ++i) if (matchesAt(s, i, needle)) return i;
+    return npos;
+}
+
+// KeywordMatcher takes its keywords as an initializer list
+KeywordMatcher makeMatcher(const std::vector<std::string>& k) {
+    switch (k.size()) {
+    case 1: return KeywordMatcher{ k[0] };
+    case 2: return KeywordMatcher{ k[0], k[1] };
+    case 3: return KeywordMatcher{ k[0], k[1], k[2] };
+    case 4: return KeywordMatcher{ k[0], k[1], k[2], k[3] };
+    case 5: return KeywordMatcher{ k[0], k[1], k[2], k[3], k[4] };
+    case 6: return KeywordMatcher{ k[0], k[1], k[2], k[3], k[4], k[5] };
+    case 7: return KeywordMatcher{ k[0], k[1], k[2], k[3], k[4], k[5], k[6] };
+    default: return KeywordMatcher{ k[0], k[1], k[2], k[3], k[4], k[5], k[6], k[7] };
+    }
+}
+
+class Checker {
+public:
+    Checker(uint64_t seed) : rng(seed) {}
+
+    void run(ScanIsa isa, int iterations) {
+        scanSelectIsa(isa);
+        if (scanActiveIsa() != isa) {
+            std::cout << scanIsaName(isa) << ": not supported by this CPU, skipped\n";
+            return;
+        }
+        size_t before = failures;
+        for (int it = 0; it < iterations && failures - before < 20; ++it) {
+            std::string_view s = randomText();
+            size_t from = uniform(0, s.size() + 2);
+
+            char c = pick();
+            expect(isa, "scanFindByte", scanFindByte(s, c, from), refFindByte(s, c, from));
+
+            std::string set;
+            for (size_t n = uniform(1, 8); set.size() < n;) set += pick();
+            expect(isa, "scanFindAnyOf", scanFindAnyOf(s, set, from), refFindAnyOf(s, set, from));
+
+            std::string needle = keyword(s);
+            expect(isa, "scanFindNoCase", scanFindNoCase(s, needle, from), refFindNoCase(s, needle, from));
+
+            std::vector<std::string> keywords;
+            for (size_t n = uniform(1, KeywordMatcher::MaxPatterns); keywords.size() < n;) {
+                std::string k = keyword(s);
+                if (!k.empty()) keywords.push_back(k);
+            }
+            KeywordMatcher matcher = makeMatcher(keywords);
+            size_t first[KeywordMatcher::MaxPatterns], counts[KeywordMatcher::MaxPatterns];
+            matcher.findFirst(s, first, from);
+            matcher.count(s, counts);
+            for (size_t i = 0; i < matcher.size(); ++i) {
+                const std::string& k = matcher.pattern(i);
+                size_t expected = 0;
+                for (size_t p = 0; p < s.size(); ++p) expected += matchesAt(s, p, k);
+                expect(isa, "KeywordMatcher::findFirst", first[i], refFindNoCase(s, k, from));
+                expect(isa, "KeywordMatcher::count", counts[i], expected);
+            }
+        }
+        std::cout << scanIsaName(isa) << ": " << (failures == before ? "ok" : "FAILED") << "\n";
+    }
+
+    size_t failed() const { return failures; }
+
+private:
+    std::mt19937_64 rng;
+    std::vector<char> storage = std::vector<char>(512);
+    std::string_view text;
+    size_t failures = 0;
+
+    size_t uniform(size_t lo, size_t hi) {
+        return std::uniform_int_distribution<size_t>(lo, hi)(rng);
+    }
+
+    // a small alphabet, so matches are frequent: both cases of a few letters, the bytes one
+    // case bit away from letters ('@' '`' '[' '{'), HTML punctuation and bytes above 0x7F
+    char pick() {
+        static const char alphabet[] = "aAbBpPoOzZ@`[{<>\"= \xC1\xE1\xFF";
+        return alphabet[uniform(0, sizeof(alphabet) - 2)];
+    }
+
+    std::string_view randomText() {
+        size_t length = uniform(0, 300);
+        size_t offset = uniform(0, 63); // start anywhere within a cache line
+        for (size_t i = 0; i < length; ++i) storage[offset + i] = pick();
+        text = std::string_view(storage.data() + offset, length);
+        return text;
+    }
+
+    // usually a piece of the text with its letters' case flipped at random, else random bytes
+    std::string keyword(std::string_view s) {
+        size_t length = uniform(0, 6);
+        std::string k;
+        if (!s.empty() && uniform(0, 3) > 0) {
+            size_t at = uniform(0, s.size() - 1);
+            k = std::string(s.substr(at, length));
+            for (char& ch : k) {
+                if (uniform(0, 1) && ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'))) ch ^= 0x20;
+            }
+        }
+        else {
+            while (k.size() < length) k += pick();
+        }
+        return k;
+    }
+
+    void expect(ScanIsa isa, const char* what, size_t got, size_t want) {
+        if (got == want) return;
+        if (++failures > 60) return; // enough to go on
+        std::cout << scanIsaName(isa) << " " << what << ": got " << static_cast<long long>(got)
+            << ", expected " << static_cast<long long>(want) << " (length " << text.size()
+            << ", alignment " << reinterpret_cast<uintptr_t>(text.data()) % 64 << ")\n";
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = 20000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a(argv[i]);
+        if (a == "--iterations" && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        if (a == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    Checker checker(seed);
+    for (ScanIsa isa : { ScanIsa::Scalar, ScanIsa::SSE2, ScanIsa::AVX2 }) checker.run(isa, iterations);
+    return checker.failed() == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 04:10
+
+// Concurrent appends to the RecordStore: many threads append small pages at once, as the
+// store node does, and afterwards every row must be present exactly once with its price,
+// rating and title intact. Pages alternate between BookRecord and BookView and some titles
+// repeat, so both append paths and the intern table are exercised. Exits with 1 on any
+// lost or damaged row; the first ones are printed.
+//   recordstore_test [--pages N] [--threads T] [--rounds R]
+
+#include "../RecordStore.hpp"
+
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// row k of page p: a unique price that encodes both, a rating and a title naming the row;
+// every eighth title is shared by all pages so interning has something to do
+double priceOf(size_t p, size_t k) { return static_cast<double>(p * 100 + k) + 0.25; }
+int ratingOf(size_t p, size_t k) { return static_cast<int>((p + k) % 6); }
+std::string titleOf(size_t p, size_t k) {
+    return k % 8 == 0 ? "shared title " + std::to_string(k) : "page " + std::to_string(p) + " row " + std::to_string(k);
+}
+size_t rowsOf(size_t p) { return 1 + p % 37; }
+
+void appendPage(RecordStore& store, size_t p) {
+    if (p % 2) {
+        std::vector<BookRecord> recs;
+        for (size_t k = 0; k < rowsOf(p); ++k) recs.push_back({ titleOf(p, k), priceOf(p, k), ratingOf(p, k) });
+        store.append(recs);
+    }
+    else {
+        std::vector<std::string> titles;
+        for (size_t k = 0; k < rowsOf(p); ++k) titles.push_back(titleOf(p, k));
+        std::vector<BookView> recs;
+        for (size_t k = 0; k < rowsOf(p); ++k) recs.push_back({ titles[k], priceOf(p, k), ratingOf(p, k) });
+        store.append(recs); // the store copies the titles, the page's strings go away
+    }
+}
+
+size_t check(const RecordStore& store, size_t pages, bool intern) {
+    size_t expected = 0;
+    for (size_t p = 0; p < pages; ++p) expected += rowsOf(p);
+    size_t failures = 0;
+    auto fail = [&failures](const std::string& what) {
+        if (++failures <= 20) std::cout << "  " << what << "\n";
+    };
+    if (store.size() != expected)
+        fail("size " + std::to_string(store.size()) + ", expected " + std::to_string(expected));
+
+    std::vector<std::vector<char>> seen(pages);
+    for (size_t p = 0; p < pages; ++p) seen[p].assign(rowsOf(p), 0);
+    for (size_t i = 0; i < store.size(); ++i) {
+        BookView b = store.at(i);
+        size_t id = static_cast<size_t>(b.price); // p * 100 + k
+        size_t p = id / 100, k = id % 100;
+        if (b.price != priceOf(p, k) || p >= pages || k >= rowsOf(p)) {
+            fail("row " + std::to_string(i) + ": unexpected price " + std::to_string(b.price));
+            continue;
+        }
+        if (seen[p][k]++) fail("row " + std::to_string(i) + ": page " + std::to_string(p) + " row " + std::to_string(k) + " stored twice");
+        if (b.rating != ratingOf(p, k)) fail("row " + std::to_string(i) + ": rating " + std::to_string(b.rating));
+        if (b.title != titleOf(p, k)) fail("row " + std::to_string(i) + ": title \"" + std::string(b.title) + "\"");
+    }
+    if (intern && store.internedTitles() > expected - expected / 8 + 8)
+        fail("interned " + std::to_string(store.internedTitles()) + " titles, shared ones were not merged");
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t pages = 20000;
+    int threads = 8;
+    int rounds = 4;
+    for (int i = 1; i < argc; ++i) {
+        std::string a(argv[i]);
+        if (a == "--pages" && i + 1 < argc) pages = std::strtoull(argv[++i], nullptr, 10);
+        if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        if (a == "--rounds" && i + 1 < argc) rounds = std::atoi(argv[++i]);
+    }
+
+    if (threads < 1) threads = 1;
+    // the threads are wanted even on a machine with fewer cores: the appends have to overlap
+    tbb::global_control parallelism(tbb::global_control::max_allowed_parallelism, threads);
+    tbb::task_arena arena(threads);
+    size_t failures = 0;
+    for (bool intern : { false, true }) {
+        RecordStore store(intern);
+        for (int r = 0; r < rounds; ++r) {
+            store.clear();
+            // grain 1: neighbouring pages land on different threads and their appends overlap
+            arena.execute([&] {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, pages, 1), [&](const tbb::blocked_range<size_t>& range) {
+                    for (size_t p = range.begin(); p != range.end(); ++p) appendPage(store, p);
+                });
+            });
+            size_t failed = check(store, pages, intern);
+            std::cout << (intern ? "interned" : "plain") << " round " << r + 1 << ": "
+                << (failed == 0 ? "ok" : "FAILED") << "\n";
+            failures += failed;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
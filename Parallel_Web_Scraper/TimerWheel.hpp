@@ -0,0 +1,109 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 05:10
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hashed timing wheel: items are parked in the slot of their due tick and handed back by
+// expire() once due. Scheduling is O(1); expire() only visits the slots the clock moved
+// past. Items due more than one revolution ahead simply stay in their slot for later rounds.
+// Every slot keeps the earliest due time of its items, so the next wakeup is found from the
+// slot minima without walking the parked items.
+// Not thread-safe: owned by a single thread (the AsyncDownloader I/O thread).
+template <typename T>
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10), size_t slot_count = 512)
+        : tickMs(std::max<long long>(tick.count(), 1)), slots(std::max<size_t>(slot_count, 1)),
+        earliest(slots.size(), Clock::time_point::max()), origin(Clock::now()) {
+    }
+
+    void schedule(T item, Clock::time_point due) {
+        uint64_t t = std::max(tickOf(due), current);
+        size_t s = t % slots.size();
+        slots[s].push_back(Entry{ due, std::move(item) });
+        earliest[s] = std::min(earliest[s], due);
+        soonest = std::min(soonest, due);
+        ++count;
+    }
+
+    // moves every item due at or before now into out
+    void expire(Clock::time_point now, std::vector<T>& out) {
+        uint64_t nowTick = tickOf(now);
+        uint64_t steps = std::min<uint64_t>(nowTick - std::min(nowTick, current), slots.size() - 1);
+        bool soonestVisited = false;
+        for (uint64_t k = 0; k <= steps && count > 0; ++k) {
+            size_t s = (current + k) % slots.size();
+            auto& slot = slots[s];
+            if (slot.empty()) continue;
+            soonestVisited = soonestVisited || earliest[s] == soonest;
+            Clock::time_point left = Clock::time_point::max(); // earliest of the items kept
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].due > now) { left = std::min(left, slot[i].due); ++i; continue; }
+                out.push_back(std::move(slot[i].item));
+                slot[i] = std::move(slot.back());
+                slot.pop_back();
+                --count;
+            }
+            earliest[s] = left;
+        }
+        current = std::max(current, nowTick);
+        if (count == 0) soonest = Clock::time_point::max();
+        else if (soonestVisited) soonest = *std::min_element(earliest.begin(), earliest.end());
+    }
+
+    // when expire() next has something to hand back: the earliest due time of all items, not
+    // before the next tick boundary unless an item is already overdue, so a poll loop does
+    // not spin inside a tick; false when empty
+    bool nextWakeup(Clock::time_point now, Clock::time_point& at) const {
+        if (count == 0) return false;
+        at = soonest;
+        if (at <= now) at = now;
+        else at = std::max(at, tickStart(tickOf(now) + 1));
+        return true;
+    }
+
+    // removes every parked item regardless of its due time
+    void drain(std::vector<T>& out) {
+        for (auto& slot : slots) {
+            for (auto& e : slot) out.push_back(std::move(e.item));
+            slot.clear();
+        }
+        std::fill(earliest.begin(), earliest.end(), Clock::time_point::max());
+        soonest = Clock::time_point::max();
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    struct Entry {
+        Clock::time_point due;
+        T item;
+    };
+
+    long long tickMs;
+    std::vector<std::vector<Entry>> slots;
+    std::vector<Clock::time_point> earliest;             // per slot; max() when empty
+    Clock::time_point soonest = Clock::time_point::max(); // minimum of earliest
+    Clock::time_point origin;
+    uint64_t current = 0; // tick expire() has advanced to
+    size_t count = 0;
+
+    Clock::time_point tickStart(uint64_t tick) const {
+        return origin + std::chrono::milliseconds(static_cast<long long>(tick) * tickMs);
+    }
+
+    uint64_t tickOf(Clock::time_point t) const {
+        if (t <= origin) return 0;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(t - origin).count() / tickMs);
+    }
+};
@@ -1,23 +1,130 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 11:09
+// Date and time of the last changes: 17.10.2026. 22:40
 
 #include "UrlManager.hpp"
-#include <tbb/parallel_for.h>
+#include "Log.hpp"
+#include <cctype>
 #include <fstream>
 #include <iostream>
-#include <regex>
-#include <mutex>
-
-void UrlManager::addUrl(const std::string& url) {
-    static const std::regex urlRe(R"(^https?://[^\s/$.?#].[^\s]*$)");
-    if (!std::regex_match(url, urlRe)) {
-        std::cerr << "[UrlManager] Invalid URL: " << url << "\n";
-        return;
+#include <vector>
+
+static inline char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+static inline bool isHexDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// appends text with the hex digits of %xx escapes in upper case
+static void appendEscaped(std::string& out, std::string_view text) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        out += c;
+        if (c == '%' && i + 2 < text.size() && isHexDigit(text[i + 1]) && isHexDigit(text[i + 2])) {
+            out += static_cast<char>(std::toupper(static_cast<unsigned char>(text[i + 1])));
+            out += static_cast<char>(std::toupper(static_cast<unsigned char>(text[i + 2])));
+            i += 2;
+        }
     }
-    if (visited.insert(url).second) {
-        urls.push_back(url);
+}
+
+bool canonicalizeUrl(std::string_view url, std::string& out) {
+    out.clear();
+    while (!url.empty() && std::isspace(static_cast<unsigned char>(url.front()))) url.remove_prefix(1);
+    while (!url.empty() && std::isspace(static_cast<unsigned char>(url.back()))) url.remove_suffix(1);
+    for (char c : url) {
+        if (std::isspace(static_cast<unsigned char>(c))) return false;
+    }
+
+    size_t schemeEnd = url.find("://");
+    if (schemeEnd == std::string_view::npos) return false;
+    for (size_t i = 0; i < schemeEnd; ++i) out += lowerAscii(url[i]);
+    bool https = out == "https";
+    if (!https && out != "http") return false;
+    out += "://";
+
+    // authority: [userinfo@]host[:port]
+    size_t hostBegin = schemeEnd + 3;
+    size_t authorityEnd = url.find_first_of("/?#", hostBegin);
+    if (authorityEnd == std::string_view::npos) authorityEnd = url.size();
+    std::string_view authority = url.substr(hostBegin, authorityEnd - hostBegin);
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        out.append(authority.data(), at + 1);
+        authority.remove_prefix(at + 1);
     }
+    size_t colon = authority.rfind(':');
+    std::string_view port;
+    if (colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+        port = authority.substr(colon + 1);
+        authority = authority.substr(0, colon);
+    }
+    if (authority.empty()) return false;
+    for (char c : authority) out += lowerAscii(c);
+    if (!port.empty() && port != (https ? "443" : "80")) {
+        out += ':';
+        out.append(port.data(), port.size());
+    }
+
+    // path with dot segments removed; segments are appended one by one
+    size_t pathEnd = url.find_first_of("?#", authorityEnd);
+    if (pathEnd == std::string_view::npos) pathEnd = url.size();
+    std::string_view path = url.substr(authorityEnd, pathEnd - authorityEnd);
+    const size_t pathBegin = out.size();
+    size_t pos = path.empty() ? 0 : 1;
+    while (pos <= path.size() && !path.empty()) {
+        size_t slash = path.find('/', pos);
+        if (slash == std::string_view::npos) slash = path.size();
+        std::string_view seg = path.substr(pos, slash - pos);
+        bool last = slash == path.size();
+        if (seg == "..") {
+            size_t prev = out.rfind('/');
+            out.resize(prev != std::string::npos && prev >= pathBegin ? prev : pathBegin);
+            if (last) out += '/';
+        }
+        else if (seg == ".") {
+            if (last) out += '/';
+        }
+        else {
+            out += '/';
+            appendEscaped(out, seg);
+        }
+        pos = slash + 1;
+    }
+    if (out.size() == pathBegin) out += '/';
+
+    // query is kept, the fragment is dropped
+    if (pathEnd < url.size() && url[pathEnd] == '?') {
+        size_t queryEnd = url.find('#', pathEnd);
+        if (queryEnd == std::string_view::npos) queryEnd = url.size();
+        if (queryEnd > pathEnd + 1) appendEscaped(out, url.substr(pathEnd, queryEnd - pathEnd));
+    }
+    return true;
+}
+
+// per-thread scratch for the canonical form, so lookups of known URLs do not allocate
+static std::string& canonicalScratch() {
+    static thread_local std::string scratch;
+    return scratch;
+}
+
+UrlManager::UrlManager(DedupeMode mode, size_t expected_urls, double bloom_fpr)
+    : visited(mode, expected_urls, bloom_fpr) {
+}
+
+bool UrlManager::addUrl(std::string_view url) {
+    std::string& canonical = canonicalScratch();
+    if (!canonicalizeUrl(url, canonical)) {
+        LOG_RATE(LogLevel::Warn, 1000, "UrlManager", "Invalid URL: {}", url);
+        return false;
+    }
+    if (visited.insert(urlFingerprint(canonical))) {
+        urls.push_back(canonical);
+        return true;
+    }
+    return false;
 }
 
 size_t UrlManager::loadFromFile(const std::string& path) {
@@ -51,26 +158,90 @@ std::vector<std::string> UrlManager::getUrlsSnapshot() const {
     return snap;
 }
 
-bool UrlManager::markVisitedIfNew(const std::string& url) {
-    return visited.insert(url).second;
+bool UrlManager::markVisitedIfNew(std::string_view url) {
+    std::string& canonical = canonicalScratch();
+    if (!canonicalizeUrl(url, canonical)) return false;
+    return visited.insert(urlFingerprint(canonical));
 }
 
 size_t UrlManager::uniqueCount() const {
     return visited.size();
 }
 
-int UrlManager::crawlIndex(Downloader& downloader, const std::string& baseUrl, int maxPages) {
-    std::atomic<int> num{ 0 };
-    addUrl(baseUrl + "page-1.html");  // Page-1
-
-    tbb::parallel_for(2, maxPages + 1, [&](int i) {
-        std::string url = baseUrl + "page-" + std::to_string(i) + ".html";
-        std::string html = downloader.downloadPage(url);
-        if (!html.empty()) {
-            addUrl(url);
-            ++num;
+// "a/./b/../c" -> "a/c"; path starts with '/'
+static std::string removeDotSegments(std::string_view path) {
+    std::vector<std::string_view> segments;
+    size_t pos = 1;
+    while (pos <= path.size()) {
+        size_t slash = path.find('/', pos);
+        if (slash == std::string_view::npos) slash = path.size();
+        std::string_view seg = path.substr(pos, slash - pos);
+        bool last = slash == path.size();
+        if (seg == "..") {
+            if (!segments.empty()) segments.pop_back();
+            if (last) segments.push_back("");
+        }
+        else if (seg == ".") {
+            if (last) segments.push_back("");
+        }
+        else {
+            segments.push_back(seg);
         }
-        });
+        pos = slash + 1;
+    }
+    std::string out;
+    for (auto seg : segments) {
+        out += '/';
+        out.append(seg.data(), seg.size());
+    }
+    return out.empty() ? "/" : out;
+}
+
+std::string resolveUrl(const std::string& base, std::string_view href) {
+    while (!href.empty() && std::isspace(static_cast<unsigned char>(href.front()))) href.remove_prefix(1);
+    while (!href.empty() && std::isspace(static_cast<unsigned char>(href.back()))) href.remove_suffix(1);
+    size_t hash = href.find('#');
+    if (hash != std::string_view::npos) href = href.substr(0, hash);
+    if (href.empty()) return "";
+
+    // explicit scheme: only http and https are followed
+    size_t colon = href.find(':');
+    if (colon != std::string_view::npos && colon < href.find_first_of("/?")) {
+        std::string scheme(href.substr(0, colon));
+        for (char& c : scheme) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (scheme != "http" && scheme != "https") return "";
+        size_t hostEnd = href.find_first_of("/?", colon + 3);
+        if (hostEnd == std::string_view::npos) return std::string(href) + "/";
+        if (href[hostEnd] == '?') return std::string(href.substr(0, hostEnd)) + "/" + std::string(href.substr(hostEnd));
+        size_t query = href.find('?', hostEnd);
+        std::string_view path = href.substr(hostEnd, query == std::string_view::npos ? std::string_view::npos : query - hostEnd);
+        std::string out(href.substr(0, hostEnd));
+        out += removeDotSegments(path);
+        if (query != std::string_view::npos) out.append(href.substr(query));
+        return out;
+    }
+
+    size_t schemeEnd = base.find("://");
+    if (schemeEnd == std::string::npos) return "";
+    size_t pathBegin = base.find_first_of("/?#", schemeEnd + 3);
+    std::string origin = base.substr(0, pathBegin);
+    if (href.size() >= 2 && href[0] == '/' && href[1] == '/')
+        return resolveUrl(base, base.substr(0, schemeEnd + 1) + std::string(href));
+
+    std::string basePath = "/";
+    if (pathBegin != std::string::npos && base[pathBegin] == '/')
+        basePath = base.substr(pathBegin, base.find_first_of("?#", pathBegin) - pathBegin);
 
-    return num;
-}
\ No newline at end of file
+    std::string path;
+    std::string_view query;
+    size_t q = href.find('?');
+    std::string_view ref = href.substr(0, q);
+    if (q != std::string_view::npos) query = href.substr(q);
+    if (ref.empty()) path = basePath;                   // "?page=2"
+    else if (ref[0] == '/') path.assign(ref.data(), ref.size());
+    else path = basePath.substr(0, basePath.rfind('/') + 1) + std::string(ref);
+
+    std::string out = origin + removeDotSegments(path);
+    out.append(query.data(), query.size());
+    return out;
+}
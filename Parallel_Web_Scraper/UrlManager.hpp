@@ -1,24 +1,42 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 10:10
+// Date and time of the last changes: 17.10.2026. 18:40
 
 #pragma once
-#include "Downloader.hpp"
+#include "VisitedSet.hpp"
 #include <string>
+#include <string_view>
+#include <vector>
 #include <tbb/concurrent_vector.h>
-#include <tbb/concurrent_unordered_set.h>
-#include <unordered_set>
 
+// URLs are canonicalized before dedupe and stored once, in canonical form, in urls;
+// the visited set only keeps 64-bit fingerprints (or Bloom filter bits).
 class UrlManager {
     tbb::concurrent_vector<std::string> urls;
-    tbb::concurrent_unordered_set<std::string> visited;
+    VisitedSet visited;
 public:
-    void addUrl(const std::string& url);
+    // expected_urls sizes the visited set; bloom_fpr is used only in DedupeMode::Bloom
+    explicit UrlManager(DedupeMode mode = DedupeMode::Exact, size_t expected_urls = 1 << 12,
+        double bloom_fpr = 0.001);
+
+    // false when the URL is invalid or already known; allocates only when the URL is new
+    bool addUrl(std::string_view url);
     size_t loadFromFile(const std::string& path);
     void loadFromConsole();
     std::vector<std::string> getUrlsSnapshot() const;
-    bool markVisitedIfNew(const std::string& url);
+    // allocation-free
+    bool markVisitedIfNew(std::string_view url);
     size_t uniqueCount() const;
-    // crawl index page (synchronously, returns discovered urls)
-    int crawlIndex(Downloader& downloader, const std::string& baseUrl, int maxPages);
-};
\ No newline at end of file
+    DedupeMode dedupeMode() const { return visited.mode(); }
+    // bytes held by the visited set
+    size_t dedupeMemoryBytes() const { return visited.memoryBytes(); }
+};
+
+// Canonical form used for dedupe: lowercase scheme and host, no default port, no fragment,
+// dot segments removed, empty path as "/", %xx escapes in upper case. Writes into out
+// (reusing its capacity); false when url is not an absolute http(s) URL.
+bool canonicalizeUrl(std::string_view url, std::string& out);
+
+// Resolve an href found on page base into an absolute http(s) URL without its fragment;
+// returns an empty string for other schemes (mailto:, javascript:, ...) and empty links.
+std::string resolveUrl(const std::string& base, std::string_view href);
\ No newline at end of file
@@ -0,0 +1,161 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 04:50
+
+#include "VisitedSet.hpp"
+#include <algorithm>
+#include <cmath>
+
+// murmur3 finalizer: spreads FNV's weak low bits over the whole word
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t urlFingerprint(std::string_view url) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : url) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h = mix64(h);
+    return h != 0 ? h : 1;
+}
+
+// ------------------ FingerprintSet -------------------
+static size_t roundUpPow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+FingerprintSet::FingerprintSet(size_t expected)
+    : slots(new std::atomic<uint64_t>[roundUpPow2(expected + expected / 3)]()),
+    capacity(roundUpPow2(expected + expected / 3)) {
+}
+
+bool FingerprintSet::insert(uint64_t fp) {
+    if (fp == 0) fp = 1;
+    while (true) {
+        size_t seen;
+        bool inserted = false;
+        {
+            tbb::spin_rw_mutex::scoped_lock lock(resizeMutex, false);
+            seen = capacity;
+            size_t mask = capacity - 1;
+            size_t i = static_cast<size_t>(fp) & mask;
+            for (size_t probes = 0; probes < capacity; ++probes, i = (i + 1) & mask) {
+                uint64_t v = slots[i].load(std::memory_order_acquire);
+                if (v == fp) return false;
+                if (v != 0) continue;
+                if (slots[i].compare_exchange_strong(v, fp, std::memory_order_acq_rel)) {
+                    inserted = true;
+                    break;
+                }
+                if (v == fp) return false; // another thread inserted the same fingerprint
+            }
+            if (inserted && (count.fetch_add(1, std::memory_order_relaxed) + 1) * 4 <= seen * 3)
+                return true;
+        }
+        grow(seen); // table is 3/4 full (or, if nothing was inserted, completely full)
+        if (inserted) return true;
+    }
+}
+
+bool FingerprintSet::contains(uint64_t fp) const {
+    if (fp == 0) fp = 1;
+    tbb::spin_rw_mutex::scoped_lock lock(resizeMutex, false);
+    size_t mask = capacity - 1;
+    size_t i = static_cast<size_t>(fp) & mask;
+    for (size_t probes = 0; probes < capacity; ++probes, i = (i + 1) & mask) {
+        uint64_t v = slots[i].load(std::memory_order_acquire);
+        if (v == fp) return true;
+        if (v == 0) return false;
+    }
+    return false;
+}
+
+void FingerprintSet::grow(size_t seen_capacity) {
+    tbb::spin_rw_mutex::scoped_lock lock(resizeMutex, true);
+    if (capacity != seen_capacity) return; // another thread already grew it
+    size_t newCapacity = capacity * 2;
+    std::unique_ptr<std::atomic<uint64_t>[]> table(new std::atomic<uint64_t>[newCapacity]());
+    size_t mask = newCapacity - 1;
+    for (size_t j = 0; j < capacity; ++j) {
+        uint64_t v = slots[j].load(std::memory_order_relaxed);
+        if (v == 0) continue;
+        size_t i = static_cast<size_t>(v) & mask;
+        while (table[i].load(std::memory_order_relaxed) != 0) i = (i + 1) & mask;
+        table[i].store(v, std::memory_order_relaxed);
+    }
+    slots = std::move(table);
+    capacity = newCapacity;
+}
+
+size_t FingerprintSet::memoryBytes() const {
+    tbb::spin_rw_mutex::scoped_lock lock(resizeMutex, false);
+    return capacity * sizeof(uint64_t);
+}
+
+void FingerprintSet::clear() {
+    for (size_t i = 0; i < capacity; ++i) slots[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+}
+
+// ------------------ BloomFilter -------------------
+BloomFilter::BloomFilter(size_t expected, double false_positive_rate) {
+    const double ln2 = std::log(2.0);
+    double p = std::min(std::max(false_positive_rate, 1e-9), 0.5);
+    double n = static_cast<double>(std::max<size_t>(expected, 1));
+    double m = std::ceil(-n * std::log(p) / (ln2 * ln2));
+    words = std::max<size_t>(1, static_cast<size_t>((m + 63) / 64));
+    k = std::max<size_t>(1, static_cast<size_t>(std::lround(m / n * ln2)));
+    bits.reset(new std::atomic<uint64_t>[words]());
+}
+
+// double hashing: bit i = h1 + i * h2 over the filter's bits
+bool BloomFilter::insert(uint64_t fp) {
+    uint64_t h1 = fp;
+    uint64_t h2 = mix64(fp) | 1;
+    uint64_t total = static_cast<uint64_t>(words) * 64;
+    bool fresh = false;
+    tbb::spin_mutex::scoped_lock lock(stripes[(h2 >> 32) % StripeCount].mutex);
+    for (size_t i = 0; i < k; ++i) {
+        uint64_t bit = (h1 + i * h2) % total;
+        uint64_t mask = 1ULL << (bit & 63);
+        if (!(bits[bit >> 6].fetch_or(mask, std::memory_order_relaxed) & mask)) fresh = true;
+    }
+    if (fresh) count.fetch_add(1, std::memory_order_relaxed);
+    return fresh;
+}
+
+bool BloomFilter::contains(uint64_t fp) const {
+    uint64_t h1 = fp;
+    uint64_t h2 = mix64(fp) | 1;
+    uint64_t total = static_cast<uint64_t>(words) * 64;
+    for (size_t i = 0; i < k; ++i) {
+        uint64_t bit = (h1 + i * h2) % total;
+        if (!(bits[bit >> 6].load(std::memory_order_relaxed) & (1ULL << (bit & 63)))) return false;
+    }
+    return true;
+}
+
+void BloomFilter::clear() {
+    for (size_t i = 0; i < words; ++i) bits[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+}
+
+// ------------------ VisitedSet -------------------
+VisitedSet::VisitedSet(DedupeMode mode, size_t expected, double false_positive_rate) {
+    if (mode == DedupeMode::Bloom) bloom = std::make_unique<BloomFilter>(expected, false_positive_rate);
+    else exact = std::make_unique<FingerprintSet>(expected);
+}
+
+void VisitedSet::clear() {
+    if (bloom) bloom->clear();
+    else exact->clear();
+}
@@ -0,0 +1,84 @@
+﻿// Project: Parallel Web Scraper
+// Name of an author: Nikolić Dalibor SV13-2023
+// Date and time of the last changes: 18.10.2026. 04:50
+
+#pragma once
+#include <tbb/spin_mutex.h>
+#include <tbb/spin_rw_mutex.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// 64-bit fingerprint of a (canonical) URL; never 0
+uint64_t urlFingerprint(std::string_view url);
+
+// Lock-free open-addressing set of fingerprints (linear probing, insert by CAS on an
+// empty slot). Probing only holds the resize lock shared; the table doubles under the
+// exclusive lock once it is 3/4 full.
+class FingerprintSet {
+public:
+    explicit FingerprintSet(size_t expected = 1 << 16);
+    // true when fp was not in the set yet
+    bool insert(uint64_t fp);
+    bool contains(uint64_t fp) const;
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+    size_t memoryBytes() const;
+    // not thread-safe
+    void clear();
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> slots; // 0 = empty
+    size_t capacity = 0;                            // power of two
+    std::atomic<size_t> count{ 0 };
+    mutable tbb::spin_rw_mutex resizeMutex;
+
+    void grow(size_t seen_capacity);
+};
+
+// Bloom filter over fingerprints, sized for expected insertions at the given false-positive
+// rate. A false positive makes a new URL look visited, so it trades a small, bounded loss of
+// URLs for about 1.44 * log2(1 / fpr) bits per URL. The rate degrades past the expected count.
+class BloomFilter {
+public:
+    BloomFilter(size_t expected, double false_positive_rate);
+    // true when at least one of the URL's bits was still clear; of several threads inserting
+    // the same fingerprint at once exactly one gets true
+    bool insert(uint64_t fp);
+    bool contains(uint64_t fp) const;
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+    size_t memoryBytes() const { return words * sizeof(uint64_t); }
+    size_t hashes() const { return k; }
+    void clear();
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> bits;
+    size_t words = 0;
+    size_t k = 1;
+    std::atomic<size_t> count{ 0 };
+    // an insert sets and tests its bits under the stripe of its fingerprint, so two inserts
+    // of one URL cannot both find some bit clear; different URLs rarely share a stripe
+    struct alignas(64) Stripe {
+        tbb::spin_mutex mutex;
+    };
+    static constexpr size_t StripeCount = 64;
+    Stripe stripes[StripeCount];
+};
+
+enum class DedupeMode { Exact, Bloom };
+
+// visited-URL set used by the UrlManager: exact fingerprints or an approximate Bloom filter
+class VisitedSet {
+public:
+    VisitedSet(DedupeMode mode, size_t expected, double false_positive_rate);
+    bool insert(uint64_t fp) { return bloom ? bloom->insert(fp) : exact->insert(fp); }
+    bool contains(uint64_t fp) const { return bloom ? bloom->contains(fp) : exact->contains(fp); }
+    size_t size() const { return bloom ? bloom->size() : exact->size(); }
+    size_t memoryBytes() const { return bloom ? bloom->memoryBytes() : exact->memoryBytes(); }
+    DedupeMode mode() const { return bloom ? DedupeMode::Bloom : DedupeMode::Exact; }
+    void clear();
+
+private:
+    std::unique_ptr<FingerprintSet> exact;
+    std::unique_ptr<BloomFilter> bloom;
+};
@@ -1,162 +1,68 @@
 ﻿// Project: Parallel Web Scraper
 // Name of an author: Nikolić Dalibor SV13-2023
-// Date and time of the last changes: 16.09.2025. 13:02
+// Date and time of the last changes: 18.10.2026. 02:00
 
 #include "Downloader.hpp"
+#include "ResponseCache.hpp"
+#include "Analytics.hpp"
 #include "Analyzer.hpp"
 #include "Storage.hpp"
 #include "UrlManager.hpp"
+#include "CrawlFrontier.hpp"
+#include "CrawlCheckpoint.hpp"
+#include "ConcurrencyController.hpp"
+#include "Pipeline.hpp"
+#include "Metrics.hpp"
+#include "Log.hpp"
+#include "MemoryBudget.hpp"
+#include "PageArchive.hpp"
+#include "ParseCache.hpp"
+#include "RecordExport.hpp"
 #include "Common.hpp"
 
 #include <tbb/tbb.h>
-#include <tbb/parallel_pipeline.h>
 #include <tbb/global_control.h>
 
 #include <curl/curl.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
-#include <chrono>
-#include <atomic>
+#include <sstream>
+#include <thread>
 #include <memory>
 
-// ------------------ Result helper -------------------
-struct Result {
-    int pages;
-    double seconds;
-    double throughput;
-    AnalysisResult result;
-};
-
-// ------------------ Serial run -------------------
-Result runSerial(const std::vector<std::string>& urls,
-    Downloader& downloader,
-    Analyzer& analyzer,
-    Storage& storage,
-    std::ostream& out) {
-    auto start = std::chrono::steady_clock::now();
-
-    for (const auto& url : urls) {
-        try {
-            std::string html = downloader.downloadPage(url);
-            if (html.empty()) {
-                std::cerr << "[serial] Failed to download: " << url << "\n";
-                continue;
-            }
-            else {
-                std::cout << "[serial] Downloaded " << url
-                    << " (length=" << html.size() << ")\n";
-            }
-            auto pr = analyzer.parsePageRecords(html);
-            storage.storeResult(pr.second);
-            storage.storeRecords(pr.first);
-            storage.incrementPagesProcessed();
-        }
-        catch (const std::exception& ex) {
-            std::cerr << "[serial] Exception: " << ex.what()
-                << " for " << url << "\n";
-        }
-    }
-
-    auto end = std::chrono::steady_clock::now();
-    double seconds = std::chrono::duration<double>(end - start).count();
-    int pages = storage.pagesProcessed();
-    AnalysisResult total = storage.getAggregatedResult();
-    double avgPrice = (total.bookCount ? total.totalPrice / total.bookCount : 0.0);
-    double throughput = (seconds > 0.0 ? pages / seconds : pages);
-
-    out << "\nSerial Web Scraper Results\n";
-    out << "==========================\n";
-    out << "Pages downloaded: " << pages << "\n";
-    out << "Unique URLs (visited): " << urls.size() << "\n";
-    out << "Elapsed time (s): " << seconds << "\n";
-    out << "Throughput (pages/sec): " << throughput << " pages/s\n\n";
-    out << "Analysis summary (aggregated):\n";
-    out << "Total books found (aggregate count): " << total.bookCount << "\n";
-    out << "Number of 5-star books: " << total.fiveStarBooks << "\n";
-    out << "Average price: " << "£" << avgPrice << "\n";
-    out << "Books with price greater than 50 pounds: " << total.priceOver50 << "\n";
-    out << "Books containing 'Poem' keyword: " << total.containsPoem << "\n";
-    out << "Most expensive book: " << total.maxPriceTitle
-        << " (£" << total.maxPrice << ")\n";
-
-    return { pages, seconds, throughput, total };
-}
+// console summary and consistency check of a parallel and a serial run over the same pages
+static void printComparison(const std::string& name, const Result& parallel, const Result& serial, int threads) {
+    std::cout << "\nParallel " << name << " completed. Pages: " << parallel.pages
+        << ", elapsed: " << parallel.seconds
+        << " s, throughput: " << parallel.throughput << " pages/s\n";
+
+    std::cout << "\nSerial completed. Pages: " << serial.pages
+        << ", elapsed: " << serial.seconds
+        << " s, throughput: " << serial.throughput << " pages/s\n";
+
+    if (parallel.result.bookCount != serial.result.bookCount ||
+        parallel.result.fiveStarBooks != serial.result.fiveStarBooks ||
+        parallel.result.containsPoem != serial.result.containsPoem ||
+        std::abs(parallel.result.totalPrice - serial.result.totalPrice) > 1e-6 ||
+        parallel.result.priceOver50 != serial.result.priceOver50)
+    {
+        std::cerr << "[main] Warning: Results differ between " << name << " and serial!\n";
+    }
+    else {
+        std::cout << "[main] Results are consistent (" << name << " == serial).\n";
+    }
 
-// ------------------ Parallel pipeline run -------------------
-Result runPipeline(const std::vector<std::string>& urls,
-    Downloader& downloader,
-    Analyzer& analyzer,
-    Storage& storage,
-    std::ostream& out,
-    size_t maxTokens)
-{
-    auto start = std::chrono::steady_clock::now();
-
-#pragma intel advisor begin ParallelPipeline
-
-    tbb::parallel_pipeline(
-        maxTokens,
-        tbb::make_filter<void, std::string>(
-            tbb::filter_mode::serial_in_order,
-            [&urls](tbb::flow_control& fc) -> std::string {
-                static size_t idx = 0;
-                if (idx >= urls.size()) {
-                    fc.stop();
-                    return {};
-                }
-                return urls[idx++];
-            })
-        &
-        tbb::make_filter<std::string, std::string>(
-            tbb::filter_mode::parallel,
-            [&downloader](const std::string& url) -> std::string {
-                return downloader.downloadPage(url);
-            })
-        &
-        tbb::make_filter<std::string, std::pair<std::vector<BookRecord>, AnalysisResult>>(
-            tbb::filter_mode::parallel,
-            [&analyzer](const std::string& page) {
-                if (page.empty())
-                    return std::pair<std::vector<BookRecord>, AnalysisResult>{};
-                return analyzer.parsePageRecords(page);
-            })
-        &
-        tbb::make_filter<std::pair<std::vector<BookRecord>, AnalysisResult>, void>(
-            tbb::filter_mode::parallel,
-            [&storage](const auto& pr) {
-                if (pr.first.empty() && pr.second.bookCount == 0) return;
-                storage.storeResult(pr.second);
-                storage.storeRecords(pr.first);
-                storage.incrementPagesProcessed();
-            })
-    );
-
-#pragma intel advisor end ParallelPipeline
-
-    auto end = std::chrono::steady_clock::now();
-    double seconds = std::chrono::duration<double>(end - start).count();
-    int pages = storage.pagesProcessed();
-
-    AnalysisResult total = storage.getAggregatedResult();
-    double avgPrice = (total.bookCount ? total.totalPrice / total.bookCount : 0.0);
-    double throughput = (seconds > 0.0 ? pages / seconds : pages);
-
-    out << "Parallel Pipeline Results\n";
-    out << "============================\n";
-    out << "Pages downloaded: " << pages << "\n";
-    out << "Unique URLs (visited): " << urls.size() << "\n";
-    out << "Elapsed time (s): " << seconds << "\n";
-    out << "Throughput (pages/sec): " << throughput << " pages/s\n\n";
-    out << "Analysis summary (aggregated):\n";
-    out << "Total books found (aggregate count): " << total.bookCount << "\n";
-    out << "Number of 5-star books: " << total.fiveStarBooks << "\n";
-    out << "Average price: " << "£" << avgPrice << "\n";
-    out << "Books with price greater than 50 pounds: " << total.priceOver50 << "\n";
-    out << "Books containing 'Poem' keyword: " << total.containsPoem << "\n";
-    out << "Most expensive book: " << total.maxPriceTitle
-        << " (£" << total.maxPrice << ")\n";
-
-    return { pages, seconds, throughput, total };
+    double speedup = serial.seconds / (parallel.seconds > 0 ? parallel.seconds : 1);
+    double efficiency = (threads > 0 ? speedup / threads : speedup);
+
+    std::cout << "\nPerformance summary:\n";
+    std::cout << "----------------------\n";
+    std::cout << "Speedup: " << speedup << "x\n";
+    if (threads > 0) {
+        std::cout << "Efficiency: " << (efficiency * 100.0) << "% (relative to " << threads << " threads)\n";
+    }
 }
 
 // ------------------ Main -------------------
@@ -165,48 +71,411 @@ int main(int argc, char** argv) {
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
     int threads = 0;
+    int inFlight = 256;
+    int ioThreads = 0;   // 0 = twice the cores
+    int maxBuffered = 0; // 0 = four pages per CPU thread
+    bool http2 = false;
+    bool compressed = true;
+    bool streamParse = false;
+    double memoryMb = 0.0; // pipeline memory budget, 0 = only measured
+    double highWater = 0.9;
+    double lowWater = 0.7;
+    size_t maxPageKb = 0; // per-page body cap, 0 = none
+    size_t parseCacheEntries = 0; // 0 = every page is parsed
+    size_t parseCacheMb = 64;
+    std::vector<VolatileRegion> volatileRegions;
+    std::vector<QuerySpec> queries;
+    bool internTitles = false;
+    bool adaptive = false;
+    double metricsInterval = 0.0; // seconds, 0 = no periodic export
+    std::string metricsProm = "metrics.prom";
+    std::string metricsJson = "metrics.jsonl";
+    std::string exportCsv = "books.csv";
+    std::string exportColumnar;  // books.col with --export columnar|both
+    bool streamExport = false;
+    std::string cacheDir;
+    size_t cacheMb = 256;
+    std::string archiveDir; // --archive: keep the pipeline's raw responses
+    std::string replayDir;  // --replay: analyze an archive instead of downloading
     bool doCrawl = false;
-    int pagesCrawl = 0;
+    int pagesCrawl = 0;   // page budget, 0 = unlimited
+    int crawlDepth = -1;  // -1 = unlimited
+    std::string crawlScope;
+    std::string checkpointDir;
+    bool resume = false;
+    int checkpointMs = 1000;
+    DedupeMode dedupe = DedupeMode::Exact;
+    size_t expectedUrls = 1 << 12;
+    double bloomFpr = 0.001;
+    HostLimit hostLimit;
+    std::vector<std::pair<std::string, HostLimit>> hostLimits;
     for (int i = 1; i < argc; ++i) {
         std::string a(argv[i]);
         if ((a == "-t" || a == "--threads") && i + 1 < argc) {
             threads = std::stoi(argv[++i]);
         }
+        if ((a == "-i" || a == "--inflight") && i + 1 < argc) {
+            inFlight = std::stoi(argv[++i]);
+        }
+        if (a == "--io-threads" && i + 1 < argc) {
+            ioThreads = std::stoi(argv[++i]);
+        }
+        if (a == "--max-buffered" && i + 1 < argc) {
+            maxBuffered = std::stoi(argv[++i]);
+        }
+        if (a == "--http2") {
+            http2 = true;
+        }
+        if (a == "--no-compress") {
+            compressed = false;
+        }
+        if (a == "--memory-mb" && i + 1 < argc) {
+            memoryMb = std::stod(argv[++i]);
+        }
+        if (a == "--high-water" && i + 1 < argc) { // fractions of --memory-mb
+            highWater = std::stod(argv[++i]);
+        }
+        if (a == "--low-water" && i + 1 < argc) {
+            lowWater = std::stod(argv[++i]);
+        }
+        if (a == "--max-page-kb" && i + 1 < argc) {
+            maxPageKb = std::stoul(argv[++i]);
+        }
+        if (a == "--parse-cache" && i + 1 < argc) {
+            parseCacheEntries = std::stoul(argv[++i]);
+        }
+        if (a == "--parse-cache-mb" && i + 1 < argc) {
+            parseCacheMb = std::stoul(argv[++i]);
+        }
+        if (a == "--volatile" && i + 2 < argc) { // BEGIN END, left out of the parse cache key
+            VolatileRegion region;
+            region.begin = argv[++i];
+            region.end = argv[++i];
+            volatileRegions.push_back(std::move(region));
+        }
+        if (a == "--query" && i + 1 < argc) { // see QuerySpec, e.g. hist:price:0:60:12@rating
+            QuerySpec query;
+            std::string error;
+            if (QuerySpec::parse(argv[++i], query, error)) queries.push_back(std::move(query));
+            else LOG_ERROR("main", "--query {}: {}", argv[i], error);
+        }
+        if (a == "--stream-parse") {
+            streamParse = true;
+        }
+        if (a == "--intern-titles") {
+            internTitles = true;
+        }
+        if (a == "--log-level" && i + 1 < argc) { // trace, debug, info (default), warn, error, off
+            LogLevel level;
+            if (parseLogLevel(argv[++i], level)) Logger::instance().setLevel(level);
+            else LOG_ERROR("main", "unknown --log-level: {}", argv[i]);
+        }
+        if (a == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::stod(argv[++i]);
+        }
+        if (a == "--metrics-prom" && i + 1 < argc) {
+            metricsProm = argv[++i];
+        }
+        if (a == "--metrics-json" && i + 1 < argc) {
+            metricsJson = argv[++i];
+        }
+        if (a == "--export" && i + 1 < argc) { // csv, columnar or both
+            std::string format(argv[++i]);
+            exportCsv = format == "columnar" ? "" : "books.csv";
+            exportColumnar = format == "csv" ? "" : "books.col";
+        }
+        if (a == "--stream-export") {
+            streamExport = true;
+        }
+        if (a == "--adaptive") {
+            adaptive = true;
+        }
+        if (a == "--cache" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        }
+        if (a == "--cache-mb" && i + 1 < argc) {
+            cacheMb = std::stoul(argv[++i]);
+        }
+        if (a == "--archive" && i + 1 < argc) {
+            archiveDir = argv[++i];
+        }
+        if (a == "--replay" && i + 1 < argc) {
+            replayDir = argv[++i];
+        }
         if ((a == "-c" || a == "--crawl") && i + 1 < argc) {
             doCrawl = true;
             pagesCrawl = std::stoi(argv[++i]);
         }
+        if (a == "--depth" && i + 1 < argc) {
+            crawlDepth = std::stoi(argv[++i]);
+        }
+        if (a == "--scope" && i + 1 < argc) {
+            crawlScope = argv[++i];
+        }
+        if (a == "--checkpoint" && i + 1 < argc) {
+            checkpointDir = argv[++i];
+        }
+        if (a == "--resume") {
+            resume = true;
+        }
+        if (a == "--checkpoint-ms" && i + 1 < argc) {
+            checkpointMs = std::stoi(argv[++i]);
+        }
+        if (a == "--dedupe" && i + 1 < argc) {
+            dedupe = std::string(argv[++i]) == "bloom" ? DedupeMode::Bloom : DedupeMode::Exact;
+        }
+        if (a == "--expected-urls" && i + 1 < argc) {
+            expectedUrls = std::stoul(argv[++i]);
+        }
+        if (a == "--bloom-fpr" && i + 1 < argc) {
+            bloomFpr = std::stod(argv[++i]);
+        }
+        if (a == "--host-rate" && i + 1 < argc) {
+            hostLimit.rate = std::stod(argv[++i]);
+        }
+        if (a == "--host-burst" && i + 1 < argc) {
+            hostLimit.burst = std::stod(argv[++i]);
+        }
+        if (a == "--host-limit" && i + 1 < argc) { // host=rate[/burst]
+            std::string spec(argv[++i]);
+            size_t eq = spec.find('=');
+            if (eq == std::string::npos) {
+                LOG_ERROR("main", "--host-limit expects host=rate[/burst]: {}", spec);
+                continue;
+            }
+            HostLimit limit = hostLimit;
+            size_t slash = spec.find('/', eq);
+            limit.rate = std::stod(spec.substr(eq + 1, slash == std::string::npos ? std::string::npos : slash - eq - 1));
+            if (slash != std::string::npos) limit.burst = std::stod(spec.substr(slash + 1));
+            hostLimits.emplace_back(spec.substr(0, eq), limit);
+        }
+    }
+
+    UrlManager urlManager(dedupe, expectedUrls, bloomFpr);
+    Analyzer analyzer;
+    Storage storage(internTitles);
+    // --query answers analytics over the pipeline's records as they are stored, in bounded
+    // memory; restored checkpoint pages are included
+    std::unique_ptr<AnalyticsEngine> analytics;
+    if (!queries.empty()) {
+        analytics.reset(new AnalyticsEngine(queries));
+        storage.setAnalytics(analytics.get());
+    }
+    // --parse-cache N memoizes up to N pages by content, so repeated pages (and the serial
+    // pass over what the pipeline parsed) are not parsed again; --stream-parse bypasses it
+    std::unique_ptr<ParseCache> parseCache;
+    if (parseCacheEntries > 0) {
+        parseCache.reset(new ParseCache(parseCacheEntries, parseCacheMb * 1024 * 1024));
+        parseCache->setVolatileRegions(volatileRegions);
+        analyzer.setCache(parseCache.get());
+    }
+
+    // pages in flight and results queued for the exporter and checkpoint are charged to it;
+    // with --memory-mb downloads pause above the high-water mark until the low one is reached
+    MemoryBudget budget(static_cast<size_t>(std::max(memoryMb, 0.0) * 1024 * 1024), highWater, lowWater);
+    if (budget.limit()) {
+        LOG_INFO("main", "Memory budget: {} MB (high/low water {}/{} bytes)", memoryMb,
+            budget.highWater(), budget.lowWater());
+    }
+
+    // --replay DIR analyzes the pages of an --archive instead of downloading them: the same
+    // dataset on every run, parsed in parallel (-t threads) and then serially
+    if (!replayDir.empty()) {
+        ArchiveReader reader;
+        if (!reader.open(replayDir)) return 1;
+        int replayThreads = threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        tbb::global_control gc(tbb::global_control::max_allowed_parallelism, replayThreads);
+        LOG_INFO("main", "Replaying {} pages from {} on {} threads.", reader.size(), replayDir, replayThreads);
+
+        std::ofstream out("results.txt");
+        Result parallel = runReplay(reader, analyzer, storage, out, true);
+        AnalyticsState replayAnalytics;
+        if (analytics) {
+            replayAnalytics = analytics->result();
+            storage.setAnalytics(nullptr); // the serial replay stores the same records again
+        }
+        ExportStats exportStats = exportRecords(storage.recordsView(), exportCsv, exportColumnar);
+        storage.reset();
+        Result serial = runReplay(reader, analyzer, storage, out, false);
+
+        out << "\nRecord export (parallel replay):\n";
+        out << "Rows: " << exportStats.rows << " in " << exportStats.batches << " batches";
+        if (!exportCsv.empty()) out << ", " << exportCsv << ": " << exportStats.csvBytes << " bytes";
+        if (!exportColumnar.empty()) out << ", " << exportColumnar << ": " << exportStats.columnarBytes << " bytes";
+        out << "\n";
+        if (analytics) {
+            out << "\nAnalytics (parallel replay records, " << queries.size() << " queries):\n";
+            replayAnalytics.write(out, queries);
+        }
+        if (parseCache) {
+            ParseCacheStats ps = parseCache->stats();
+            out << "\nParse cache hits/misses: " << ps.hits << "/" << ps.misses << "\n";
+        }
+        out.close();
+
+        Logger::instance().flush();
+        printComparison("replay", parallel, serial, threads);
+        curl_global_cleanup();
+        return 0;
     }
 
-    UrlManager urlManager;
+    // --checkpoint DIR logs the crawl as it goes; with --resume the completed pages are put
+    // back into storage and the pages left pending are fetched instead of starting over
+    std::unique_ptr<CrawlCheckpoint> checkpoint;
+    CrawlCheckpoint::Restored restored;
+    if (resume && checkpointDir.empty()) LOG_ERROR("main", "--resume needs --checkpoint DIR");
+    if (!checkpointDir.empty()) {
+        checkpoint.reset(new CrawlCheckpoint(checkpointDir, std::chrono::milliseconds(checkpointMs)));
+        checkpoint->setBudget(&budget);
+        bool ready = resume ? checkpoint->resume(urlManager, storage, restored) : checkpoint->create();
+        if (!ready) return 1;
+        if (resume) {
+            LOG_INFO("main", "Resumed from {}: {} pages ({} records) done, {} pending.", checkpointDir,
+                restored.pages, restored.records, restored.pending.size());
+        }
+    }
+    size_t restoredUrls = urlManager.getUrlsSnapshot().size();
+
     size_t loaded = urlManager.loadFromFile("urls.txt");
-    if (loaded == 0) {
+    if (loaded == 0 && restored.pending.empty()) {
         std::cout << "No urls.txt or file empty. You can enter URLs manually.\n";
         urlManager.loadFromConsole();
     }
 
-    Downloader downloader(10, 3);
-    Analyzer analyzer;
-    Storage storage;
-
-    if (doCrawl) {
-        std::cout << "[main] Crawling catalogue pages...\n";
-        int pagesNumber = urlManager.crawlIndex(downloader, "https://books.toscrape.com/catalogue/", pagesCrawl);
-        std::cout << "[main] Crawl found " << pagesNumber << " catalogue pages.\n";
+    Downloader downloader(10, 3, http2, compressed);
+    if (compressed) LOG_INFO("main", "Accept-Encoding: {}", Downloader::acceptedEncodings());
+    downloader.setMaxPageBytes(static_cast<uint64_t>(maxPageKb) * 1024);
+    downloader.hostScheduler().setDefaultLimit(hostLimit);
+    for (const auto& hl : hostLimits) downloader.hostScheduler().setLimit(hl.first, hl.second);
+    std::unique_ptr<ResponseCache> cache;
+    if (!cacheDir.empty()) {
+        cache.reset(new ResponseCache(cacheDir, cacheMb * 1024 * 1024));
+        downloader.setCache(cache.get());
+        LOG_INFO("main", "Response cache: {} ({} entries)", cacheDir, cache->entries());
     }
+    if (doCrawl) urlManager.addUrl("https://books.toscrape.com/catalogue/page-1.html");
 
-    auto urls = urlManager.getUrlsSnapshot();
-    if (urls.empty()) {
+    // URLs known from the checkpoint are either stored or pending already
+    auto known = urlManager.getUrlsSnapshot();
+    std::vector<std::string> seeds(known.begin() + restoredUrls, known.end());
+    if (seeds.empty() && restored.pending.empty()) {
         std::cerr << "No URLs to process.\n";
         return 1;
     }
 
-    std::unique_ptr<tbb::global_control> gc;
-    if (threads > 0) {
-        gc.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, threads));
-        std::cout << "[main] Using " << threads << " threads.\n";
+    // without --crawl only the seeds are fetched; with it, links are followed within
+    // the scope (by default the directory of the first seed)
+    if (doCrawl && crawlScope.empty()) crawlScope = known.front().substr(0, known.front().rfind('/') + 1);
+    CrawlFrontier frontier(urlManager, doCrawl ? crawlDepth : 0,
+        doCrawl ? static_cast<size_t>(std::max(pagesCrawl, 0)) : 0, crawlScope);
+    frontier.restore(restored.pending, restored.pages);
+    if (checkpoint) frontier.setAdmitObserver([&](const CrawlFrontier::Item& item) { checkpoint->admitted(item); });
+    frontier.seed(seeds);
+    if (doCrawl) {
+        LOG_INFO("main", "Crawling {} (depth {}, budget {} pages)", crawlScope,
+            crawlDepth < 0 ? std::string("unlimited") : std::to_string(crawlDepth),
+            pagesCrawl > 0 ? std::to_string(pagesCrawl) : std::string("unlimited"));
+    }
+
+    // -t sizes the CPU arena (parsing, storage), --io-threads the oversubscribed I/O arena
+    // (completions, link extraction); the global limit only has to leave room for both
+    ExecutionDomains domains;
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    domains.cpuThreads = threads > 0 ? threads : cores;
+    domains.ioThreads = ioThreads > 0 ? ioThreads : 2 * cores;
+    domains.maxBuffered = maxBuffered > 0 ? static_cast<size_t>(maxBuffered) : 4 * static_cast<size_t>(domains.cpuThreads);
+    tbb::global_control gc(tbb::global_control::max_allowed_parallelism, domains.cpuThreads + domains.ioThreads);
+    LOG_INFO("main", "CPU arena: {} threads, I/O arena: {} threads, buffer: {} pages.",
+        domains.cpuThreads, domains.ioThreads, domains.maxBuffered);
+    // --archive DIR writes every page the pipeline downloads to a WARC archive for --replay;
+    // with --resume the pages are added to the archive of the interrupted run. Created after
+    // the global limit, since its writer arena asks for workers when it is set up
+    std::unique_ptr<PageArchive> archive;
+    if (!archiveDir.empty()) {
+        archive.reset(new PageArchive(archiveDir));
+        archive->setBudget(&budget);
+        if (!archive->open(!resume)) return 1;
+        downloader.setArchive(archive.get());
+        LOG_INFO("main", "Archiving pages to {}", archiveDir);
+    }
+
+    // Parallel run (pipeline); discovers the full URL list while it runs
+    LOG_INFO("main", "Starting parallel pipeline run...");
+    std::ostringstream pipelineOut;
+    size_t maxInFlight = inFlight > 0 ? inFlight : 1;
+    std::unique_ptr<ConcurrencyController> controller;
+    if (adaptive) { // --inflight becomes the upper bound
+        ConcurrencyController::Options co;
+        co.initial = std::min<size_t>(16, maxInFlight);
+        co.minLimit = std::min<size_t>(2, maxInFlight);
+        co.maxLimit = maxInFlight;
+        co.backlogHigh = domains.maxBuffered / 2; // stop growing before the buffer blocks downloads
+        controller.reset(new ConcurrencyController(co));
+    }
+    // always recorded for the pipeline run; exported while it runs with --metrics-interval
+    Metrics metrics;
+    downloader.setMetrics(&metrics);
+    std::unique_ptr<MetricsExporter> exporter;
+    if (metricsInterval > 0.0) {
+        exporter.reset(new MetricsExporter(metrics,
+            std::chrono::milliseconds(static_cast<long long>(metricsInterval * 1000)), metricsProm, metricsJson));
+    }
+    // --stream-export writes the records as pages are stored, otherwise they are exported
+    // once the pipeline is done; either way the pipeline's records, not the serial run's
+    std::unique_ptr<RecordExporter> recordExporter;
+    if (streamExport) {
+        recordExporter.reset(new RecordExporter(exportCsv, exportColumnar));
+        recordExporter->setBudget(&budget);
+        if (!recordExporter->open()) recordExporter.reset();
+        else recordExporter->append(storage.recordsView()); // restored from a checkpoint
+    }
+    Result parallel = runPipeline(frontier, downloader, analyzer, storage, pipelineOut,
+        domains, maxInFlight, streamParse, controller.get(), &metrics, checkpoint.get(), recordExporter.get(), &budget);
+    exporter.reset(); // final snapshot
+    downloader.setMetrics(nullptr);
+    ArchiveStats archiveStats;
+    if (archive) {
+        downloader.setArchive(nullptr); // the serial run fetches the same pages again
+        archive->flush();
+        archiveStats = archive->stats();
+    }
+    MetricsSnapshot pipelineMetrics = metrics.snapshot();
+    AnalyticsState pipelineAnalytics;
+    size_t analyticsPartialBytes = 0;
+    if (analytics) {
+        pipelineAnalytics = analytics->result();
+        analyticsPartialBytes = analytics->partialBytes();
+        storage.setAnalytics(nullptr); // the serial run stores the same records again
+    }
+    ParseCacheStats pipelineParses;
+    if (parseCache) pipelineParses = parseCache->stats();
+    if (controller) {
+        std::ofstream trace("concurrency_trace.csv");
+        controller->writeTrace(trace);
+    }
+    ExportStats exportStats;
+    auto exportStart = std::chrono::steady_clock::now();
+    if (recordExporter) {
+        recordExporter->close();
+        exportStats = recordExporter->stats();
+    }
+    else if (!streamExport) {
+        exportStats = exportRecords(storage.recordsView(), exportCsv, exportColumnar);
+    }
+    double exportSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - exportStart).count();
+
+    CheckpointStats checkpointStats;
+    if (checkpoint) {
+        frontier.setAdmitObserver(nullptr);
+        checkpoint->flush();
+        checkpointStats = checkpoint->stats();
+        checkpoint.reset(); // compacts frontier.log into a final frontier.snap
+    }
+    if (doCrawl) {
+        LOG_INFO("main", "Crawl admitted {} pages from {} host(s).", frontier.admitted(), frontier.hosts());
     }
 
+    auto urls = urlManager.getUrlsSnapshot();
     std::ofstream out("results.txt");
 
     out << "Processed URLs:\n";
@@ -214,65 +483,152 @@ int main(int argc, char** argv) {
         out << u << "\n";
     }
     out << "\n============================\n\n";
-
-    // Parallel run (pipeline)
-    storage.reset();
-    std::cout << "Starting parallel pipeline run...\n";
-    Result parallel = runPipeline(urls, downloader, analyzer, storage, out,
-        threads > 0 ? threads : std::thread::hardware_concurrency());
+    out << pipelineOut.str();
 
     // Serial run
     storage.reset();
-    std::cout << "Starting serial run...\n";
-    Result serial = runSerial(urls, downloader, analyzer, storage, out);
-
-    out.close();
+    LOG_INFO("main", "Starting serial run...");
+    Result serial = runSerial(urls, downloader, analyzer, storage, out, streamParse);
+
+    PoolStats pool = downloader.poolStats();
+    out << "\nConnection pool:\n";
+    out << "Handle pool hits/misses: " << pool.handleHits << "/" << pool.handleMisses << "\n";
+    out << "Connections reused/opened: " << pool.connectionsReused << "/" << pool.connectionsOpened << "\n";
+
+    if (controller) {
+        auto trace = controller->trace();
+        size_t lo = trace.front().limit, hi = lo;
+        for (const auto& p : trace) {
+            lo = std::min(lo, p.limit);
+            hi = std::max(hi, p.limit);
+        }
+        out << "\nAdaptive concurrency (trace in concurrency_trace.csv):\n";
+        out << "Final limit: " << controller->limit() << ", min/max: " << lo << "/" << hi
+            << ", updates: " << trace.size() - 1 << "\n";
+    }
 
-    std::cout << "\nParallel pipeline completed. Pages: " << parallel.pages
-        << ", elapsed: " << parallel.seconds
-        << " s, throughput: " << parallel.throughput << " pages/s\n";
+    out << "\nPipeline metrics (count, p50/p90/p99/max ms):\n";
+    for (size_t h = 0; h < pipelineMetrics.histograms.size(); ++h) {
+        const HistogramSnapshot& hs = pipelineMetrics.histograms[h];
+        if (hs.count == 0) continue;
+        out << metricName(static_cast<Hist>(h)) << ": " << hs.count << ", " << hs.quantile(0.5) / 1000.0
+            << "/" << hs.quantile(0.9) / 1000.0 << "/" << hs.quantile(0.99) / 1000.0 << "/" << hs.max / 1000.0 << "\n";
+    }
+    for (size_t c = 0; c < pipelineMetrics.counters.size(); ++c)
+        out << metricName(static_cast<Counter>(c)) << ": " << pipelineMetrics.counters[c] << "\n";
+
+    uint64_t wire = pipelineMetrics.counters[static_cast<size_t>(Counter::BytesDown)];
+    uint64_t decoded = pipelineMetrics.counters[static_cast<size_t>(Counter::BytesDecoded)];
+    out << "Transfer encoding: " << (compressed ? "compressed" : "identity") << ", wire/decoded bytes: "
+        << wire << "/" << decoded;
+    if (wire > 0) out << " (" << static_cast<double>(decoded) / wire << "x)";
+    out << "\n";
+    // every page passes the link and store stages, only buffered ones the timed parse
+    auto perPage = [&](Counter c, Hist h) {
+        uint64_t n = pipelineMetrics.histograms[static_cast<size_t>(h)].count;
+        return n ? static_cast<double>(pipelineMetrics.counters[static_cast<size_t>(c)]) / n : 0.0;
+    };
+    out << "Heap allocations per page (link/parse/store): " << perPage(Counter::LinkAllocations, Hist::LinkStage)
+        << "/" << perPage(Counter::ParseAllocations, Hist::ParseStage)
+        << "/" << perPage(Counter::StoreAllocations, Hist::LinkStage) << "\n";
+
+    out << "\nPer-host scheduling (requests/delayed/throttled/retried/abandoned):\n";
+    for (const auto& hs : downloader.hostScheduler().stats()) {
+        const HostStats& st = hs.second;
+        out << hs.first << ": " << st.requests << "/" << st.delayed << "/" << st.throttled
+            << "/" << st.retried << "/" << st.abandoned << "\n";
+    }
 
-    std::cout << "\nSerial completed. Pages: " << serial.pages
-        << ", elapsed: " << serial.seconds
-        << " s, throughput: " << serial.throughput << " pages/s\n";
+    out << "\nRecord export (" << (streamExport ? "streamed" : "after the pipeline") << "):\n";
+    out << "Rows: " << exportStats.rows << " in " << exportStats.batches << " batches";
+    if (!exportCsv.empty()) out << ", " << exportCsv << ": " << exportStats.csvBytes << " bytes";
+    if (!exportColumnar.empty()) {
+        out << ", " << exportColumnar << ": " << exportStats.columnarBytes << " bytes in "
+            << exportStats.rowGroups << " row groups";
+    }
+    out << "\n" << (streamExport ? "Final flush (s): " : "Elapsed time (s): ") << exportSeconds << "\n";
 
-    // Export CSV with all books
-    auto allBooks = storage.snapshotRecords();
-    std::ofstream csv("books.csv");
-    csv << "title,price,rating\n";
-    for (auto& b : allBooks) {
-        std::string t = b.title;
-        size_t p = 0;
-        while ((p = t.find('"', p)) != std::string::npos) {
-            t.replace(p, 1, "\"\"");
-            p += 2;
+    if (!checkpointDir.empty()) {
+        out << "\nCheckpoint (" << checkpointDir << "):\n";
+        if (resume) {
+            out << "Resumed: " << restored.pages << " pages, " << restored.records << " records, "
+                << restored.pending.size() << " pending\n";
         }
-        csv << "\"" << t << "\"," << b.price << "," << b.rating << "\n";
+        out << "Logged pages/admissions: " << checkpointStats.pagesLogged << "/" << checkpointStats.admissionsLogged
+            << ", snapshots: " << checkpointStats.snapshots << ", bytes written: " << checkpointStats.bytesWritten << "\n";
     }
-    csv.close();
 
-    if (parallel.result.bookCount != serial.result.bookCount ||
-        parallel.result.fiveStarBooks != serial.result.fiveStarBooks ||
-        parallel.result.containsPoem != serial.result.containsPoem ||
-        std::abs(parallel.result.totalPrice - serial.result.totalPrice) > 1e-6 ||
-        parallel.result.priceOver50 != serial.result.priceOver50)
-    {
-        std::cerr << "[main] Warning: Results differ between pipeline and serial!\n";
+    // taken after the exporter and checkpoint drained, so current should be back at 0
+    MemoryBudgetStats mem = budget.stats();
+    out << "\nMemory budget (pages in flight, queued exports and checkpoint entries):\n";
+    if (mem.limit) {
+        out << "Limit: " << mem.limit << " bytes, high/low water: " << budget.highWater() << "/" << budget.lowWater()
+            << ", throttled " << mem.throttles << " times for " << mem.throttledSeconds << " s\n";
     }
-    else {
-        std::cout << "[main] Results are consistent (pipeline == serial).\n";
+    else out << "Limit: none\n";
+    out << "Peak/current usage (bytes): " << mem.peak << "/" << mem.current << "\n";
+    if (maxPageKb) {
+        out << "Page cap: " << maxPageKb << " KB, pages over it: "
+            << pipelineMetrics.counters[static_cast<size_t>(Counter::OversizePages)] << "\n";
     }
 
-    double speedup = serial.seconds / (parallel.seconds > 0 ? parallel.seconds : 1);
-    double efficiency = (threads > 0 ? speedup / threads : speedup);
+    if (cache) {
+        CacheStats cs = cache->stats();
+        out << "\nResponse cache:\n";
+        out << "Hits (304)/misses: " << cs.hits << "/" << cs.misses
+            << ", revalidations: " << cs.revalidations << "\n";
+        out << "Stored: " << cs.stored << ", evictions: " << cs.evictions
+            << ", bytes not transferred: " << cs.bytesSaved << "\n";
+        out << "On disk: " << cache->entries() << " entries, " << cache->bytesStored() << " bytes\n";
+    }
 
-    std::cout << "\nPerformance summary:\n";
-    std::cout << "----------------------\n";
-    std::cout << "Speedup: " << speedup << "x\n";
-    if (threads > 0) {
-        std::cout << "Efficiency: " << (efficiency * 100.0) << "% (relative to " << threads << " threads)\n";
+    if (archive) {
+        out << "\nPage archive (" << archive->directory() << ", replay with --replay):\n";
+        out << "Records: " << archiveStats.records << ", WARC bytes: " << archiveStats.rawBytes
+            << " written this run, " << archiveStats.storedBytes << " compressed in total";
+        if (archiveStats.failed) out << ", failed: " << archiveStats.failed;
+        out << "\n";
     }
 
+    if (analytics) {
+        out << "\nAnalytics (pipeline records, " << queries.size() << " queries, largest per-thread state "
+            << analyticsPartialBytes << " bytes):\n";
+        pipelineAnalytics.write(out, queries);
+    }
+
+    if (parseCache) {
+        ParseCacheStats ps = parseCache->stats();
+        auto hitRate = [](size_t hits, size_t misses) {
+            return hits + misses ? 100.0 * hits / (hits + misses) : 0.0;
+        };
+        out << "\nParse cache (" << parseCacheEntries << " entries, " << parseCacheMb << " MB, "
+            << volatileRegions.size() << " volatile regions):\n";
+        out << "Pipeline hits/misses: " << pipelineParses.hits << "/" << pipelineParses.misses
+            << " (" << hitRate(pipelineParses.hits, pipelineParses.misses) << "%)\n";
+        out << "Serial hits/misses: " << ps.hits - pipelineParses.hits << "/" << ps.misses - pipelineParses.misses
+            << " (" << hitRate(ps.hits - pipelineParses.hits, ps.misses - pipelineParses.misses) << "%)\n";
+        out << "Held: " << ps.entries << " pages, " << ps.bytes << " bytes, evictions: " << ps.evictions << "\n";
+    }
+
+    out << "\nURL dedupe (" << (urlManager.dedupeMode() == DedupeMode::Bloom ? "bloom" : "exact") << "):\n";
+    out << "Unique URLs: " << urlManager.uniqueCount() << ", visited set: "
+        << urlManager.dedupeMemoryBytes() << " bytes\n";
+
+    const RecordStore& store = storage.recordsView();
+    RecordStats rs = store.stats();
+    out << "\nRecord store (serial run):\n";
+    out << "Records: " << rs.count << ", five star: " << rs.fiveStar
+        << ", over 50: " << rs.priceOver50 << ", total price: " << rs.totalPrice << "\n";
+    out << "Memory: " << store.memoryBytes() << " bytes";
+    if (rs.count > 0) out << " (" << store.memoryBytes() / rs.count << " bytes/record)";
+    if (internTitles) out << ", distinct titles: " << store.internedTitles();
+    out << "\n";
+
+    out.close();
+
+    Logger::instance().flush(); // the summary comes after everything logged so far
+    printComparison("pipeline", parallel, serial, threads);
+
     curl_global_cleanup();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+# Project: Parallel Web Scraper
+# Generates HtmlEntityTable.hpp: every HTML5 named character reference (the ';'-terminated
+# ones from Python's html.entities.html5) plus a hash-and-displace perfect hash over them.
+#
+#   python tools/gen_html_entities.py      (rewrites ../HtmlEntityTable.hpp)
+#
+# The hash must stay in sync with entityHash() in the generated header.
+
+import html.entities
+import pathlib
+
+SLOT_BITS = 12          # 4096 slots for ~2100 names
+BUCKET_BITS = 10        # 1024 displacement buckets
+EMPTY = 0xFFFF
+
+# The scraper has always folded these to ASCII so titles stay plain in books.csv.
+ASCII_OVERRIDES = {
+    "nbsp": " ",
+    "rsquo": "'",
+    "ldquo": "\"",
+    "rdquo": "\"",
+}
+
+
+def entity_hash(name: bytes, seed: int) -> int:
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for b in name:
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    return h
+
+
+def c_string(data: bytes) -> str:
+    out = []
+    escaped = False
+    for b in data:
+        ch = chr(b)
+        if b in (0x22, 0x5C) or b < 0x20 or b >= 0x7F:
+            out.append("\\x%02X" % b)
+            escaped = True
+            continue
+        if escaped and ch in "0123456789abcdefABCDEF":
+            out.append("\"\"")  # keep the hex escape from swallowing this character
+        out.append(ch)
+        escaped = False
+    return "\"" + "".join(out) + "\""
+
+
+def main():
+    entities = []
+    for key, value in sorted(html.entities.html5.items()):
+        if not key.endswith(";"):
+            continue
+        name = key[:-1]
+        value = ASCII_OVERRIDES.get(name, value)
+        entities.append((name.encode("ascii"), value.encode("utf-8")))
+
+    slots = 1 << SLOT_BITS
+    buckets = [[] for _ in range(1 << BUCKET_BITS)]
+    for index, (name, _) in enumerate(entities):
+        buckets[entity_hash(name, 0) & ((1 << BUCKET_BITS) - 1)].append(index)
+
+    table = [EMPTY] * slots
+    seeds = [0] * (1 << BUCKET_BITS)
+    for bucket_id in sorted(range(len(buckets)), key=lambda b: -len(buckets[b])):
+        members = buckets[bucket_id]
+        if not members:
+            continue
+        seed = 1
+        while True:
+            positions = [entity_hash(entities[i][0], seed) & (slots - 1) for i in members]
+            if len(set(positions)) == len(positions) and all(table[p] == EMPTY for p in positions):
+                break
+            seed += 1
+        seeds[bucket_id] = seed
+        for i, p in zip(members, positions):
+            table[p] = i
+
+    max_name = max(len(n) for n, _ in entities)
+    lines = []
+
+    def emit(line=""):
+        lines.append(line)
+
+    emit("// Project: Parallel Web Scraper")
+    emit("// Generated by tools/gen_html_entities.py - do not edit by hand.")
+    emit()
+    emit("#pragma once")
+    emit("#include <cstdint>")
+    emit("#include <string_view>")
+    emit()
+    emit("struct HtmlEntity {")
+    emit("    std::string_view name;  // without '&' and ';'")
+    emit("    std::string_view value; // UTF-8")
+    emit("};")
+    emit()
+    emit("constexpr size_t kHtmlEntityCount = %d;" % len(entities))
+    emit("constexpr size_t kHtmlEntityMaxName = %d;" % max_name)
+    emit("constexpr uint32_t kHtmlEntitySlotMask = %d;" % (slots - 1))
+    emit("constexpr uint32_t kHtmlEntityBucketMask = %d;" % ((1 << BUCKET_BITS) - 1))
+    emit("constexpr uint16_t kHtmlEntityEmptySlot = 0x%X;" % EMPTY)
+    emit()
+    emit("constexpr uint32_t entityHash(std::string_view name, uint32_t seed) {")
+    emit("    uint32_t h = 2166136261u ^ seed;")
+    emit("    for (char c : name) {")
+    emit("        h ^= static_cast<uint8_t>(c);")
+    emit("        h *= 16777619u;")
+    emit("    }")
+    emit("    h ^= h >> 16;")
+    emit("    h *= 0x85EBCA6Bu;")
+    emit("    h ^= h >> 13;")
+    emit("    return h;")
+    emit("}")
+    emit()
+    emit("inline constexpr HtmlEntity kHtmlEntities[kHtmlEntityCount] = {")
+    for name, value in entities:
+        emit("    { %s, %s }," % (c_string(name), c_string(value)))
+    emit("};")
+    emit()
+    emit("// displacement seed per bucket of entityHash(name, 0)")
+    emit("inline constexpr uint16_t kHtmlEntitySeeds[kHtmlEntityBucketMask + 1] = {")
+    for i in range(0, len(seeds), 16):
+        emit("    " + ", ".join(str(s) for s in seeds[i:i + 16]) + ",")
+    emit("};")
+    emit()
+    emit("// slot -> index into kHtmlEntities, kHtmlEntityEmptySlot when unused")
+    emit("inline constexpr uint16_t kHtmlEntitySlots[kHtmlEntitySlotMask + 1] = {")
+    for i in range(0, len(table), 16):
+        emit("    " + ", ".join(str(s) for s in table[i:i + 16]) + ",")
+    emit("};")
+    emit()
+    emit("// perfect-hash lookup; nullptr when name is not an HTML5 entity")
+    emit("constexpr const HtmlEntity* findHtmlEntity(std::string_view name) {")
+    emit("    if (name.empty() || name.size() > kHtmlEntityMaxName) return nullptr;")
+    emit("    uint32_t seed = kHtmlEntitySeeds[entityHash(name, 0) & kHtmlEntityBucketMask];")
+    emit("    uint16_t index = kHtmlEntitySlots[entityHash(name, seed) & kHtmlEntitySlotMask];")
+    emit("    if (index == kHtmlEntityEmptySlot || kHtmlEntities[index].name != name) return nullptr;")
+    emit("    return &kHtmlEntities[index];")
+    emit("}")
+    emit()
+    emit("static_assert(findHtmlEntity(\"amp\") != nullptr && findHtmlEntity(\"amp\")->value == \"&\",")
+    emit("    \"entity table and entityHash() are out of sync\");")
+
+    target = pathlib.Path(__file__).resolve().parent.parent / "HtmlEntityTable.hpp"
+    target.write_text("\n".join(lines) + "\n", encoding="utf-8-sig")
+
+
+if __name__ == "__main__":
+    main()
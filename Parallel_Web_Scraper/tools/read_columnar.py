@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# Project: Parallel Web Scraper
+# Reads a columnar export (books.col, see RecordExport.hpp for the layout) through mmap and
+# prints it as CSV, or with --summary only the row count and column statistics.
+#
+#   python tools/read_columnar.py books.col [--summary]
+
+import mmap
+import struct
+import sys
+
+MAGIC = b"PWSCOL1\0"
+
+
+def align(n: int) -> int:
+    return (n + 7) & ~7
+
+
+def read_groups(buf):
+    if buf[:8] != MAGIC or buf[-8:] != MAGIC:
+        raise ValueError("not a columnar export")
+    version, columns = struct.unpack_from("<II", buf, 8)
+    if version != 1:
+        raise ValueError(f"unsupported version {version}")
+    (footer,) = struct.unpack_from("<Q", buf, len(buf) - 16)
+    (groups,) = struct.unpack_from("<Q", buf, footer)
+    for g in range(groups):
+        offset, rows = struct.unpack_from("<QQ", buf, footer + 8 + 16 * g)
+        pos = offset + 8
+        ends = memoryview(buf)[pos:pos + 4 * rows].cast("I")
+        pos = align(pos + 4 * rows)
+        titles = pos
+        pos = align(pos + (ends[-1] if rows else 0))
+        prices = memoryview(buf)[pos:pos + 8 * rows].cast("d")
+        pos += 8 * rows
+        ratings = memoryview(buf)[pos:pos + rows]
+        yield rows, ends, titles, prices, ratings
+
+
+def main() -> int:
+    if len(sys.argv) < 2:
+        print(__doc__ or "usage: read_columnar.py FILE [--summary]", file=sys.stderr)
+        return 2
+    summary = "--summary" in sys.argv[2:]
+    with open(sys.argv[1], "rb") as f:
+        # left open: the column views point into the mapping until the process exits
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        total, price_sum, five = 0, 0.0, 0
+        if not summary:
+            print("title,price,rating")
+        for rows, ends, titles, prices, ratings in read_groups(buf):
+            total += rows
+            price_sum += sum(prices)
+            five += sum(1 for r in ratings if r == 5)
+            if summary:
+                continue
+            start = 0
+            for i in range(rows):
+                title = buf[titles + start:titles + ends[i]].decode("utf-8", "replace")
+                start = ends[i]
+                print('"' + title.replace('"', '""') + f'",{prices[i]!r},{ratings[i]}')
+        if summary:
+            print(f"rows: {total}, total price: {price_sum:.2f}, five star: {five}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())